@@ -37,15 +37,49 @@ const int DEFAULT_TIMEOUT_SECS = 30; // ref.: QNetworkConfigurationPrivate::Defa
 const int DEFAULT_CONCURRENT_FRAGMENTS = 20;
 
 const int MAX_CONNECTION_SEGMENTS = 10;
+const qsizetype MIN_CONNECTION_SEGMENT_SIZE = 1024 * 1024; ///< Don't split files smaller than 2 x 1 MB.
+const qsizetype ENDGAME_BLOCK_SIZE = 256 * 1024; ///< Smaller ranges are duplicated rather than split.
 
-const std::chrono::milliseconds TIMEOUT_COUNT_DOWN(1000);
-const std::chrono::milliseconds TIMEOUT_INFO(150);
+const QLatin1StringView PARTIAL_FILE_SUFFIX(".adlpart"); ///< Not '.part', already used by yt-dlp.
+
+const qint64 READ_BUFFER_SIZE = 2 * 1024 * 1024; ///< Network data kept in each reply while the disk is busy.
+const qsizetype RECEIVE_BUFFER_SIZE = 64 * 1024; ///< Size of the recycled buffers the replies are read into.
+const qint64 WRITE_CHUNK_SIZE = 1024 * 1024; ///< Contiguous writes are coalesced up to 1 MB.
+const int WRITE_CHUNK_BUFFERS = 16; ///< ...i.e. up to 16 receive buffers per write.
+const qint64 WRITE_QUEUE_MAX_SIZE = 64 * 1024 * 1024; ///< Stop reading the network above 64 MB not yet written.
+const qint64 WRITE_QUEUE_RESUME_SIZE = 16 * 1024 * 1024; ///< Read again below 16 MB.
+
+const int MSEC_BANDWIDTH_TICK = 100; ///< Throttled replies are read again every 100 ms.
+const int MSEC_BANDWIDTH_BURST = 250; ///< A token bucket holds 250 ms of data at most.
+const int MSEC_BANDWIDTH_SCHEDULE = 60 * 1000; ///< The schedule is checked every minute.
+
+const std::chrono::milliseconds TIMEOUT_INFO(150); ///< The engine ticks every 150 ms, while items are running.
+const int MSEC_JOBS_CHANGED = 16; ///< The changes are notified once per frame (60 Hz) at most.
 
 const int SELECTION_DISPLAY_LIMIT = 10;
 const int MSEC_SPEED_DISPLAY_TIME = 2000;
+const int MSEC_SPEED_SAMPLE = 100; ///< The speed is sampled every 100 ms at most.
+const int MSEC_SPEED_WINDOW = 1000; ///< The instant speed is measured over the last second.
+const int MSEC_SPEED_HALF_LIFE = 3000; ///< The weight of a smoothed speed sample halves every 3 seconds.
 
 const int MSEC_AUTO_SAVE = 3000; ///< Autosave the queue every 3 seconds.
 
+const int MSEC_TORRENT_STATUS_REFRESH = 500; ///< Default interval of the torrent status polls.
+const int MSEC_TORRENT_REFRESH_MIN = 50; ///< The polls can't be more frequent.
+
+const QLatin1StringView SESSION_JOURNAL_SUFFIX(".journal");
+const QLatin1StringView SESSION_TEMPORARY_SUFFIX(".tmp"); ///< The checkpoint is written aside, then renamed.
+const qint64 SESSION_JOURNAL_MIN_SIZE = 1024 * 1024; ///< Compact the journal above 1 MB, if bigger than the queue.
+const qsizetype SESSION_LOAD_CHUNK = 256; ///< Items created per event loop iteration when loading the queue.
+
+const int LOG_MAX_LINES = 200; ///< Lines of log kept in memory for each download.
+const qsizetype LOG_MAX_LINE_LENGTH = 1024; ///< Longer lines are truncated.
+const int MSEC_LOG_PROGRESS = 1000; ///< One progress line per second at most.
+const qsizetype LOG_SPILL_CHUNK = 4 * 1024; ///< The older lines are written to the log file by chunks of 4 KB.
+const qint64 LOG_FILE_MAX_SIZE = 1024 * 1024; ///< The log file is rotated above 1 MB.
+const QLatin1StringView LOG_FILE_SUFFIX(".log");
+const QLatin1StringView LOG_DIRECTORY_NAME("logs");
+
 /*
  * Remark:
  * Characters '<' and '>' are unlikely to be used as value for data or directory path.
@@ -108,6 +142,8 @@ const QLatin1StringView FLATSUBDIRS("*flatsubdirs*");
 const QLatin1StringView QSTRING("*qstring*");
 
 const int MSEC_MESSAGE_TIMEOUT = 2000;
+const qsizetype MAX_CONTROL_MESSAGE_SIZE = 16 * 1024 * 1024; ///< bytes of a control request line
+const qsizetype MAX_CONTROL_PENDING_SIZE = 4 * 1024 * 1024; ///< bytes not yet sent to a control client
 
 const int DEFAULT_ICON_SIZE = 32;
 const int ICON_SIZE = 16;
@@ -192,6 +228,10 @@ const QLatin1StringView REGISTRY_STREAM_SHORTCUT  ("StreamShortcutEnabled");
 
 // Tab Network
 const QLatin1StringView REGISTRY_MAX_SIMULTANEOUS ("MaxSimultaneous");
+const QLatin1StringView REGISTRY_MAX_PER_HOST     ("MaxSimultaneousPerHost");
+const QLatin1StringView REGISTRY_LIMIT_PER_DOMAIN ("MaxSimultaneousPerDomainEnabled");
+const QLatin1StringView REGISTRY_DOWNLOAD_LIMIT   ("DownloadLimit");
+const QLatin1StringView REGISTRY_LIMIT_SCHEDULE   ("DownloadLimitSchedule");
 const QLatin1StringView REGISTRY_CONCURRENT_FRAG  ("ConcurrentFragments");
 const QLatin1StringView REGISTRY_CUSTOM_BATCH     ("CustomBatchEnabled");
 const QLatin1StringView REGISTRY_CUSTOM_BATCH_BL  ("CustomBatchButtonLabel");
@@ -204,6 +244,7 @@ const QLatin1StringView REGISTRY_REMOVE_COMPLETED ("PrivacyRemoveCompleted");
 const QLatin1StringView REGISTRY_REMOVE_CANCELED  ("PrivacyRemoveCanceled");
 const QLatin1StringView REGISTRY_REMOVE_PAUSED    ("PrivacyRemovePaused");
 const QLatin1StringView REGISTRY_DATABASE         ("Database");
+const QLatin1StringView REGISTRY_LOG_FILE         ("LogFileEnabled");
 const QLatin1StringView REGISTRY_HTTP_USER_AGENT  ("HttpUserAgent");
 const QLatin1StringView REGISTRY_HTTP_REFERRER_ON ("HttpReferringPageEnabled");
 const QLatin1StringView REGISTRY_HTTP_REFERRER    ("HttpReferringPage");
@@ -219,6 +260,8 @@ const QLatin1StringView REGISTRY_TORRENT_SHARED   ("TorrentShareFolderEnabled");
 const QLatin1StringView REGISTRY_TORRENT_DIR      ("TorrentShareFolder");
 const QLatin1StringView REGISTRY_TORRENT_PEERS    ("TorrentPeerList");
 const QLatin1StringView REGISTRY_TORRENT_ADVANCED ("TorrentAdvanced");
+const QLatin1StringView REGISTRY_TORRENT_STATUS_REFRESH ("TorrentStatusRefresh");
+const QLatin1StringView REGISTRY_TORRENT_DEBUG_ALERTS   ("TorrentDebugAlerts");
 
 // Tab Advanced
 const QLatin1StringView REGISTRY_CHECK_UPDATE     ("CheckUpdate");
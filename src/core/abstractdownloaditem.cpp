@@ -18,10 +18,8 @@
 
 #include <Constants>
 
-#include <QtCore/QDateTime>
 #include <QtCore/QDebug>
 #include <QtCore/QtMath>
-#include <QtCore/QTimer>
 
 /*!
  * \class AbstractDownloadItem
@@ -36,11 +34,7 @@
  * \brief Constructor
  */
 AbstractDownloadItem::AbstractDownloadItem(QObject *parent) : QObject(parent)
-    , m_updateInfoTimer(new QTimer(this))
-    , m_updateCountDownTimer(new QTimer(this))
 {
-    connect(m_updateInfoTimer, SIGNAL(timeout()), this, SLOT(updateInfo()));
-    connect(m_updateCountDownTimer, SIGNAL(timeout()), this, SLOT(updateInfo()));
 }
 
 /******************************************************************************
@@ -60,7 +54,12 @@ void AbstractDownloadItem::setState(State state)
 
 QString AbstractDownloadItem::stateToString() const
 {
-    switch (m_state) {
+    return stateToString(m_state);
+}
+
+QString AbstractDownloadItem::stateToString(State state)
+{
+    switch (state) {
     case IDownloadItem::Idle:                return tr("Idle");
     case IDownloadItem::Paused:              return tr("Paused");
     case IDownloadItem::Stopped:             return tr("Canceled");
@@ -125,9 +124,34 @@ void AbstractDownloadItem::setBytesTotal(qsizetype bytesTotal)
 
 /******************************************************************************
  ******************************************************************************/
+static inline bool isTransferring(IDownloadItem::State state)
+{
+    return state == IDownloadItem::Downloading || state == IDownloadItem::Endgame;
+}
+
+/*!
+ * \brief Returns the smoothed speed, in bytes per second, or -1 if unknown.
+ * It follows the changes of throughput within a few seconds.
+ */
 qreal AbstractDownloadItem::speed() const
 {
-    return m_state == Downloading ? m_speed : -1;
+    return isTransferring(m_state) ? m_speedEstimator.smoothedRate() : -1;
+}
+
+/*!
+ * \brief Returns the speed over the last second, or -1 if unknown.
+ */
+qreal AbstractDownloadItem::instantSpeed() const
+{
+    return isTransferring(m_state) ? m_speedEstimator.instantRate() : -1;
+}
+
+/*!
+ * \brief Returns the average speed since the download was resumed, or -1 if unknown.
+ */
+qreal AbstractDownloadItem::averageSpeed() const
+{
+    return isTransferring(m_state) ? m_speedEstimator.averageRate() : -1;
 }
 
 int AbstractDownloadItem::progress() const
@@ -187,14 +211,32 @@ void AbstractDownloadItem::setMaxConnections(int connections)
 
 /******************************************************************************
  ******************************************************************************/
-QString AbstractDownloadItem::log() const
+/*!
+ * \brief Returns the maximum speed of this download, in bytes per second,
+ * or 0 if unlimited.
+ */
+qint64 AbstractDownloadItem::speedLimit() const
+{
+    return m_speedLimit;
+}
+
+void AbstractDownloadItem::setSpeedLimit(qint64 bytesPerSecond)
 {
-    return m_log;
+    auto speedLimit = qMax(qint64(0), bytesPerSecond);
+    if (m_speedLimit != speedLimit) {
+        m_speedLimit = speedLimit;
+        emit changed();
+    }
 }
 
-void AbstractDownloadItem::setLog(const QString &log)
+/******************************************************************************
+ ******************************************************************************/
+/*!
+ * \brief Returns the whole log, reading the log file if any.
+ */
+QString AbstractDownloadItem::log() const
 {
-    m_log = log;
+    return m_log.fullText();
 }
 
 /*!
@@ -202,12 +244,34 @@ void AbstractDownloadItem::setLog(const QString &log)
  */
 void AbstractDownloadItem::logInfo(const QString &message)
 {
-    QDateTime local(QDateTime::currentDateTime());
-    auto timestamp = local.toString(QLatin1String("yyyy-MM-dd HH:mm:ss.zzz"));
-    m_log.append("[" + timestamp + "] " + message + "\n");
+    m_log.append(message);
     qInfo() << message;
 }
 
+/*!
+ * \brief Appends the given progress message to the log, at most once per second.
+ */
+void AbstractDownloadItem::logProgress(const QString &message)
+{
+    m_log.appendProgress(message);
+}
+
+/*!
+ * \brief Sets the id of the log file, i.e. the id of the item in the session.
+ */
+void AbstractDownloadItem::setLogId(qint64 id)
+{
+    m_log.setId(id);
+}
+
+/*!
+ * \brief Removes the log file, when the item is removed from the queue.
+ */
+void AbstractDownloadItem::removeLog()
+{
+    m_log.remove();
+}
+
 /******************************************************************************
  ******************************************************************************/
 bool AbstractDownloadItem::isResumable() const
@@ -231,6 +295,7 @@ bool AbstractDownloadItem::isCancelable() const
 {
     return m_state == Idle
             || m_state == Paused
+            || m_state == NetworkError /* discards the partial file */
             || isDownloading()
             || m_state == Completed
             || m_state == Seeding;
@@ -247,7 +312,7 @@ bool AbstractDownloadItem::isDownloading() const
 
 /******************************************************************************
  ******************************************************************************/
-QTime AbstractDownloadItem::remainingTime()
+QTime AbstractDownloadItem::remainingTime() const
 {
     return m_remainingTime;
 }
@@ -260,22 +325,24 @@ void AbstractDownloadItem::setReadyToResume()
     emit changed();
 }
 
+/*!
+ * \brief Pauses the download.
+ * Contrary to stop(), the bytes received so far are kept, to resume later.
+ */
 void AbstractDownloadItem::pause()
 {
-    // TO DO
-    // https://kunalmaemo.blogspot.com/2011/07/simple-download-manager-with-pause.html
-
-    stop();
-
     m_state = Paused;
+    m_speedEstimator.reset();
+
     emit changed();
+    finish();
 }
 
 // cancel?
 void AbstractDownloadItem::stop()
 {
     m_state = Stopped;
-    m_speed = -1;
+    m_speedEstimator.reset();
     m_bytesReceived = 0;
     m_bytesTotal = 0;
 
@@ -291,6 +358,7 @@ void AbstractDownloadItem::beginResume()
     emit changed();
 
     m_downloadElapsedTimer.start();
+    m_speedEstimator.start(0, m_bytesReceived);
 
     /* Ensure the destination directory exists */
     m_state = Preparing;
@@ -313,17 +381,9 @@ bool AbstractDownloadItem::checkResume(bool connected)
 void AbstractDownloadItem::tearDownResume()
 {
     /*
-     * This timer ticks each second, in order to update the remaining time information (countdown)
-     */
-    m_updateCountDownTimer->start(TIMEOUT_COUNT_DOWN);
-
-    /*
-     * This timer updates the speed/progress info.
-     * It can be quicker than the countdown timer.
+     * Start downloading now.
+     * The speed/progress info is updated by the engine's tick, see tick().
      */
-    m_updateInfoTimer->start(TIMEOUT_INFO);
-
-    /* Start downloading now. */
     m_state = Downloading;
     emit changed();
 }
@@ -345,8 +405,6 @@ void AbstractDownloadItem::preFinish(bool commited)
  ******************************************************************************/
 void AbstractDownloadItem::finish()
 {
-    m_updateCountDownTimer->stop();
-    m_updateInfoTimer->stop();
     emit finished();
 }
 
@@ -363,31 +421,39 @@ void AbstractDownloadItem::updateInfo(qsizetype bytesReceived, qsizetype bytesTo
 {
     m_bytesReceived = bytesReceived;
     m_bytesTotal = bytesTotal;
-    auto elapsed = m_downloadElapsedTimer.elapsed();
-    if (elapsed > 0) {
-        m_speed = 1000 * static_cast<qreal>(bytesReceived) / static_cast<qreal>(m_downloadElapsedTimer.elapsed());
-    } else {
-        m_speed = qreal(-1);
+    if (m_downloadElapsedTimer.isValid()) {
+        m_speedEstimator.update(m_downloadElapsedTimer.elapsed(), bytesReceived);
     }
     /*
      * It's very tempting to add 'emit changed();' here, but don't do that.
      *
-     * Indeed, 'emit changed()' informs the GUI of a change, i.e. every 150 msec.
+     * Indeed, the GUI is informed of the progress by the engine's tick, i.e. every 150 msec.
      *
      * But updateInfo(int, int) is called more often by the download engine,
      * typically every time a chunk of data is downloaded.
      */
 }
 
-void AbstractDownloadItem::updateInfo()
+/*!
+ * \brief Updates the speed and the remaining time (countdown).
+ *
+ * Called by the download engine at each tick, for all the running items
+ * at once: the engine then emits a single notification for the batch,
+ * instead of one changed() signal per item.
+ */
+void AbstractDownloadItem::tick()
 {
-    if (m_speed > 0 && m_bytesReceived > 0 && m_bytesTotal > 0) {
-        auto estimatedTime = qCeil(static_cast<qreal>(m_bytesTotal - m_bytesReceived) / m_speed);
+    /* Also samples the stalled downloads, that don't receive data */
+    if (m_downloadElapsedTimer.isValid()) {
+        m_speedEstimator.update(m_downloadElapsedTimer.elapsed(), m_bytesReceived);
+    }
+    auto speed = m_speedEstimator.smoothedRate();
+    if (speed > 0 && m_bytesReceived > 0 && m_bytesTotal > 0) {
+        auto estimatedTime = qCeil(static_cast<qreal>(m_bytesTotal - m_bytesReceived) / speed);
         QTime time(0, 0, 0);
         time = time.addSecs(static_cast<int>(estimatedTime));
         m_remainingTime = time;
     } else {
         m_remainingTime = {};
     }
-    emit changed();
 }
@@ -17,7 +17,9 @@
 #ifndef CORE_ABSTRACT_DOWNLOAD_ITEM_H
 #define CORE_ABSTRACT_DOWNLOAD_ITEM_H
 
+#include <Core/DownloadLog>
 #include <Core/IDownloadItem>
+#include <Core/SpeedEstimator>
 
 #include <QtCore/QElapsedTimer>
 #include <QtCore/QObject>
@@ -25,7 +27,6 @@
 #include <QtCore/QUrl>
 #include <QtCore/QTime>
 
-class QTimer;
 
 class AbstractDownloadItem : public QObject, public IDownloadItem
 {
@@ -38,6 +39,7 @@ public:
     State state() const override;
     void setState(State state);
     QString stateToString() const;
+    static QString stateToString(State state);
     const char* state_c_str() const;
 
     qsizetype bytesReceived() const override;
@@ -47,27 +49,34 @@ public:
     void setBytesTotal(qsizetype bytesTotal);
 
     qreal speed() const override;
+    qreal instantSpeed() const;
+    qreal averageSpeed() const;
     int progress() const override;
 
     QString errorMessage() const;
     void setErrorMessage(const QString &message);
 
     int maxConnectionSegments() const override;
-    void setMaxConnectionSegments(int connectionSegments);
+    virtual void setMaxConnectionSegments(int connectionSegments);
 
     int maxConnections() const override;
     void setMaxConnections(int connections);
 
+    qint64 speedLimit() const;
+    virtual void setSpeedLimit(qint64 bytesPerSecond);
+
     QString log() const override;
-    void setLog(const QString &log);
     void logInfo(const QString &message);
+    void logProgress(const QString &message);
+    void setLogId(qint64 id);
+    void removeLog();
 
     bool isResumable() const override;
     bool isPausable() const override;
     bool isCancelable() const override;
     bool isDownloading() const override;
 
-    QTime remainingTime();
+    QTime remainingTime() const;
 
     void setReadyToResume() override;
 
@@ -81,6 +90,8 @@ public:
 
     void finish();
 
+    void tick();
+
     virtual void rename(const QString &newName);
 
 signals:
@@ -91,13 +102,9 @@ signals:
 public slots:
     void updateInfo(qsizetype bytesReceived, qsizetype bytesTotal);
 
-private slots:
-    void updateInfo();
-
 private:
     State m_state = State::Idle;
 
-    qreal m_speed = -1;
     qsizetype m_bytesReceived = 0;
     qsizetype m_bytesTotal = 0;
 
@@ -105,13 +112,13 @@ private:
 
     int m_maxConnectionSegments = 4;
     int m_maxConnections = 1;
+    qint64 m_speedLimit = 0;
 
-    QString m_log = {};
+    DownloadLog m_log = {};
 
     QElapsedTimer m_downloadElapsedTimer = {};
+    SpeedEstimator m_speedEstimator = {};
     QTime m_remainingTime = {};
-    QTimer* m_updateInfoTimer = nullptr;
-    QTimer* m_updateCountDownTimer = nullptr;
 };
 
 #endif // CORE_ABSTRACT_DOWNLOAD_ITEM_H
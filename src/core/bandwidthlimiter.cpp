@@ -0,0 +1,321 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "bandwidthlimiter.h"
+
+#include <Constants>
+
+#include <QtCore/QRegularExpression>
+#include <QtCore/QStringList>
+#include <QtCore/QTimer>
+
+/*!
+ * \class TokenBucket
+ *
+ * The bucket fills up with rate() tokens per second, up to capacity(),
+ * and each byte read consumes a token. The bucket can be in debt,
+ * if more bytes than tokens had to be read.
+ *
+ * The time is given by the caller, in msecs, so that the buckets
+ * share the same clock.
+ */
+
+TokenBucket::TokenBucket(qint64 rate)
+{
+    setRate(rate);
+}
+
+qint64 TokenBucket::rate() const
+{
+    return m_rate;
+}
+
+void TokenBucket::setRate(qint64 rate)
+{
+    m_rate = qMax(qint64(0), rate);
+    m_tokens = qMin(m_tokens, capacity());
+}
+
+bool TokenBucket::isLimited() const
+{
+    return m_rate > 0;
+}
+
+qint64 TokenBucket::capacity() const
+{
+    return qMax(qint64(1), m_rate * MSEC_BANDWIDTH_BURST / 1000);
+}
+
+qint64 TokenBucket::tokens() const
+{
+    return m_tokens;
+}
+
+/*!
+ * \brief Adds the tokens earned since the previous refill.
+ */
+void TokenBucket::refill(qint64 now)
+{
+    if (m_lastRefill < 0) {
+        m_lastRefill = now;
+        m_tokens = capacity();
+        return;
+    }
+    auto earned = m_rate * (now - m_lastRefill) / 1000;
+    if (earned <= 0) {
+        return; /* Keep the fraction of token for the next refill */
+    }
+    m_tokens += earned;
+    if (m_tokens >= capacity()) {
+        m_tokens = capacity();
+        m_lastRefill = now;
+    } else {
+        m_lastRefill += earned * 1000 / m_rate;
+    }
+}
+
+void TokenBucket::consume(qint64 bytes)
+{
+    if (isLimited()) {
+        m_tokens -= bytes;
+    }
+}
+
+/*!
+ * \brief Gives back the tokens consumed for bytes that were not received.
+ */
+void TokenBucket::refund(qint64 bytes)
+{
+    if (isLimited() && bytes > 0) {
+        m_tokens = qMin(m_tokens + bytes, capacity());
+    }
+}
+
+/******************************************************************************
+ ******************************************************************************/
+/*!
+ * \class BandwidthLimiter
+ *
+ * Each download reads its replies through acquire(), that grants the bytes
+ * allowed by both the global bucket and the bucket of the download.
+ * A throttled download doesn't sleep: it leaves the data in the reply,
+ * whose read buffer is small enough to make the server slow down
+ * (see readBufferSize()), and reads it again when refilled() is emitted.
+ *
+ * The schedule gives another limit for some periods of the day.
+ */
+
+BandwidthLimiter& BandwidthLimiter::getInstance()
+{
+    static BandwidthLimiter instance; // lazy singleton, instantiated on first use
+    return instance;
+}
+
+BandwidthLimiter::BandwidthLimiter() : QObject()
+    , m_refillTimer(new QTimer(this))
+    , m_scheduleTimer(new QTimer(this))
+{
+    m_clock.start();
+
+    m_refillTimer->setSingleShot(true);
+    m_refillTimer->setInterval(MSEC_BANDWIDTH_TICK);
+    connect(m_refillTimer, SIGNAL(timeout()), this, SIGNAL(refilled()));
+
+    m_scheduleTimer->setInterval(MSEC_BANDWIDTH_SCHEDULE);
+    connect(m_scheduleTimer, SIGNAL(timeout()), this, SLOT(updateLimit()));
+}
+
+/******************************************************************************
+ ******************************************************************************/
+/*!
+ * \brief Returns the download limit outside the scheduled periods,
+ * in bytes per second, or 0 if unlimited.
+ */
+qint64 BandwidthLimiter::downloadLimit() const
+{
+    return m_downloadLimit;
+}
+
+void BandwidthLimiter::setDownloadLimit(qint64 bytesPerSecond)
+{
+    m_downloadLimit = qMax(qint64(0), bytesPerSecond);
+    updateLimit();
+}
+
+QString BandwidthLimiter::schedule() const
+{
+    return m_schedule;
+}
+
+void BandwidthLimiter::setSchedule(const QString &schedule)
+{
+    m_schedule = schedule;
+    m_periods = parseSchedule(schedule);
+    if (m_periods.isEmpty()) {
+        m_scheduleTimer->stop();
+    } else {
+        m_scheduleTimer->start();
+    }
+    updateLimit();
+}
+
+/*!
+ * \brief Returns the limit in force, in bytes per second, or 0 if unlimited.
+ */
+qint64 BandwidthLimiter::currentLimit() const
+{
+    return m_global.rate();
+}
+
+void BandwidthLimiter::updateLimit()
+{
+    auto limit = m_downloadLimit;
+    auto now = QTime::currentTime();
+    for (const auto &period : std::as_const(m_periods)) {
+        if (period.contains(now)) {
+            limit = period.limit;
+            break;
+        }
+    }
+    if (m_global.rate() != limit) {
+        m_global.setRate(limit);
+        emit limitChanged();
+    }
+}
+
+/******************************************************************************
+ ******************************************************************************/
+/*!
+ * \brief Returns how many of the given bytes can be read now.
+ * The granted bytes are consumed from the global bucket and the given one.
+ *
+ * If some bytes are refused, refilled() is emitted a bit later.
+ */
+qint64 BandwidthLimiter::acquire(TokenBucket &bucket, qint64 bytes)
+{
+    if (!m_global.isLimited() && !bucket.isLimited()) {
+        return bytes;
+    }
+    auto now = m_clock.elapsed();
+    m_global.refill(now);
+    bucket.refill(now);
+    auto granted = bytes;
+    if (m_global.isLimited()) {
+        granted = qMin(granted, qMax(qint64(0), m_global.tokens()));
+    }
+    if (bucket.isLimited()) {
+        granted = qMin(granted, qMax(qint64(0), bucket.tokens()));
+    }
+    m_global.consume(granted);
+    bucket.consume(granted);
+    if (granted < bytes && !m_refillTimer->isActive()) {
+        m_refillTimer->start();
+    }
+    return granted;
+}
+
+/*!
+ * \brief Consumes the bytes already read, even beyond the limit.
+ */
+void BandwidthLimiter::consume(TokenBucket &bucket, qint64 bytes)
+{
+    auto now = m_clock.elapsed();
+    m_global.refill(now);
+    bucket.refill(now);
+    m_global.consume(bytes);
+    bucket.consume(bytes);
+}
+
+/*!
+ * \brief Gives back the bytes acquired but not read.
+ */
+void BandwidthLimiter::refund(TokenBucket &bucket, qint64 bytes)
+{
+    m_global.refund(bytes);
+    bucket.refund(bytes);
+}
+
+/*!
+ * \brief Returns the size of the read buffer of a reply limited by
+ * the given bucket: it holds a burst of data, so that the socket
+ * stops receiving when the download is throttled.
+ */
+qint64 BandwidthLimiter::readBufferSize(const TokenBucket &bucket) const
+{
+    auto limit = streamLimit(bucket);
+    if (limit <= 0) {
+        return READ_BUFFER_SIZE;
+    }
+    return qBound(qint64(RECEIVE_BUFFER_SIZE), limit * MSEC_BANDWIDTH_BURST / 1000, READ_BUFFER_SIZE);
+}
+
+/*!
+ * \brief Returns the limit of a download that can't be throttled
+ * while running, like a yt-dlp process, or 0 if unlimited.
+ */
+qint64 BandwidthLimiter::streamLimit(const TokenBucket &bucket) const
+{
+    if (!m_global.isLimited()) {
+        return bucket.rate();
+    }
+    if (!bucket.isLimited()) {
+        return m_global.rate();
+    }
+    return qMin(m_global.rate(), bucket.rate());
+}
+
+/******************************************************************************
+ ******************************************************************************/
+bool BandwidthLimiter::Period::contains(const QTime &time) const
+{
+    if (begin <= end) {
+        return begin <= time && time < end;
+    }
+    return begin <= time || time < end; /* Over midnight */
+}
+
+/*!
+ * \brief Parses the periods like "08:00-18:00=512; 22:00-06:00=0",
+ * where the limit is in KB/s, and 0 means unlimited.
+ * The invalid periods are ignored.
+ */
+QList<BandwidthLimiter::Period> BandwidthLimiter::parseSchedule(const QString &schedule)
+{
+    QList<Period> periods;
+    const auto tokens = schedule.split(QRegularExpression("[;\\n]"), Qt::SkipEmptyParts);
+    for (const auto &token : tokens) {
+        auto parts = token.split('=');
+        if (parts.count() != 2) {
+            continue;
+        }
+        auto times = parts.at(0).split('-');
+        if (times.count() != 2) {
+            continue;
+        }
+        Period period;
+        period.begin = QTime::fromString(times.at(0).trimmed(), "H:mm");
+        period.end = QTime::fromString(times.at(1).trimmed(), "H:mm");
+        bool ok = false;
+        auto kilobytes = parts.at(1).trimmed().toLongLong(&ok);
+        if (!period.begin.isValid() || !period.end.isValid() || !ok || kilobytes < 0) {
+            continue;
+        }
+        period.limit = kilobytes * 1024;
+        periods.append(period);
+    }
+    return periods;
+}
@@ -0,0 +1,113 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CORE_BANDWIDTH_LIMITER_H
+#define CORE_BANDWIDTH_LIMITER_H
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QList>
+#include <QtCore/QObject>
+#include <QtCore/QString>
+#include <QtCore/QTime>
+
+class QTimer;
+
+/*!
+ * @class TokenBucket
+ * @brief Limits a flow of bytes to the given rate, in bytes per second.
+ */
+class TokenBucket
+{
+public:
+    explicit TokenBucket(qint64 rate = 0);
+
+    qint64 rate() const;
+    void setRate(qint64 rate);
+    bool isLimited() const;
+
+    qint64 capacity() const;
+    qint64 tokens() const;
+
+    void refill(qint64 now);
+    void consume(qint64 bytes);
+    void refund(qint64 bytes);
+
+private:
+    qint64 m_rate = 0; /* 0 if unlimited */
+    qint64 m_tokens = 0;
+    qint64 m_lastRefill = -1;
+};
+
+/*!
+ * @class BandwidthLimiter
+ * @brief Shares the global download limit between the downloads.
+ */
+class BandwidthLimiter : public QObject
+{
+    Q_OBJECT
+
+private:
+    BandwidthLimiter();
+    ~BandwidthLimiter() override = default;
+public:
+    BandwidthLimiter(BandwidthLimiter const&) = delete; // Don't Implement
+    void operator=(BandwidthLimiter const&) = delete; // Don't implement
+
+    static BandwidthLimiter& getInstance();
+
+    qint64 downloadLimit() const;
+    void setDownloadLimit(qint64 bytesPerSecond);
+
+    QString schedule() const;
+    void setSchedule(const QString &schedule);
+
+    qint64 currentLimit() const;
+
+    qint64 acquire(TokenBucket &bucket, qint64 bytes);
+    void consume(TokenBucket &bucket, qint64 bytes);
+    void refund(TokenBucket &bucket, qint64 bytes);
+
+    qint64 readBufferSize(const TokenBucket &bucket) const;
+    qint64 streamLimit(const TokenBucket &bucket) const;
+
+    struct Period
+    {
+        QTime begin = {};
+        QTime end = {};
+        qint64 limit = 0; /* bytes per second, 0 if unlimited */
+
+        bool contains(const QTime &time) const;
+    };
+    static QList<Period> parseSchedule(const QString &schedule);
+
+signals:
+    void limitChanged();
+    void refilled();
+
+private slots:
+    void updateLimit();
+
+private:
+    TokenBucket m_global = TokenBucket();
+    qint64 m_downloadLimit = 0;
+    QString m_schedule = {};
+    QList<Period> m_periods = {};
+    QElapsedTimer m_clock = {};
+    QTimer *m_refillTimer = nullptr;
+    QTimer *m_scheduleTimer = nullptr;
+};
+
+#endif // CORE_BANDWIDTH_LIMITER_H
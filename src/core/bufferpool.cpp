@@ -0,0 +1,95 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bufferpool.h"
+
+/*!
+ * \class BufferPool
+ *
+ * Recycles fixed-size buffers (slabs), to receive the network data
+ * without allocating memory for each chunk.
+ *
+ * A released buffer is shared with its readers (e.g. the DiskWriter queue),
+ * thanks to the implicit sharing of QByteArray: it is reused only once
+ * every reader has dropped its copy, i.e. when the pool holds the only reference.
+ *
+ * allocationCount() stays constant once the pool holds enough slabs
+ * for the data in flight.
+ */
+
+BufferPool::BufferPool(qsizetype slabSize)
+    : m_slabSize(slabSize)
+{
+}
+
+/******************************************************************************
+ ******************************************************************************/
+/*!
+ * \brief Returns a buffer of slabSize() bytes, not shared,
+ * whose content is undefined.
+ */
+QByteArray BufferPool::acquire()
+{
+    m_acquisitionCount++;
+    for (qsizetype i = 0; i < m_slabs.size(); ++i) {
+        if (m_slabs.at(i).isDetached()) {
+            QByteArray buffer = std::move(m_slabs[i]);
+            m_slabs.swapItemsAt(i, m_slabs.size() - 1);
+            m_slabs.removeLast();
+            /* Shrinking or growing within the capacity doesn't reallocate */
+            buffer.resize(m_slabSize);
+            return buffer;
+        }
+    }
+    m_allocationCount++;
+    return QByteArray(m_slabSize, Qt::Uninitialized);
+}
+
+/*!
+ * \brief Gives the buffer back to the pool.
+ * The buffer can still be used by its readers.
+ */
+void BufferPool::release(const QByteArray &buffer)
+{
+    if (buffer.capacity() >= m_slabSize) {
+        m_slabs.append(buffer);
+    }
+}
+
+void BufferPool::clear()
+{
+    m_slabs.clear();
+}
+
+/******************************************************************************
+ ******************************************************************************/
+qsizetype BufferPool::slabSize() const
+{
+    return m_slabSize;
+}
+
+qint64 BufferPool::acquisitionCount() const
+{
+    return m_acquisitionCount;
+}
+
+/*!
+ * \brief Returns the number of buffers allocated by the pool.
+ */
+qint64 BufferPool::allocationCount() const
+{
+    return m_allocationCount;
+}
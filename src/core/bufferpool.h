@@ -0,0 +1,43 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CORE_BUFFER_POOL_H
+#define CORE_BUFFER_POOL_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+
+class BufferPool
+{
+public:
+    explicit BufferPool(qsizetype slabSize);
+
+    QByteArray acquire();
+    void release(const QByteArray &buffer);
+    void clear();
+
+    qsizetype slabSize() const;
+    qint64 acquisitionCount() const;
+    qint64 allocationCount() const;
+
+private:
+    qsizetype m_slabSize = 0;
+    QList<QByteArray> m_slabs = {};
+    qint64 m_acquisitionCount = 0;
+    qint64 m_allocationCount = 0;
+};
+
+#endif // CORE_BUFFER_POOL_H
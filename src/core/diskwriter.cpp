@@ -0,0 +1,356 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "diskwriter.h"
+
+#include <Constants>
+
+#include <QtCore/QMutexLocker>
+
+#include <algorithm> /* std::count_if */
+
+#ifdef Q_OS_WIN
+#  include <io.h>
+#  include <windows.h>
+#else /* POSIX */
+#  include <cerrno>
+#  include <sys/uio.h>
+#  include <unistd.h>
+#endif
+
+/*!
+ * \class DiskWriter
+ *
+ * The writes are queued by the GUI thread, and executed by the writer thread,
+ * so that the GUI doesn't wait for the disk.
+ *
+ * A write that continues a queued write of the same file is appended to it,
+ * up to WRITE_CHUNK_SIZE: when the disk is slow, the many small chunks
+ * received from the network become a few large writes.
+ * The buffers are not copied: they are written at once with pwritev().
+ *
+ * Above WRITE_QUEUE_MAX_SIZE of pending data, the writer is congested:
+ * the downloads stop reading their replies, until drained() is emitted.
+ *
+ * The chunks are not aligned to the blocks of the disk: the files are
+ * written through the page cache (no O_DIRECT), which writes back whole
+ * pages anyway. The page at the edge of a chunk is shared with the next
+ * chunk of the segment, written just after: splitting the buffers at the
+ * block boundaries would only cost copies.
+ *
+ * The file handle must stay open until flush() or discard() returns,
+ * or until the task queued by close() closes it. The closing (fsync,
+ * rename...) is also done by the writer thread.
+ */
+
+DiskWriter& DiskWriter::getInstance()
+{
+    static DiskWriter instance; // lazy singleton, instantiated on first use
+    return instance;
+}
+
+DiskWriter::DiskWriter() : QThread()
+{
+    start();
+}
+
+DiskWriter::~DiskWriter()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_shouldQuit = true;
+        m_queued.wakeAll();
+    }
+    wait();
+}
+
+/******************************************************************************
+ ******************************************************************************/
+/*!
+ * \brief Queues the given data, to be written at the given offset of the file.
+ *
+ * Returns false if a previous write to this file failed.
+ */
+bool DiskWriter::write(int handle, qint64 offset, const QByteArray &data)
+{
+    if (handle < 0) {
+        return false;
+    }
+    if (data.isEmpty()) {
+        return true;
+    }
+    QMutexLocker locker(&m_mutex);
+    if (m_failed.contains(handle)) {
+        return false;
+    }
+    auto coalesced = false;
+    for (auto it = m_queue.rbegin(); it != m_queue.rend(); ++it) {
+        if (it->handle == handle
+                && !it->task
+                && it->offset + it->size == offset
+                && it->size + data.size() <= WRITE_CHUNK_SIZE
+                && it->buffers.size() < WRITE_CHUNK_BUFFERS) {
+            it->buffers.append(data);
+            it->size += data.size();
+            coalesced = true;
+            break;
+        }
+    }
+    if (!coalesced) {
+        Chunk chunk;
+        chunk.handle = handle;
+        chunk.offset = offset;
+        chunk.size = data.size();
+        chunk.buffers.append(data);
+        m_queue.append(std::move(chunk));
+        m_pending[handle]++;
+    }
+    m_queuedBytes += data.size();
+    if (m_queuedBytes > WRITE_QUEUE_MAX_SIZE) {
+        m_congested = true;
+    }
+    m_queued.wakeOne();
+    return true;
+}
+
+/*!
+ * \brief Queues the task that closes the file, after its queued data.
+ *
+ * The task runs in the writer thread. It receives false if a write to the
+ * file failed, and returns its result. The result is given to \a done,
+ * in the thread of the writer object (the main thread), unless \a context
+ * is destroyed before.
+ *
+ * Returns the ticket of the task, for waitForClosed().
+ */
+quint64 DiskWriter::close(int handle, const Task &task, QObject *context, const Callback &done)
+{
+    Q_ASSERT(task);
+    QMutexLocker locker(&m_mutex);
+    Chunk chunk;
+    chunk.handle = handle;
+    chunk.task = task;
+    chunk.ticket = ++m_lastTicket;
+    chunk.context = context;
+    chunk.done = done;
+    m_queue.append(std::move(chunk));
+    m_pending[handle]++;
+    m_queued.wakeOne();
+    return m_lastTicket;
+}
+
+/*!
+ * \brief Waits until the task of the given ticket has closed its file.
+ * The handle can't be used to wait: it can be reused once closed.
+ */
+void DiskWriter::waitForClosed(quint64 ticket)
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_closedTicket < ticket) {
+        m_written.wait(&m_mutex);
+    }
+}
+
+/*!
+ * \brief Waits until the queued data of the file is written.
+ *
+ * Returns false if a write to this file failed.
+ */
+bool DiskWriter::flush(int handle)
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_pending.value(handle) > 0) {
+        m_written.wait(&m_mutex);
+    }
+    return !m_failed.remove(handle);
+}
+
+/*!
+ * \brief Drops the queued data of the file, and waits for the current write.
+ */
+void DiskWriter::discard(int handle)
+{
+    QMutexLocker locker(&m_mutex);
+    for (auto it = m_queue.begin(); it != m_queue.end(); ) {
+        if (it->handle == handle && !it->task) {
+            m_queuedBytes -= it->size;
+            m_pending[handle]--;
+            it = m_queue.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    while (m_pending.value(handle) > 0) {
+        m_written.wait(&m_mutex);
+    }
+    m_pending.remove(handle);
+    m_failed.remove(handle);
+    if (m_congested && m_queuedBytes <= WRITE_QUEUE_RESUME_SIZE) {
+        m_congested = false;
+        QMetaObject::invokeMethod(this, &DiskWriter::drained, Qt::QueuedConnection);
+    }
+}
+
+bool DiskWriter::isCongested() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_congested;
+}
+
+/*!
+ * \brief Returns the number of writes waiting in the queue, after coalescing.
+ */
+qsizetype DiskWriter::queuedWriteCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return std::count_if(m_queue.cbegin(), m_queue.cend(),
+                         [](const Chunk &chunk) { return !chunk.task; });
+}
+
+/******************************************************************************
+ ******************************************************************************/
+void DiskWriter::run()
+{
+    forever {
+        QMutexLocker locker(&m_mutex);
+        while (m_queue.isEmpty() && !m_shouldQuit) {
+            m_queued.wait(&m_mutex);
+        }
+        if (m_queue.isEmpty()) {
+            return;
+        }
+        auto chunk = m_queue.takeFirst();
+        /* The previous writes of the file are done */
+        auto written = chunk.task ? !m_failed.remove(chunk.handle) : true;
+        locker.unlock();
+
+        auto ok = chunk.task
+                ? chunk.task(written)
+                : writeAt(chunk.handle, chunk.offset, chunk.buffers);
+        chunk.buffers.clear(); /* Give the buffers back to their pool */
+
+        if (chunk.done) {
+            QMetaObject::invokeMethod(this, [context = chunk.context, done = chunk.done, ok]() {
+                if (context) {
+                    done(ok);
+                }
+            }, Qt::QueuedConnection);
+        }
+
+        locker.relock();
+        m_queuedBytes -= chunk.size;
+        if (chunk.task) {
+            m_closedTicket = chunk.ticket;
+        } else if (!ok) {
+            m_failed.insert(chunk.handle);
+        }
+        if (--m_pending[chunk.handle] <= 0) {
+            m_pending.remove(chunk.handle);
+        }
+        m_written.wakeAll();
+        auto isDrained = m_congested && m_queuedBytes <= WRITE_QUEUE_RESUME_SIZE;
+        if (isDrained) {
+            m_congested = false;
+        }
+        locker.unlock();
+
+        if (isDrained) {
+            emit drained();
+        }
+    }
+}
+
+/******************************************************************************
+ ******************************************************************************/
+/*!
+ * \brief Writes the contiguous buffers at the given offset of the file.
+ */
+bool DiskWriter::writeAt(int handle, qint64 offset, const Buffers &buffers)
+{
+    qint64 skip = 0;
+#if defined(Q_OS_LINUX)
+    iovec vectors[WRITE_CHUNK_BUFFERS];
+    int count = 0;
+    qint64 size = 0;
+    for (const auto &buffer : buffers) {
+        vectors[count].iov_base = const_cast<char*>(buffer.constData());
+        vectors[count].iov_len = static_cast<size_t>(buffer.size());
+        size += buffer.size();
+        count++;
+    }
+    ssize_t written = 0;
+    do {
+        written = ::pwritev(handle, vectors, count, static_cast<off_t>(offset));
+    } while (written < 0 && errno == EINTR);
+    if (written < 0) {
+        return false;
+    }
+    if (written == size) {
+        return true;
+    }
+    skip = written; /* Short write: write the rest buffer per buffer */
+#endif
+    for (const auto &buffer : buffers) {
+        if (skip >= buffer.size()) {
+            skip -= buffer.size();
+        } else if (!writeAt(handle, offset + skip, buffer.constData() + skip, buffer.size() - skip)) {
+            return false;
+        } else {
+            skip = 0;
+        }
+        offset += buffer.size();
+    }
+    return true;
+}
+
+/*!
+ * \brief Writes the data at the given offset of the file, without moving
+ * the file position, so that several threads can write to the same file.
+ */
+bool DiskWriter::writeAt(int handle, qint64 offset, const char *data, qint64 size)
+{
+#ifdef Q_OS_WIN
+    auto fileHandle = reinterpret_cast<HANDLE>(::_get_osfhandle(handle));
+    while (size > 0) {
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD written = 0;
+        auto count = static_cast<DWORD>(qMin(size, qint64(0x40000000)));
+        if (!::WriteFile(fileHandle, data, count, &written, &overlapped) || written == 0) {
+            return false;
+        }
+        data += written;
+        offset += written;
+        size -= written;
+    }
+    return true;
+#else /* POSIX */
+    while (size > 0) {
+        auto written = ::pwrite(handle, data, static_cast<size_t>(size), static_cast<off_t>(offset));
+        if (written <= 0) {
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        offset += written;
+        size -= written;
+    }
+    return true;
+#endif
+}
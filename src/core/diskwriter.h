@@ -0,0 +1,100 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CORE_DISK_WRITER_H
+#define CORE_DISK_WRITER_H
+
+#include <Constants>
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QPointer>
+#include <QtCore/QSet>
+#include <QtCore/QThread>
+#include <QtCore/QVarLengthArray>
+#include <QtCore/QWaitCondition>
+
+#include <functional>
+
+/*!
+ * @class DiskWriter
+ * @brief Writes the downloaded data to the disk, in a dedicated thread.
+ */
+class DiskWriter : public QThread
+{
+    Q_OBJECT
+
+private:
+    DiskWriter();
+    ~DiskWriter() override;
+public:
+    DiskWriter(DiskWriter const&) = delete; // Don't Implement
+    void operator=(DiskWriter const&) = delete; // Don't implement
+
+    static DiskWriter& getInstance();
+
+    using Task = std::function<bool(bool written)>;
+    using Callback = std::function<void(bool result)>;
+
+    bool write(int handle, qint64 offset, const QByteArray &data);
+    quint64 close(int handle, const Task &task, QObject *context = nullptr, const Callback &done = {});
+    void waitForClosed(quint64 ticket);
+    bool flush(int handle);
+    void discard(int handle);
+
+    bool isCongested() const;
+    qsizetype queuedWriteCount() const;
+
+    static bool writeAt(int handle, qint64 offset, const char *data, qint64 size);
+
+    using Buffers = QVarLengthArray<QByteArray, WRITE_CHUNK_BUFFERS>;
+    static bool writeAt(int handle, qint64 offset, const Buffers &buffers);
+
+signals:
+    void drained();
+
+protected:
+    void run() override;
+
+private:
+    struct Chunk
+    {
+        int handle = -1;
+        qint64 offset = 0;
+        qint64 size = 0;
+        Buffers buffers = {}; /* contiguous, written with a single call */
+        Task task = {}; /* instead of the buffers: closes the file */
+        quint64 ticket = 0;
+        QPointer<QObject> context = {};
+        Callback done = {};
+    };
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_queued;
+    QWaitCondition m_written;
+    QList<Chunk> m_queue = {};
+    QHash<int, int> m_pending = {}; /* queued or being written, per handle */
+    QSet<int> m_failed = {};
+    qint64 m_queuedBytes = 0;
+    quint64 m_lastTicket = 0;
+    quint64 m_closedTicket = 0; /* the tasks run in the order of their tickets */
+    bool m_congested = false;
+    bool m_shouldQuit = false;
+};
+
+#endif // CORE_DISK_WRITER_H
@@ -20,17 +20,26 @@
 #include <Core/AbstractDownloadItem>
 
 #include <QtCore/QDebug>
+#include <QtCore/QFileInfo>
 #include <QtCore/QtMath>
 #include <QtCore/QTimer>
 
 
 DownloadEngine::DownloadEngine(QObject *parent) : QObject(parent)
     , m_speedTimer(new QTimer(this))
+    , m_tickTimer(new QTimer(this))
+    , m_changeTimer(new QTimer(this))
 {
     connect(this, SIGNAL(jobFinished(IDownloadItem*)),
             this, SLOT(startNext(IDownloadItem*)));
 
     connect(m_speedTimer, SIGNAL(timeout()), this, SLOT(onSpeedTimerTimeout()));
+    connect(m_tickTimer, SIGNAL(timeout()), this, SLOT(onTick()));
+
+    m_changeTimer->setSingleShot(true);
+    connect(m_changeTimer, SIGNAL(timeout()), this, SLOT(onChangeTimerTimeout()));
+
+    m_clock.start();
 }
 
 DownloadEngine::~DownloadEngine()
@@ -45,28 +54,99 @@ DownloadEngine::~DownloadEngine()
  * This signal is emited whenever the download data or its progress or its state has changed
  */
 
+/**
+ * \fn void DownloadEngine::jobReplaced(DownloadRange before, DownloadRange after)
+ * This signal is emited when items are replaced at the same rows, e.g.
+ * when the records of the queue file are materialized. The items of
+ * \a before are deleted once the signal is delivered.
+ */
+
+/**
+ * \fn void DownloadEngine::jobsChanged(QSet<IDownloadItem *> items)
+ * This signal is emited at most once per frame, with the items changed
+ * since the previous emission (the set can be empty if only
+ * the total speed changed). The views should prefer it to jobStateChanged().
+ */
+
 /******************************************************************************
  ******************************************************************************/
 qsizetype DownloadEngine::downloadingCount() const
 {
-    auto count = 0;
-    for (auto item : m_items) {
-        if (item->isDownloading()) {
-            count++;
+    return runningJobCount();
+}
+
+/*!
+ * \brief Starts the next Idle items until the maximum of simultaneous
+ * downloads is reached.
+ *
+ * The Idle items wait in one ready queue per host, sorted by rank,
+ * so the completed items at the head of the queue are never visited.
+ * The hosts take turns, and a host is skipped while it runs
+ * its maximum of simultaneous downloads.
+ */
+void DownloadEngine::startNext(IDownloadItem * /*item*/)
+{
+    if (m_isScheduling) {
+        return; /* An item finished during resume(), the loop below continues */
+    }
+    m_isScheduling = true;
+    while (downloadingCount() < m_maxSimultaneousDownloads) {
+        auto item = nextReadyItem();
+        if (!item) {
+            break; /* Every waiting host is busy */
+        }
+        item->resume();
+        /* The item left the ready queue in onChanged(), unless it stayed Idle */
+        auto entry = m_entries.value(item);
+        if (entry.state == IDownloadItem::Idle) {
+            dequeueReady(entry);
         }
     }
-    return count;
+    m_isScheduling = false;
 }
 
-void DownloadEngine::startNext(IDownloadItem * /*item*/)
+/*!
+ * \brief Returns the first Idle item of the next host that can start
+ * a download, or nullptr if none.
+ *
+ * Items without host (e.g. magnet links) are not limited per host.
+ */
+IDownloadItem* DownloadEngine::nextReadyItem()
 {
-    if (downloadingCount() < m_maxSimultaneousDownloads) {
-        for (auto item : m_items) {
-            if (item->state() == IDownloadItem::Idle) {
-                item->resume();
-                startNext(nullptr);
-                break;
-            }
+    const auto count = m_readyHosts.size();
+    for (qsizetype i = 0; i < count; ++i) {
+        auto index = (m_nextHost + i) % count;
+        const auto &host = m_readyHosts.at(index);
+        if (host.isEmpty() || m_runningPerHost.value(host) < m_maxSimultaneousDownloadsPerHost) {
+            m_nextHost = index + 1;
+            return m_readyQueues.value(host).first();
+        }
+    }
+    return nullptr;
+}
+
+void DownloadEngine::enqueueReady(IDownloadItem *item, const Entry &entry)
+{
+    auto &queue = m_readyQueues[entry.host];
+    if (queue.isEmpty()) {
+        m_readyHosts.append(entry.host);
+    }
+    queue.insert(entry.rank, item);
+}
+
+void DownloadEngine::dequeueReady(const Entry &entry)
+{
+    auto it = m_readyQueues.find(entry.host);
+    if (it == m_readyQueues.end()) {
+        return;
+    }
+    it->remove(entry.rank);
+    if (it->isEmpty()) {
+        m_readyQueues.erase(it);
+        auto index = m_readyHosts.indexOf(entry.host);
+        m_readyHosts.removeAt(index);
+        if (index < m_nextHost) {
+            m_nextHost--;
         }
     }
 }
@@ -88,6 +168,13 @@ void DownloadEngine::clear()
 
 /******************************************************************************
  ******************************************************************************/
+/*!
+ * \brief Appends the items to the queue.
+ *
+ * The items that aren't AbstractDownloadItem, e.g. the records of
+ * the queue file, are appended as they are: they don't run
+ * until materialize() replaces them.
+ */
 void DownloadEngine::append(const QList<IDownloadItem*> &items, bool started)
 {    
     if (items.isEmpty()) {
@@ -96,12 +183,13 @@ void DownloadEngine::append(const QList<IDownloadItem*> &items, bool started)
     for (auto item : items) {
         auto downloadItem = dynamic_cast<AbstractDownloadItem*>(item);
         if (!downloadItem) {
-            return;
+            track(item);
+            m_items.append(item);
+            continue;
         }
 
-        connect(downloadItem, SIGNAL(changed()), this, SLOT(onChanged()));
-        connect(downloadItem, SIGNAL(finished()), this, SLOT(onFinished()));
-        connect(downloadItem, SIGNAL(renamed(QString,QString,bool)), this, SLOT(onRenamed(QString,QString,bool)));
+        track(downloadItem);
+        connectItem(downloadItem);
 
         if (started) {
             if (downloadItem->isResumable()) {
@@ -140,24 +228,97 @@ void DownloadEngine::removeItems(const QList<IDownloadItem*> &items)
     endSelectionChange();
 
     /* Then, remove */
-    for (auto item : items) {
-        cancel(item); // stop the reply first
-        m_items.removeAll(item);
+    const QSet<IDownloadItem*> removed(items.cbegin(), items.cend());
+    QList<IDownloadItem*> records;
+    for (auto item : removed) {
         auto downloadItem = dynamic_cast<AbstractDownloadItem*>(item);
+        if (downloadItem) {
+            cancel(item); // stop the reply first
+        }
+        untrack(item);
         if (downloadItem) {
             downloadItem->deleteLater();
+        } else {
+            records.append(item); // deleted once the signal is delivered
         }
     }
+    m_items.removeIf([&removed](IDownloadItem *item) { return removed.contains(item); });
     emit jobRemoved(items);
+    qDeleteAll(records);
 }
 
 void DownloadEngine::updateItems(const QList<IDownloadItem *> &items)
 {
     for (auto item : items) {
         emit jobStateChanged(item);
+        markChanged(item);
     }
 }
 
+/*!
+ * \brief Returns the items, where the ones that aren't AbstractDownloadItem
+ * are replaced by the item returned by materializeItem().
+ *
+ * The new item keeps the row, the rank and the selection of the replaced
+ * one, and the queue is updated in one pass. Then jobReplaced() is
+ * emitted, and the replaced items are deleted.
+ */
+QList<IDownloadItem *> DownloadEngine::materialize(const QList<IDownloadItem *> &items)
+{
+    auto result = items;
+    QHash<IDownloadItem*, IDownloadItem*> replaced;
+    DownloadRange before;
+    DownloadRange after;
+    for (auto &item : result) {
+        auto it = replaced.constFind(item);
+        if (it != replaced.constEnd()) {
+            item = it.value();
+            continue;
+        }
+        if (dynamic_cast<AbstractDownloadItem*>(item) || !m_entries.contains(item)) {
+            continue;
+        }
+        auto downloadItem = dynamic_cast<AbstractDownloadItem*>(materializeItem(item));
+        if (!downloadItem) {
+            continue;
+        }
+        auto entry = m_entries.take(item);
+        unindexEntry(item, entry);
+        m_changedItems.remove(item);
+        entry.state = downloadItem->state();
+        m_entries.insert(downloadItem, entry);
+        indexEntry(downloadItem, entry);
+        connectItem(downloadItem);
+
+        replaced.insert(item, downloadItem);
+        before.append(item);
+        after.append(downloadItem);
+        item = downloadItem;
+    }
+    if (replaced.isEmpty()) {
+        return result;
+    }
+    for (auto &item : m_items) {
+        item = replaced.value(item, item);
+    }
+    for (auto &item : m_selectedItems) {
+        item = replaced.value(item, item);
+    }
+    emit jobReplaced(before, after);
+    qDeleteAll(before);
+    return result;
+}
+
+/*!
+ * \brief Reimplement this method to create the item of a job that isn't
+ * an AbstractDownloadItem yet, e.g. a record of the queue file.
+ * \remark Optional
+ */
+IDownloadItem* DownloadEngine::materializeItem(IDownloadItem *item)
+{
+    return item;
+}
+
 /******************************************************************************
  ******************************************************************************/
 const IDownloadItem* DownloadEngine::clientForRow(qsizetype row) const
@@ -178,6 +339,48 @@ void DownloadEngine::setMaxSimultaneousDownloads(int number)
     m_maxSimultaneousDownloads = number;
 }
 
+int DownloadEngine::maxSimultaneousDownloadsPerHost() const
+{
+    return m_maxSimultaneousDownloadsPerHost;
+}
+
+void DownloadEngine::setMaxSimultaneousDownloadsPerHost(int number)
+{
+    if (m_maxSimultaneousDownloadsPerHost == number) {
+        return;
+    }
+    auto isRaised = number > m_maxSimultaneousDownloadsPerHost;
+    m_maxSimultaneousDownloadsPerHost = number;
+    if (isRaised) {
+        startNext(nullptr); /* The busy hosts can start more downloads */
+    }
+}
+
+bool DownloadEngine::isLimitPerDomainEnabled() const
+{
+    return m_limitPerDomain;
+}
+
+/*!
+ * \brief If enabled, the hosts of a same registered domain
+ * (e.g. cdn1.example.com and cdn2.example.com) share the limit per host.
+ */
+void DownloadEngine::setLimitPerDomainEnabled(bool enabled)
+{
+    if (m_limitPerDomain == enabled) {
+        return;
+    }
+    m_limitPerDomain = enabled;
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        unindexEntry(it.key(), it.value());
+        it->host = hostKey(it.key());
+        indexEntry(it.key(), it.value());
+    }
+    if (!enabled) {
+        startNext(nullptr); /* The hosts of a domain no longer share the limit */
+    }
+}
+
 /******************************************************************************
  ******************************************************************************/
 QList<IDownloadItem *> DownloadEngine::downloadItems() const
@@ -185,51 +388,235 @@ QList<IDownloadItem *> DownloadEngine::downloadItems() const
     return m_items;
 }
 
-static inline QList<IDownloadItem*> filter(const QList<IDownloadItem*> &items,
-                                           const QList<IDownloadItem::State> &states)
+static const QList<IDownloadItem::State> s_waitingStates = {
+    IDownloadItem::Idle
+};
+static const QList<IDownloadItem::State> s_completedStates = {
+    IDownloadItem::Completed,
+    IDownloadItem::Seeding
+};
+static const QList<IDownloadItem::State> s_pausedStates = {
+    IDownloadItem::Paused
+};
+static const QList<IDownloadItem::State> s_failedStates = {
+    IDownloadItem::Stopped,
+    IDownloadItem::Skipped,
+    IDownloadItem::NetworkError,
+    IDownloadItem::FileError
+};
+static const QList<IDownloadItem::State> s_runningStates = {
+    IDownloadItem::Preparing,
+    IDownloadItem::Connecting,
+    IDownloadItem::DownloadingMetadata,
+    IDownloadItem::Downloading,
+    IDownloadItem::Endgame
+};
+
+/*!
+ * \brief Returns the items in the given states, in no particular order.
+ */
+QList<IDownloadItem*> DownloadEngine::itemsIn(const QList<IDownloadItem::State> &states) const
 {
     QList<IDownloadItem*> list;
-    for (auto item : items) {
-        for (auto state : states) {
-            if (item->state() == state) {
-                list.append(item);
-            }
+    list.reserve(countIn(states));
+    for (auto state : states) {
+        for (auto item : m_itemsByState[state]) {
+            list.append(item);
         }
     }
     return list;
 }
 
+qsizetype DownloadEngine::countIn(const QList<IDownloadItem::State> &states) const
+{
+    qsizetype count = 0;
+    for (auto state : states) {
+        count += m_itemsByState[state].count();
+    }
+    return count;
+}
+
 QList<IDownloadItem*> DownloadEngine::waitingJobs() const
 {
-    return filter(m_items, {IDownloadItem::Idle});
+    return itemsIn(s_waitingStates);
 }
 
 QList<IDownloadItem*> DownloadEngine::completedJobs() const
 {
-    return filter(m_items, {IDownloadItem::Completed,
-                            IDownloadItem::Seeding});
+    return itemsIn(s_completedStates);
 }
 
 QList<IDownloadItem*> DownloadEngine::pausedJobs() const
 {
-    return filter(m_items, {IDownloadItem::Paused});
+    return itemsIn(s_pausedStates);
 }
 
 QList<IDownloadItem*> DownloadEngine::failedJobs() const
 {
-    return filter(m_items, {IDownloadItem::Stopped,
-                            IDownloadItem::Skipped,
-                            IDownloadItem::NetworkError,
-                            IDownloadItem::FileError});
+    return itemsIn(s_failedStates);
 }
 
 QList<IDownloadItem*> DownloadEngine::runningJobs() const
 {
-    return filter(m_items, {IDownloadItem::Preparing,
-                            IDownloadItem::Connecting,
-                            IDownloadItem::DownloadingMetadata,
-                            IDownloadItem::Downloading,
-                            IDownloadItem::Endgame});
+    return itemsIn(s_runningStates);
+}
+
+qsizetype DownloadEngine::waitingJobCount() const
+{
+    return countIn(s_waitingStates);
+}
+
+qsizetype DownloadEngine::completedJobCount() const
+{
+    return countIn(s_completedStates);
+}
+
+qsizetype DownloadEngine::pausedJobCount() const
+{
+    return countIn(s_pausedStates);
+}
+
+qsizetype DownloadEngine::failedJobCount() const
+{
+    return countIn(s_failedStates);
+}
+
+qsizetype DownloadEngine::runningJobCount() const
+{
+    return countIn(s_runningStates);
+}
+
+/******************************************************************************
+ ******************************************************************************/
+void DownloadEngine::connectItem(AbstractDownloadItem *item)
+{
+    connect(item, SIGNAL(changed()), this, SLOT(onChanged()));
+    connect(item, SIGNAL(finished()), this, SLOT(onFinished()));
+    connect(item, SIGNAL(renamed(QString,QString,bool)), this, SLOT(onRenamed(QString,QString,bool)));
+}
+
+/*!
+ * \brief Adds the item to the index.
+ * The index is updated in onChanged(), so that the statistics don't
+ * need to iterate over the whole queue.
+ */
+void DownloadEngine::track(IDownloadItem *item)
+{
+    if (m_entries.contains(item)) {
+        return;
+    }
+    Entry entry;
+    entry.state = item->state();
+    entry.speed = qMax(item->speed(), qreal(0));
+    entry.bytesReceived = item->bytesReceived();
+    entry.rank = m_nextRank++;
+    entry.host = hostKey(item);
+    m_entries.insert(item, entry);
+    indexEntry(item, entry);
+    m_speed += entry.speed;
+}
+
+void DownloadEngine::untrack(IDownloadItem *item)
+{
+    auto it = m_entries.constFind(item);
+    if (it == m_entries.constEnd()) {
+        return;
+    }
+    unindexEntry(item, it.value());
+    m_speed -= it->speed;
+    m_entries.erase(it);
+    m_changedItems.remove(item);
+    if (m_entries.isEmpty()) {
+        m_speed = 0;
+    }
+}
+
+void DownloadEngine::updateIndex(IDownloadItem *item)
+{
+    auto it = m_entries.find(item);
+    if (it == m_entries.end()) {
+        return;
+    }
+    auto state = item->state();
+    if (it->state != state) {
+        unindexEntry(item, it.value());
+        it->state = state;
+        indexEntry(item, it.value());
+    }
+    /* Count only the bytes received while running, not the restored ones */
+    auto bytesReceived = item->bytesReceived();
+    if (s_runningStates.contains(state) && bytesReceived > it->bytesReceived) {
+        m_bytesReceived += bytesReceived - it->bytesReceived;
+    }
+    it->bytesReceived = bytesReceived;
+
+    auto speed = qMax(item->speed(), qreal(0));
+    m_speed += speed - it->speed;
+    it->speed = speed;
+    if (runningJobCount() == 0) {
+        m_speed = 0; /* Reset the rounding errors */
+    }
+}
+
+void DownloadEngine::indexEntry(IDownloadItem *item, const Entry &entry)
+{
+    m_itemsByState[entry.state].insert(item);
+    if (entry.state == IDownloadItem::Idle) {
+        enqueueReady(item, entry);
+    }
+    if (s_runningStates.contains(entry.state)) {
+        m_runningPerHost[entry.host]++;
+        if (!m_tickTimer->isActive()) {
+            m_tickTimer->start(TIMEOUT_INFO);
+        }
+    }
+}
+
+void DownloadEngine::unindexEntry(IDownloadItem *item, const Entry &entry)
+{
+    m_itemsByState[entry.state].remove(item);
+    if (entry.state == IDownloadItem::Idle) {
+        dequeueReady(entry);
+    }
+    if (s_runningStates.contains(entry.state)) {
+        if (--m_runningPerHost[entry.host] <= 0) {
+            m_runningPerHost.remove(entry.host);
+        }
+    }
+}
+
+/*!
+ * \brief Returns the registered domain of the host, guessed from its labels:
+ * "cdn.example.com" gives "example.com", "www.bbc.co.uk" gives "bbc.co.uk".
+ *
+ * A short second-level label under a country code (co.uk, com.au...) is
+ * considered part of the public suffix.
+ */
+static QString registeredDomain(const QString &host)
+{
+    if (host.contains(':')) {
+        return host; // IPv6
+    }
+    auto labels = host.split('.', Qt::SkipEmptyParts);
+    if (labels.size() <= 2) {
+        return host;
+    }
+    bool isNumber = false;
+    labels.last().toInt(&isNumber);
+    if (isNumber) {
+        return host; // IPv4
+    }
+    auto count = 2;
+    if (labels.last().size() == 2 && labels.at(labels.size() - 2).size() <= 3) {
+        count = 3;
+    }
+    return labels.mid(labels.size() - count).join('.');
+}
+
+QString DownloadEngine::hostKey(const IDownloadItem *item) const
+{
+    auto host = item->sourceUrl().host().toLower();
+    return m_limitPerDomain ? registeredDomain(host) : host;
 }
 
 /******************************************************************************
@@ -241,12 +628,37 @@ void DownloadEngine::onSpeedTimerTimeout()
     emit onChanged();
 }
 
-qreal DownloadEngine::totalSpeed()
+/*!
+ * \brief Updates all the running items at once.
+ *
+ * A single timer for the whole queue, instead of timers in each item:
+ * the number of wakeups doesn't depend on the number of running items,
+ * and the views are notified once per tick. The timer stops
+ * when no item is running.
+ */
+void DownloadEngine::onTick()
 {
-    qreal speed = 0;
-    for (auto item : m_items) {
-        speed += qMax(item->speed(), qreal(0));
+    auto items = runningJobs();
+    if (items.isEmpty()) {
+        m_tickTimer->stop();
+        m_speedEstimator.reset();
+        return;
+    }
+    for (auto item : std::as_const(items)) {
+        auto downloadItem = dynamic_cast<AbstractDownloadItem*>(item);
+        if (downloadItem) {
+            downloadItem->tick();
+        }
+        updateIndex(item);
+        m_changedItems.insert(item);
     }
+    m_speedEstimator.update(m_clock.elapsed(), m_bytesReceived);
+    flushChanges();
+}
+
+qreal DownloadEngine::totalSpeed()
+{
+    auto speed = m_speed;
     if (speed > 0) {
         m_previouSpeed = speed;
         m_speedTimer->start(MSEC_SPEED_DISPLAY_TIME);
@@ -254,11 +666,43 @@ qreal DownloadEngine::totalSpeed()
     return m_previouSpeed;
 }
 
+/*!
+ * \brief Returns the throughput of the queue over the last second,
+ * in bytes per second, or -1 if unknown.
+ */
+qreal DownloadEngine::instantSpeed() const
+{
+    return m_speedEstimator.instantRate();
+}
+
+/*!
+ * \brief Returns the smoothed throughput of the queue, or -1 if unknown.
+ * Contrary to totalSpeed(), it's measured from the bytes received,
+ * not summed from the speeds of the items.
+ */
+qreal DownloadEngine::smoothedSpeed() const
+{
+    return m_speedEstimator.smoothedRate();
+}
+
+/*!
+ * \brief Returns the average throughput of the queue since the
+ * downloads are running, or -1 if unknown.
+ */
+qreal DownloadEngine::averageSpeed() const
+{
+    return m_speedEstimator.averageRate();
+}
+
 /******************************************************************************
  ******************************************************************************/
+/*!
+ * \brief Applies the action to the item, materialized first if needed.
+ */
 void DownloadEngine::resume(IDownloadItem *item)
 {
     if (item->isResumable()) {
+        item = materialize({ item }).first();
         item->setReadyToResume();
         startNext(item);
     }
@@ -267,6 +711,7 @@ void DownloadEngine::resume(IDownloadItem *item)
 void DownloadEngine::pause(IDownloadItem *item)
 {
     if (item->isPausable()) {
+        item = materialize({ item }).first();
         item->pause();
     }
 }
@@ -274,6 +719,7 @@ void DownloadEngine::pause(IDownloadItem *item)
 void DownloadEngine::cancel(IDownloadItem *item)
 {
     if (item->isCancelable()) {
+        item = materialize({ item }).first();
         item->stop();
     }
 }
@@ -283,7 +729,44 @@ void DownloadEngine::cancel(IDownloadItem *item)
 void DownloadEngine::onChanged()
 {
     auto downloadItem = qobject_cast<AbstractDownloadItem *>(sender());
+    updateIndex(downloadItem);
     emit jobStateChanged(downloadItem);
+    markChanged(downloadItem);
+}
+
+/*!
+ * \brief Flags the item as changed. The changed items are notified
+ * together with jobsChanged(), at most once per frame, so that the cost
+ * of the refresh depends on the number of changed items, not on
+ * the number of changes.
+ */
+void DownloadEngine::markChanged(IDownloadItem *item)
+{
+    if (item) {
+        m_changedItems.insert(item);
+    }
+    if (!m_changeTimer->isActive()) {
+        m_changeTimer->start(MSEC_JOBS_CHANGED);
+    }
+}
+
+void DownloadEngine::onChangeTimerTimeout()
+{
+    flushChanges();
+}
+
+/*!
+ * \brief Emits jobsChanged() now with the pending changes, if any.
+ */
+void DownloadEngine::flushChanges()
+{
+    if (m_changedItems.isEmpty() && !m_changeTimer->isActive()) {
+        return;
+    }
+    m_changeTimer->stop();
+    const auto items = m_changedItems;
+    m_changedItems.clear();
+    emit jobsChanged(items);
 }
 
 void DownloadEngine::onFinished()
@@ -310,10 +793,13 @@ QList<IDownloadItem *> DownloadEngine::selection() const
     return m_selectedItems;
 }
 
+/*!
+ * \brief Selects the items. The selected items are materialized,
+ * since the actions and the views of the selection need them.
+ */
 void DownloadEngine::setSelection(const QList<IDownloadItem*> &selection)
 {
-    m_selectedItems.clear();
-    m_selectedItems.append(selection);
+    m_selectedItems = materialize(selection);
     if (!m_selectionAboutToChange) {
         emit selectionChanged();
     }
@@ -328,7 +814,7 @@ void DownloadEngine::setSelected(IDownloadItem* item, bool isSelected)
 {
     m_selectedItems.removeAll(item);
     if (isSelected) {
-        m_selectedItems.append(item);
+        m_selectedItems.append(materialize({ item }).first());
     }
     if (!m_selectionAboutToChange) {
         emit selectionChanged();
@@ -376,80 +862,138 @@ void DownloadEngine::endSelectionChange()
 
 /******************************************************************************
  ******************************************************************************/
-void DownloadEngine::sortSelectionByIndex()
+/*!
+ * \brief Moves the selected items as one block, in the order of the queue,
+ * to the top or to the bottom, or one row above the first selected item
+ * or below the last one.
+ *
+ * The queue is rebuilt in one pass. Only the moved items and the items
+ * they pass over get a new rank: a block moved to the top or to
+ * the bottom gets ranks beyond the current ones, since the ranks
+ * don't need to be contiguous.
+ */
+void DownloadEngine::moveSelection(MoveTarget target)
 {
-    if (m_selectedItems.isEmpty()) {
+    const QSet<IDownloadItem*> selected(m_selectedItems.cbegin(), m_selectedItems.cend());
+    QList<IDownloadItem*> block;
+    QList<IDownloadItem*> others;
+    block.reserve(selected.size());
+    others.reserve(m_items.size());
+    qsizetype first = -1;
+    qsizetype last = -1;
+    for (qsizetype i = 0; i < m_items.size(); ++i) {
+        auto item = m_items.at(i);
+        if (selected.contains(item)) {
+            if (first < 0) {
+                first = i;
+            }
+            last = i;
+            block.append(item);
+        } else {
+            others.append(item);
+        }
+    }
+    if (block.isEmpty()) {
         return;
     }
-    QMap<qsizetype, IDownloadItem*> map;
-    for (auto selectedItem : m_selectedItems) {
-        auto index = m_items.indexOf(selectedItem);
-        map.insert(index, selectedItem);
+    /* Index of the block in the new queue */
+    qsizetype targetIndex = 0;
+    switch (target) {
+    case MoveToTop:
+        targetIndex = 0;
+        break;
+    case MoveUp:
+        targetIndex = qMax(qsizetype(0), first - 1);
+        break;
+    case MoveDown:
+        targetIndex = qMin(m_items.size() - 1, last + 1) - (block.size() - 1);
+        break;
+    case MoveToBottom:
+        targetIndex = others.size();
+        break;
     }
-    m_selectedItems = map.values();
-}
 
-void DownloadEngine::moveUpTo(qsizetype targetIndex)
-{
-    for (auto i = 0; i < m_selectedItems.size(); ++i) {
-        auto indexToMove = m_items.indexOf(m_selectedItems.at(i));
-        for (auto j = indexToMove; j > targetIndex + i; --j) {
-            m_items.swapItemsAt(j, j - 1);
+    const auto previous = m_items;
+    m_items = others.mid(0, targetIndex) + block + others.mid(targetIndex);
+    m_selectedItems = block;
+
+    if (targetIndex == 0) {
+        m_firstRank -= block.size();
+        rerank(block, m_firstRank);
+    } else if (targetIndex == others.size()) {
+        rerank(block, m_nextRank);
+        m_nextRank += block.size();
+    } else {
+        /* The ranks of the span, in increasing order, are redistributed */
+        auto begin = qMin(first, targetIndex);
+        auto end = qMax(last, targetIndex + block.size() - 1);
+        QList<qint64> ranks;
+        ranks.reserve(end - begin + 1);
+        for (auto i = begin; i <= end; ++i) {
+            ranks.append(m_entries.value(previous.at(i)).rank);
         }
+        rerank(m_items.mid(begin, end - begin + 1), ranks);
     }
     emit sortChanged();
 }
 
-void DownloadEngine::moveDownTo(qsizetype targetIndex)
+/*!
+ * \brief Gives the consecutive ranks from \a firstRank to the items.
+ */
+void DownloadEngine::rerank(const QList<IDownloadItem*> &items, qint64 firstRank)
+{
+    QList<qint64> ranks;
+    ranks.reserve(items.size());
+    for (qsizetype i = 0; i < items.size(); ++i) {
+        ranks.append(firstRank + i);
+    }
+    rerank(items, ranks);
+}
+
+/*!
+ * \brief Gives the ranks to the items, and moves them in the ready queues.
+ * The items are dequeued first, since a rank can belong to another item
+ * of the list until it's reassigned.
+ */
+void DownloadEngine::rerank(const QList<IDownloadItem*> &items, const QList<qint64> &ranks)
 {
-    auto count = m_selectedItems.size() - 1;
-    for (auto i = count; i >= 0; --i) {
-        auto k = count - i;
-        auto indexToMove = m_items.indexOf(m_selectedItems.at(i));
-        for (auto j = indexToMove; j < targetIndex - k; ++j) {
-            m_items.swapItemsAt(j, j + 1);
+    Q_ASSERT(items.size() == ranks.size());
+    for (auto item : items) {
+        auto it = m_entries.constFind(item);
+        if (it != m_entries.constEnd() && it->state == IDownloadItem::Idle) {
+            dequeueReady(it.value());
+        }
+    }
+    for (qsizetype i = 0; i < items.size(); ++i) {
+        auto it = m_entries.find(items.at(i));
+        if (it == m_entries.end()) {
+            continue;
+        }
+        it->rank = ranks.at(i);
+        if (it->state == IDownloadItem::Idle) {
+            enqueueReady(it.key(), it.value());
         }
     }
-    emit sortChanged();
 }
 
 void DownloadEngine::moveCurrentTop()
 {
-    if (m_selectedItems.isEmpty()) {
-        return;
-    }
-    sortSelectionByIndex();
-    moveUpTo(0);
+    moveSelection(MoveToTop);
 }
 
 void DownloadEngine::moveCurrentUp()
 {
-    if (m_selectedItems.isEmpty()) {
-        return;
-    }
-    sortSelectionByIndex();
-    auto targetIndex = qMax(0, m_items.indexOf(m_selectedItems.first()) - 1);
-    moveUpTo(targetIndex);
+    moveSelection(MoveUp);
 }
 
 void DownloadEngine::moveCurrentDown()
 {
-    if (m_selectedItems.isEmpty()) {
-        return;
-    }
-    sortSelectionByIndex();
-    auto targetIndex = qMin(m_items.size() - 1, m_items.indexOf(m_selectedItems.last()) + 1);
-    moveDownTo(targetIndex);
+    moveSelection(MoveDown);
 }
 
 void DownloadEngine::moveCurrentBottom()
 {
-    if (m_selectedItems.isEmpty()) {
-        return;
-    }
-    sortSelectionByIndex();
-    auto targetIndex = m_items.size() - 1;
-    moveDownTo(targetIndex);
+    moveSelection(MoveToBottom);
 }
 
 /******************************************************************************
@@ -492,3 +1036,19 @@ IDownloadItem* DownloadEngine::createTorrentItem(const QUrl &/*url*/)
 {
     return nullptr;
 }
+
+/*!
+ * \brief Returns true if the url is a magnet link or a .torrent file,
+ * i.e. if the item must be made with createTorrentItem().
+ */
+bool DownloadEngine::isTorrentUrl(const QUrl &url)
+{
+    if (url.scheme().toLower() == QLatin1String("magnet")) {
+        return true;
+    }
+    QFileInfo fi(url.path());
+    if (fi.suffix().toLower() == QLatin1String("torrent")) {
+        return true;
+    }
+    return false;
+}
@@ -18,11 +18,17 @@
 #define CORE_DOWNLOAD_ENGINE_H
 
 #include <Core/IDownloadItem>
+#include <Core/SpeedEstimator>
 
 #include <QtCore/QObject>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
 #include <QtCore/QList>
+#include <QtCore/QMap>
+#include <QtCore/QSet>
 #include <QtCore/QString>
 
+class AbstractDownloadItem;
 class QTimer;
 
 using DownloadRange = QList<IDownloadItem *>;
@@ -45,11 +51,19 @@ public:
     void removeItems(const QList<IDownloadItem *> &items);
     void updateItems(const QList<IDownloadItem *> &items);
 
+    QList<IDownloadItem *> materialize(const QList<IDownloadItem *> &items);
+
     const IDownloadItem* clientForRow(qsizetype row) const;
 
     int maxSimultaneousDownloads() const;
     void setMaxSimultaneousDownloads(int number);
 
+    int maxSimultaneousDownloadsPerHost() const;
+    void setMaxSimultaneousDownloadsPerHost(int number);
+
+    bool isLimitPerDomainEnabled() const;
+    void setLimitPerDomainEnabled(bool enabled);
+
     /* Statistics */
     QList<IDownloadItem *> downloadItems() const;
     QList<IDownloadItem *> waitingJobs() const;
@@ -58,7 +72,16 @@ public:
     QList<IDownloadItem *> failedJobs() const;
     QList<IDownloadItem *> runningJobs() const;
 
+    qsizetype waitingJobCount() const;
+    qsizetype completedJobCount() const;
+    qsizetype pausedJobCount() const;
+    qsizetype failedJobCount() const;
+    qsizetype runningJobCount() const;
+
     qreal totalSpeed();
+    qreal instantSpeed() const;
+    qreal smoothedSpeed() const;
+    qreal averageSpeed() const;
 
     /* Actions */
     void resume(IDownloadItem *item);
@@ -92,10 +115,18 @@ public:
     virtual IDownloadItem* createItem(const QUrl &url);
     virtual IDownloadItem* createTorrentItem(const QUrl &url);
 
+    static bool isTorrentUrl(const QUrl &url);
+
+protected:
+    void flushChanges();
+    virtual IDownloadItem* materializeItem(IDownloadItem *item);
+
 signals:
     void jobAppended(DownloadRange range);
     void jobRemoved(DownloadRange range);
+    void jobReplaced(DownloadRange before, DownloadRange after);
     void jobStateChanged(IDownloadItem *item);
+    void jobsChanged(QSet<IDownloadItem *> items);
     void jobFinished(IDownloadItem *item);
     void jobRenamed(QString oldName, QString newName, bool success);
 
@@ -112,23 +143,80 @@ private slots:
 
 private slots:
     void onSpeedTimerTimeout();
+    void onTick();
+    void onChangeTimerTimeout();
 
 private:
     QList<IDownloadItem *> m_items = {};
 
+    /* Index of the items by state, updated when the items change */
+    struct Entry
+    {
+        IDownloadItem::State state = IDownloadItem::Idle;
+        qreal speed = 0;
+        qsizetype bytesReceived = 0;
+        qint64 rank = 0; /* position in the queue, not contiguous */
+        QString host = {}; /* host or registered domain of the source */
+    };
+    QHash<IDownloadItem *, Entry> m_entries = {};
+    QSet<IDownloadItem *> m_itemsByState[IDownloadItem::FileError + 1] = {};
+    qreal m_speed = 0;
+
+    /* Scheduler: the Idle items, by host then by rank */
+    QHash<QString, QMap<qint64, IDownloadItem *>> m_readyQueues = {};
+    QList<QString> m_readyHosts = {}; /* round-robin order */
+    qsizetype m_nextHost = 0;
+    QHash<QString, int> m_runningPerHost = {};
+    qint64 m_firstRank = 0;
+    qint64 m_nextRank = 0;
+    bool m_isScheduling = false;
+
+    IDownloadItem* nextReadyItem();
+    void enqueueReady(IDownloadItem *item, const Entry &entry);
+    void dequeueReady(const Entry &entry);
+    void rerank(const QList<IDownloadItem *> &items, qint64 firstRank);
+    void rerank(const QList<IDownloadItem *> &items, const QList<qint64> &ranks);
+
+    void connectItem(AbstractDownloadItem *item);
+    void track(IDownloadItem *item);
+    void untrack(IDownloadItem *item);
+    void updateIndex(IDownloadItem *item);
+    void indexEntry(IDownloadItem *item, const Entry &entry);
+    void unindexEntry(IDownloadItem *item, const Entry &entry);
+    QString hostKey(const IDownloadItem *item) const;
+    QList<IDownloadItem *> itemsIn(const QList<IDownloadItem::State> &states) const;
+    qsizetype countIn(const QList<IDownloadItem::State> &states) const;
+
+    /* Throughput of the whole queue, sampled at each tick */
+    SpeedEstimator m_speedEstimator = {};
+    QElapsedTimer m_clock = {};
+    qint64 m_bytesReceived = 0; /* by the running items, since the start */
+
     qreal m_previouSpeed = 0;
     QTimer* m_speedTimer = nullptr;
+    QTimer* m_tickTimer = nullptr;
+
+    /* Items changed since the last jobsChanged() */
+    QSet<IDownloadItem *> m_changedItems = {};
+    QTimer* m_changeTimer = nullptr;
+    void markChanged(IDownloadItem *item);
 
     // Pool
     int m_maxSimultaneousDownloads = 4;
+    int m_maxSimultaneousDownloadsPerHost = 4;
+    bool m_limitPerDomain = false;
     qsizetype downloadingCount() const;
 
     QList<IDownloadItem *> m_selectedItems = {};
     bool m_selectionAboutToChange = false;
 
-    void sortSelectionByIndex();
-    void moveUpTo(qsizetype targetIndex);
-    void moveDownTo(qsizetype targetIndex);
+    enum MoveTarget {
+        MoveToTop,
+        MoveUp,
+        MoveDown,
+        MoveToBottom
+    };
+    void moveSelection(MoveTarget target);
 };
 
 #endif // CORE_DOWNLOAD_ENGINE_H
@@ -16,6 +16,9 @@
 
 #include "downloaditem_p.h"
 
+#include <Constants>
+#include <Core/BandwidthLimiter>
+#include <Core/DiskWriter>
 #include <Core/DownloadManager>
 #include <Core/File>
 #include <Core/NetworkManager>
@@ -25,22 +28,233 @@
 #include <QtCore/QFile>
 #include <QtCore/QFileInfo>
 #include <QtCore/QDir>
+#include <QtCore/QStringList>
 #include <QtNetwork/QNetworkReply>
 
+#include <limits> /* std::numeric_limits */
+
 using namespace Qt::Literals::StringLiterals;
 
 DownloadItemPrivate::DownloadItemPrivate(DownloadItem *qq)
-    : q(qq)
+    : pool(RECEIVE_BUFFER_SIZE)
+    , q(qq)
 {
     file = new File(qq);
 }
 
+DownloadSegment* DownloadItemPrivate::segmentOf(const QObject *reply) const
+{
+    if (reply) {
+        for (auto segment : segments) {
+            if (segment->reply == reply) {
+                return segment;
+            }
+        }
+    }
+    return nullptr;
+}
+
+/*!
+ * \brief Returns the bytes received so far, including the bytes received
+ * before the download was paused.
+ *
+ * The segments always cover all the bytes that remain to download.
+ */
+qsizetype DownloadItemPrivate::segmentsReceived() const
+{
+    if (segments.isEmpty()) {
+        return 0;
+    }
+    if (!isBounded()) {
+        return segments.first()->position();
+    }
+    qsizetype remaining = 0;
+    for (auto segment : segments) {
+        if (!segment->original) {
+            remaining += segment->remaining();
+        }
+    }
+    return qMax(qsizetype(0), q->bytesTotal() - remaining);
+}
+
+bool DownloadItemPrivate::isSegmented() const
+{
+    return segments.count() > 1;
+}
+
+/*!
+ * \brief Returns true if the ends of the segments are known,
+ * i.e. if the size of the file is known.
+ */
+bool DownloadItemPrivate::isBounded() const
+{
+    for (auto segment : segments) {
+        if (segment->end < 0) {
+            return false;
+        }
+    }
+    return !segments.isEmpty() && q->bytesTotal() > 0;
+}
+
+bool DownloadItemPrivate::isSegmentsComplete() const
+{
+    for (auto segment : segments) {
+        if (!segment->isComplete()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int DownloadItemPrivate::activeSegmentCount() const
+{
+    int count = 0;
+    for (auto segment : segments) {
+        if (segment->reply) {
+            count++;
+        }
+    }
+    return count;
+}
+
+DownloadSegment* DownloadItemPrivate::duplicateOf(const DownloadSegment *segment) const
+{
+    for (auto other : segments) {
+        if (other->original == segment) {
+            return other;
+        }
+    }
+    return nullptr;
+}
+
+/*!
+ * \brief Returns the segment that downloads the same range, in endgame.
+ */
+DownloadSegment* DownloadItemPrivate::twinOf(const DownloadSegment *segment) const
+{
+    return segment->original ? segment->original : duplicateOf(segment);
+}
+
+/*!
+ * \brief Returns the running segment that will finish last,
+ * among those with at least minRemaining bytes to download.
+ */
+DownloadSegment* DownloadItemPrivate::slowestSegment(qsizetype minRemaining) const
+{
+    DownloadSegment *slowest = nullptr;
+    qreal slowestTime = 0;
+    auto now = clock.elapsed();
+    for (auto segment : segments) {
+        if (!segment->reply || twinOf(segment) || segment->remaining() < minRemaining) {
+            continue;
+        }
+        /* Estimated time to finish; a segment that received nothing yet is the slowest */
+        auto elapsed = qMax(qint64(1), now - segment->startTime);
+        auto time = segment->received > 0
+                ? static_cast<qreal>(segment->remaining()) * static_cast<qreal>(elapsed) / static_cast<qreal>(segment->received)
+                : std::numeric_limits<qreal>::max();
+        if (!slowest || time > slowestTime
+                || (time == slowestTime && segment->remaining() > slowest->remaining())) {
+            slowest = segment;
+            slowestTime = time;
+        }
+    }
+    return slowest;
+}
+
+/*!
+ * \brief Completes the twin of the given complete segment, if any.
+ * The first of the two connections to reach the end of the range wins,
+ * the other one is aborted.
+ */
+void DownloadItemPrivate::completeTwins(DownloadSegment *segment)
+{
+    if (auto original = segment->original) {
+        releaseReply(original);
+        original->received = original->end + 1 - original->begin;
+        segments.removeAll(segment);
+        delete segment;
+
+    } else if (auto duplicate = duplicateOf(segment)) {
+        releaseReply(duplicate);
+        segments.removeAll(duplicate);
+        delete duplicate;
+    }
+}
+
+/*!
+ * \brief Gives up the given segment, because its twin is still running.
+ * An original segment is kept: its twin will complete it.
+ */
+void DownloadItemPrivate::dropTwin(DownloadSegment *segment)
+{
+    releaseReply(segment);
+    if (segment->original) {
+        segments.removeAll(segment);
+        delete segment;
+    }
+}
+
+/*!
+ * \brief Detaches the reply from the segment, aborting it if still running.
+ */
+void DownloadItemPrivate::releaseReply(DownloadSegment *segment)
+{
+    if (segment->reply) {
+        segment->reply->disconnect(q);
+        segment->reply->abort();
+        segment->reply->deleteLater();
+        segment->reply = nullptr;
+    }
+}
+
+/*!
+ * \brief Detaches all the replies.
+ * The duplicates are discarded: their ranges are still in their original segments.
+ */
+void DownloadItemPrivate::releaseReplies()
+{
+    for (auto segment : segments) {
+        releaseReply(segment);
+    }
+    QList<DownloadSegment*> originals;
+    for (auto segment : segments) {
+        if (segment->original) {
+            delete segment;
+        } else {
+            originals.append(segment);
+        }
+    }
+    segments = originals;
+}
+
+void DownloadItemPrivate::clearSegments()
+{
+    releaseReplies();
+    qDeleteAll(segments);
+    segments.clear();
+}
+
+/*!
+ * \brief Returns the value of the 'If-Range' header.
+ * A weak ETag can't be used to validate a range, so fall back to the date.
+ */
+QString DownloadItemPrivate::ifRange() const
+{
+    auto entityTag = resource->httpEntityTag();
+    if (!entityTag.isEmpty() && !entityTag.startsWith("W/"_L1)) {
+        return entityTag;
+    }
+    return resource->httpLastModified();
+}
+
 /******************************************************************************
  ******************************************************************************/
 DownloadItem::DownloadItem(DownloadManager *downloadManager) : AbstractDownloadItem(downloadManager)
   , d(new DownloadItemPrivate(this))
 {
     d->downloadManager = downloadManager;
+    connect(d->file, SIGNAL(committed(bool)), this, SLOT(onCommitted(bool)));
 }
 
 DownloadItem::~DownloadItem()
@@ -50,11 +264,7 @@ DownloadItem::~DownloadItem()
         d->file = nullptr;
     }
 
-    if (d->reply) {
-        d->reply->abort();
-        d->reply->deleteLater();
-        d->reply = nullptr;
-    }
+    d->clearSegments();
 }
 
 /******************************************************************************
@@ -65,7 +275,9 @@ void DownloadItem::resume()
 
     this->beginResume();
 
-    auto flag = d->file->open(d->resource);
+    auto resumable = !d->segments.isEmpty() && !d->isSegmentsComplete();
+
+    auto flag = d->file->open(d->resource, resumable);
 
     if (flag == File::Skip) {
         setState(Skipped);
@@ -79,29 +291,51 @@ void DownloadItem::resume()
     /* Prepare the connection, try to contact the server */
     if (this->checkResume(connected)) {
 
+        connectLimiters();
         auto url = d->resource->url_TODO();
-        d->reply = d->downloadManager->networkManager()->get(url);
-        d->reply->setParent(this);
-
-        /* Signals/Slots of QNetworkReply */
-        connect(d->reply, SIGNAL(metaDataChanged()), this, SLOT(onMetaDataChanged()));
-        connect(d->reply, SIGNAL(downloadProgress(qint64,qint64)), this, SLOT(onDownloadProgress(qint64,qint64)));
-        connect(d->reply, SIGNAL(redirected(QUrl)), this, SLOT(onRedirected(QUrl)));
-        connect(d->reply, SIGNAL(errorOccurred(QNetworkReply::NetworkError)), this, SLOT(onErrorOccurred(QNetworkReply::NetworkError)));
-        connect(d->reply, SIGNAL(finished()), this, SLOT(onFinished()));
+        d->clock.start();
 
-        /* Signals/Slots of QIODevice */
-        connect(d->reply, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
-        connect(d->reply, SIGNAL(aboutToClose()), this, SLOT(onAboutToClose()));
+        if (resumable && d->file->size() > 0) {
+            /* Request the missing byte ranges only, if the file didn't change */
+            logInfo(QString("Resume byte ranges '%0' of '%1'.").arg(pendingRanges(), url.toString()));
+            auto ifRange = d->ifRange();
+            for (auto segment : d->segments) {
+                if (!segment->isComplete()) {
+                    segment->begin = segment->position();
+                    segment->received = 0;
+                    segment->startTime = 0;
+                    segment->reply = d->downloadManager->networkManager()->getRange(
+                                url, segment->begin, segment->end, ifRange);
+                    connectReply(segment->reply);
+                }
+            }
 
+        } else {
+            /*
+             * The first segment covers the whole file, until the server tells us
+             * its size and whether it accepts byte ranges (see onMetaDataChanged()).
+             */
+            d->clearSegments();
+            d->isRangeRefused = false;
+            setBytesReceived(0);
+            auto segment = new DownloadSegment();
+            segment->reply = d->downloadManager->networkManager()->get(url);
+            d->segments.append(segment);
+            connectReply(segment->reply);
+        }
         this->tearDownResume();
+        rebalanceSegments();
     }
 }
 
 void DownloadItem::pause()
 {
-    /// \todo implement?
     logInfo(QString("Pause '%0'.").arg(d->resource->url()));
+
+    /* Keep the partial file and the segments, to resume later */
+    d->releaseReplies();
+    disconnectLimiters();
+    d->file->close();
     AbstractDownloadItem::pause();
 }
 
@@ -109,14 +343,287 @@ void DownloadItem::stop()
 {
     logInfo(QString("Stop '%0'.").arg(d->resource->url()));
     d->file->cancel();
-    if (d->reply) {
-        d->reply->abort();
-        d->reply->deleteLater();
-        d->reply = nullptr;
-    }
+    d->clearSegments();
+    disconnectLimiters();
+
+    /* Remove the partial file of a paused download, if any */
+    QFile::remove(File::partialFileName(localFullFileName()));
     AbstractDownloadItem::stop();
 }
 
+/******************************************************************************
+ ******************************************************************************/
+/*!
+ * \brief Returns the byte ranges that remain to download,
+ * formatted like the HTTP 'Range' header: "0-499,1000-".
+ */
+QString DownloadItem::pendingRanges() const
+{
+    QStringList ranges;
+    for (auto segment : d->segments) {
+        if (!segment->isComplete() && !segment->original) {
+            auto end = segment->end < 0 ? QString() : QString::number(segment->end);
+            ranges << QString("%0-%1").arg(QString::number(segment->position()), end);
+        }
+    }
+    return ranges.join(',');
+}
+
+void DownloadItem::setPendingRanges(const QString &ranges)
+{
+    d->clearSegments();
+    const auto tokens = ranges.split(',', Qt::SkipEmptyParts);
+    for (const auto &token : tokens) {
+        auto bounds = token.split('-');
+        if (bounds.count() != 2) {
+            continue;
+        }
+        bool ok = false;
+        auto begin = bounds.at(0).trimmed().toLongLong(&ok);
+        if (!ok || begin < 0) {
+            continue;
+        }
+        auto end = bounds.at(1).trimmed().isEmpty() ? -1 : bounds.at(1).trimmed().toLongLong(&ok);
+        if (!ok || (end >= 0 && end < begin)) {
+            continue;
+        }
+        auto segment = new DownloadSegment();
+        segment->begin = static_cast<qsizetype>(begin);
+        segment->end = static_cast<qsizetype>(end);
+        d->segments.append(segment);
+    }
+}
+
+/******************************************************************************
+ ******************************************************************************/
+/*!
+ * \brief Listens to the disk writer and to the bandwidth limiter.
+ * Only the running downloads are woken up when they can read again.
+ */
+void DownloadItem::connectLimiters()
+{
+    connect(&DiskWriter::getInstance(), SIGNAL(drained()),
+            this, SLOT(onWriterDrained()), Qt::UniqueConnection);
+    connect(&BandwidthLimiter::getInstance(), SIGNAL(refilled()),
+            this, SLOT(onBandwidthRefilled()), Qt::UniqueConnection);
+    connect(&BandwidthLimiter::getInstance(), SIGNAL(limitChanged()),
+            this, SLOT(onBandwidthLimitChanged()), Qt::UniqueConnection);
+}
+
+void DownloadItem::disconnectLimiters()
+{
+    disconnect(&DiskWriter::getInstance(), nullptr, this, nullptr);
+    disconnect(&BandwidthLimiter::getInstance(), nullptr, this, nullptr);
+}
+
+void DownloadItem::connectReply(QNetworkReply *reply)
+{
+    reply->setParent(this);
+
+    /*
+     * When the disk can't keep up, or when the download is throttled,
+     * the data waits here, then in the socket
+     */
+    reply->setReadBufferSize(BandwidthLimiter::getInstance().readBufferSize(d->bucket));
+
+    /* Signals/Slots of QNetworkReply */
+    connect(reply, SIGNAL(metaDataChanged()), this, SLOT(onMetaDataChanged()));
+    connect(reply, SIGNAL(downloadProgress(qint64,qint64)), this, SLOT(onDownloadProgress(qint64,qint64)));
+    connect(reply, SIGNAL(redirected(QUrl)), this, SLOT(onRedirected(QUrl)));
+    connect(reply, SIGNAL(errorOccurred(QNetworkReply::NetworkError)), this, SLOT(onErrorOccurred(QNetworkReply::NetworkError)));
+    connect(reply, SIGNAL(finished()), this, SLOT(onFinished()));
+
+    /* Signals/Slots of QIODevice */
+    connect(reply, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+    connect(reply, SIGNAL(aboutToClose()), this, SLOT(onAboutToClose()));
+}
+
+/*!
+ * \brief Splits the download into byte ranges fetched in parallel.
+ *
+ * The first reply is kept: it becomes the first segment and is aborted once
+ * it reaches the beginning of the second segment.
+ * The other segments are requested with a 'Range' header.
+ *
+ * The download is not split if the server doesn't accept byte ranges,
+ * if the size is unknown or if the file is too small.
+ */
+void DownloadItem::splitIntoSegments(QNetworkReply *reply)
+{
+    Q_ASSERT(d->segments.count() == 1);
+    auto first = d->segments.first();
+
+    /* A compressed length doesn't match the decompressed data */
+    auto encoding = reply->rawHeader("Content-Encoding").trimmed().toLower();
+    auto isIdentity = encoding.isEmpty() || encoding == "identity";
+    auto length = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+    if (!isIdentity || length <= 0) {
+        return;
+    }
+    first->end = static_cast<qsizetype>(length) - 1;
+    setBytesTotal(static_cast<qsizetype>(length));
+
+    if (!d->file->preallocate(length)) {
+        logInfo(QString("Can't preallocate %0 bytes for '%1'.")
+                .arg(QString::number(length), localFullFileName()));
+    }
+
+    auto acceptRanges = reply->rawHeader("Accept-Ranges").trimmed().toLower() == "bytes";
+    if (!acceptRanges || d->isRangeRefused) {
+        return;
+    }
+    auto count = qMin(static_cast<qsizetype>(maxConnectionSegments()),
+                      static_cast<qsizetype>(length) / MIN_CONNECTION_SEGMENT_SIZE);
+    if (count < 2) {
+        return;
+    }
+
+    logInfo(QString("Split '%0' into %1 segments.").arg(reply->url().toString(), QString::number(count)));
+
+    /* Request the next segments at the final url, after redirection */
+    auto url = reply->url();
+    auto ifRange = d->ifRange();
+    auto size = static_cast<qsizetype>(length) / count;
+    first->end = size - 1;
+    for (qsizetype i = 1; i < count; ++i) {
+        auto segment = new DownloadSegment();
+        segment->begin = i * size;
+        segment->end = (i == count - 1) ? static_cast<qsizetype>(length) - 1 : (i + 1) * size - 1;
+        segment->startTime = d->clock.elapsed();
+        segment->reply = d->downloadManager->networkManager()->getRange(url, segment->begin, segment->end, ifRange);
+        d->segments.append(segment);
+        connectReply(segment->reply);
+    }
+}
+
+/*!
+ * \brief Restarts the download from zero, with the given reply.
+ *
+ * The server replied '200 OK' to a range request: either it doesn't support
+ * byte ranges, or the file changed since the download started ('If-Range').
+ * In both cases, the reply contains the whole file, so keep it as the only
+ * segment, and discard the other ones.
+ */
+void DownloadItem::restartFromZero(DownloadSegment *segment, QNetworkReply *reply)
+{
+    logInfo(QString("Server refused byte range '%0-%1' of '%2', restart from zero.")
+            .arg(QString::number(segment->begin),
+                 QString::number(segment->end),
+                 reply->url().toString()));
+
+    for (auto other : d->segments) {
+        if (other != segment) {
+            d->releaseReply(other);
+            delete other;
+        }
+    }
+    d->segments = { segment };
+    /*
+     * After a validator mismatch, the server still accepts byte ranges:
+     * the new file can be split again
+     */
+    d->isRangeRefused = reply->rawHeader("Accept-Ranges").trimmed().toLower() != "bytes";
+    d->file->reset();
+
+    segment->begin = 0;
+    segment->end = -1;
+    segment->received = 0;
+    segment->original = nullptr;
+    setBytesReceived(0);
+    setBytesTotal(0);
+    splitIntoSegments(reply);
+}
+
+/*!
+ * \brief Gives some work to the idle connections.
+ *
+ * An idle connection steals the second half of the range of the slowest
+ * segment. When the ranges are too small to be split, the download enters
+ * the endgame: the range of the slowest segment is requested a second time,
+ * and the first connection to complete it wins.
+ */
+void DownloadItem::rebalanceSegments()
+{
+    if (!d->isBounded() || d->isRangeRefused || !isDownloading()) {
+        return;
+    }
+    auto ifRange = d->ifRange();
+    while (d->activeSegmentCount() < maxConnectionSegments()) {
+        auto segment = new DownloadSegment();
+        auto slowest = d->slowestSegment(2 * ENDGAME_BLOCK_SIZE);
+        if (slowest) {
+            segment->begin = slowest->end + 1 - slowest->remaining() / 2;
+            segment->end = slowest->end;
+            slowest->end = segment->begin - 1;
+            logInfo(QString("Steal byte range '%0-%1' from segment [%2-%3].")
+                    .arg(QString::number(segment->begin),
+                         QString::number(segment->end),
+                         QString::number(slowest->begin),
+                         QString::number(slowest->end)));
+        } else {
+            slowest = d->slowestSegment(1);
+            if (!slowest) {
+                delete segment;
+                break;
+            }
+            segment->begin = slowest->position();
+            segment->end = slowest->end;
+            segment->original = slowest;
+            logInfo(QString("Endgame: duplicate byte range '%0-%1'.")
+                    .arg(QString::number(segment->begin),
+                         QString::number(segment->end)));
+            setState(Endgame);
+        }
+        /* The slowest reply is running, so it knows the final url */
+        segment->startTime = d->clock.elapsed();
+        segment->reply = d->downloadManager->networkManager()->getRange(
+                    slowest->reply->url(), segment->begin, segment->end, ifRange);
+        d->segments.append(segment);
+        connectReply(segment->reply);
+    }
+}
+
+/*!
+ * \brief Called when the given segment has received its whole range.
+ */
+void DownloadItem::completeSegment(DownloadSegment *segment)
+{
+    d->releaseReply(segment);
+    d->completeTwins(segment);
+    if (d->isSegmentsComplete()) {
+        onFinished();
+    } else {
+        rebalanceSegments();
+    }
+}
+
+void DownloadItem::setMaxConnectionSegments(int connectionSegments)
+{
+    AbstractDownloadItem::setMaxConnectionSegments(connectionSegments);
+    rebalanceSegments();
+}
+
+void DownloadItem::setSpeedLimit(qint64 bytesPerSecond)
+{
+    AbstractDownloadItem::setSpeedLimit(bytesPerSecond);
+    d->bucket.setRate(speedLimit());
+    updateReadBufferSizes();
+}
+
+/*!
+ * \brief Resizes the read buffers of the replies, so that they hold
+ * a burst of data at the current speed limit.
+ */
+void DownloadItem::updateReadBufferSizes()
+{
+    auto size = BandwidthLimiter::getInstance().readBufferSize(d->bucket);
+    for (auto segment : std::as_const(d->segments)) {
+        if (segment->reply) {
+            segment->reply->setReadBufferSize(size);
+        }
+    }
+}
+
 /******************************************************************************
  ******************************************************************************/
 void DownloadItem::rename(const QString &newName)
@@ -140,6 +647,11 @@ void DownloadItem::rename(const QString &newName)
     if (QFile::exists(oldPath) && !QFile::rename(oldPath, newPath)) {
         success = false; /* File error */
     }
+    auto oldPartialPath = File::partialFileName(oldPath);
+    if (success && !d->file->isOpen() && QFile::exists(oldPartialPath)
+            && !QFile::rename(oldPartialPath, File::partialFileName(newPath))) {
+        success = false; /* File error */
+    }
     if (success) {
         d->resource->setCustomFileName(newCustomFileName);
         if (d->file->isOpen()) {
@@ -154,8 +666,10 @@ void DownloadItem::rename(const QString &newName)
  ******************************************************************************/
 void DownloadItem::onMetaDataChanged()
 {
-    if (d->reply) {
-        auto rawNewUrl = d->reply->header(QNetworkRequest::LocationHeader);
+    auto reply = qobject_cast<QNetworkReply*>(sender());
+    auto segment = d->segmentOf(reply);
+    if (segment) {
+        auto rawNewUrl = reply->header(QNetworkRequest::LocationHeader);
         if (rawNewUrl.isValid()) {
             auto oldUrl = d->resource->url_TODO();
             auto newUrl = rawNewUrl.toUrl();
@@ -164,9 +678,21 @@ void DownloadItem::onMetaDataChanged()
                 logInfo(QString("HTTP redirect: '%0' to '%1'.").arg(oldUrl.toString(), newUrl.toString()));
             }
         }
+        auto statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (statusCode == 200) {
+            /* Keep the validators, to resume the download later */
+            d->resource->setHttpEntityTag(QString::fromLatin1(reply->rawHeader("ETag")));
+            d->resource->setHttpLastModified(QString::fromLatin1(reply->rawHeader("Last-Modified")));
+
+            if (reply->request().hasRawHeader("Range")) {
+                restartFromZero(segment, reply);
+            } else if (d->segments.count() == 1) {
+                splitIntoSegments(reply);
+            }
+        }
         auto settings = d->downloadManager->settings();
-        auto rawTime = d->reply->header(QNetworkRequest::LastModifiedHeader);
-        if (settings && rawTime.isValid()) {
+        auto rawTime = reply->header(QNetworkRequest::LastModifiedHeader);
+        if (settings && rawTime.isValid() && statusCode == 200) {
             auto time = rawTime.toDateTime();
             if (settings->isRemoteCreationTimeEnabled()) {
                 d->file->setCreationFileTime(time);
@@ -186,9 +712,15 @@ void DownloadItem::onMetaDataChanged()
 
 void DownloadItem::onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal)
 {
-    if (d->reply && bytesReceived > 0 && bytesTotal > 0) {
-        logInfo(QString("Downloaded '%0' (%1 of %2 bytes).")
-                .arg(d->reply->url().toString(),
+    if (d->isBounded()) {
+        /* Each reply reports the progress of its own byte range only */
+        updateInfo(d->segmentsReceived(), this->bytesTotal());
+        return;
+    }
+    auto reply = qobject_cast<QNetworkReply*>(sender());
+    if (reply && bytesReceived > 0 && bytesTotal > 0) {
+        logProgress(QString("Downloaded '%0' (%1 of %2 bytes).")
+                .arg(reply->url().toString(),
                      QString::number(bytesReceived),
                      QString::number(bytesTotal)));
     }
@@ -198,15 +730,52 @@ void DownloadItem::onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal)
 
 void DownloadItem::onRedirected(const QUrl &url)
 {
-    if (d->reply) {
+    auto reply = qobject_cast<QNetworkReply*>(sender());
+    if (reply) {
         logInfo(QString("HTTP redirect: redirected '%0' to '%1'.")
-                .arg(d->reply->url().toString(), url.toString()));
+                .arg(reply->url().toString(), url.toString()));
     }
 }
 
 void DownloadItem::onFinished()
 {
+    auto segment = d->segmentOf(sender());
+    if (segment) {
+        /* The data left in the reply, if the disk was congested or throttled */
+        writeAvailable(segment, true);
+        d->releaseReply(segment);
+    }
+    if (d->isBounded() && isDownloading()) {
+        if (segment && segment->isComplete()) {
+            completeSegment(segment);
+            return;
+        }
+        if (segment && d->twinOf(segment) && d->twinOf(segment)->reply) {
+            d->dropTwin(segment); /* Endgame: the twin still downloads the range */
+            return;
+        }
+        if (segment) {
+            /* The server closed the connection before the end of the range */
+            logInfo(QString("Error '%0': segment [%1-%2] closed at %3.")
+                    .arg(d->resource->url(),
+                         QString::number(segment->begin),
+                         QString::number(segment->end),
+                         QString::number(segment->position())));
+            setErrorMessage(statusToHttp(QNetworkReply::RemoteHostClosedError));
+            setState(NetworkError);
+        } else if (!d->isSegmentsComplete()) {
+            return; /* Wait for the other segments */
+        } else {
+            updateInfo(d->segmentsReceived(), bytesTotal());
+        }
+    }
+    if (d->pool.acquisitionCount() > 0) {
+        logInfo(QString("Received %0 chunks in %1 allocated buffers.")
+                .arg(QString::number(d->pool.acquisitionCount()),
+                     QString::number(d->pool.allocationCount())));
+    }
     logInfo(QString("Finished (%0) '%1'.").arg(state_c_str(), localFullFileName()));
+    auto isCommitting = false;
     switch (state()) {
     case Idle:
     case Preparing:
@@ -228,30 +797,50 @@ void DownloadItem::onFinished()
             setBytesReceived(0);
             // setBytesTotal(0);
             d->file->cancel();
+            d->clearSegments();
             emit changed();
         } else {
             /* Here, finish the operation if downloading. */
             /* If network error or file error, just ignore */
-            bool commited = d->file->commit();
-            preFinish(commited);
+            /* The file is committed by the writer thread: finish at onCommitted() */
+            setState(Endgame);
+            d->file->commit();
+            d->clearSegments();
+            isCommitting = true;
         }
         break;
 
     case Paused:
+    case NetworkError:
+        /* Keep the partial file and the segments, to resume later */
+        d->file->close();
+        emit changed();
+        break;
+
     case Stopped:
     case Skipped:
-    case NetworkError:
     case FileError:
         setBytesReceived(0);
         setBytesTotal(0);
         d->file->cancel();
+        d->clearSegments();
         emit changed();
         break;
     }
-    if (d->reply) {
-        d->reply->deleteLater();
-        d->reply = nullptr;
+    d->releaseReplies();
+    d->pool.clear();
+    disconnectLimiters();
+    if (!isCommitting) {
+        this->finish();
+    }
+}
+
+void DownloadItem::onCommitted(bool commited)
+{
+    if (state() != Endgame) {
+        return; /* Paused or stopped meanwhile */
     }
+    preFinish(commited);
     this->finish();
 }
 
@@ -316,11 +905,35 @@ QString DownloadItem::statusToHttp(QNetworkReply::NetworkError error)
 
 void DownloadItem::onErrorOccurred(QNetworkReply::NetworkError error)
 {
-    /// \todo Use instead: auto reply = qobject_cast<QNetworkReply*>(sender());
-    if (d->reply) {
-        logInfo(QString("Error '%0': '%1'.").arg(d->reply->url().toString(),d->reply->errorString()));
+    auto reply = qobject_cast<QNetworkReply*>(sender());
+    if (reply) {
+        logInfo(QString("Error '%0': '%1'.").arg(reply->url().toString(), reply->errorString()));
+    }
+    auto failed = d->segmentOf(reply);
+    if (failed && d->twinOf(failed) && d->twinOf(failed)->reply) {
+        d->dropTwin(failed); /* Endgame: the twin still downloads the range */
+        return;
+    }
+    /* One failed segment fails the whole download: stop the other ones */
+    for (auto segment : d->segments) {
+        if (segment->reply != reply) {
+            d->releaseReply(segment);
+        }
+    }
+    auto statusCode = reply ? reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() : 0;
+    if (statusCode == 416) {
+        /*
+         * Range Not Satisfiable: the partial file can't be resumed.
+         * The failed reply stays connected: its finished() finishes the download.
+         */
+        if (failed) {
+            failed->reply = nullptr;
+            reply->deleteLater();
+        }
+        d->file->cancel();
+        d->clearSegments();
+        setBytesReceived(0);
     }
-    d->file->cancel();
     auto httpError = statusToHttp(error);
     setErrorMessage(httpError);
     setState(NetworkError);
@@ -328,11 +941,127 @@ void DownloadItem::onErrorOccurred(QNetworkReply::NetworkError error)
 
 void DownloadItem::onReadyRead()
 {
-    if (!d->reply || !d->file) {
+    auto segment = d->segmentOf(sender());
+    if (!segment || DiskWriter::getInstance().isCongested()) {
+        /* The data waits in the reply, until the disk catches up */
         return;
     }
-    QByteArray data = d->reply->readAll();
-    d->file->write(data);
+    readSegment(segment);
+}
+
+/*!
+ * \brief Reads the data again, now that the disk caught up.
+ */
+void DownloadItem::onWriterDrained()
+{
+    readBufferedSegments();
+}
+
+/*!
+ * \brief Reads the data again, now that the download can receive more bytes.
+ */
+void DownloadItem::onBandwidthRefilled()
+{
+    readBufferedSegments();
+}
+
+void DownloadItem::onBandwidthLimitChanged()
+{
+    updateReadBufferSizes();
+    readBufferedSegments();
+}
+
+/*!
+ * \brief Reads the data already buffered in the replies:
+ * no readyRead() is emitted for it.
+ */
+void DownloadItem::readBufferedSegments()
+{
+    const auto segments = d->segments;
+    for (auto segment : segments) {
+        if (!isDownloading() || DiskWriter::getInstance().isCongested()) {
+            return;
+        }
+        if (d->segments.contains(segment)
+                && segment->reply
+                && segment->reply->bytesAvailable() > 0) {
+            readSegment(segment);
+        }
+    }
+}
+
+void DownloadItem::readSegment(DownloadSegment *segment)
+{
+    auto reply = segment->reply;
+    if (!writeAvailable(segment)) {
+        d->releaseReplies();
+        onFinished();
+        return;
+    }
+    if (segment->isComplete() && d->isBounded() && reply->isRunning()) {
+        /* The reply reached the next segment, or a stolen range: stop it here */
+        completeSegment(segment);
+    }
+}
+
+/*!
+ * \brief Writes the data buffered in the reply of the segment.
+ * Returns false, and sets the FileError state, if the data can't be written.
+ *
+ * The data is read into recycled buffers, that are passed as is to the
+ * DiskWriter thread, without copy.
+ *
+ * The reading stops when the speed limit is reached, unless the reply
+ * is finished: its last data is read anyway.
+ */
+bool DownloadItem::writeAvailable(DownloadSegment *segment, bool isFinished)
+{
+    auto reply = segment->reply;
+    if (!reply || !d->file) {
+        return true;
+    }
+    while (reply->bytesAvailable() > 0) {
+        auto remaining = segment->remaining();
+        if (remaining == 0) {
+            /* The data beyond the range is downloaded by another segment */
+            reply->skip(reply->bytesAvailable());
+            break;
+        }
+        auto size = qMin(reply->bytesAvailable(), static_cast<qint64>(d->pool.slabSize()));
+        if (remaining > 0) {
+            size = qMin(size, static_cast<qint64>(remaining));
+        }
+        auto &limiter = BandwidthLimiter::getInstance();
+        if (isFinished) {
+            limiter.consume(d->bucket, size);
+        } else {
+            size = limiter.acquire(d->bucket, size);
+            if (size == 0) {
+                break; /* Throttled: read again when refilled */
+            }
+        }
+        auto buffer = d->pool.acquire();
+        auto count = reply->read(buffer.data(), size);
+        if (!isFinished && count < size) {
+            /* The reply had less data than announced */
+            limiter.refund(d->bucket, size - qMax(count, qint64(0)));
+        }
+        if (count <= 0) {
+            d->pool.release(buffer);
+            break;
+        }
+        buffer.resize(count);
+        auto written = d->file->write(segment->position(), buffer);
+        d->pool.release(buffer);
+        if (!written) {
+            logInfo(QString("Error: can't write to '%0'.").arg(localFullFileName()));
+            setErrorMessage(tr("Can't write to the file"));
+            setState(FileError);
+            return false;
+        }
+        segment->received += count;
+    }
+    return true;
 }
 
 void DownloadItem::onAboutToClose()
@@ -26,6 +26,7 @@
 
 class File;
 class DownloadItemPrivate;
+class DownloadSegment;
 class DownloadManager;
 class ResourceItem;
 
@@ -55,14 +56,25 @@ public:
 
     void rename(const QString &newName) override;
 
+    void setMaxConnectionSegments(int connectionSegments) override;
+    void setSpeedLimit(qint64 bytesPerSecond) override;
+
+    /* Byte ranges still to download, to resume the download later */
+    QString pendingRanges() const;
+    void setPendingRanges(const QString &ranges);
+
 private slots:
     void onMetaDataChanged();
     void onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal);
     void onRedirected(const QUrl &url);
     void onFinished();
+    void onCommitted(bool commited);
     void onErrorOccurred(QNetworkReply::NetworkError error);
     void onReadyRead();
     void onAboutToClose();
+    void onWriterDrained();
+    void onBandwidthRefilled();
+    void onBandwidthLimitChanged();
 
 protected:
     File* file() const;
@@ -72,6 +84,18 @@ private:
     friend class DownloadItemPrivate;
 
     QString statusToHttp(QNetworkReply::NetworkError error);
+
+    void connectLimiters();
+    void disconnectLimiters();
+    void connectReply(QNetworkReply *reply);
+    void splitIntoSegments(QNetworkReply *reply);
+    void restartFromZero(DownloadSegment *segment, QNetworkReply *reply);
+    void rebalanceSegments();
+    void completeSegment(DownloadSegment *segment);
+    void readSegment(DownloadSegment *segment);
+    void readBufferedSegments();
+    bool writeAvailable(DownloadSegment *segment, bool isFinished = false);
+    void updateReadBufferSizes();
 };
 
 #endif // CORE_DOWNLOAD_ITEM_H
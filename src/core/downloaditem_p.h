@@ -19,12 +19,37 @@
 
 #include "downloaditem.h"
 
+#include <Core/BandwidthLimiter>
+#include <Core/BufferPool>
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QList>
+
 class DownloadManager;
 class File;
 class ResourceItem;
 
 class QNetworkReply;
 
+/*!
+ * A segment is a contiguous byte range of the remote file,
+ * fetched by its own network reply and written at its offset in the file.
+ */
+class DownloadSegment
+{
+public:
+    QNetworkReply *reply = nullptr;
+    qsizetype begin = 0;    /*!< offset of the first byte */
+    qsizetype end = -1;     /*!< offset of the last byte (inclusive), or -1 if unknown */
+    qsizetype received = 0; /*!< bytes written from begin */
+    qint64 startTime = 0;   /*!< msecs since the download resumed, when requested */
+    DownloadSegment *original = nullptr; /*!< in endgame, the segment this one duplicates */
+
+    qsizetype position() const { return begin + received; }
+    qsizetype remaining() const { return end < 0 ? -1 : end + 1 - position(); }
+    bool isComplete() const { return end >= 0 && position() > end; }
+};
+
 class DownloadItemPrivate
 {    
 public:
@@ -32,10 +57,32 @@ public:
 
     DownloadManager *downloadManager = nullptr;
     ResourceItem *resource = nullptr;
-    QNetworkReply *reply = nullptr;
+    QList<DownloadSegment*> segments = {};
     File *file = nullptr;
+    BufferPool pool;
+    TokenBucket bucket; /* the speed limit of this download */
 
     DownloadItem *q = nullptr;
+
+    bool isRangeRefused = false;
+    QElapsedTimer clock;
+
+    DownloadSegment* segmentOf(const QObject *reply) const;
+    qsizetype segmentsReceived() const;
+    bool isSegmented() const;
+    bool isBounded() const;
+    bool isSegmentsComplete() const;
+    int activeSegmentCount() const;
+    DownloadSegment* duplicateOf(const DownloadSegment *segment) const;
+    DownloadSegment* twinOf(const DownloadSegment *segment) const;
+    DownloadSegment* slowestSegment(qsizetype minRemaining) const;
+    void completeTwins(DownloadSegment *segment);
+    void dropTwin(DownloadSegment *segment);
+    void releaseReply(DownloadSegment *segment);
+    void releaseReplies();
+    void clearSegments();
+
+    QString ifRange() const;
 };
 
 #endif // CORE_DOWNLOAD_ITEM_P_H
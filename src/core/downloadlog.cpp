@@ -0,0 +1,246 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "downloadlog.h"
+
+#include <Constants>
+
+#include <QtCore/QDateTime>
+#include <QtCore/QDebug>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+
+/*!
+ * \class DownloadLog
+ *
+ * Ring buffer of the last LOG_MAX_LINES lines of log of a download.
+ *
+ * The progress lines are rate-limited: a progress line that comes
+ * within MSEC_LOG_PROGRESS of the previous one replaces it.
+ *
+ * Optionally, the lines that leave the ring are spilled to a log file
+ * in directory(), rotated above LOG_FILE_MAX_SIZE (the previous one is
+ * renamed with the suffix ".1"). The log file is read by fullText() only,
+ * i.e. when the user opens the log.
+ *
+ * The log file is named after the id of the download in the session,
+ * and removed with the download, see remove().
+ */
+
+static QString s_directory = {};
+
+static QString toLine(const QString &message)
+{
+    QDateTime local(QDateTime::currentDateTime());
+    auto timestamp = local.toString(QLatin1String("yyyy-MM-dd HH:mm:ss.zzz"));
+    return "[" + timestamp + "] " + message.left(LOG_MAX_LINE_LENGTH);
+}
+
+DownloadLog::~DownloadLog()
+{
+    flush();
+}
+
+/******************************************************************************
+ ******************************************************************************/
+void DownloadLog::append(const QString &message)
+{
+    push(message);
+    m_isLastProgress = false;
+}
+
+/*!
+ * \brief Appends the progress message, or replaces the previous
+ * progress message if it's too recent.
+ */
+void DownloadLog::appendProgress(const QString &message)
+{
+    if (m_isLastProgress && m_progressTimer.isValid()
+            && m_progressTimer.elapsed() < MSEC_LOG_PROGRESS) {
+        last() = toLine(message);
+        return;
+    }
+    push(message);
+    m_isLastProgress = true;
+    m_progressTimer.start();
+}
+
+void DownloadLog::push(const QString &message)
+{
+    auto line = toLine(message);
+
+    /* The ring grows up to its capacity, then overwrites its oldest line */
+    if (m_lines.size() < LOG_MAX_LINES) {
+        m_lines.append(line);
+        return;
+    }
+    if (!fileName().isEmpty()) {
+        m_spilled.append(m_lines.at(m_head));
+        m_spilled.append('\n');
+        if (m_spilled.size() > LOG_SPILL_CHUNK) {
+            flush();
+        }
+    }
+    m_lines[m_head] = line;
+    m_head = (m_head + 1) % m_lines.size();
+}
+
+QString &DownloadLog::last()
+{
+    Q_ASSERT(!m_lines.isEmpty());
+    return m_lines[(m_head + m_lines.size() - 1) % m_lines.size()];
+}
+
+/******************************************************************************
+ ******************************************************************************/
+qsizetype DownloadLog::count() const
+{
+    return m_lines.size();
+}
+
+/*!
+ * \brief Returns the lines kept in memory.
+ */
+QString DownloadLog::text() const
+{
+    QString text;
+    for (qsizetype i = 0; i < m_lines.size(); ++i) {
+        text.append(m_lines.at((m_head + i) % m_lines.size()));
+        text.append('\n');
+    }
+    return text;
+}
+
+/*!
+ * \brief Returns the whole log, including the lines spilled to the log file.
+ */
+QString DownloadLog::fullText() const
+{
+    QString text;
+    auto name = fileName();
+    if (!name.isEmpty()) {
+        for (const auto &path : {name + ".1", name}) {
+            QFile file(path);
+            if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+                text.append(QString::fromUtf8(file.readAll()));
+            }
+        }
+        text.append(m_spilled);
+    }
+    text.append(this->text());
+    return text;
+}
+
+/******************************************************************************
+ ******************************************************************************/
+qint64 DownloadLog::id() const
+{
+    return m_id;
+}
+
+/*!
+ * \brief Sets the id that identifies the log file, e.g. the id of the download in the session.
+ * The log isn't spilled without id.
+ */
+void DownloadLog::setId(qint64 id)
+{
+    if (m_id != id) {
+        flush();
+        m_id = id;
+    }
+}
+
+/*!
+ * \brief Returns the path of the log file, or an empty string if the log isn't spilled.
+ */
+QString DownloadLog::fileName() const
+{
+    if (s_directory.isEmpty() || m_id < 0) {
+        return {};
+    }
+    return QString("%0/%1%2").arg(s_directory, QString::number(m_id), LOG_FILE_SUFFIX);
+}
+
+/******************************************************************************
+ ******************************************************************************/
+/*!
+ * \brief Writes the spilled lines to the log file.
+ */
+void DownloadLog::flush()
+{
+    if (m_spilled.isEmpty()) {
+        return;
+    }
+    auto name = fileName();
+    if (name.isEmpty()) {
+        m_spilled.clear();
+        return;
+    }
+    if (QFileInfo(name).size() > LOG_FILE_MAX_SIZE) {
+        QFile::remove(name + ".1");
+        QFile::rename(name, name + ".1");
+    }
+    QDir().mkpath(s_directory);
+    QFile file(name);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        qWarning("Couldn't open log file '%s'.", qPrintable(name));
+        m_spilled.clear();
+        return;
+    }
+    file.write(m_spilled.toUtf8());
+    m_spilled.clear();
+}
+
+void DownloadLog::clear()
+{
+    m_lines.clear();
+    m_head = 0;
+    m_isLastProgress = false;
+    m_spilled.clear();
+}
+
+/*!
+ * \brief Removes the log files, when the download is removed from the queue.
+ */
+void DownloadLog::remove()
+{
+    m_spilled.clear();
+    auto name = fileName();
+    if (!name.isEmpty()) {
+        QFile::remove(name + ".1");
+        QFile::remove(name);
+    }
+    /* The next lines aren't spilled anymore */
+    m_id = -1;
+}
+
+/******************************************************************************
+ ******************************************************************************/
+/*!
+ * \brief Returns the directory of the log files, or an empty string
+ * if the logs aren't spilled.
+ */
+QString DownloadLog::directory()
+{
+    return s_directory;
+}
+
+void DownloadLog::setDirectory(const QString &path)
+{
+    s_directory = path;
+}
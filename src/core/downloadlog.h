@@ -0,0 +1,69 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef CORE_DOWNLOAD_LOG_H
+#define CORE_DOWNLOAD_LOG_H
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QList>
+#include <QtCore/QString>
+
+/*!
+ * @class DownloadLog
+ * @brief Keeps the last lines of the log of a download.
+ */
+class DownloadLog
+{
+public:
+    DownloadLog() = default;
+    ~DownloadLog();
+
+    DownloadLog(const DownloadLog &) = delete;
+    DownloadLog &operator=(const DownloadLog &) = delete;
+
+    void append(const QString &message);
+    void appendProgress(const QString &message);
+
+    qsizetype count() const;
+    QString text() const;
+    QString fullText() const;
+
+    qint64 id() const;
+    void setId(qint64 id);
+    QString fileName() const;
+
+    void flush();
+    void clear();
+    void remove();
+
+    static QString directory();
+    static void setDirectory(const QString &path);
+
+private:
+    QList<QString> m_lines = {};
+    qsizetype m_head = 0;
+    bool m_isLastProgress = false;
+    QElapsedTimer m_progressTimer = {};
+
+    qint64 m_id = -1;
+    QString m_spilled = {};
+
+    void push(const QString &line);
+    QString &last();
+};
+
+#endif // CORE_DOWNLOAD_LOG_H
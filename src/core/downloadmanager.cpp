@@ -17,7 +17,9 @@
 #include "downloadmanager.h"
 
 #include <Constants>
+#include <Core/BandwidthLimiter>
 #include <Core/DownloadItem>
+#include <Core/DownloadLog>
 #include <Core/DownloadTorrentItem>
 #include <Core/NetworkManager>
 #include <Core/ResourceItem>
@@ -25,6 +27,8 @@
 #include <Core/Settings>
 
 #include <QtCore/QDebug>
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
 #include <QtCore/QSettings>
 #include <QtCore/QTimer>
 #include <QtNetwork/QNetworkAccessManager>
@@ -47,16 +51,22 @@ using namespace Qt::Literals::StringLiterals;
 
 DownloadManager::DownloadManager(QObject *parent) : DownloadEngine(parent)
   , m_networkManager(new NetworkManager(this))
+  , m_session(new Session())
 {
     /* Auto save of the queue */
-    connect(this, SIGNAL(jobAppended(DownloadRange)), this, SLOT(onQueueChanged(DownloadRange)));
-    connect(this, SIGNAL(jobRemoved(DownloadRange)), this, SLOT(onQueueChanged(DownloadRange)));
-    connect(this, SIGNAL(jobStateChanged(IDownloadItem*)), this, SLOT(onQueueChanged(IDownloadItem*)));
+    connect(this, SIGNAL(jobAppended(DownloadRange)), this, SLOT(onJobAppended(DownloadRange)));
+    connect(this, SIGNAL(jobRemoved(DownloadRange)), this, SLOT(onJobRemoved(DownloadRange)));
+    connect(this, SIGNAL(jobsChanged(QSet<IDownloadItem*>)), this, SLOT(onJobsChanged(QSet<IDownloadItem*>)));
+    connect(this, SIGNAL(sortChanged()), this, SLOT(onSortChanged()));
 }
 
 DownloadManager::~DownloadManager()
 {
     saveQueue();
+    /* Remove the items without saving the removal, before the session unmaps the records */
+    disconnect(this, nullptr, this, nullptr);
+    clear();
+    delete m_session;
 }
 
 /******************************************************************************
@@ -87,7 +97,27 @@ void DownloadManager::setSettings(Settings *settings)
 
 void DownloadManager::onSettingsChanged()
 {
+    auto queueFilter = (m_settings->isRemoveCompletedEnabled() ? 1 : 0)
+            | (m_settings->isRemoveCanceledEnabled() ? 2 : 0)
+            | (m_settings->isRemovePausedEnabled() ? 4 : 0);
+    if (m_queueFilter != queueFilter) {
+        /* Other items are saved: rewrite the queue */
+        m_queueFilter = queueFilter;
+        m_session->requestCompaction();
+        onQueueChanged();
+    }
     setMaxSimultaneousDownloads(m_settings->maxSimultaneousDownloads());
+    setMaxSimultaneousDownloadsPerHost(m_settings->maxSimultaneousDownloadsPerHost());
+    setLimitPerDomainEnabled(m_settings->isLimitPerDomainEnabled());
+    BandwidthLimiter::getInstance().setDownloadLimit(qint64(m_settings->downloadLimit()) * 1024);
+    BandwidthLimiter::getInstance().setSchedule(m_settings->downloadLimitSchedule());
+    if (m_settings->isLogFileEnabled()) {
+        /* Next to the queue */
+        QFileInfo fi(m_settings->database());
+        DownloadLog::setDirectory(fi.absoluteDir().filePath(LOG_DIRECTORY_NAME));
+    } else {
+        DownloadLog::setDirectory({});
+    }
     // reload the queue here
     if (m_queueFile != m_settings->database()) {
         m_queueFile = m_settings->database();
@@ -100,70 +130,150 @@ void DownloadManager::onSettingsChanged()
 void DownloadManager::loadQueue()
 {
     if (!m_queueFile.isEmpty()) {
-        QList<DownloadItem*> downloadItems;
-        Session::read(downloadItems, m_queueFile, this);
-
-        QList<IDownloadItem*> abstractItems;
-        for (auto item : downloadItems) {
-            // Cast items of the list
-            abstractItems.append(static_cast<IDownloadItem*>(item));
-        }
         clear();
-        append(abstractItems, false);
+        m_session->open(m_queueFile);
+        loadQueueChunk();
     }
 }
 
+/*!
+ * \brief Creates the next items of the queue file, then yields to
+ * the event loop, so that the window shows the first rows at once.
+ *
+ * The finished jobs are appended as records of the queue file:
+ * their item is created by materializeItem(), when needed.
+ */
+void DownloadManager::loadQueueChunk()
+{
+    append(m_session->materialize(this, SESSION_LOAD_CHUNK), false);
+
+    if (m_session->isLoading()) {
+        QTimer::singleShot(0, this, SLOT(loadQueueChunk()));
+    } else {
+        emit queueLoaded();
+    }
+}
+
+/*!
+ * \brief Saves the changes since the previous save only,
+ * unless the whole queue must be rewritten.
+ */
 void DownloadManager::saveQueue()
 {
-    if (!m_queueFile.isEmpty()) {
-        QList<DownloadItem *> items;
-
-        auto skipCompleted = m_settings->isRemoveCompletedEnabled();
-        auto skipCanceled = m_settings->isRemoveCanceledEnabled();
-        auto skipPaused = m_settings->isRemovePausedEnabled();
-
-        auto abstractItems = downloadItems();
-        for (auto abstractItem : abstractItems) {
-            auto item = dynamic_cast<DownloadItem*>(abstractItem);
-            if (item) {
-                switch (item->state()) {
-                case IDownloadItem::Idle:
-                case IDownloadItem::Paused:
-                case IDownloadItem::Preparing:
-                case IDownloadItem::Connecting:
-                case IDownloadItem::DownloadingMetadata:
-                case IDownloadItem::Downloading:
-                case IDownloadItem::Endgame:
-                    if (skipPaused) continue;
-                    break;
-
-                case IDownloadItem::Completed:
-                case IDownloadItem::Seeding:
-                    if (skipCompleted) continue;
-                    break;
-
-                case IDownloadItem::Stopped:
-                case IDownloadItem::Skipped:
-                case IDownloadItem::NetworkError:
-                case IDownloadItem::FileError:
-                    if (skipCanceled) continue;
-                    break;
-                }
-                items.append(item);
-            }
+    flushChanges(); /* Marks the pending changes in the session */
+    if (!m_queueFile.isEmpty() && m_session->hasChanges()) {
+        if (m_session->isCompactionNeeded()) {
+            m_session->compact(savedItems());
+        } else {
+            m_session->commit();
         }
-        Session::write(items, m_queueFile);
     }
 }
 
+bool DownloadManager::isSaved(const IDownloadItem *item) const
+{
+    switch (item->state()) {
+    case IDownloadItem::Idle:
+    case IDownloadItem::Paused:
+    case IDownloadItem::Preparing:
+    case IDownloadItem::Connecting:
+    case IDownloadItem::DownloadingMetadata:
+    case IDownloadItem::Downloading:
+    case IDownloadItem::Endgame:
+        return !m_settings->isRemovePausedEnabled();
 
-void DownloadManager::onQueueChanged(const DownloadRange &/*range*/)
+    case IDownloadItem::Completed:
+    case IDownloadItem::Seeding:
+        return !m_settings->isRemoveCompletedEnabled();
+
+    case IDownloadItem::Stopped:
+    case IDownloadItem::Skipped:
+    case IDownloadItem::NetworkError:
+    case IDownloadItem::FileError:
+        return !m_settings->isRemoveCanceledEnabled();
+    }
+    Q_UNREACHABLE();
+}
+
+QList<IDownloadItem *> DownloadManager::savedItems() const
+{
+    auto items = downloadItems();
+    items.removeIf([this](IDownloadItem *item) { return !isSaved(item); });
+    return items;
+}
+
+/*!
+ * \brief Creates the item of a record of the queue file.
+ */
+IDownloadItem* DownloadManager::materializeItem(IDownloadItem *item)
 {
+    auto record = dynamic_cast<SessionRecord*>(item);
+    if (!record) {
+        return item;
+    }
+    return m_session->readItem(record, this);
+}
+
+void DownloadManager::onJobAppended(const DownloadRange &range)
+{
+    if (m_queueFile.isEmpty()) {
+        return;
+    }
+    for (auto abstractItem : range) {
+        auto item = dynamic_cast<DownloadItem*>(abstractItem);
+        /* The items loaded from the session are already saved */
+        if (item && !m_session->contains(item) && isSaved(item)) {
+            m_session->markChanged(item);
+        }
+    }
     onQueueChanged();
 }
 
-void DownloadManager::onQueueChanged(IDownloadItem* /*item*/)
+void DownloadManager::onJobRemoved(const DownloadRange &range)
 {
+    for (auto abstractItem : range) {
+        auto item = dynamic_cast<AbstractDownloadItem*>(abstractItem);
+        if (item) {
+            item->removeLog();
+        }
+        auto record = dynamic_cast<SessionRecord*>(abstractItem);
+        if (record) {
+            record->removeLog();
+        }
+    }
+    if (m_queueFile.isEmpty()) {
+        return;
+    }
+    for (auto item : range) {
+        m_session->markRemoved(item);
+    }
+    onQueueChanged();
+}
+
+void DownloadManager::onJobsChanged(const QSet<IDownloadItem *> &items)
+{
+    if (m_queueFile.isEmpty() || items.isEmpty()) {
+        return;
+    }
+    for (auto abstractItem : items) {
+        auto item = dynamic_cast<DownloadItem*>(abstractItem);
+        if (item) {
+            if (isSaved(item)) {
+                m_session->markChanged(item);
+            } else {
+                m_session->markRemoved(item);
+            }
+        }
+    }
+    onQueueChanged();
+}
+
+void DownloadManager::onSortChanged()
+{
+    if (m_queueFile.isEmpty()) {
+        return;
+    }
+    m_session->requestCompaction();
     onQueueChanged();
 }
 
@@ -23,6 +23,7 @@
 #include <QtCore/QString>
 
 class ResourceItem;
+class Session;
 class Settings;
 
 class QTimer;
@@ -48,14 +49,23 @@ public:
     IDownloadItem* createItem(const QUrl &url) override;
     IDownloadItem* createTorrentItem(const QUrl &url) override;
 
+protected:
+    IDownloadItem* materializeItem(IDownloadItem *item) override;
+
+signals:
+    void queueLoaded();
+
 private slots:
     void onSettingsChanged();
 
-    void onQueueChanged(const DownloadRange &range);
-    void onQueueChanged(IDownloadItem* item);
+    void onJobAppended(const DownloadRange &range);
+    void onJobRemoved(const DownloadRange &range);
+    void onJobsChanged(const QSet<IDownloadItem *> &items);
+    void onSortChanged();
     void onQueueChanged();
 
     void loadQueue();
+    void loadQueueChunk();
     void saveQueue();
 
 private:
@@ -66,6 +76,11 @@ private:
     /* Crash Recovery */
     QTimer* m_dirtyQueueTimer = nullptr;
     QString m_queueFile = {};
+    Session *m_session = nullptr;
+    int m_queueFilter = 0;
+
+    bool isSaved(const IDownloadItem *item) const;
+    QList<IDownloadItem *> savedItems() const;
 
     inline ResourceItem* createResourceItem(const QUrl &url);
 };
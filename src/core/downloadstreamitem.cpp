@@ -16,6 +16,7 @@
 
 #include "downloadstreamitem.h"
 
+#include <Core/BandwidthLimiter>
 #include <Core/DownloadManager>
 #include <Core/File>
 #include <Core/ResourceItem>
@@ -66,6 +67,9 @@ void DownloadStreamItem::resume()
 
         m_stream->setConfig(resource()->streamConfig());
 
+        /* The process can't be throttled: give it the limit in force at start */
+        m_stream->setRateLimit(BandwidthLimiter::getInstance().streamLimit(TokenBucket(speedLimit())));
+
         connect(m_stream, SIGNAL(downloadMetadataChanged()), this, SLOT(onMetaDataChanged()));
         connect(m_stream, SIGNAL(downloadProgress(qsizetype,qsizetype)), this, SLOT(onDownloadProgress(qsizetype,qsizetype)));
         connect(m_stream, SIGNAL(downloadError(QString)), this, SLOT(onError(QString)));
@@ -81,8 +85,17 @@ void DownloadStreamItem::resume()
 
 void DownloadStreamItem::pause()
 {
-    /// \todo implement?
     logInfo(QString("Pause '%0'.").arg(resource()->url()));
+
+    /* The stream restarts from the beginning */
+    file()->cancel();
+    if (m_stream) {
+        m_stream->abort();
+        m_stream->deleteLater();
+        m_stream = nullptr;
+    }
+    setBytesReceived(0);
+    setBytesTotal(0);
     AbstractDownloadItem::pause();
 }
 
@@ -16,6 +16,8 @@
 
 #include "file.h"
 
+#include <Constants>
+#include <Core/DiskWriter>
 #include <Core/IFileAccessManager>
 #include <Core/ResourceItem>
 #include <Core/Settings>
@@ -24,10 +26,18 @@
 #include <QtCore/QFile>
 #include <QtCore/QFileInfo>
 #include <QtCore/QDir>
-#include <QtCore/QSaveFile>
 #include <QtCore/QDate>
 #include <QtCore/QTime>
 
+#ifdef Q_OS_WIN
+#  include <io.h>
+#  include <windows.h>
+#else /* POSIX */
+#  include <cerrno>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
 static IFileAccessManager *s_fileAccessManager = nullptr;
 
 static ExistingFileOption existingFileOption()
@@ -42,13 +52,31 @@ static ExistingFileOption existingFileOption()
     return option;
 }
 
+/*!
+ * \class File
+ *
+ * The file is written in a partial file, next to the destination,
+ * named like the destination with the suffix PARTIAL_FILE_SUFFIX.
+ *
+ * The partial file is renamed to the destination at commit(),
+ * is kept on the disk at close(), to resume the download later,
+ * or is removed at cancel().
+ *
+ * The partial file is unbuffered: the data is written at its offset with
+ * pwrite(), by the DiskWriter thread. The file is closed by the same
+ * thread, after the pending writes: commit() and close() don't wait
+ * for the disk, and committed() is emitted once the file is renamed.
+ * When the size is known, the space is allocated at once with preallocate(),
+ * which avoids fragmenting the file on the disk.
+ */
+
 File::File(QObject *parent) : QObject(parent)
 {
 }
 
 File::~File()
 {
-    cancel();
+    close();
 }
 
 /******************************************************************************
@@ -62,20 +90,26 @@ void File::setFileAccessManager(IFileAccessManager *manager)
  ******************************************************************************/
 /*!
  * \brief Opens the given fileName, returning Open if successful; otherwise Error or Skip.
+ *
+ * If resumable is true, the content of a previous partial file is kept.
+ * Otherwise, the partial file is truncated.
  */
-File::OpenFlag File::open(ResourceItem *resource)
+File::OpenFlag File::open(ResourceItem *resource, bool resumable)
 {
     Q_ASSERT(resource);
     auto target = resource->localFileUrl();
     auto fileName = target.toLocalFile();
 
-    auto flag = open(fileName);
+    auto flag = open(fileName, resumable);
     resource->setCustomFileName(customFileName());
     return flag;
 }
 
-File::OpenFlag File::open(const QString &fileName)
+File::OpenFlag File::open(const QString &fileName, bool resumable)
 {
+    /* The previous partial file must be closed (or renamed), and its writes done */
+    DiskWriter::getInstance().waitForClosed(m_closeTicket);
+
     // Check Path
     const QFileInfo fi(fileName);
     auto localFilePath = fi.absolutePath();
@@ -83,7 +117,8 @@ File::OpenFlag File::open(const QString &fileName)
 
     // Check Existing File
     auto safeFileName = fileName;
-    if (QFile::exists(safeFileName)) {
+    auto isPartial = resumable && QFile::exists(partialFileName(fileName));
+    if (!isPartial && QFile::exists(safeFileName)) {
 
         auto option = existingFileOption();
 
@@ -107,16 +142,26 @@ File::OpenFlag File::open(const QString &fileName)
 
     // Create and open file
     if (m_file) {
-        cancel();
+        close();
+        DiskWriter::getInstance().waitForClosed(m_closeTicket);
     }
-    m_file = new QSaveFile(this);
-    m_file->setFileName(safeFileName);
-    if (m_file->isOpen() || m_file->open(QIODevice::WriteOnly)) {
+    m_fileName = safeFileName;
+    m_fileTimes.clear();
+    m_file = new QFile(partialFileName(safeFileName), this);
+    auto mode = resumable
+            ? QIODevice::ReadWrite | QIODevice::Unbuffered
+            : QIODevice::ReadWrite | QIODevice::Unbuffered | QIODevice::Truncate;
+    if (m_file->open(mode)) {
         return Open;
     }
     return Error;
 }
 
+QString File::partialFileName(const QString &fileName)
+{
+    return fileName + PARTIAL_FILE_SUFFIX;
+}
+
 /******************************************************************************
  ******************************************************************************/
 bool File::isOpen() const
@@ -124,65 +169,70 @@ bool File::isOpen() const
     return m_file && m_file->isOpen();
 }
 
+qint64 File::size() const
+{
+    return m_file ? m_file->size() : 0;
+}
+
 /*!
  * \brief Rename file to the given resource file name.
  * If rename is a success, return true. Otherwise return false.
  */
 bool File::rename(ResourceItem *resource)
 {
-    /* Flush and close the previous temporary file */
-    QByteArray data;
-    if (m_file && m_file->isOpen()) {
-        m_file->flush();
-        m_file->commit();
-        QString oldFile = m_file->fileName();
-
-        QFile inputFile(this);
-        inputFile.setFileName(oldFile);
-        if (inputFile.open(QIODevice::ReadOnly)) {
-            data = inputFile.readAll();
-            inputFile.close();
-        }
-        m_file->deleteLater();
-        m_file = nullptr;
-        QFile::remove(oldFile);
+    /* Close the previous partial file */
+    QString oldPartialFileName;
+    if (m_file) {
+        oldPartialFileName = m_file->fileName();
+        close();
     }
-    /* Open a new temporary file and append previous data */
-    File::OpenFlag flag = open(resource);
-    if (flag == Open) {
-        write(data);
-        return true;
+    /* Open the new partial file, and move the previous data into it */
+    File::OpenFlag flag = open(resource, true);
+    if (flag != Open) {
+        return false;
     }
-    return false;
+    if (!oldPartialFileName.isEmpty() && oldPartialFileName != m_file->fileName()) {
+        auto newPartialFileName = m_file->fileName();
+        m_file->close();
+        QFile::remove(newPartialFileName);
+        if (!QFile::rename(oldPartialFileName, newPartialFileName)) {
+            return false;
+        }
+        return m_file->open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+    }
+    return true;
 }
 
 /******************************************************************************
  ******************************************************************************/
+/*
+ * The times are applied at commit(), otherwise the next writes
+ * would overwrite the modification time.
+ */
 void File::setCreationFileTime(const QDateTime &newDate)
 {
-    if (m_file && m_file->isOpen()) {
-        m_file->setFileTime(newDate, QFileDevice::FileBirthTime);
-    }
+    setFileTime(newDate, QFileDevice::FileBirthTime);
 }
 
 void File::setLastModifiedFileTime(const QDateTime &newDate)
 {
-    if (m_file && m_file->isOpen()) {
-        m_file->setFileTime(newDate, QFileDevice::FileModificationTime);
-    }
+    setFileTime(newDate, QFileDevice::FileModificationTime);
 }
 
 void File::setAccessFileTime(const QDateTime &newDate)
 {
-    if (m_file && m_file->isOpen()) {
-        m_file->setFileTime(newDate, QFileDevice::FileAccessTime);
-    }
+    setFileTime(newDate, QFileDevice::FileAccessTime);
 }
 
 void File::setMetadataChangeFileTime(const QDateTime &newDate)
+{
+    setFileTime(newDate, QFileDevice::FileMetadataChangeTime);
+}
+
+inline void File::setFileTime(const QDateTime &newDate, QFileDevice::FileTime fileTime)
 {
     if (m_file && m_file->isOpen()) {
-        m_file->setFileTime(newDate, QFileDevice::FileMetadataChangeTime);
+        m_fileTimes.insert(fileTime, newDate);
     }
 }
 
@@ -215,48 +265,166 @@ void File::write(const QByteArray &data)
     }
 }
 
+/*!
+ * \brief Writes the given bytes of data at the given offset of the device.
+ * The segments of a download are written at their position in the file,
+ * in whatever order they arrive.
+ *
+ * The data is written asynchronously by the DiskWriter thread.
+ * Returns false if the previous data couldn't be written, e.g. if the disk is full.
+ */
+bool File::write(qint64 offset, const QByteArray &data)
+{
+    if (!m_file || !m_file->isOpen()) {
+        return false;
+    }
+    return DiskWriter::getInstance().write(m_file->handle(), offset, data);
+}
+
+/*!
+ * \brief Allocates the given size on the disk for the partial file.
+ *
+ * Returns false if the disk is too small.
+ * If the file system can't preallocate, the file is only extended.
+ */
+bool File::preallocate(qint64 size)
+{
+    if (!m_file || !m_file->isOpen() || size <= 0) {
+        return false;
+    }
+    if (m_file->size() >= size) {
+        return true;
+    }
+#if defined(Q_OS_LINUX)
+    /* Unlike posix_fallocate(), fallocate() never falls back to writing zeros */
+    auto fd = m_file->handle();
+    int ret = 0;
+    do {
+        ret = ::fallocate(fd, 0, 0, static_cast<off_t>(size));
+    } while (ret != 0 && errno == EINTR);
+    if (ret == 0) {
+        return true;
+    }
+    if (errno == ENOSPC) {
+        return false;
+    }
+#endif
+    return m_file->resize(size);
+}
+
 /******************************************************************************
  ******************************************************************************/
 /*!
  * \brief Finish writing the file (flush) and close it.
  *
- * Returns true if the temporary file is renamed to the final file.
- * Other returns false.
+ * The file is closed asynchronously, by the DiskWriter thread.
+ * Then committed() is emitted, with true if the partial file is renamed
+ * to the final file, otherwise false.
  *
  * It is mandatory to call this at the end of the saving operation,
- * otherwise the file will be discarded.
+ * otherwise the file stays partial.
  */
-bool File::commit()
+void File::commit()
 {
-    if (m_file) {
-        auto commited = m_file->commit();
-        m_file->deleteLater();
-        m_file = nullptr;
-        return commited;
+    if (!m_file) {
+        QMetaObject::invokeMethod(this, [this]() { emit committed(false); }, Qt::QueuedConnection);
+        return;
     }
-    return false;
+    auto file = release();
+    auto handle = file->handle();
+    auto task = [file, fileName = m_fileName, fileTimes = m_fileTimes](bool written) {
+        auto commited = written && file->flush() && sync(file->handle());
+        for (auto it = fileTimes.constBegin(); it != fileTimes.constEnd(); ++it) {
+            file->setFileTime(it.value(), it.key());
+        }
+        file->close();
+        if (commited) {
+            /* The option for the existing file has been applied at open() */
+            QFile::remove(fileName);
+            commited = file->rename(fileName);
+        }
+        delete file;
+        return commited;
+    };
+    m_closeTicket = DiskWriter::getInstance().close(handle, task, this, [this](bool commited) {
+        emit committed(commited);
+    });
+}
+
+/*!
+ * \brief Detaches the partial file, to be closed by the DiskWriter thread.
+ */
+inline QFile* File::release()
+{
+    auto file = m_file;
+    m_file = nullptr;
+    file->setParent(nullptr);
+    file->moveToThread(&DiskWriter::getInstance());
+    return file;
+}
+
+/*!
+ * \brief Flushes the data to the disk, before the partial file replaces the destination.
+ */
+inline bool File::sync(int handle)
+{
+#ifdef Q_OS_WIN
+    auto fileHandle = reinterpret_cast<HANDLE>(::_get_osfhandle(handle));
+    return ::FlushFileBuffers(fileHandle) != 0;
+#else /* POSIX */
+    return ::fsync(handle) == 0;
+#endif
 }
 
 /******************************************************************************
  ******************************************************************************/
 /*!
- * \brief Cancel writing (close) and remove the temporary file (if exists).
+ * \brief Close the file, but keep the partial file to resume it later.
+ * The file is closed asynchronously, by the DiskWriter thread.
+ */
+void File::close()
+{
+    if (m_file) {
+        auto file = release();
+        m_closeTicket = DiskWriter::getInstance().close(file->handle(), [file](bool written) {
+            file->close();
+            delete file;
+            return written;
+        });
+    }
+}
+
+/*!
+ * \brief Cancel writing (close) and remove the partial file (if exists).
  */
 void File::cancel()
 {
     if (m_file) {
-        m_file->cancelWriting();
+        DiskWriter::getInstance().discard(m_file->handle());
+        m_file->close();
+        m_file->remove();
         m_file->deleteLater();
         m_file = nullptr;
     }
 }
 
+/*!
+ * \brief Discard the content of the partial file, to restart from zero.
+ */
+void File::reset()
+{
+    if (m_file) {
+        DiskWriter::getInstance().discard(m_file->handle());
+        m_file->resize(0);
+    }
+}
+
 /******************************************************************************
  ******************************************************************************/
 QString File::customFileName() const
 {
     if (m_file) {
-        QFileInfo fi(m_file->fileName());
+        QFileInfo fi(m_fileName);
         return fi.completeBaseName();
     }
     return {};
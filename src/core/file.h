@@ -17,12 +17,15 @@
 #ifndef CORE_FILE_H
 #define CORE_FILE_H
 
+#include <QtCore/QDateTime>
+#include <QtCore/QFileDevice>
+#include <QtCore/QMap>
 #include <QtCore/QObject>
 
 class ResourceItem;
 class Settings;
 class IFileAccessManager;
-class QSaveFile;
+class QFile;
 
 class File : public QObject
 {
@@ -40,13 +43,18 @@ public:
 
     static void setFileAccessManager(IFileAccessManager *manager);
 
-    OpenFlag open(ResourceItem *resource);
+    OpenFlag open(ResourceItem *resource, bool resumable = false);
 
     void write(const QByteArray &data);
-    bool commit();
+    bool write(qint64 offset, const QByteArray &data);
+    bool preallocate(qint64 size);
+    void commit();
+    void close();
     void cancel();
+    void reset();
 
     bool isOpen() const;
+    qint64 size() const;
     bool rename(ResourceItem *resource);
     QString customFileName() const;
 
@@ -55,10 +63,21 @@ public:
     void setAccessFileTime(const QDateTime &newDate);
     void setMetadataChangeFileTime(const QDateTime &newDate);
 
+    static QString partialFileName(const QString &fileName);
+
+signals:
+    void committed(bool commited);
+
 private:
-    QSaveFile *m_file = nullptr;
+    QFile *m_file = nullptr;
+    quint64 m_closeTicket = 0;
+    QString m_fileName = {};
+    QMap<QFileDevice::FileTime, QDateTime> m_fileTimes = {};
 
-    inline OpenFlag open(const QString &fileName);
+    inline OpenFlag open(const QString &fileName, bool resumable);
+    inline QFile* release();
+    static inline bool sync(int handle);
+    inline void setFileTime(const QDateTime &newDate, QFileDevice::FileTime fileTime);
     static inline QString nextAvailableName(const QString &name);
 };
 
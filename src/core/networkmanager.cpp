@@ -107,8 +107,44 @@ void NetworkManager::setNetworkSettings(Settings *settings)
  ******************************************************************************/
 QNetworkReply* NetworkManager::get(const QUrl &url, const QString &referer)
 {
-    Q_ASSERT(m_networkAccessManager);
+    auto request = createRequest(url, referer);
+    return send(request);
+}
+
+/*!
+ * \brief Requests the byte range [begin, end] of the resource at the given url.
+ *
+ * The bounds are inclusive, as in the HTTP 'Range' header.
+ * If end is negative, the range is open and extends to the end of the resource.
+ *
+ * The server replies with '206 Partial Content' when it honors the range.
+ *
+ * If ifRange is given (an ETag or a HTTP date), the server sends the range
+ * only if the resource didn't change; otherwise it sends the whole resource
+ * with '200 OK'.
+ */
+QNetworkReply* NetworkManager::getRange(const QUrl &url, qsizetype begin, qsizetype end,
+                                        const QString &ifRange, const QString &referer)
+{
+    auto request = createRequest(url, referer);
+    auto range = end < 0
+            ? QString("bytes=%0-").arg(QString::number(begin))
+            : QString("bytes=%0-%1").arg(QString::number(begin), QString::number(end));
+    request.setRawHeader(QByteArray("Range"), range.toLatin1());
+    if (!ifRange.isEmpty()) {
+        request.setRawHeader(QByteArray("If-Range"), ifRange.toLatin1());
+    }
+
+    /*
+     * Byte ranges are offsets in the encoded representation of the resource,
+     * so ask for the raw content, not a compressed one.
+     */
+    request.setRawHeader(QByteArray("Accept-Encoding"), QByteArray("identity"));
+    return send(request);
+}
 
+inline QNetworkRequest NetworkManager::createRequest(const QUrl &url, const QString &referer) const
+{
     QNetworkRequest request;
     request.setUrl(url);
 
@@ -126,6 +162,12 @@ QNetworkReply* NetworkManager::get(const QUrl &url, const QString &referer)
     request.setSslConfiguration(QSslConfiguration::defaultConfiguration()); // HTTPS
     request.setMaximumRedirectsAllowed(MAX_REDIRECTS_ALLOWED);
     request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+    return request;
+}
+
+inline QNetworkReply* NetworkManager::send(const QNetworkRequest &request)
+{
+    Q_ASSERT(m_networkAccessManager);
 
     auto reply = m_networkAccessManager->get(request);
 
@@ -19,6 +19,7 @@
 
 #include <QtCore/QObject>
 #include <QtCore/QString>
+#include <QtNetwork/QNetworkRequest>
 
 class Settings;
 
@@ -37,6 +38,8 @@ public:
     void setSettings(Settings *settings);
 
     QNetworkReply* get(const QUrl &url, const QString &referer = {});
+    QNetworkReply* getRange(const QUrl &url, qsizetype begin, qsizetype end = -1,
+                            const QString &ifRange = {}, const QString &referer = {});
 
     static QStringList proxyTypeNames();
 
@@ -51,6 +54,9 @@ private:
     Settings *m_settings = nullptr;
 
     void setNetworkSettings(Settings *settings);
+
+    inline QNetworkRequest createRequest(const QUrl &url, const QString &referer) const;
+    inline QNetworkReply* send(const QNetworkRequest &request);
 };
 
 #endif // CORE_NETWORK_MANAGER_H
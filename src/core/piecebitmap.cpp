@@ -0,0 +1,333 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "piecebitmap.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QtAlgorithms> // qPopulationCount, qCountLeadingZeroBits
+#include <QtCore/QtEndian>     // qFromBigEndian, qToBigEndian
+
+#include <cstring> // std::memcpy
+
+/*!
+ * \class PieceBitmap
+ *
+ * The bits are stored in 64-bit words, so that the conversions, the counts
+ * and the bitwise operations process 64 pieces at once. The counts use
+ * qPopulationCount(), that compiles to the CPU's popcount instruction.
+ *
+ * The piece 0 is the high bit of the first word, like in the BitTorrent
+ * bitfield message and in libtorrent's bitfield, so that their bytes are
+ * copied as is, then loaded as big-endian words.
+ *
+ * The bits beyond size() are always zero, so that the words can be
+ * compared and counted directly.
+ *
+ * The words are implicitly shared: the copies are cheap.
+ */
+
+static constexpr qsizetype BITS_PER_WORD = 64;
+
+static inline qsizetype wordCount(qsizetype size)
+{
+    return (size + BITS_PER_WORD - 1) / BITS_PER_WORD;
+}
+
+static inline quint64 bitMask(qsizetype i)
+{
+    return quint64(1) << (BITS_PER_WORD - 1 - (i % BITS_PER_WORD));
+}
+
+/* Mask of the bits [first, last) of a word, with 0 <= first < last <= 64 */
+static inline quint64 rangeMask(qsizetype first, qsizetype last)
+{
+    const quint64 fromFirst = ~quint64(0) >> first;
+    const quint64 beforeLast = last >= BITS_PER_WORD ? ~quint64(0) : ~(~quint64(0) >> last);
+    return fromFirst & beforeLast;
+}
+
+/* QBitArray counts the bits from the least significant bit of each byte */
+static inline uchar reversed(uchar b)
+{
+    b = static_cast<uchar>((b & 0xF0) >> 4 | (b & 0x0F) << 4);
+    b = static_cast<uchar>((b & 0xCC) >> 2 | (b & 0x33) << 2);
+    b = static_cast<uchar>((b & 0xAA) >> 1 | (b & 0x55) << 1);
+    return b;
+}
+
+/******************************************************************************
+ ******************************************************************************/
+PieceBitmap::PieceBitmap(qsizetype size, bool value)
+    : m_words(wordCount(qMax(size, qsizetype(0))), value ? ~quint64(0) : quint64(0))
+    , m_size(qMax(size, qsizetype(0)))
+{
+    clearPadding();
+}
+
+/*!
+ * \brief Returns the bitmap of the first \a size bits of \a data,
+ * in the BitTorrent bitfield format: the high bit of the first byte
+ * is the piece 0.
+ */
+PieceBitmap PieceBitmap::fromBitfield(const char *data, qsizetype size)
+{
+    PieceBitmap bitmap(size);
+    if (!data || bitmap.m_size == 0) {
+        return bitmap;
+    }
+    auto words = bitmap.m_words.data();
+    std::memcpy(words, data, static_cast<std::size_t>((bitmap.m_size + 7) / 8));
+    for (qsizetype w = 0; w < bitmap.m_words.size(); ++w) {
+        words[w] = qFromBigEndian(words[w]);
+    }
+    bitmap.clearPadding();
+    return bitmap;
+}
+
+PieceBitmap PieceBitmap::fromBitArray(const QBitArray &bits)
+{
+    PieceBitmap bitmap(bits.size());
+    if (bitmap.m_size == 0) {
+        return bitmap;
+    }
+    const auto src = reinterpret_cast<const uchar*>(bits.bits());
+    auto dst = reinterpret_cast<uchar*>(bitmap.m_words.data());
+    for (qsizetype i = 0; i < (bitmap.m_size + 7) / 8; ++i) {
+        dst[i] = reversed(src[i]);
+    }
+    auto words = bitmap.m_words.data();
+    for (qsizetype w = 0; w < bitmap.m_words.size(); ++w) {
+        words[w] = qFromBigEndian(words[w]);
+    }
+    bitmap.clearPadding();
+    return bitmap;
+}
+
+QBitArray PieceBitmap::toBitArray() const
+{
+    if (m_size == 0) {
+        return {};
+    }
+    QByteArray bytes(m_words.size() * 8, Qt::Uninitialized);
+    auto dst = reinterpret_cast<uchar*>(bytes.data());
+    for (qsizetype w = 0; w < m_words.size(); ++w) {
+        const quint64 word = qToBigEndian(m_words.at(w));
+        const auto src = reinterpret_cast<const uchar*>(&word);
+        for (auto i = 0; i < 8; ++i) {
+            *dst++ = reversed(src[i]);
+        }
+    }
+    return QBitArray::fromBits(bytes.constData(), m_size);
+}
+
+/******************************************************************************
+ ******************************************************************************/
+bool PieceBitmap::operator==(const PieceBitmap &other) const
+{
+    return m_size == other.m_size && m_words == other.m_words;
+}
+
+/******************************************************************************
+ ******************************************************************************/
+qsizetype PieceBitmap::size() const
+{
+    return m_size;
+}
+
+/*!
+ * \brief Same as size(), like QBitArray::count().
+ */
+qsizetype PieceBitmap::count() const
+{
+    return m_size;
+}
+
+bool PieceBitmap::isEmpty() const
+{
+    return m_size == 0;
+}
+
+/*!
+ * \brief Resizes the bitmap. The new bits are zero.
+ */
+void PieceBitmap::resize(qsizetype size)
+{
+    m_size = qMax(size, qsizetype(0));
+    m_words.resize(wordCount(m_size));
+    clearPadding();
+}
+
+void PieceBitmap::clear()
+{
+    m_words.clear();
+    m_size = 0;
+}
+
+/******************************************************************************
+ ******************************************************************************/
+bool PieceBitmap::at(qsizetype i) const
+{
+    return testBit(i);
+}
+
+bool PieceBitmap::testBit(qsizetype i) const
+{
+    Q_ASSERT(i >= 0 && i < m_size);
+    return (m_words.at(i / BITS_PER_WORD) & bitMask(i)) != 0;
+}
+
+void PieceBitmap::setBit(qsizetype i)
+{
+    Q_ASSERT(i >= 0 && i < m_size);
+    m_words[i / BITS_PER_WORD] |= bitMask(i);
+}
+
+void PieceBitmap::setBit(qsizetype i, bool value)
+{
+    if (value) {
+        setBit(i);
+    } else {
+        clearBit(i);
+    }
+}
+
+void PieceBitmap::clearBit(qsizetype i)
+{
+    Q_ASSERT(i >= 0 && i < m_size);
+    m_words[i / BITS_PER_WORD] &= ~bitMask(i);
+}
+
+void PieceBitmap::fill(bool value)
+{
+    m_words.fill(value ? ~quint64(0) : quint64(0));
+    clearPadding();
+}
+
+/******************************************************************************
+ ******************************************************************************/
+/*!
+ * \brief Returns the count of bits set to \a on.
+ */
+qsizetype PieceBitmap::count(bool on) const
+{
+    qsizetype n = 0;
+    for (auto word : m_words) {
+        n += qPopulationCount(word);
+    }
+    return on ? n : m_size - n;
+}
+
+/*!
+ * \brief Returns the count of bits set to \a on, in the range [first, last).
+ * The range is clipped to the bitmap.
+ */
+qsizetype PieceBitmap::count(bool on, qsizetype first, qsizetype last) const
+{
+    first = qMax(first, qsizetype(0));
+    last = qMin(last, m_size);
+    if (first >= last) {
+        return 0;
+    }
+    const qsizetype firstWord = first / BITS_PER_WORD;
+    const qsizetype lastWord = (last - 1) / BITS_PER_WORD;
+    qsizetype n = 0;
+    for (auto w = firstWord; w <= lastWord; ++w) {
+        auto word = m_words.at(w);
+        if (w == firstWord || w == lastWord) {
+            const qsizetype begin = w == firstWord ? first % BITS_PER_WORD : 0;
+            const qsizetype end = w == lastWord ? (last - 1) % BITS_PER_WORD + 1 : BITS_PER_WORD;
+            word &= rangeMask(begin, end);
+        }
+        n += qPopulationCount(word);
+    }
+    return on ? n : (last - first) - n;
+}
+
+/*!
+ * \brief Returns true if all the bits of the range [first, last) are set,
+ * for instance if all the pieces of a file are downloaded.
+ */
+bool PieceBitmap::isAllSet(qsizetype first, qsizetype last) const
+{
+    if (first < 0 || last > m_size) {
+        return false;
+    }
+    return count(true, first, last) == qMax(last - first, qsizetype(0));
+}
+
+/*!
+ * \brief Returns the indexes of the bits set, in increasing order.
+ */
+QList<int> PieceBitmap::indexes() const
+{
+    QList<int> ret;
+    ret.reserve(count(true));
+    for (qsizetype w = 0; w < m_words.size(); ++w) {
+        auto word = m_words.at(w);
+        while (word) {
+            const auto p = qCountLeadingZeroBits(word);
+            ret.append(static_cast<int>(w * BITS_PER_WORD + p));
+            word &= ~(quint64(1) << (BITS_PER_WORD - 1 - p));
+        }
+    }
+    return ret;
+}
+
+/******************************************************************************
+ ******************************************************************************/
+PieceBitmap PieceBitmap::operator~() const
+{
+    PieceBitmap ret = *this;
+    auto words = ret.m_words.data();
+    for (qsizetype w = 0; w < ret.m_words.size(); ++w) {
+        words[w] = ~words[w];
+    }
+    ret.clearPadding();
+    return ret;
+}
+
+/*!
+ * \brief The result has the size of the larger bitmap,
+ * the missing bits of the smaller one being zero.
+ */
+PieceBitmap &PieceBitmap::operator&=(const PieceBitmap &other)
+{
+    resize(qMax(m_size, other.m_size));
+    auto words = m_words.data();
+    for (qsizetype w = 0; w < m_words.size(); ++w) {
+        words[w] &= w < other.m_words.size() ? other.m_words.at(w) : quint64(0);
+    }
+    return *this;
+}
+
+PieceBitmap &PieceBitmap::operator|=(const PieceBitmap &other)
+{
+    resize(qMax(m_size, other.m_size));
+    auto words = m_words.data();
+    for (qsizetype w = 0; w < other.m_words.size(); ++w) {
+        words[w] |= other.m_words.at(w);
+    }
+    return *this;
+}
+
+/******************************************************************************
+ ******************************************************************************/
+void PieceBitmap::clearPadding()
+{
+    if (m_size % BITS_PER_WORD != 0) {
+        m_words.last() &= rangeMask(0, m_size % BITS_PER_WORD);
+    }
+}
@@ -0,0 +1,72 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CORE_PIECE_BITMAP_H
+#define CORE_PIECE_BITMAP_H
+
+#include <QtCore/QBitArray>
+#include <QtCore/QList>
+
+/*!
+ * @class PieceBitmap
+ * @brief Compact bitmap of the pieces of a torrent,
+ * like the downloaded pieces, or the pieces available at a peer.
+ */
+class PieceBitmap
+{
+public:
+    PieceBitmap() = default;
+    explicit PieceBitmap(qsizetype size, bool value = false);
+
+    static PieceBitmap fromBitfield(const char *data, qsizetype size);
+    static PieceBitmap fromBitArray(const QBitArray &bits);
+    QBitArray toBitArray() const;
+
+    bool operator==(const PieceBitmap &other) const;
+
+    qsizetype size() const;
+    qsizetype count() const;
+    bool isEmpty() const;
+    void resize(qsizetype size);
+    void clear();
+
+    bool at(qsizetype i) const;
+    bool testBit(qsizetype i) const;
+    void setBit(qsizetype i);
+    void setBit(qsizetype i, bool value);
+    void clearBit(qsizetype i);
+    void fill(bool value);
+
+    qsizetype count(bool on) const;
+    qsizetype count(bool on, qsizetype first, qsizetype last) const;
+    bool isAllSet(qsizetype first, qsizetype last) const;
+
+    QList<int> indexes() const;
+
+    PieceBitmap operator~() const;
+    PieceBitmap &operator&=(const PieceBitmap &other);
+    PieceBitmap &operator|=(const PieceBitmap &other);
+    friend PieceBitmap operator&(PieceBitmap a, const PieceBitmap &b) { return a &= b; }
+    friend PieceBitmap operator|(PieceBitmap a, const PieceBitmap &b) { return a |= b; }
+
+private:
+    QList<quint64> m_words = {};
+    qsizetype m_size = 0;
+
+    void clearPadding();
+};
+
+#endif // CORE_PIECE_BITMAP_H
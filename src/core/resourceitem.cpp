@@ -190,6 +190,32 @@ void ResourceItem::setCheckSum(const QString &checkSum)
     m_checkSum = checkSum;
 }
 
+/******************************************************************************
+ ******************************************************************************/
+/*!
+ * \brief The HTTP validators of the remote file ('ETag' and 'Last-Modified'),
+ * sent back in 'If-Range' when the download is resumed.
+ */
+QString ResourceItem::httpEntityTag() const
+{
+    return m_httpEntityTag;
+}
+
+void ResourceItem::setHttpEntityTag(const QString &entityTag)
+{
+    m_httpEntityTag = entityTag;
+}
+
+QString ResourceItem::httpLastModified() const
+{
+    return m_httpLastModified;
+}
+
+void ResourceItem::setHttpLastModified(const QString &lastModified)
+{
+    m_httpLastModified = lastModified;
+}
+
 /******************************************************************************
  ******************************************************************************/
 QString ResourceItem::streamFileName() const
@@ -72,6 +72,12 @@ public:
     QString checkSum() const;
     void setCheckSum(const QString &checkSum);
 
+    QString httpEntityTag() const;
+    void setHttpEntityTag(const QString &entityTag);
+
+    QString httpLastModified() const;
+    void setHttpLastModified(const QString &lastModified);
+
     QString streamFileName() const;
     void setStreamFileName(const QString &streamFileName);
 
@@ -99,6 +105,8 @@ private:
 
     /* Regular file-specific properties */
     QString m_checkSum = {};
+    QString m_httpEntityTag = {};    // validators, to resume
+    QString m_httpLastModified = {};
 
     /* Stream-specific properties */
     QString m_streamFileName = {};
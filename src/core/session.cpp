@@ -15,8 +15,11 @@
  */
 
 #include "session.h"
+#include "session_p.h"
 
+#include <Constants>
 #include <Core/DownloadItem>
+#include <Core/DownloadLog>
 #include <Core/DownloadManager>
 #include <Core/DownloadStreamItem>
 #include <Core/DownloadTorrentItem>
@@ -25,29 +28,29 @@
 #include <QtCore/QDebug>
 #include <QtCore/QByteArray>
 #include <QtCore/QFile>
+#include <QtCore/QFileInfo>
 #include <QtCore/QJsonArray>
 #include <QtCore/QJsonDocument>
 #include <QtCore/QJsonObject>
+#include <QtCore/QMap>
+#include <QtCore/QtMath>
+
+using namespace SessionNS;
 
 static inline IDownloadItem::State intToState(int value)
 {
     return static_cast<IDownloadItem::State>(value);
 }
 
-static inline int stateToInt(IDownloadItem::State state)
+/*!
+ * The jobs in these states don't run until an action resumes them:
+ * they stay records of the checkpoint.
+ */
+static inline bool isRecordState(IDownloadItem::State state)
 {
-    /* Do not store error states and intermediary states. */
-    switch (state) {
-    case IDownloadItem::Stopped:
-        return static_cast<int>(IDownloadItem::Stopped);
-
-    case IDownloadItem::Completed:
-    case IDownloadItem::Seeding:
-        return static_cast<int>(IDownloadItem::Completed);
-
-    default:
-        return static_cast<int>(IDownloadItem::Paused);
-    }
+    return state == IDownloadItem::Completed
+            || state == IDownloadItem::Stopped
+            || state == IDownloadItem::Skipped;
 }
 
 static inline StreamObject::Config readStreamConfig(const QJsonObject &json)
@@ -93,47 +96,22 @@ static inline StreamObject::Config readStreamConfig(const QJsonObject &json)
     return config;
 }
 
-static inline QJsonObject writeStreamConfig(const StreamObject::Config &config)
+static inline DownloadItem* newItem(ResourceItem *resourceItem, DownloadManager *downloadManager)
 {
-    QJsonObject json;
-    {
-        QJsonObject j;
-        j["skipVideo"] = config.overview.skipVideo;
-        j["markWatched"] = config.overview.markWatched;
-        json["overview"] = j;
-    }
-    {
-        QJsonObject j;
-        j["writeSubtitle"] = config.subtitle.writeSubtitle;
-        j["isAutoGenerated"] = config.subtitle.isAutoGenerated;
-        j["extensions"] = config.subtitle.extensions;
-        j["languages"] = config.subtitle.languages;
-        j["convert"] = config.subtitle.convert;
-        json["subtitle"] = j;
-    }
-    {
-        QJsonObject j;
-        j["writeChapters"] = config.chapter.writeChapters;
-        json["chapter"] = j;
-    }
-    {
-        QJsonObject j;
-        j["writeDefaultThumbnail"] = config.thumbnail.writeDefaultThumbnail;
-        json["thumbnail"] = j;
-    }
-    {
-        QJsonObject j;
-        j["writeComment"] = config.comment.writeComment;
-        json["comment"] = j;
-    }
-    {
-        QJsonObject j;
-        j["writeDescription"] = config.metadata.writeDescription;
-        j["writeMetadata"] = config.metadata.writeMetadata;
-        j["writeInternetShortcut"] = config.metadata.writeInternetShortcut;
-        json["metadata"] = j;
+    DownloadItem *item;
+    switch (resourceItem->type()) {
+    case ResourceItem::Type::Stream:
+        item = new DownloadStreamItem(downloadManager);
+        break;
+    case ResourceItem::Type::Torrent:
+        item = new DownloadTorrentItem(downloadManager);
+        break;
+    default:
+        item = new DownloadItem(downloadManager);
+        break;
     }
-    return json;
+    item->setResource(resourceItem);
+    return item;
 }
 
 static inline DownloadItem* readJob(const QJsonObject &json, DownloadManager *downloadManager)
@@ -164,6 +142,8 @@ static inline DownloadItem* readJob(const QJsonObject &json, DownloadManager *do
     resourceItem->setReferringPage(json["referringPage"].toString());
     resourceItem->setDescription(json["description"].toString());
     resourceItem->setCheckSum(json["checkSum"].toString());
+    resourceItem->setHttpEntityTag(json["httpEntityTag"].toString());
+    resourceItem->setHttpLastModified(json["httpLastModified"].toString());
 
     resourceItem->setStreamFileName(json["streamFileName"].toString());
     resourceItem->setStreamFormatId(json["streamFormatId"].toString());
@@ -174,58 +154,19 @@ static inline DownloadItem* readJob(const QJsonObject &json, DownloadManager *do
 
     resourceItem->setTorrentPreferredFilePriorities(json["torrentPreferredFilePriorities"].toString());
 
-    DownloadItem *item;
-    switch (resourceItem->type()) {
-    case ResourceItem::Type::Stream:
-        item = new DownloadStreamItem(downloadManager);
-        break;
-    case ResourceItem::Type::Torrent:
-        item = new DownloadTorrentItem(downloadManager);
-        break;
-    default:
-        item = new DownloadItem(downloadManager);
-        break;
-    }
-    item->setResource(resourceItem);
+    auto item = newItem(resourceItem, downloadManager);
 
     item->setState(intToState(json["state"].toInt()));
     item->setBytesReceived(static_cast<qsizetype>(json["bytesReceived"].toInteger()));
     item->setBytesTotal(static_cast<qsizetype>(json["bytesTotal"].toInteger()));
+    item->setPendingRanges(json["pendingRanges"].toString());
     item->setMaxConnectionSegments(json["maxConnectionSegments"].toInt());
     item->setMaxConnections(json["maxConnections"].toInt());
-    item->setLog(json["log"].toString());
+    item->setSpeedLimit(json["speedLimit"].toInteger());
 
     return item;
 }
 
-static inline void writeJob(const DownloadItem *item, QJsonObject &json)
-{
-    json["type"] = ResourceItem::toString(item->resource()->type());
-    json["url"] = item->resource()->url();
-    json["destination"] = item->resource()->destination();
-    json["mask"] = item->resource()->mask();
-    json["customFileName"] = item->resource()->customFileName();
-    json["referringPage"] = item->resource()->referringPage();
-    json["description"] = item->resource()->description();
-    json["checkSum"] = item->resource()->checkSum();
-
-    json["streamFileName"] = item->resource()->streamFileName();
-    json["streamFormatId"] = item->resource()->streamFormatId();
-    json["streamFileSize"] = static_cast<qsizetype>(item->resource()->streamFileSize());
-
-    auto config = item->resource()->streamConfig();
-    json["streamConfig"] = writeStreamConfig(config);
-
-    json["torrentPreferredFilePriorities"] = item->resource()->torrentPreferredFilePriorities();
-
-    json["state"] = stateToInt(item->state());
-    json["bytesReceived"] = static_cast<qsizetype>(item->bytesReceived());
-    json["bytesTotal"] = static_cast<qsizetype>(item->bytesTotal());
-    json["maxConnectionSegments"] = item->maxConnectionSegments();
-    json["maxConnections"] = item->maxConnections();
-    json["log"] = item->log();
-}
-
 /******************************************************************************
  ******************************************************************************/
 static inline void readList(QList<DownloadItem *> &downloadItems, const QJsonObject &json, DownloadManager *downloadManager)
@@ -242,9 +183,7 @@ static inline void writeList(const QList<DownloadItem *> &downloadItems, QJsonOb
 {
     QJsonArray jobs;
     for (auto item : downloadItems) {
-        QJsonObject jobObject;
-        writeJob(item, jobObject);
-        jobs.append(jobObject);
+        jobs.append(SessionWriter::toJson(JobSnapshot::fromItem(item)));
     }
     json["jobs"] = jobs;
 }
@@ -285,3 +224,696 @@ void Session::write(const QList<DownloadItem *> &downloadItems, const QString &f
     QJsonDocument saveDoc(json);
     file.write( saveDoc.toJson() );
 }
+
+/******************************************************************************
+ ******************************************************************************/
+/*!
+ * \class Session
+ *
+ * The journaled store keeps the queue in two files:
+ * \li the checkpoint, i.e. the whole queue in the binary format above,
+ * where each job has an id (a JSON checkpoint, like Session::write()
+ * with ids, is still read);
+ * \li the journal, where each line is a change since the checkpoint:
+ * {"put":id,"job":{...}} adds or replaces a job, {"del":id} removes it.
+ *
+ * commit() appends the changed jobs only, so that the cost of a save
+ * depends on what changed, not on the size of the queue.
+ * Both commit() and compact() only take a snapshot of the items: the
+ * SessionWriter serializes and writes it in its own thread.
+ * compact() writes a new checkpoint and empties the journal. It's needed
+ * when the order of the queue changed, or when the journal grows
+ * bigger than the checkpoint.
+ *
+ * The first line of the journal is the generation of its checkpoint:
+ * a journal left by a compaction that didn't complete is ignored.
+ *
+ * open() maps the checkpoint and reads its index only. materialize()
+ * creates the items by chunks, so that the first rows of the queue are
+ * shown before the whole queue is read.
+ *
+ * The completed, stopped and skipped jobs of the checkpoint don't get
+ * an item: they stay SessionRecord, read in place from the map, so
+ * the view formats only the visible rows. The engine replaces a record
+ * by its item, with readItem(), when the job is resumed or selected.
+ * The map is kept until the next open() then.
+ *
+ * Session::read() and Session::write() are the JSON format
+ * for import and export.
+ */
+
+Session::~Session()
+{
+    unmap();
+}
+
+QString Session::journalFileName(const QString &filename)
+{
+    return filename + SESSION_JOURNAL_SUFFIX;
+}
+
+/*!
+ * \brief Reads the whole queue, without records.
+ */
+QList<DownloadItem *> Session::load(const QString &filename, DownloadManager *downloadManager)
+{
+    open(filename);
+    QList<DownloadItem *> downloadItems;
+    const auto items = materialize(downloadManager);
+    downloadItems.reserve(items.size());
+    for (auto item : items) {
+        auto record = dynamic_cast<SessionRecord *>(item);
+        if (record) {
+            downloadItems.append(readItem(record, downloadManager));
+            delete record;
+        } else {
+            downloadItems.append(dynamic_cast<DownloadItem *>(item));
+        }
+    }
+    return downloadItems;
+}
+
+/*!
+ * \brief Reads the checkpoint index, then replays the journal.
+ * Returns the number of jobs, to materialize().
+ *
+ * A torn record at the end of the journal, after a crash, is ignored.
+ */
+qsizetype Session::open(const QString &filename)
+{
+    /* Don't read the files while they're written */
+    m_writer.flush();
+    unmap();
+    m_fileName = filename;
+    m_ids.clear();
+    m_changed.clear();
+    m_removed.clear();
+    m_pending.clear();
+    m_nextPending = 0;
+    m_hasRecords = false;
+    m_nextId = 0;
+    m_generation = 0;
+    m_compactionRequested = false;
+
+    qint64 checkpointSize = 0;
+    qint64 journalSize = 0;
+
+    /* Position of each job in m_pending, by id */
+    QHash<qint64, qsizetype> positions;
+
+    m_checkpoint.setFileName(filename);
+    if (m_checkpoint.open(QIODevice::ReadOnly)) {
+        checkpointSize = m_checkpoint.size();
+        if (checkpointSize > 0) {
+#ifdef Q_OS_WIN
+            /* A mapped file can't be replaced by the next compaction */
+            m_buffer = m_checkpoint.readAll();
+            m_map = reinterpret_cast<const uchar *>(m_buffer.constData());
+            m_mapSize = m_buffer.size();
+            m_checkpoint.close();
+#else
+            m_map = m_checkpoint.map(0, checkpointSize);
+            m_mapSize = m_map ? checkpointSize : 0;
+#endif
+        }
+    }
+    if (m_mapSize >= BINARY_HEADER_SIZE && memcmp(m_map, BINARY_MAGIC, 4) == 0) {
+        auto version = get<quint32>(m_map, 4);
+        auto count = static_cast<qint64>(get<quint32>(m_map, 16));
+        auto recordSize = static_cast<qint64>(get<quint32>(m_map, 20));
+        m_stringTable = static_cast<qint64>(get<quint64>(m_map, 24));
+        if (version != BINARY_VERSION
+                || recordSize != BINARY_RECORD_SIZE
+                || m_stringTable != BINARY_HEADER_SIZE + count * recordSize
+                || m_stringTable > m_mapSize) {
+            qCritical("Couldn't read binary session file.");
+            unmap();
+        } else {
+            m_generation = get<qint64>(m_map, 8);
+            m_pending.reserve(count);
+            for (qint64 i = 0; i < count; ++i) {
+                auto id = get<qint64>(m_map + BINARY_HEADER_SIZE + i * recordSize, RecordId);
+                m_nextId = qMax(m_nextId, id + 1);
+                positions.insert(id, m_pending.size());
+                m_pending.append(PendingJob{id, i, {}});
+            }
+        }
+    } else if (m_mapSize > 0) {
+        /* JSON checkpoint, written by a previous version */
+        auto saveData = QByteArray::fromRawData(reinterpret_cast<const char*>(m_map), m_mapSize);
+        QJsonParseError ok = {};
+        QJsonDocument loadDoc( QJsonDocument::fromJson(saveData, &ok) );
+        if (ok.error != QJsonParseError::NoError) {
+            qCritical("Couldn't parse JSON file.");
+        }
+        auto json = loadDoc.object();
+        m_generation = json["generation"].toInteger();
+        const auto array = json["jobs"].toArray();
+        for (const auto &value : array) {
+            auto job = value.toObject();
+            /* The files written by Session::write() have no id */
+            auto id = job.contains("id") ? job["id"].toInteger() : m_nextId;
+            m_nextId = qMax(m_nextId, id + 1);
+            positions.insert(id, m_pending.size());
+            m_pending.append(PendingJob{id, -1, job});
+        }
+        unmap();
+    }
+
+    QFile journal(journalFileName(filename));
+    if (journal.open(QIODevice::ReadOnly)) {
+        journalSize = journal.size();
+        auto isHeader = true;
+        while (!journal.atEnd()) {
+            QJsonParseError ok = {};
+            auto record = QJsonDocument::fromJson(journal.readLine(), &ok).object();
+            if (ok.error != QJsonParseError::NoError) {
+                qWarning("Torn record in the journal: ignore the next records.");
+                break;
+            }
+            if (isHeader) {
+                isHeader = false;
+                if (record["generation"].toInteger() != m_generation) {
+                    qWarning("Obsolete journal: ignore it.");
+                    break;
+                }
+            } else if (record.contains("put")) {
+                auto id = record["put"].toInteger();
+                m_nextId = qMax(m_nextId, id + 1);
+                auto it = positions.constFind(id);
+                if (it != positions.constEnd()) {
+                    m_pending[it.value()] = PendingJob{id, -1, record["job"].toObject()};
+                } else {
+                    positions.insert(id, m_pending.size());
+                    m_pending.append(PendingJob{id, -1, record["job"].toObject()});
+                }
+            } else if (record.contains("del")) {
+                auto it = positions.constFind(record["del"].toInteger());
+                if (it != positions.constEnd()) {
+                    m_pending[it.value()] = PendingJob();
+                }
+            }
+        }
+    }
+    /* Don't replay the same journal at each start */
+    m_compactionRequested = journalSize > 0;
+    m_writer.reset(checkpointSize, journalSize);
+
+    if (m_pending.isEmpty()) {
+        unmap();
+    }
+    return m_pending.size();
+}
+
+/*!
+ * \brief Creates the items of the next jobs, at most count, in the queue order.
+ * The finished jobs of the checkpoint are SessionRecord instead.
+ * The checkpoint is unmapped once every job is materialized, unless
+ * there are records.
+ */
+QList<IDownloadItem *> Session::materialize(DownloadManager *downloadManager, qsizetype count)
+{
+    QList<IDownloadItem *> downloadItems;
+    auto end = count < 0
+            ? m_pending.size()
+            : qMin(m_pending.size(), m_nextPending + count);
+    downloadItems.reserve(end - m_nextPending);
+    for (; m_nextPending < end; ++m_nextPending) {
+        auto &pending = m_pending[m_nextPending];
+        if (pending.id < 0) {
+            continue;
+        }
+        if (pending.record >= 0
+                && isRecordState(intToState(get<qint32>(recordAt(pending.record), RecordState)))) {
+            auto record = new SessionRecord(this, pending.record);
+            m_ids.insert(record, pending.id);
+            m_hasRecords = true;
+            downloadItems.append(record);
+            continue;
+        }
+        auto item = pending.record < 0
+                ? readJob(pending.job, downloadManager)
+                : readRecord(pending.record, downloadManager);
+        m_ids.insert(item, pending.id);
+        item->setLogId(pending.id);
+        downloadItems.append(item);
+    }
+    if (!isLoading()) {
+        m_pending.clear();
+        m_nextPending = 0;
+        if (!m_hasRecords) {
+            unmap();
+        }
+    }
+    return downloadItems;
+}
+
+/*!
+ * \brief Creates the item of the record, that takes over its id.
+ * The record can be deleted then.
+ */
+DownloadItem *Session::readItem(const SessionRecord *record, DownloadManager *downloadManager)
+{
+    auto item = readRecord(record->m_index, downloadManager);
+    auto id = record->id();
+    m_ids.remove(record);
+    m_ids.insert(item, id);
+    item->setLogId(id);
+    return item;
+}
+
+bool Session::isLoading() const
+{
+    return m_nextPending < m_pending.size();
+}
+
+void Session::unmap()
+{
+#ifdef Q_OS_WIN
+    m_buffer.clear();
+#else
+    if (m_map) {
+        m_checkpoint.unmap(const_cast<uchar *>(m_map));
+    }
+#endif
+    m_map = nullptr;
+    m_mapSize = 0;
+    m_stringTable = 0;
+    m_checkpoint.close();
+}
+
+/******************************************************************************
+ ******************************************************************************/
+QString Session::readString(const uchar *record, int field) const
+{
+    auto offset = m_stringTable + get<quint32>(record, RecordStrings + 4 * field);
+    if (offset + 4 > m_mapSize) {
+        return {};
+    }
+    auto size = static_cast<qint64>(get<quint32>(m_map, offset));
+    if (offset + 4 + size > m_mapSize) {
+        return {};
+    }
+    return QString::fromUtf8(reinterpret_cast<const char*>(m_map + offset + 4), size);
+}
+
+const uchar *Session::recordAt(qint64 index) const
+{
+    return m_map + BINARY_HEADER_SIZE + index * BINARY_RECORD_SIZE;
+}
+
+JobSnapshot Session::readSnapshot(qint64 index) const
+{
+    auto record = recordAt(index);
+    auto flags = get<quint16>(record, RecordFlags);
+
+    JobSnapshot job;
+    job.id = get<qint64>(record, RecordId);
+
+    job.type = get<quint16>(record, RecordType);
+    job.url = readString(record, StringUrl);
+    job.destination = readString(record, StringDestination);
+    job.mask = readString(record, StringMask);
+    job.customFileName = readString(record, StringCustomFileName);
+    job.referringPage = readString(record, StringReferringPage);
+    job.description = readString(record, StringDescription);
+    job.checkSum = readString(record, StringCheckSum);
+    job.httpEntityTag = readString(record, StringHttpEntityTag);
+    job.httpLastModified = readString(record, StringHttpLastModified);
+
+    job.streamFileName = readString(record, StringStreamFileName);
+    job.streamFormatId = readString(record, StringStreamFormatId);
+    job.streamFileSize = get<qint64>(record, RecordStreamFileSize);
+
+    auto &config = job.streamConfig;
+    config.overview.skipVideo = flags & FlagSkipVideo;
+    config.overview.markWatched = flags & FlagMarkWatched;
+    config.subtitle.writeSubtitle = flags & FlagWriteSubtitle;
+    config.subtitle.isAutoGenerated = flags & FlagIsAutoGenerated;
+    config.subtitle.extensions = readString(record, StringSubtitleExtensions);
+    config.subtitle.languages = readString(record, StringSubtitleLanguages);
+    config.subtitle.convert = readString(record, StringSubtitleConvert);
+    config.chapter.writeChapters = flags & FlagWriteChapters;
+    config.thumbnail.writeDefaultThumbnail = flags & FlagWriteDefaultThumbnail;
+    config.comment.writeComment = flags & FlagWriteComment;
+    config.metadata.writeDescription = flags & FlagWriteDescription;
+    config.metadata.writeMetadata = flags & FlagWriteMetadata;
+    config.metadata.writeInternetShortcut = flags & FlagWriteInternetShortcut;
+
+    job.torrentPreferredFilePriorities = readString(record, StringTorrentPreferredFilePriorities);
+
+    job.state = get<qint32>(record, RecordState);
+    job.bytesReceived = get<qint64>(record, RecordBytesReceived);
+    job.bytesTotal = get<qint64>(record, RecordBytesTotal);
+    job.pendingRanges = readString(record, StringPendingRanges);
+    job.maxConnectionSegments = get<quint16>(record, RecordMaxConnectionSegments);
+    job.maxConnections = get<quint16>(record, RecordMaxConnections);
+    job.speedLimit = get<qint64>(record, RecordSpeedLimit);
+    return job;
+}
+
+DownloadItem *Session::readRecord(qint64 index, DownloadManager *downloadManager) const
+{
+    auto job = readSnapshot(index);
+
+    auto resourceItem = new ResourceItem();
+    resourceItem->setType(static_cast<ResourceItem::Type>(job.type));
+    resourceItem->setUrl(job.url);
+    resourceItem->setDestination(job.destination);
+    resourceItem->setMask(job.mask);
+    resourceItem->setCustomFileName(job.customFileName);
+    resourceItem->setReferringPage(job.referringPage);
+    resourceItem->setDescription(job.description);
+    resourceItem->setCheckSum(job.checkSum);
+    resourceItem->setHttpEntityTag(job.httpEntityTag);
+    resourceItem->setHttpLastModified(job.httpLastModified);
+
+    resourceItem->setStreamFileName(job.streamFileName);
+    resourceItem->setStreamFormatId(job.streamFormatId);
+    resourceItem->setStreamFileSize(static_cast<qsizetype>(job.streamFileSize));
+    resourceItem->setStreamConfig(job.streamConfig);
+
+    resourceItem->setTorrentPreferredFilePriorities(job.torrentPreferredFilePriorities);
+
+    auto item = newItem(resourceItem, downloadManager);
+
+    item->setState(intToState(job.state));
+    item->setBytesReceived(static_cast<qsizetype>(job.bytesReceived));
+    item->setBytesTotal(static_cast<qsizetype>(job.bytesTotal));
+    item->setPendingRanges(job.pendingRanges);
+    item->setMaxConnectionSegments(job.maxConnectionSegments);
+    item->setMaxConnections(job.maxConnections);
+    item->setSpeedLimit(job.speedLimit);
+
+    return item;
+}
+
+/******************************************************************************
+ ******************************************************************************/
+qint64 Session::idOf(const IDownloadItem *item)
+{
+    auto it = m_ids.find(item);
+    if (it == m_ids.end()) {
+        it = m_ids.insert(item, m_nextId++);
+    }
+    return it.value();
+}
+
+bool Session::contains(const IDownloadItem *item) const
+{
+    return m_ids.contains(item);
+}
+
+/*!
+ * \brief The item will be saved by the next commit().
+ * The new items are saved in the order they're marked.
+ */
+void Session::markChanged(DownloadItem *item)
+{
+    item->setLogId(idOf(item));
+    m_changed.insert(item);
+}
+
+void Session::markRemoved(IDownloadItem *item)
+{
+    m_changed.remove(dynamic_cast<DownloadItem *>(item));
+    auto it = m_ids.find(item);
+    if (it != m_ids.end()) {
+        m_removed.append(it.value());
+        m_ids.erase(it);
+    }
+}
+
+/*!
+ * \brief The next save will be a compaction, e.g. because
+ * the order of the items changed.
+ */
+void Session::requestCompaction()
+{
+    m_compactionRequested = true;
+}
+
+/*!
+ * \brief Returns true if the journal should be compacted,
+ * once every job is materialized.
+ */
+bool Session::isCompactionNeeded() const
+{
+    if (isLoading()) {
+        return false;
+    }
+    return m_compactionRequested
+            || m_writer.hasFailed()
+            || m_writer.journalSize() > qMax(SESSION_JOURNAL_MIN_SIZE, m_writer.checkpointSize());
+}
+
+bool Session::hasChanges() const
+{
+    return m_compactionRequested || !m_changed.isEmpty() || !m_removed.isEmpty();
+}
+
+/******************************************************************************
+ ******************************************************************************/
+/*!
+ * \brief Queues the changes since the previous save, to be appended to the journal.
+ */
+bool Session::commit()
+{
+    if (m_fileName.isEmpty()) {
+        return false;
+    }
+    if (m_changed.isEmpty() && m_removed.isEmpty()) {
+        return true;
+    }
+    /* By id, so that the new items are replayed in the queue order */
+    QMap<qint64, DownloadItem *> changed;
+    for (auto item : std::as_const(m_changed)) {
+        changed.insert(idOf(item), item);
+    }
+    QList<JobSnapshot> jobs;
+    jobs.reserve(changed.size());
+    for (auto it = changed.cbegin(); it != changed.cend(); ++it) {
+        jobs.append(JobSnapshot::fromItem(it.value(), it.key()));
+    }
+    m_writer.append(m_fileName, m_generation, m_removed, jobs);
+    m_changed.clear();
+    m_removed.clear();
+    return true;
+}
+
+/*!
+ * \brief Queues the given items, to be written as the new checkpoint.
+ * The journal is emptied.
+ *
+ * The records are copied from the map: on POSIX systems, the map
+ * still reads the previous checkpoint once the new one replaces it.
+ */
+bool Session::compact(const QList<IDownloadItem *> &downloadItems)
+{
+    if (m_fileName.isEmpty()) {
+        return false;
+    }
+    if (isLoading()) {
+        qWarning("Can't compact the session while loading it.");
+        return false;
+    }
+    QList<JobSnapshot> jobs;
+    jobs.reserve(downloadItems.size());
+    for (auto item : downloadItems) {
+        auto record = dynamic_cast<const SessionRecord *>(item);
+        if (record) {
+            jobs.append(readSnapshot(record->m_index));
+            continue;
+        }
+        auto downloadItem = dynamic_cast<const DownloadItem *>(item);
+        if (downloadItem) {
+            jobs.append(JobSnapshot::fromItem(downloadItem, idOf(item)));
+        }
+    }
+    m_generation++;
+    m_writer.checkpoint(m_fileName, m_generation, jobs);
+    m_changed.clear();
+    m_removed.clear();
+    m_compactionRequested = false;
+    return true;
+}
+
+/*!
+ * \brief Waits until the queued saves are written.
+ */
+void Session::flush()
+{
+    m_writer.flush();
+}
+
+/******************************************************************************
+ ******************************************************************************/
+SessionRecord::SessionRecord(const Session *session, qint64 index)
+    : m_session(session)
+    , m_index(index)
+{
+}
+
+const uchar *SessionRecord::data() const
+{
+    return m_session->recordAt(m_index);
+}
+
+qint64 SessionRecord::id() const
+{
+    return get<qint64>(data(), RecordId);
+}
+
+/*!
+ * \brief Removes the log file, when the record is removed from the queue.
+ */
+void SessionRecord::removeLog()
+{
+    DownloadLog log;
+    log.setId(id());
+    log.remove();
+}
+
+/******************************************************************************
+ ******************************************************************************/
+IDownloadItem::State SessionRecord::state() const
+{
+    return intToState(get<qint32>(data(), RecordState));
+}
+
+qsizetype SessionRecord::bytesReceived() const
+{
+    return static_cast<qsizetype>(get<qint64>(data(), RecordBytesReceived));
+}
+
+qsizetype SessionRecord::bytesTotal() const
+{
+    return static_cast<qsizetype>(get<qint64>(data(), RecordBytesTotal));
+}
+
+qreal SessionRecord::speed() const
+{
+    return 0;
+}
+
+/*!
+ * \brief Same as AbstractDownloadItem::progress(), for the finished states.
+ */
+int SessionRecord::progress() const
+{
+    auto total = bytesTotal();
+    if (total > 0) {
+        return qBound(0, qFloor(100 * static_cast<qreal>(bytesReceived()) / static_cast<qreal>(total)), 100);
+    }
+    if (state() == Stopped || state() == Skipped) {
+        return 100;
+    }
+    return -1; // Undefined
+}
+
+int SessionRecord::maxConnectionSegments() const
+{
+    return get<quint16>(data(), RecordMaxConnectionSegments);
+}
+
+int SessionRecord::maxConnections() const
+{
+    return get<quint16>(data(), RecordMaxConnections);
+}
+
+/*!
+ * \brief Returns the lines of the log file, if any.
+ */
+QString SessionRecord::log() const
+{
+    DownloadLog log;
+    log.setId(id());
+    return log.fullText();
+}
+
+/******************************************************************************
+ ******************************************************************************/
+QUrl SessionRecord::sourceUrl() const
+{
+    return QUrl(m_session->readString(data(), StringUrl));
+}
+
+QString SessionRecord::localFullFileName() const
+{
+    return localFileUrl().toLocalFile();
+}
+
+QString SessionRecord::localFileName() const
+{
+    const QFileInfo fi(localFullFileName());
+    return fi.fileName();
+}
+
+QString SessionRecord::localFilePath() const
+{
+    const QFileInfo fi(localFullFileName());
+    return fi.absolutePath();
+}
+
+/*!
+ * \brief Same as DownloadItem::localFileUrl(), from the strings of the record.
+ */
+QUrl SessionRecord::localFileUrl() const
+{
+    auto record = data();
+    ResourceItem resourceItem;
+    resourceItem.setType(static_cast<ResourceItem::Type>(get<quint16>(record, RecordType)));
+    resourceItem.setUrl(m_session->readString(record, StringUrl));
+    resourceItem.setDestination(m_session->readString(record, StringDestination));
+    resourceItem.setMask(m_session->readString(record, StringMask));
+    resourceItem.setCustomFileName(m_session->readString(record, StringCustomFileName));
+    resourceItem.setStreamFileName(m_session->readString(record, StringStreamFileName));
+    return resourceItem.localFileUrl();
+}
+
+QUrl SessionRecord::localDirUrl() const
+{
+    return QUrl::fromLocalFile(localFilePath());
+}
+
+/******************************************************************************
+ ******************************************************************************/
+/*!
+ * \brief Same as AbstractDownloadItem, for the finished states.
+ * The engine materializes the record before the action.
+ */
+bool SessionRecord::isResumable() const
+{
+    return state() != Completed;
+}
+
+bool SessionRecord::isPausable() const
+{
+    return false;
+}
+
+bool SessionRecord::isCancelable() const
+{
+    return state() == Completed;
+}
+
+bool SessionRecord::isDownloading() const
+{
+    return false;
+}
+
+void SessionRecord::setReadyToResume()
+{
+}
+
+void SessionRecord::resume()
+{
+}
+
+void SessionRecord::pause()
+{
+}
+
+void SessionRecord::stop()
+{
+}
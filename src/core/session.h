@@ -17,20 +17,142 @@
 #ifndef CORE_SESSION_H
 #define CORE_SESSION_H
 
+#include <Core/IDownloadItem>
+#include <Core/SessionWriter>
+
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+#include <QtCore/QHash>
+#include <QtCore/QJsonObject>
 #include <QtCore/QList>
+#include <QtCore/QSet>
 #include <QtCore/QString>
 
 class DownloadItem;
 class DownloadManager;
+class Session;
+
+/*!
+ * \class SessionRecord
+ * \brief Job of the queue file that is read in place from the checkpoint,
+ * until the engine needs its item.
+ *
+ * The record is valid until the next Session::open().
+ */
+class SessionRecord : public IDownloadItem
+{
+public:
+    SessionRecord(const Session *session, qint64 index);
+    ~SessionRecord() noexcept override = default;
+
+    qint64 id() const;
+    void removeLog();
+
+    State state() const override;
+
+    qsizetype bytesReceived() const override;
+    qsizetype bytesTotal() const override;
+
+    qreal speed() const override;
+    int progress() const override;
+
+    int maxConnectionSegments() const override;
+    int maxConnections() const override;
+    QString log() const override;
+
+    QUrl sourceUrl() const override;
+    QString localFullFileName() const override;
+    QString localFileName() const override;
+    QString localFilePath() const override;
+    QUrl localFileUrl() const override;
+    QUrl localDirUrl() const override;
+
+    bool isResumable() const override;
+    bool isPausable() const override;
+    bool isCancelable() const override;
+    bool isDownloading() const override;
+
+    void setReadyToResume() override;
+    void resume() override;
+    void pause() override;
+    void stop() override;
+
+private:
+    friend class Session;
+    const Session *m_session = nullptr;
+    qint64 m_index = 0;
+
+    const uchar *data() const;
+};
 
 class Session
 {
 public:
     Session() = default;
+    ~Session();
 
     static void read(QList<DownloadItem *> &downloadItems, const QString &filename, DownloadManager *downloadManager);
     static void write(const QList<DownloadItem *> &downloadItems, const QString &filename);
 
+    /* Journaled store */
+    QList<DownloadItem *> load(const QString &filename, DownloadManager *downloadManager);
+
+    qsizetype open(const QString &filename);
+    QList<IDownloadItem *> materialize(DownloadManager *downloadManager, qsizetype count = -1);
+    DownloadItem *readItem(const SessionRecord *record, DownloadManager *downloadManager);
+    bool isLoading() const;
+
+    bool contains(const IDownloadItem *item) const;
+    void markChanged(DownloadItem *item);
+    void markRemoved(IDownloadItem *item);
+    void requestCompaction();
+
+    bool isCompactionNeeded() const;
+    bool hasChanges() const;
+
+    bool commit();
+    bool compact(const QList<IDownloadItem *> &downloadItems);
+    void flush();
+
+    static QString journalFileName(const QString &filename);
+
+private:
+    friend class SessionRecord;
+
+    QString m_fileName = {};
+    QHash<const IDownloadItem *, qint64> m_ids = {};
+    QSet<DownloadItem *> m_changed = {};
+    QList<qint64> m_removed = {};
+    qint64 m_nextId = 0;
+    qint64 m_generation = 0;
+    bool m_compactionRequested = false;
+    SessionWriter m_writer;
+
+    /* Jobs not yet materialized */
+    struct PendingJob
+    {
+        qint64 id = -1; ///< -1 if removed by the journal
+        qint64 record = -1; ///< Index of the record in the checkpoint, or -1 if 'job' is set
+        QJsonObject job = {};
+    };
+    QList<PendingJob> m_pending = {};
+    qsizetype m_nextPending = 0;
+    bool m_hasRecords = false; ///< The map is kept for the records
+
+    QFile m_checkpoint;
+#ifdef Q_OS_WIN
+    QByteArray m_buffer = {}; ///< Read instead of mapped, see open()
+#endif
+    const uchar *m_map = nullptr;
+    qint64 m_mapSize = 0;
+    qint64 m_stringTable = 0;
+
+    qint64 idOf(const IDownloadItem *item);
+    void unmap();
+    const uchar *recordAt(qint64 index) const;
+    JobSnapshot readSnapshot(qint64 index) const;
+    DownloadItem *readRecord(qint64 index, DownloadManager *downloadManager) const;
+    QString readString(const uchar *record, int field) const;
 };
 
 #endif // CORE_SESSION_H
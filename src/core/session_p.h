@@ -0,0 +1,107 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef CORE_SESSION_PRIVATE_H
+#define CORE_SESSION_PRIVATE_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QtEndian>
+
+namespace SessionNS
+{
+
+/*
+ * Binary checkpoint, little-endian:
+ *
+ *   header   magic "ADLQ", version (u32), generation (i64),
+ *            record count (u32), record size (u32), string table offset (u64)
+ *   records  fixed-size, in the queue order
+ *   strings  table of length-prefixed (u32) UTF-8 strings, referenced
+ *            by their offset in the table; offset 0 is the empty string.
+ *
+ * The records can be read in place from the mapped file,
+ * so that a job is decoded only when its item is materialized.
+ */
+inline constexpr char BINARY_MAGIC[4] = { 'A', 'D', 'L', 'Q' };
+inline constexpr quint32 BINARY_VERSION = 1;
+inline constexpr qint64 BINARY_HEADER_SIZE = 32;
+
+enum RecordOffset {
+    RecordId = 0,
+    RecordBytesReceived = 8,
+    RecordBytesTotal = 16,
+    RecordSpeedLimit = 24,
+    RecordStreamFileSize = 32,
+    RecordState = 40,
+    RecordType = 44,
+    RecordMaxConnectionSegments = 46,
+    RecordMaxConnections = 48,
+    RecordFlags = 50,
+    RecordStrings = 52
+};
+
+enum RecordString {
+    StringUrl = 0,
+    StringDestination,
+    StringMask,
+    StringCustomFileName,
+    StringReferringPage,
+    StringDescription,
+    StringCheckSum,
+    StringHttpEntityTag,
+    StringHttpLastModified,
+    StringStreamFileName,
+    StringStreamFormatId,
+    StringTorrentPreferredFilePriorities,
+    StringPendingRanges,
+    StringSubtitleExtensions,
+    StringSubtitleLanguages,
+    StringSubtitleConvert,
+    StringCount
+};
+
+inline constexpr qint64 BINARY_RECORD_SIZE = RecordStrings + StringCount * 4;
+
+/* Flags of the stream config */
+enum RecordFlag {
+    FlagSkipVideo               = 0x0001,
+    FlagMarkWatched             = 0x0002,
+    FlagWriteSubtitle           = 0x0004,
+    FlagIsAutoGenerated         = 0x0008,
+    FlagWriteChapters           = 0x0010,
+    FlagWriteDefaultThumbnail   = 0x0020,
+    FlagWriteComment            = 0x0040,
+    FlagWriteDescription        = 0x0080,
+    FlagWriteMetadata           = 0x0100,
+    FlagWriteInternetShortcut   = 0x0200
+};
+
+template <typename T>
+inline void put(QByteArray &record, int offset, T value)
+{
+    qToLittleEndian(value, record.data() + offset);
+}
+
+template <typename T>
+inline T get(const uchar *record, int offset)
+{
+    return qFromLittleEndian<T>(record + offset);
+}
+
+} // namespace SessionNS
+
+#endif // CORE_SESSION_PRIVATE_H
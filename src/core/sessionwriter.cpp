@@ -0,0 +1,540 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "sessionwriter.h"
+#include "session_p.h"
+
+#include <Constants>
+#include <Core/DownloadItem>
+#include <Core/ResourceItem>
+
+#include <QtCore/QDebug>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QHash>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QMutexLocker>
+
+#ifdef Q_OS_WIN
+#  include <io.h>
+#  include <windows.h>
+#else /* POSIX */
+#  include <cstdio>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+using namespace SessionNS;
+
+/*!
+ * \class SessionWriter
+ *
+ * The GUI thread takes a snapshot of the changed items, i.e. plain copies
+ * of their properties, and queues it. The writer thread serializes
+ * the snapshot and writes it, so that saving never blocks the event loop.
+ *
+ * The tasks are executed in order: the journal records appended after
+ * a checkpoint go to the new journal.
+ *
+ * A checkpoint is written to a temporary file, synced to the disk, then
+ * renamed over the previous one: the queue file is never torn.
+ * If a write fails, hasFailed() returns true until the next checkpoint.
+ */
+
+static inline int stateToInt(IDownloadItem::State state)
+{
+    /* Do not store error states and intermediary states. */
+    switch (state) {
+    case IDownloadItem::Stopped:
+        return static_cast<int>(IDownloadItem::Stopped);
+
+    case IDownloadItem::Completed:
+    case IDownloadItem::Seeding:
+        return static_cast<int>(IDownloadItem::Completed);
+
+    default:
+        return static_cast<int>(IDownloadItem::Paused);
+    }
+}
+
+static inline QJsonObject writeStreamConfig(const StreamObject::Config &config)
+{
+    QJsonObject json;
+    {
+        QJsonObject j;
+        j["skipVideo"] = config.overview.skipVideo;
+        j["markWatched"] = config.overview.markWatched;
+        json["overview"] = j;
+    }
+    {
+        QJsonObject j;
+        j["writeSubtitle"] = config.subtitle.writeSubtitle;
+        j["isAutoGenerated"] = config.subtitle.isAutoGenerated;
+        j["extensions"] = config.subtitle.extensions;
+        j["languages"] = config.subtitle.languages;
+        j["convert"] = config.subtitle.convert;
+        json["subtitle"] = j;
+    }
+    {
+        QJsonObject j;
+        j["writeChapters"] = config.chapter.writeChapters;
+        json["chapter"] = j;
+    }
+    {
+        QJsonObject j;
+        j["writeDefaultThumbnail"] = config.thumbnail.writeDefaultThumbnail;
+        json["thumbnail"] = j;
+    }
+    {
+        QJsonObject j;
+        j["writeComment"] = config.comment.writeComment;
+        json["comment"] = j;
+    }
+    {
+        QJsonObject j;
+        j["writeDescription"] = config.metadata.writeDescription;
+        j["writeMetadata"] = config.metadata.writeMetadata;
+        j["writeInternetShortcut"] = config.metadata.writeInternetShortcut;
+        json["metadata"] = j;
+    }
+    return json;
+}
+
+/******************************************************************************
+ ******************************************************************************/
+JobSnapshot JobSnapshot::fromItem(const DownloadItem *item, qint64 id)
+{
+    auto resource = item->resource();
+    JobSnapshot job;
+    job.id = id;
+
+    job.type = static_cast<int>(resource->type());
+    job.url = resource->url();
+    job.destination = resource->destination();
+    job.mask = resource->mask();
+    job.customFileName = resource->customFileName();
+    job.referringPage = resource->referringPage();
+    job.description = resource->description();
+    job.checkSum = resource->checkSum();
+    job.httpEntityTag = resource->httpEntityTag();
+    job.httpLastModified = resource->httpLastModified();
+
+    job.streamFileName = resource->streamFileName();
+    job.streamFormatId = resource->streamFormatId();
+    job.streamFileSize = resource->streamFileSize();
+    job.streamConfig = resource->streamConfig();
+
+    job.torrentPreferredFilePriorities = resource->torrentPreferredFilePriorities();
+
+    job.state = stateToInt(item->state());
+    job.bytesReceived = item->bytesReceived();
+    job.bytesTotal = item->bytesTotal();
+    job.pendingRanges = item->pendingRanges();
+    job.maxConnectionSegments = item->maxConnectionSegments();
+    job.maxConnections = item->maxConnections();
+    job.speedLimit = item->speedLimit();
+    return job;
+}
+
+/******************************************************************************
+ ******************************************************************************/
+QJsonObject SessionWriter::toJson(const JobSnapshot &job)
+{
+    QJsonObject json;
+    json["type"] = ResourceItem::toString(static_cast<ResourceItem::Type>(job.type));
+    json["url"] = job.url;
+    json["destination"] = job.destination;
+    json["mask"] = job.mask;
+    json["customFileName"] = job.customFileName;
+    json["referringPage"] = job.referringPage;
+    json["description"] = job.description;
+    json["checkSum"] = job.checkSum;
+    json["httpEntityTag"] = job.httpEntityTag;
+    json["httpLastModified"] = job.httpLastModified;
+
+    json["streamFileName"] = job.streamFileName;
+    json["streamFormatId"] = job.streamFormatId;
+    json["streamFileSize"] = job.streamFileSize;
+    json["streamConfig"] = writeStreamConfig(job.streamConfig);
+
+    json["torrentPreferredFilePriorities"] = job.torrentPreferredFilePriorities;
+
+    json["state"] = job.state;
+    json["bytesReceived"] = job.bytesReceived;
+    json["bytesTotal"] = job.bytesTotal;
+    json["pendingRanges"] = job.pendingRanges;
+    json["maxConnectionSegments"] = job.maxConnectionSegments;
+    json["maxConnections"] = job.maxConnections;
+    json["speedLimit"] = job.speedLimit;
+    return json;
+}
+
+/******************************************************************************
+ ******************************************************************************/
+/*!
+ * \brief Stores each distinct string once.
+ */
+class StringTable
+{
+public:
+    StringTable() : m_data(4, '\0') {} // the empty string
+
+    quint32 insert(const QString &str)
+    {
+        if (str.isEmpty()) {
+            return 0;
+        }
+        auto it = m_offsets.constFind(str);
+        if (it != m_offsets.constEnd()) {
+            return it.value();
+        }
+        auto offset = static_cast<quint32>(m_data.size());
+        auto utf8 = str.toUtf8();
+        append32(m_data, static_cast<quint32>(utf8.size()));
+        m_data.append(utf8);
+        m_offsets.insert(str, offset);
+        return offset;
+    }
+
+    const QByteArray &data() const { return m_data; }
+
+    static void append32(QByteArray &data, quint32 value)
+    {
+        char buffer[4];
+        qToLittleEndian(value, buffer);
+        data.append(buffer, 4);
+    }
+
+private:
+    QByteArray m_data;
+    QHash<QString, quint32> m_offsets;
+};
+
+static inline void writeRecord(const JobSnapshot &job, QByteArray &record, StringTable &strings)
+{
+    const auto &config = job.streamConfig;
+
+    quint16 flags = 0;
+    if (config.overview.skipVideo)                   flags |= FlagSkipVideo;
+    if (config.overview.markWatched)                 flags |= FlagMarkWatched;
+    if (config.subtitle.writeSubtitle)               flags |= FlagWriteSubtitle;
+    if (config.subtitle.isAutoGenerated)             flags |= FlagIsAutoGenerated;
+    if (config.chapter.writeChapters)                flags |= FlagWriteChapters;
+    if (config.thumbnail.writeDefaultThumbnail)      flags |= FlagWriteDefaultThumbnail;
+    if (config.comment.writeComment)                 flags |= FlagWriteComment;
+    if (config.metadata.writeDescription)            flags |= FlagWriteDescription;
+    if (config.metadata.writeMetadata)               flags |= FlagWriteMetadata;
+    if (config.metadata.writeInternetShortcut)       flags |= FlagWriteInternetShortcut;
+
+    record.fill('\0', BINARY_RECORD_SIZE);
+    put<qint64>(record, RecordId, job.id);
+    put<qint64>(record, RecordBytesReceived, job.bytesReceived);
+    put<qint64>(record, RecordBytesTotal, job.bytesTotal);
+    put<qint64>(record, RecordSpeedLimit, job.speedLimit);
+    put<qint64>(record, RecordStreamFileSize, job.streamFileSize);
+    put<qint32>(record, RecordState, job.state);
+    put<quint16>(record, RecordType, static_cast<quint16>(job.type));
+    put<quint16>(record, RecordMaxConnectionSegments, static_cast<quint16>(job.maxConnectionSegments));
+    put<quint16>(record, RecordMaxConnections, static_cast<quint16>(job.maxConnections));
+    put<quint16>(record, RecordFlags, flags);
+
+    const QString *values[StringCount] = {
+        &job.url,
+        &job.destination,
+        &job.mask,
+        &job.customFileName,
+        &job.referringPage,
+        &job.description,
+        &job.checkSum,
+        &job.httpEntityTag,
+        &job.httpLastModified,
+        &job.streamFileName,
+        &job.streamFormatId,
+        &job.torrentPreferredFilePriorities,
+        &job.pendingRanges,
+        &config.subtitle.extensions,
+        &config.subtitle.languages,
+        &config.subtitle.convert
+    };
+    for (int i = 0; i < StringCount; ++i) {
+        put<quint32>(record, RecordStrings + 4 * i, strings.insert(*values[i]));
+    }
+}
+
+/*!
+ * \brief Returns the binary checkpoint of the given jobs.
+ */
+QByteArray SessionWriter::toBinary(const QList<JobSnapshot> &jobs, qint64 generation)
+{
+    StringTable strings;
+    QByteArray records;
+    records.reserve(jobs.size() * BINARY_RECORD_SIZE);
+    QByteArray record(BINARY_RECORD_SIZE, '\0');
+    for (const auto &job : jobs) {
+        writeRecord(job, record, strings);
+        records.append(record);
+    }
+
+    QByteArray header(BINARY_HEADER_SIZE, '\0');
+    memcpy(header.data(), BINARY_MAGIC, 4);
+    put<quint32>(header, 4, BINARY_VERSION);
+    put<qint64>(header, 8, generation);
+    put<quint32>(header, 16, static_cast<quint32>(jobs.size()));
+    put<quint32>(header, 20, static_cast<quint32>(BINARY_RECORD_SIZE));
+    put<quint64>(header, 24, static_cast<quint64>(BINARY_HEADER_SIZE + records.size()));
+
+    return header + records + strings.data();
+}
+
+/******************************************************************************
+ ******************************************************************************/
+static inline bool sync(QFile &file)
+{
+    if (!file.flush()) {
+        return false;
+    }
+#ifdef Q_OS_WIN
+    auto handle = reinterpret_cast<HANDLE>(::_get_osfhandle(file.handle()));
+    return ::FlushFileBuffers(handle) != 0;
+#else /* POSIX */
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
+/*!
+ * \brief Replaces the content of the file atomically:
+ * writes a temporary file, syncs it to the disk, then renames it.
+ */
+bool SessionWriter::replace(const QString &fileName, const QByteArray &data)
+{
+    auto temporaryName = fileName + SESSION_TEMPORARY_SUFFIX;
+    QFile file(temporaryName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning("Couldn't open save file.");
+        return false;
+    }
+    if (file.write(data) != data.size() || !sync(file)) {
+        qWarning("Couldn't write save file.");
+        file.close();
+        QFile::remove(temporaryName);
+        return false;
+    }
+    file.close();
+
+#ifdef Q_OS_WIN
+    auto ok = ::MoveFileExW(reinterpret_cast<const wchar_t *>(temporaryName.utf16()),
+                            reinterpret_cast<const wchar_t *>(fileName.utf16()),
+                            MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else /* POSIX */
+    auto ok = std::rename(QFile::encodeName(temporaryName).constData(),
+                         QFile::encodeName(fileName).constData()) == 0;
+    if (ok) {
+        /* Persist the rename itself */
+        auto dir = QFile::encodeName(QFileInfo(fileName).absolutePath());
+        auto fd = ::open(dir.constData(), O_RDONLY);
+        if (fd >= 0) {
+            ::fsync(fd);
+            ::close(fd);
+        }
+    }
+#endif
+    if (!ok) {
+        qWarning("Couldn't replace save file.");
+        QFile::remove(temporaryName);
+    }
+    return ok;
+}
+
+/******************************************************************************
+ ******************************************************************************/
+SessionWriter::SessionWriter() : QThread()
+{
+    start();
+}
+
+SessionWriter::~SessionWriter()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_shouldQuit = true;
+        m_queued.wakeAll();
+    }
+    wait();
+}
+
+/******************************************************************************
+ ******************************************************************************/
+/*!
+ * \brief Queues the given changes, to be appended to the journal of the file.
+ */
+void SessionWriter::append(const QString &fileName, qint64 generation,
+                           const QList<qint64> &removed, const QList<JobSnapshot> &jobs)
+{
+    Task task;
+    task.fileName = fileName;
+    task.generation = generation;
+    task.removed = removed;
+    task.jobs = jobs;
+    enqueue(std::move(task));
+}
+
+/*!
+ * \brief Queues the given jobs, to be written as the new checkpoint of the file.
+ * The journal is removed once the checkpoint is written.
+ */
+void SessionWriter::checkpoint(const QString &fileName, qint64 generation,
+                               const QList<JobSnapshot> &jobs)
+{
+    Task task;
+    task.isCheckpoint = true;
+    task.fileName = fileName;
+    task.generation = generation;
+    task.jobs = jobs;
+    enqueue(std::move(task));
+}
+
+void SessionWriter::enqueue(Task &&task)
+{
+    QMutexLocker locker(&m_mutex);
+    m_queue.append(std::move(task));
+    m_queued.wakeOne();
+}
+
+/*!
+ * \brief Waits until the queued tasks are written.
+ */
+void SessionWriter::flush()
+{
+    QMutexLocker locker(&m_mutex);
+    while (!m_queue.isEmpty() || m_busy) {
+        m_written.wait(&m_mutex);
+    }
+}
+
+/******************************************************************************
+ ******************************************************************************/
+/*!
+ * \brief Sets the sizes of the files, read when the session is opened.
+ */
+void SessionWriter::reset(qint64 checkpointSize, qint64 journalSize)
+{
+    QMutexLocker locker(&m_mutex);
+    m_checkpointSize = checkpointSize;
+    m_journalSize = journalSize;
+    m_failed = false;
+}
+
+qint64 SessionWriter::checkpointSize() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_checkpointSize;
+}
+
+qint64 SessionWriter::journalSize() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_journalSize;
+}
+
+bool SessionWriter::hasFailed() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_failed;
+}
+
+/******************************************************************************
+ ******************************************************************************/
+void SessionWriter::run()
+{
+    forever {
+        QMutexLocker locker(&m_mutex);
+        while (m_queue.isEmpty() && !m_shouldQuit) {
+            m_queued.wait(&m_mutex);
+        }
+        if (m_queue.isEmpty()) {
+            return;
+        }
+        auto task = m_queue.takeFirst();
+        m_busy = true;
+        locker.unlock();
+
+        auto ok = execute(task);
+
+        locker.relock();
+        if (task.isCheckpoint) {
+            m_failed = !ok;
+        } else if (!ok) {
+            m_failed = true;
+        }
+        m_busy = false;
+        m_written.wakeAll();
+    }
+}
+
+static inline QByteArray toRecord(const QJsonObject &json)
+{
+    return QJsonDocument(json).toJson(QJsonDocument::Compact) + '\n';
+}
+
+bool SessionWriter::execute(const Task &task)
+{
+    auto journalName = task.fileName + SESSION_JOURNAL_SUFFIX;
+    if (task.isCheckpoint) {
+        auto data = toBinary(task.jobs, task.generation);
+        if (!replace(task.fileName, data)) {
+            return false;
+        }
+        /* The journal is obsolete: its generation is the previous one */
+        QFile::remove(journalName);
+
+        QMutexLocker locker(&m_mutex);
+        m_checkpointSize = data.size();
+        m_journalSize = 0;
+        return true;
+    }
+
+    QFile journal(journalName);
+    if (!journal.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning("Couldn't open journal file.");
+        return false;
+    }
+    QByteArray data;
+    if (journal.size() == 0) {
+        QJsonObject header;
+        header["generation"] = task.generation;
+        data += toRecord(header);
+    }
+    for (auto id : task.removed) {
+        QJsonObject record;
+        record["del"] = id;
+        data += toRecord(record);
+    }
+    for (const auto &job : task.jobs) {
+        QJsonObject record;
+        record["put"] = job.id;
+        record["job"] = toJson(job);
+        data += toRecord(record);
+    }
+    if (journal.write(data) != data.size() || !sync(journal)) {
+        qWarning("Couldn't write journal file.");
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_journalSize = journal.size();
+    return true;
+}
@@ -0,0 +1,122 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef CORE_SESSION_WRITER_H
+#define CORE_SESSION_WRITER_H
+
+#include <Core/Stream>
+
+#include <QtCore/QByteArray>
+#include <QtCore/QJsonObject>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
+
+class DownloadItem;
+
+/*!
+ * @struct JobSnapshot
+ * @brief Copy of the saved properties of a download, readable from any thread.
+ */
+struct JobSnapshot
+{
+    qint64 id = -1;
+
+    int type = 0;
+    QString url = {};
+    QString destination = {};
+    QString mask = {};
+    QString customFileName = {};
+    QString referringPage = {};
+    QString description = {};
+    QString checkSum = {};
+    QString httpEntityTag = {};
+    QString httpLastModified = {};
+
+    QString streamFileName = {};
+    QString streamFormatId = {};
+    qint64 streamFileSize = 0;
+    StreamObject::Config streamConfig = {};
+
+    QString torrentPreferredFilePriorities = {};
+
+    int state = 0;
+    qint64 bytesReceived = 0;
+    qint64 bytesTotal = 0;
+    QString pendingRanges = {};
+    int maxConnectionSegments = 0;
+    int maxConnections = 0;
+    qint64 speedLimit = 0;
+
+    static JobSnapshot fromItem(const DownloadItem *item, qint64 id = -1);
+};
+
+/*!
+ * @class SessionWriter
+ * @brief Serializes and writes the queue files, in a dedicated thread.
+ */
+class SessionWriter : public QThread
+{
+public:
+    SessionWriter();
+    ~SessionWriter() override;
+
+    void append(const QString &fileName, qint64 generation,
+                const QList<qint64> &removed, const QList<JobSnapshot> &jobs);
+    void checkpoint(const QString &fileName, qint64 generation,
+                    const QList<JobSnapshot> &jobs);
+    void flush();
+
+    void reset(qint64 checkpointSize, qint64 journalSize);
+    qint64 checkpointSize() const;
+    qint64 journalSize() const;
+    bool hasFailed() const;
+
+    static QJsonObject toJson(const JobSnapshot &job);
+    static QByteArray toBinary(const QList<JobSnapshot> &jobs, qint64 generation);
+    static bool replace(const QString &fileName, const QByteArray &data);
+
+protected:
+    void run() override;
+
+private:
+    struct Task
+    {
+        bool isCheckpoint = false;
+        QString fileName = {};
+        qint64 generation = 0;
+        QList<qint64> removed = {};
+        QList<JobSnapshot> jobs = {};
+    };
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_queued;
+    QWaitCondition m_written;
+    QList<Task> m_queue = {};
+    bool m_busy = false;
+    bool m_failed = false;
+    bool m_shouldQuit = false;
+    qint64 m_checkpointSize = 0;
+    qint64 m_journalSize = 0;
+
+    void enqueue(Task &&task);
+    bool execute(const Task &task);
+};
+
+#endif // CORE_SESSION_WRITER_H
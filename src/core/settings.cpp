@@ -57,6 +57,10 @@ Settings::Settings(QObject *parent) : AbstractSettings(parent)
 
     // Tab Network
     addDefaultSettingInt(REGISTRY_MAX_SIMULTANEOUS, 4);
+    addDefaultSettingInt(REGISTRY_MAX_PER_HOST, 4);
+    addDefaultSettingBool(REGISTRY_LIMIT_PER_DOMAIN, false);
+    addDefaultSettingInt(REGISTRY_DOWNLOAD_LIMIT, 0);
+    addDefaultSettingString(REGISTRY_LIMIT_SCHEDULE, QString());
     addDefaultSettingInt(REGISTRY_CONCURRENT_FRAG, DEFAULT_CONCURRENT_FRAGMENTS);
     addDefaultSettingBool(REGISTRY_CUSTOM_BATCH, true);
     addDefaultSettingString(REGISTRY_CUSTOM_BATCH_BL, QLatin1String("1 -> 25"));
@@ -92,6 +96,7 @@ Settings::Settings(QObject *parent) : AbstractSettings(parent)
     addDefaultSettingBool(REGISTRY_REMOVE_CANCELED, false);
     addDefaultSettingBool(REGISTRY_REMOVE_PAUSED, false);
     addDefaultSettingString(REGISTRY_DATABASE, QString("%0/queue.json").arg(qApp->applicationDirPath()));
+    addDefaultSettingBool(REGISTRY_LOG_FILE, false);
     addDefaultSettingString(REGISTRY_HTTP_USER_AGENT, httpUserAgents().at(0));
     addDefaultSettingBool(REGISTRY_HTTP_REFERRER_ON, false);
     addDefaultSettingString(REGISTRY_HTTP_REFERRER, QLatin1String("https://www.example.com/"));
@@ -144,6 +149,8 @@ Settings::Settings(QObject *parent) : AbstractSettings(parent)
     addDefaultSettingString(REGISTRY_TORRENT_DIR, defaultTorrentShareFolder());
     addDefaultSettingString(REGISTRY_TORRENT_PEERS, QLatin1String(""));
     addDefaultSettingString(REGISTRY_TORRENT_ADVANCED, QLatin1String(""));
+    addDefaultSettingInt(REGISTRY_TORRENT_STATUS_REFRESH, MSEC_TORRENT_STATUS_REFRESH);
+    addDefaultSettingBool(REGISTRY_TORRENT_DEBUG_ALERTS, false);
 
     // Tab Advanced
     addDefaultSettingInt(REGISTRY_CHECK_UPDATE, static_cast<int>(CheckUpdateBeatMode::OnceADay));
@@ -300,6 +307,54 @@ void Settings::setMaxSimultaneousDownloads(int number)
     setSettingInt(REGISTRY_MAX_SIMULTANEOUS, number);
 }
 
+int Settings::maxSimultaneousDownloadsPerHost() const
+{
+    return getSettingInt(REGISTRY_MAX_PER_HOST);
+}
+
+void Settings::setMaxSimultaneousDownloadsPerHost(int number)
+{
+    setSettingInt(REGISTRY_MAX_PER_HOST, number);
+}
+
+bool Settings::isLimitPerDomainEnabled() const
+{
+    return getSettingBool(REGISTRY_LIMIT_PER_DOMAIN);
+}
+
+void Settings::setLimitPerDomainEnabled(bool enabled)
+{
+    setSettingBool(REGISTRY_LIMIT_PER_DOMAIN, enabled);
+}
+
+/*!
+ * \brief Returns the maximum download speed of all the downloads,
+ * in KB/s, or 0 if unlimited.
+ */
+int Settings::downloadLimit() const
+{
+    return getSettingInt(REGISTRY_DOWNLOAD_LIMIT);
+}
+
+void Settings::setDownloadLimit(int kilobytesPerSecond)
+{
+    setSettingInt(REGISTRY_DOWNLOAD_LIMIT, kilobytesPerSecond);
+}
+
+/*!
+ * \brief Returns the periods of the day with another download limit,
+ * like "08:00-18:00=512; 22:00-06:00=0" (in KB/s, 0 if unlimited).
+ */
+QString Settings::downloadLimitSchedule() const
+{
+    return getSettingString(REGISTRY_LIMIT_SCHEDULE);
+}
+
+void Settings::setDownloadLimitSchedule(const QString &schedule)
+{
+    setSettingString(REGISTRY_LIMIT_SCHEDULE, schedule);
+}
+
 int Settings::concurrentFragments() const
 {
     return getSettingInt(REGISTRY_CONCURRENT_FRAG);
@@ -573,6 +628,16 @@ void Settings::setDatabase(const QString &value)
     setSettingString(REGISTRY_DATABASE, value);
 }
 
+bool Settings::isLogFileEnabled() const
+{
+    return getSettingBool(REGISTRY_LOG_FILE);
+}
+
+void Settings::setLogFileEnabled(bool enabled)
+{
+    setSettingBool(REGISTRY_LOG_FILE, enabled);
+}
+
 QString Settings::httpUserAgent() const
 {
     return getSettingString(REGISTRY_HTTP_USER_AGENT);
@@ -733,6 +798,34 @@ void Settings::setTorrentPeers(const QString &value)
     setSettingString(REGISTRY_TORRENT_PEERS, value);
 }
 
+/*!
+ * \brief Interval between two polls of the torrent status, in milliseconds.
+ * \remark The alerts of libtorrent don't wait for the polls.
+ */
+int Settings::torrentStatusRefreshInterval() const
+{
+    return getSettingInt(REGISTRY_TORRENT_STATUS_REFRESH);
+}
+
+void Settings::setTorrentStatusRefreshInterval(int msec)
+{
+    setSettingInt(REGISTRY_TORRENT_STATUS_REFRESH, msec);
+}
+
+/*!
+ * \brief Debug mode: libtorrent posts all its alerts, and they are logged.
+ * \remark Slow with many torrents.
+ */
+bool Settings::isTorrentAlertDebugEnabled() const
+{
+    return getSettingBool(REGISTRY_TORRENT_DEBUG_ALERTS);
+}
+
+void Settings::setTorrentAlertDebugEnabled(bool enabled)
+{
+    setSettingBool(REGISTRY_TORRENT_DEBUG_ALERTS, enabled);
+}
+
 /* Other (advanced) settings */
 QMap<QString, QVariant> Settings::torrentSettings() const
 {
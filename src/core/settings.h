@@ -105,6 +105,18 @@ public:
     int maxSimultaneousDownloads() const;
     void setMaxSimultaneousDownloads(int number);
 
+    int maxSimultaneousDownloadsPerHost() const;
+    void setMaxSimultaneousDownloadsPerHost(int number);
+
+    bool isLimitPerDomainEnabled() const;
+    void setLimitPerDomainEnabled(bool enabled);
+
+    int downloadLimit() const;
+    void setDownloadLimit(int kilobytesPerSecond);
+
+    QString downloadLimitSchedule() const;
+    void setDownloadLimitSchedule(const QString &schedule);
+
     int concurrentFragments() const;
     void setConcurrentFragments(int fragments);
 
@@ -187,6 +199,9 @@ public:
     QString database() const;
     void setDatabase(const QString &value);
 
+    bool isLogFileEnabled() const;
+    void setLogFileEnabled(bool enabled);
+
     QString httpUserAgent() const;
     void setHttpUserAgent(const QString &value);
     static QStringList httpUserAgents();
@@ -217,6 +232,12 @@ public:
     QString torrentPeers() const;
     void setTorrentPeers(const QString &value);
 
+    int torrentStatusRefreshInterval() const;
+    void setTorrentStatusRefreshInterval(int msec);
+
+    bool isTorrentAlertDebugEnabled() const;
+    void setTorrentAlertDebugEnabled(bool enabled);
+
     QMap<QString, QVariant> torrentSettings() const;
     void setTorrentSettings(const QMap<QString, QVariant> &map);
 
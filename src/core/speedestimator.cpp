@@ -0,0 +1,130 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "speedestimator.h"
+
+#include <Constants>
+
+#include <QtCore/QtMath>
+
+/*!
+ * \class SpeedEstimator
+ *
+ * The estimator is fed with the total count of bytes received,
+ * and the time of the sample, in msecs, given by the caller.
+ * The samples closer than MSEC_SPEED_SAMPLE are coalesced,
+ * so the estimator can be fed each time some data is received.
+ *
+ * It gives three rates:
+ * \li instantRate(): over the last MSEC_SPEED_WINDOW msecs,
+ * \li smoothedRate(): exponentially weighted moving average of the
+ * rates between the samples, whose weights halve every MSEC_SPEED_HALF_LIFE,
+ * \li averageRate(): since start().
+ *
+ * The rates are -1 while unknown.
+ */
+
+void SpeedEstimator::start(qint64 now, qint64 bytes)
+{
+    m_first = { now, bytes };
+    m_last = m_first;
+    m_window.clear();
+    m_window.append(m_first);
+    m_smoothedRate = -1;
+    m_started = true;
+}
+
+void SpeedEstimator::reset()
+{
+    m_first = {};
+    m_last = {};
+    m_window.clear();
+    m_smoothedRate = -1;
+    m_started = false;
+}
+
+bool SpeedEstimator::isStarted() const
+{
+    return m_started;
+}
+
+/*!
+ * \brief Adds the sample. The estimator restarts if the count of bytes
+ * decreased, i.e. if the transfer restarted from the beginning.
+ */
+void SpeedEstimator::update(qint64 now, qint64 bytes)
+{
+    if (!m_started || bytes < m_last.bytes || now < m_last.time) {
+        start(now, bytes);
+        return;
+    }
+    m_last = { now, bytes };
+
+    auto previous = m_window.last();
+    auto elapsed = now - previous.time;
+    if (elapsed < MSEC_SPEED_SAMPLE) {
+        return;
+    }
+    auto rate = 1000 * static_cast<qreal>(bytes - previous.bytes) / static_cast<qreal>(elapsed);
+    if (m_smoothedRate < 0) {
+        m_smoothedRate = rate;
+    } else {
+        auto alpha = 1 - qPow(0.5, static_cast<qreal>(elapsed) / MSEC_SPEED_HALF_LIFE);
+        m_smoothedRate += alpha * (rate - m_smoothedRate);
+    }
+    m_window.append(m_last);
+    while (m_window.size() > 2 && m_window.at(1).time <= now - MSEC_SPEED_WINDOW) {
+        m_window.removeFirst();
+    }
+}
+
+/*!
+ * \brief Returns the bytes received since start().
+ */
+qint64 SpeedEstimator::bytesReceived() const
+{
+    return m_last.bytes - m_first.bytes;
+}
+
+/******************************************************************************
+ ******************************************************************************/
+qreal SpeedEstimator::instantRate() const
+{
+    if (m_window.isEmpty()) {
+        return -1;
+    }
+    auto first = m_window.first();
+    auto elapsed = m_last.time - first.time;
+    if (elapsed <= 0) {
+        return -1;
+    }
+    return 1000 * static_cast<qreal>(m_last.bytes - first.bytes) / static_cast<qreal>(elapsed);
+}
+
+qreal SpeedEstimator::smoothedRate() const
+{
+    return m_smoothedRate;
+}
+
+qreal SpeedEstimator::averageRate() const
+{
+    auto elapsed = m_last.time - m_first.time;
+    if (!m_started || elapsed <= 0) {
+        return -1;
+    }
+    return 1000 * static_cast<qreal>(m_last.bytes - m_first.bytes) / static_cast<qreal>(elapsed);
+}
@@ -0,0 +1,58 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef CORE_SPEED_ESTIMATOR_H
+#define CORE_SPEED_ESTIMATOR_H
+
+#include <QtCore/QList>
+
+/*!
+ * @class SpeedEstimator
+ * @brief Estimates a transfer rate, in bytes per second,
+ * from samples of the count of bytes received.
+ */
+class SpeedEstimator
+{
+public:
+    SpeedEstimator() = default;
+
+    void start(qint64 now, qint64 bytes = 0);
+    void reset();
+    bool isStarted() const;
+
+    void update(qint64 now, qint64 bytes);
+
+    qint64 bytesReceived() const;
+
+    qreal instantRate() const;
+    qreal smoothedRate() const;
+    qreal averageRate() const;
+
+private:
+    struct Sample
+    {
+        qint64 time = 0; /* msecs */
+        qint64 bytes = 0;
+    };
+    QList<Sample> m_window = {}; /* oldest first */
+    Sample m_first = {};
+    Sample m_last = {};
+    qreal m_smoothedRate = -1;
+    bool m_started = false;
+};
+
+#endif // CORE_SPEED_ESTIMATOR_H
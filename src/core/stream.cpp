@@ -295,6 +295,22 @@ void Stream::setFileSizeInBytes(qsizetype fileSizeInBytes)
     m_bytesTotal = fileSizeInBytes;
 }
 
+/******************************************************************************
+ ******************************************************************************/
+/*!
+ * \brief Returns the maximum download rate of the process,
+ * in bytes per second, or 0 if unlimited.
+ */
+qint64 Stream::rateLimit() const
+{
+    return m_rateLimit;
+}
+
+void Stream::setRateLimit(qint64 bytesPerSecond)
+{
+    m_rateLimit = qMax(qint64(0), bytesPerSecond);
+}
+
 /******************************************************************************
  ******************************************************************************/
 StreamObject::Config Stream::config() const
@@ -395,6 +411,9 @@ QStringList Stream::arguments() const
     if (s_youtubedl_socket_timeout > 0) {
         arguments << QLatin1String("--socket-timeout") << QString::number(s_youtubedl_socket_timeout);
     }
+    if (m_rateLimit > 0) {
+        arguments << QLatin1String("--limit-rate") << QString::number(m_rateLimit);
+    }
     switch (s_youtubedl_socket_type) {
     case 1: arguments << QLatin1String("--force-ipv4"); break;
     case 2: arguments << QLatin1String("--force-ipv6"); break;
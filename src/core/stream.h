@@ -379,6 +379,9 @@ public:
     qsizetype fileSizeInBytes() const;
     void setFileSizeInBytes(qsizetype fileSizeInBytes);
 
+    qint64 rateLimit() const;
+    void setRateLimit(qint64 bytesPerSecond);
+
     StreamObject::Config config() const;
     void setConfig(const StreamObject::Config &config);
 
@@ -416,6 +419,7 @@ private:
     QString m_outputPath = {};
     QString m_referringPage = {};
     StreamFormatId m_selectedFormatId = {};
+    qint64 m_rateLimit = 0;
 
     qsizetype m_bytesReceived = 0;
     qsizetype m_bytesReceivedCurrentSection = 0;
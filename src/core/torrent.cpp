@@ -125,6 +125,14 @@ void Torrent::setInfo(const TorrentInfo &info, bool mustRefreshMetaInfo)
     }
 }
 
+/*!
+ * \brief Applies the changes of the status to the info.
+ */
+void Torrent::setInfo(const TorrentStatus &status)
+{
+    status.applyInfoChanges(m_info);
+}
+
 /******************************************************************************
  ******************************************************************************/
 TorrentHandleInfo Torrent::detail() const
@@ -148,6 +156,27 @@ void Torrent::setDetail(const TorrentHandleInfo &detail, bool mustRefreshMetaInf
     emit changed();
 }
 
+/*!
+ * \brief Applies the changes of the status to the detail.
+ * Only the models of the changed fields are refreshed.
+ */
+void Torrent::setDetail(const TorrentStatus &status)
+{
+    status.applyDetailChanges(m_detail);
+    if (status.detailFields.testFlag(TorrentHandleInfo::FilesField)) {
+        m_fileModel->refreshData(m_detail.files);
+    }
+    if (status.detailFields.testFlag(TorrentHandleInfo::PeersField)) {
+        m_peerModel->refreshData(m_detail.peers);
+    }
+    if (status.detailFields.testFlag(TorrentHandleInfo::TrackersField)) {
+        m_trackerModel->refreshData(m_detail.trackers);
+    }
+
+    // requires a GUI update signal, because the info can change too
+    emit changed();
+}
+
 /******************************************************************************
  ******************************************************************************/
 void Torrent::setError(TorrentError::Type errorType, const QString &message)
@@ -627,7 +656,7 @@ QVariant TorrentPeerTableModel::data(const QModelIndex &index, int role) const
         return total > 0 ? qMin(qCeil(100 * done / total), 100) : 0;
 
     } else if (role == SegmentRole) {
-        return peer.availablePieces;
+        return peer.availablePieces.toBitArray();
 
     } else if (role == ConnectRole) {
         return m_connectedPeers.contains(peer.endpoint);
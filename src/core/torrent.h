@@ -56,9 +56,11 @@ public:
 
     TorrentInfo info() const;
     void setInfo(const TorrentInfo &info, bool mustRefreshMetaInfo);
+    void setInfo(const TorrentStatus &status);
 
     TorrentHandleInfo detail() const;
     void setDetail(const TorrentHandleInfo &detail, bool mustRefreshMetaInfo);
+    void setDetail(const TorrentStatus &status);
 
     int progress() const;
 
@@ -156,7 +158,7 @@ private:
     QList<TorrentFileInfo> m_files;
 
     qsizetype m_pieceByteSize = 0;
-    QBitArray m_downloadedPieces = {};
+    PieceBitmap m_downloadedPieces = {};
 
     int percent(const TorrentFileMetaInfo &mi, const TorrentFileInfo &ti) const;
     qint64 firstPieceIndex(const TorrentFileMetaInfo &mi) const;
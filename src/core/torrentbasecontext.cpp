@@ -37,6 +37,14 @@ void TorrentBaseContext::setPriorityByFileOrder(Torrent *torrent, const QList<in
     }
 }
 
+/*!
+ * \brief Sets the torrent whose details are shown.
+ * Its files, peers and trackers are refreshed, but not the other torrents'.
+ */
+void TorrentBaseContext::setInspectedTorrent(Torrent * /*torrent*/)
+{
+}
+
 TorrentFileInfo::Priority TorrentBaseContext::computePriority(int row, qsizetype count)
 {
     if (count < 3) {
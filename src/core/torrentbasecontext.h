@@ -30,6 +30,8 @@ public:
     virtual void setPriority(Torrent *torrent, int index, TorrentFileInfo::Priority p);
     virtual void setPriorityByFileOrder(Torrent *torrent, const QList<int> &rows);
 
+    virtual void setInspectedTorrent(Torrent *torrent);
+
     static TorrentFileInfo::Priority computePriority(int row, qsizetype count);
 };
 
@@ -237,3 +237,8 @@ void TorrentContext::setPriority(Torrent *torrent, int index, TorrentFileInfo::P
         qWarning() << "Caught exception in " << Q_FUNC_INFO << ": " << QString::fromUtf8(e.what());
     }
 }
+
+void TorrentContext::setInspectedTorrent(Torrent *torrent)
+{
+    d->setInspectedTorrent(torrent);
+}
@@ -94,6 +94,8 @@ public:
 
     void setPriority(Torrent *torrent, int index, TorrentFileInfo::Priority p) override;
 
+    void setInspectedTorrent(Torrent *torrent) override;
+
 signals:
     void changed();
 
@@ -33,6 +33,7 @@
 #include <QtNetwork/QNetworkReply>
 
 #include <algorithm> // std::min, std::max
+#include <array>     // std::array
 #include <chrono>
 #include <fstream>   // std::fstream
 #include <string>    // std::string
@@ -79,7 +80,6 @@ static const lt::status_flags_t s_torrent_status_flags =
         ;
 
 const std::chrono::milliseconds TIMEOUT_TERMINATING( 3000 );
-const std::chrono::milliseconds TIMEOUT_REFRESH( 500);
 
 
 TorrentContextPrivate::TorrentContextPrivate(TorrentContext *qq)
@@ -152,8 +152,12 @@ void TorrentContextPrivate::onSettingsChanged()
         }
     }
 
+    workerThread->setAlertDebugEnabled(settings->isTorrentAlertDebugEnabled());
     workerThread->setSettings(pack);
 
+    workerThread->setRefreshInterval(
+                std::chrono::milliseconds(settings->torrentStatusRefreshInterval()));
+
     auto enabled = settings->isTorrentEnabled();
     workerThread->setEnabled(enabled);
 }
@@ -322,9 +326,7 @@ void TorrentContextPrivate::onMetadataUpdated(TorrentData data)
                     TorrentInitialMetaInfo initialMetaInfo = TorrentUtils::toTorrentInitialMetaInfo(ti);
                     metaInfo.initialMetaInfo = initialMetaInfo;
 
-                    auto info = torrent->info();
-                    info.state = TorrentInfo::stopped;
-                    torrent->setInfo(info, true);
+                    setLocalState(torrent, TorrentInfo::stopped, true);
                     torrent->setMetaInfo(metaInfo); // setMetaInfo will emit the GUI update signal
 
                     resetPriorities(torrent);
@@ -353,8 +355,8 @@ void TorrentContextPrivate::onStatusUpdated(TorrentStatus status)
     qDebug_1 << Q_FUNC_INFO;
     auto torrent = find(status.unique_id);
     if (torrent) {
-        torrent->setInfo(status.info, false);
-        torrent->setDetail(status.detail, false);
+        torrent->setInfo(status);
+        torrent->setDetail(status); // setDetail will emit the GUI update signal
     }
 }
 
@@ -440,9 +442,7 @@ void TorrentContextPrivate::prepareTorrent(Torrent *torrent)
     if (!torrent) {
         return;
     }
-    auto info = torrent->info();
-    info.state = TorrentInfo::downloading_metadata;
-    torrent->setInfo(info, false);
+    setLocalState(torrent, TorrentInfo::downloading_metadata, false);
 
     auto torrentFile = torrent->localFullFileName(); // destination
 
@@ -666,9 +666,7 @@ void TorrentContextPrivate::readTorrentFile(const QString &filename, Torrent *to
 
     auto initialMetaInfo = workerThread->dump(filename);
 
-    auto info = torrent->info();
-    info.state = TorrentInfo::stopped;
-    torrent->setInfo(info, true);
+    setLocalState(torrent, TorrentInfo::stopped, true);
 
     auto metaInfo = torrent->metaInfo();
     metaInfo.initialMetaInfo = initialMetaInfo;
@@ -713,9 +711,7 @@ bool TorrentContextPrivate::hasTorrent(Torrent *torrent)
  */
 bool TorrentContextPrivate::addTorrent(Torrent *torrent) // resumeTorrent
 {
-    auto info = torrent->info();
-    info.state = TorrentInfo::checking_files;
-    torrent->setInfo(info, false);
+    setLocalState(torrent, TorrentInfo::checking_files, false);
 
     auto source = torrent->url();
     auto torrentFile = torrent->localFullFileName(); // destination
@@ -732,9 +728,7 @@ bool TorrentContextPrivate::addTorrent(Torrent *torrent) // resumeTorrent
     lt::add_torrent_params p;
 
     if (isMagnetSource(source)) { // Add from magnet link
-        auto info = torrent->info();
-        info.state = TorrentInfo::downloading_metadata;
-        torrent->setInfo(info, false);
+        setLocalState(torrent, TorrentInfo::downloading_metadata, false);
 
         auto bytes = source.toLatin1();
         // QByteArray bytes = source.toUtf8();
@@ -814,6 +808,13 @@ bool TorrentContextPrivate::addTorrent(Torrent *torrent) // resumeTorrent
 
     auto uuid = TorrentUtils::toUniqueId(handle.info_hash());
     hashMap.insert(uuid, torrent);
+
+    /* The state was set locally before the torrent had its id */
+    workerThread->resetInfo(uuid);
+
+    if (torrent == m_inspectedTorrent) {
+        workerThread->setInspectedTorrent(uuid);
+    }
     return true;
 }
 
@@ -832,6 +833,36 @@ void TorrentContextPrivate::removeTorrent(Torrent *torrent)
     }
 }
 
+/******************************************************************************
+ ******************************************************************************/
+/*!
+ * \brief Sets the torrent whose details (files, peers, trackers...) are
+ * shown, and hence are refreshed. The others get their status only.
+ */
+void TorrentContextPrivate::setInspectedTorrent(Torrent *torrent)
+{
+    qDebug_1 << Q_FUNC_INFO;
+    m_inspectedTorrent = torrent;
+    workerThread->setInspectedTorrent(hashMap.key(torrent, UniqueId()));
+}
+
+/*!
+ * \brief Shows the given state until libtorrent reports the actual one.
+ * The worker sends the next status of the torrent entirely, since
+ * the state of the GUI differs from the last one it sent.
+ */
+void TorrentContextPrivate::setLocalState(Torrent *torrent, TorrentInfo::TorrentState state, bool mustRefreshMetaInfo)
+{
+    auto info = torrent->info();
+    info.state = state;
+    torrent->setInfo(info, mustRefreshMetaInfo);
+
+    auto uuid = hashMap.key(torrent, UniqueId());
+    if (!uuid.isEmpty()) {
+        workerThread->resetInfo(uuid);
+    }
+}
+
 /******************************************************************************
  ******************************************************************************/
 void TorrentContextPrivate::resumeTorrent(Torrent *torrent)
@@ -1107,6 +1138,7 @@ inline lt::torrent_handle TorrentContextPrivate::find(Torrent *torrent)
  ******************************************************************************/
 WorkerThread::WorkerThread(QObject *parent) : QThread(parent)
   , m_session_ptr(new lt::session())
+  , m_statusRefresh(MSEC_TORRENT_STATUS_REFRESH)
 {
 }
 
@@ -1115,6 +1147,32 @@ WorkerThread::WorkerThread(QObject *parent) : QThread(parent)
 void WorkerThread::stop()
 {
     shouldQuit = true;
+    wakeUp();
+}
+
+/*!
+ * \brief Wakes the main loop up.
+ * \remark Called by the libtorrent's network thread, when the alert queue
+ * becomes non-empty: it must not call libtorrent, nor block.
+ */
+void WorkerThread::wakeUp()
+{
+    {
+        const std::lock_guard<std::mutex> lock(m_alertMutex);
+        m_hasAlerts = true;
+    }
+    m_alertCondition.notify_one();
+}
+
+/******************************************************************************
+ ******************************************************************************/
+/*!
+ * \brief Sets the cadence of the status polls.
+ * The new interval applies after the next poll.
+ */
+void WorkerThread::setRefreshInterval(std::chrono::milliseconds status)
+{
+    m_statusRefresh = std::max(MSEC_TORRENT_REFRESH_MIN, static_cast<int>(status.count()));
 }
 
 /******************************************************************************
@@ -1138,6 +1196,7 @@ void WorkerThread::setEnabled(bool enabled)
         } else {
             m_session_ptr->pause();
         }
+        wakeUp(); // The loop starts or stops the polls
     }
 }
 
@@ -1159,7 +1218,7 @@ void WorkerThread::setSettings(lt::settings_pack &pack)
 
         // Settings that can't be modified by the user
         pack.set_str(lt::settings_pack::user_agent, std::string());
-        pack.set_int(lt::settings_pack::alert_mask, lt::alert::all_categories);
+        pack.set_int(lt::settings_pack::alert_mask, static_cast<int>(static_cast<std::uint32_t>(alertMask())));
 
         m_session_ptr->apply_settings(pack);
     }
@@ -1268,21 +1327,62 @@ void WorkerThread::run()
 
     session.pause();
 
+    /*
+     * The loop sleeps until libtorrent posts alerts, or until the next poll.
+     * Rem: the notification is sent only when the alert queue becomes
+     * non-empty, so the queue is emptied after each wake up.
+     */
+    session.set_alert_notify([this]() { wakeUp(); });
+
+    using Clock = std::chrono::steady_clock;
+    auto nextStatusPoll = Clock::now();
+    auto isPolling = false;
+
+    std::vector<lt::alert*> alerts;
+
     // main loop
     while (!shouldQuit) {
-        session.post_torrent_updates(s_torrent_status_flags);
-        session.post_session_stats();
-        session.post_dht_stats();
+        /*
+         * No status changes while the session is paused or empty:
+         * the polls stop, after a last one that sends the paused states.
+         * A newly inspected torrent still gets its details.
+         */
+        auto wasPolling = isPolling;
+        isPolling = m_torrentCount > 0 && !session.is_paused();
+        auto isInspectedChanged = false;
+        {
+            const std::lock_guard<std::mutex> lock(m_inspectedMutex);
+            isInspectedChanged = m_inspectedId != m_detailId;
+        }
+
+        auto now = Clock::now();
+        if ((isPolling && now >= nextStatusPoll)
+                || (wasPolling && !isPolling)
+                || isInspectedChanged) {
+            session.post_torrent_updates(s_torrent_status_flags);
+            requestDetail();
+            nextStatusPoll = now + std::chrono::milliseconds(m_statusRefresh.load());
+        }
 
-        QThread::msleep(TIMEOUT_REFRESH.count());
+        {
+            std::unique_lock<std::mutex> lock(m_alertMutex);
+            auto isWoken = [this]() { return m_hasAlerts || shouldQuit; };
+            if (isPolling) {
+                m_alertCondition.wait_until(lock, nextStatusPoll, isWoken);
+            } else {
+                m_alertCondition.wait(lock, isWoken);
+            }
+            m_hasAlerts = false;
+        }
 
-        std::vector<lt::alert*> alerts;
         session.pop_alerts(&alerts);
         for (auto a : alerts) {
             signalizeAlert(a);
         }
     } // end of main loop
 
+    session.set_alert_notify([]() {});
+
     qDebug_2 << Q_FUNC_INFO << "Closing session... ";
 
     /*
@@ -1303,376 +1403,265 @@ void WorkerThread::run()
 /******************************************************************************
  ******************************************************************************/
 /*!
- * \brief Convert lt::alert to QSignal
+ * \brief Returns the categories of the alerts consumed by signalizeAlert().
+ * In debug mode, all the alerts are requested, and logged.
  */
-void WorkerThread::signalizeAlert(lt::alert* a)
+lt::alert_category_t WorkerThread::alertMask() const
 {
-    /* status_notification */
-    if (auto s = lt::alert_cast<lt::torrent_removed_alert>(a)) {
-        //QString hash = toString(s->info_hashes.get_best());
-        //  emit torrentRemoved(hash);
-    }
-    else if (auto s = lt::alert_cast<lt::state_changed_alert>(a)) {
-        //        lt::torrent_status::state_t oldStatus = s->prev_state;
-        //        lt::torrent_status::state_t newStatus = s->state;
-        //  emit torrentStateChanged(oldState, newState); // rem quel torrent ?
-    }
-    else if (auto s = lt::alert_cast<lt::hash_failed_alert>(a)) {
-        //        int piece_index = (int)s->piece_index;
-        //  emit pieceHashCheckFailed(piece_index);
-    }
-    else if (auto s = lt::alert_cast<lt::torrent_finished_alert>(a)) {
-        //        emit torrentFinished();
-    }
-    else if (auto s = lt::alert_cast<lt::torrent_paused_alert>(a)) {
-        //        emit torrentPaused();
-    }
-    else if (auto s = lt::alert_cast<lt::torrent_resumed_alert>(a)) {
-        //        emit torrentResumed();
-    }
-    else if (auto s = lt::alert_cast<lt::torrent_checked_alert>(a)) {
-        //        emit torrentChecked();
-    }
-    else if (auto s = lt::alert_cast<lt::fastresume_rejected_alert>(a)) {
-        //        emit torrentFastResumeFailed();
-    }
-    else if (auto s = lt::alert_cast<lt::trackerid_alert>(a)) {
-        //        emit trackeridReceived();
-    }
-    else if (auto s = lt::alert_cast<lt::torrent_error_alert>(a)) {
-        //        emit torrentError();
-    }
-    else if (auto s = lt::alert_cast<lt::torrent_need_cert_alert>(a)) {
-        //        emit torrentSSLError();
-    }
-    else if (auto s = lt::alert_cast<lt::add_torrent_alert>(a)) {
-        onTorrentAdded(s->handle, s->params, s->error);
-    }
-    else if (auto s = lt::alert_cast<lt::state_update_alert>(a)) {
-        /* Note: This alert is emitted very often (each loop) */
-        // log(s);
-        onStateUpdated(s->status);
+    if (m_debugAlerts) {
+        return lt::alert_category::all;
     }
+    return lt::alert_category::status
+            | lt::alert_category::error
+            | lt::alert_category::performance_warning
+            | lt::alert_category::file_progress;
+}
 
-    // magnet extension
-    else if (auto s = lt::alert_cast<lt::metadata_failed_alert>(a)) {
-        //        emit metadataFailed();
-        qWarning() << "metadata that was received was corrupt";
-    }
-    else if (auto s = lt::alert_cast<lt::metadata_received_alert>(a)) {
-        onMetadataReceived(s->handle);
-    }
+void WorkerThread::setAlertDebugEnabled(bool enabled)
+{
+    m_debugAlerts = enabled;
+}
 
+/*!
+ * \brief Returns the handlers of the alerts, indexed by lt::alert::type().
+ * The alerts without handler are ignored.
+ */
+const WorkerThread::AlertHandler* WorkerThread::alertHandlers()
+{
+    static const auto handlers = []() {
+        std::array<AlertHandler, lt::num_alert_types> h = {};
+        h[lt::add_torrent_alert::alert_type]       = &WorkerThread::onAddTorrentAlert;
+        h[lt::torrent_removed_alert::alert_type]   = &WorkerThread::onTorrentRemovedAlert;
+        h[lt::state_update_alert::alert_type]      = &WorkerThread::onStateUpdateAlert;
+        h[lt::metadata_received_alert::alert_type] = &WorkerThread::onMetadataReceivedAlert;
+        h[lt::metadata_failed_alert::alert_type]   = &WorkerThread::onErrorAlert;
+        h[lt::torrent_error_alert::alert_type]     = &WorkerThread::onErrorAlert;
+        h[lt::file_error_alert::alert_type]        = &WorkerThread::onErrorAlert;
+        h[lt::performance_alert::alert_type]       = &WorkerThread::onErrorAlert;
+        h[lt::alerts_dropped_alert::alert_type]    = &WorkerThread::onAlertsDroppedAlert;
+        h[lt::file_progress_alert::alert_type]      = &WorkerThread::onFileProgressAlert;
+        h[lt::peer_info_alert::alert_type]          = &WorkerThread::onPeerInfoAlert;
+        h[lt::tracker_list_alert::alert_type]       = &WorkerThread::onTrackerListAlert;
+        h[lt::piece_availability_alert::alert_type] = &WorkerThread::onPieceAvailabilityAlert;
+        return h;
+    }();
+    return handlers.data();
+}
 
-    // IP
-    else if (auto s = lt::alert_cast<lt::external_ip_alert>(a)) {
-        Q_UNUSED(s) //  emit externalIpAddressReceived();
-    }
-    else if (auto s = lt::alert_cast<lt::peer_blocked_alert>(a)) {
-        Q_UNUSED(s) //  emit peerIpBlocked();
-    }
-    // dht
-    else if (auto s = lt::alert_cast<lt::dht_announce_alert>(a)) {
-        Q_UNUSED(s) //  emit peerDHT();
-    }
-    else if (auto s = lt::alert_cast<lt::dht_get_peers_alert>(a)) {
-        Q_UNUSED(s) //  emit peerDHTReceviedd();
-    }
-    else if (auto s = lt::alert_cast<lt::dht_bootstrap_alert>(a)) {
-        Q_UNUSED(s) //  emit peerDHTbootstrapDone();
-    }
-    else if (auto s = lt::alert_cast<lt::dht_error_alert>(a)) {
-        Q_UNUSED(s) //  emit peerDHTError();
-    }
-    else if (auto s = lt::alert_cast<lt::dht_immutable_item_alert>(a)) {
-        Q_UNUSED(s) //  emit peerDHTImmmutablee();
-    }
-    else if (auto s = lt::alert_cast<lt::dht_mutable_item_alert>(a)) {
-        Q_UNUSED(s) //  emit peerDHTmutablee();
-    }
-    else if (auto s = lt::alert_cast<lt::dht_put_alert>(a)) {
-        Q_UNUSED(s) //  emit peerDHTput();
-    }
-    else if (auto s = lt::alert_cast<lt::i2p_alert>(a)) {
-        Q_UNUSED(s) //  emit i2pError();
+/*!
+ * \brief Convert lt::alert to QSignal
+ */
+void WorkerThread::signalizeAlert(lt::alert* a)
+{
+    const auto type = a->type();
+    if (type >= 0 && type < lt::num_alert_types) {
+        auto handler = alertHandlers()[type];
+        if (handler) {
+            (this->*handler)(a);
+            return;
+        }
     }
-    else if (auto s = lt::alert_cast<lt::dht_outgoing_get_peers_alert>(a)) {
-        Q_UNUSED(s) //  emit dht_get_peers_Sent();
+    if (m_debugAlerts) {
+        log(a);
     }
+}
 
-
-
-    // Firewall error ?
-    else if (auto s = lt::alert_cast<lt::udp_error_alert>(a)) {
-        Q_UNUSED(s) //  emit protocolError();
-    }
-    else if (auto s = lt::alert_cast<lt::listen_succeeded_alert>(a)) {
-        Q_UNUSED(s) //  emit hostPortOpened();
-    }
-    else if (auto s = lt::alert_cast<lt::listen_failed_alert>(a)) {
-        Q_UNUSED(s) //  emit hostPortOpenFailed();
-    }
-    else if (auto s = lt::alert_cast<lt::portmap_alert>(a)) {
-        Q_UNUSED(s) //  emit portOpened();
-    }
-    else if (auto s = lt::alert_cast<lt::portmap_error_alert>(a)) {
-        Q_UNUSED(s) //  emit portOpenFailed();
-    }
-    else if (auto s = lt::alert_cast<lt::portmap_log_alert>(a)) {
-        Q_UNUSED(s) //  emit debugPort();
-    }
-    else if (auto s = lt::alert_cast<lt::log_alert>(a)) {
-        Q_UNUSED(s) //  emit debugLog();
-    }
-    else if (auto s = lt::alert_cast<lt::torrent_log_alert>(a)) {
-        Q_UNUSED(s) //  emit debugTorrentLog();
-    }
-    else if (auto s = lt::alert_cast<lt::peer_log_alert>(a)) {
-        Q_UNUSED(s) //  emit debugPeerLog();
-    }
-    else if (auto s = lt::alert_cast<lt::lsd_error_alert>(a)) {
-        Q_UNUSED(s) //  emit debugLSDPeerLog();
-    }
-    else if (auto s = lt::alert_cast<lt::dht_log_alert>(a)) {
-        Q_UNUSED(s) //  emit debugDHTLog();
-    }
-    else if (auto s = lt::alert_cast<lt::dht_pkt_alert>(a)) {
-        Q_UNUSED(s) //  emit dht_pkt_alert();
-    }
-    else if (auto s = lt::alert_cast<lt::dht_get_peers_reply_alert>(a)) {
-        Q_UNUSED(s) //  emit dht_get_peers_reply_alert();
-    }
-    else if (auto s = lt::alert_cast<lt::dht_direct_response_alert>(a)) {
-        Q_UNUSED(s) //  emit dht_direct_response_alert();
-    }
-    else if (auto s = lt::alert_cast<lt::picker_log_alert>(a)) {
-        Q_UNUSED(s) //  emit debugPickerLog();
-    }
-    else if (auto s = lt::alert_cast<lt::session_error_alert>(a)) {
-        Q_UNUSED(s) //  emit session_error_alert();
-    }
-    else if (auto s = lt::alert_cast<lt::dht_live_nodes_alert>(a)) {
-        Q_UNUSED(s) //  emit dht_live_nodes_alert();
-    }
-    else if (auto s = lt::alert_cast<lt::dht_sample_infohashes_alert>(a)) {
-        Q_UNUSED(s) //  emit dht_sample_infohashes_alert();
+void WorkerThread::onAddTorrentAlert(lt::alert *a)
+{
+    auto s = static_cast<lt::add_torrent_alert*>(a);
+    if (!s->error) {
+        m_torrentCount++;
     }
+    onTorrentAdded(s->handle, s->params, s->error);
+}
 
+void WorkerThread::onTorrentRemovedAlert(lt::alert *a)
+{
+    auto s = static_cast<lt::torrent_removed_alert*>(a);
+    m_torrentCount = std::max(0, m_torrentCount - 1);
+    m_lastInfo.remove(TorrentUtils::toUniqueId(s->info_hashes));
+}
 
-    /* stats_notification */
-    else if (auto s = lt::alert_cast<lt::session_stats_alert>(a)) {
-        //        const lt::span<std::int64_t const> counters = s->counters() ;
+void WorkerThread::onStateUpdateAlert(lt::alert *a)
+{
+    /* Note: This alert is emitted at each status poll */
+    auto s = static_cast<lt::state_update_alert*>(a);
+    onStateUpdated(s->status);
+}
 
-        // TODO
+void WorkerThread::onMetadataReceivedAlert(lt::alert *a)
+{
+    auto s = static_cast<lt::metadata_received_alert*>(a);
+    onMetadataReceived(s->handle);
+}
 
-        Q_UNUSED(s) //  emit sessionStatsUpdated();
-    }
-    else if (auto s = lt::alert_cast<lt::dht_stats_alert>(a)) {
-        Q_UNUSED(s) //  emit dhtStatsUpdated();
-    }
-    else if (auto s = lt::alert_cast<lt::session_stats_header_alert>(a)) {
-        Q_UNUSED(s) //  emit session_stats_header_Updated();
-    }
+void WorkerThread::onErrorAlert(lt::alert *a)
+{
+    qWarning() << "[alert]" << QString::fromStdString(a->message());
+}
 
+void WorkerThread::onAlertsDroppedAlert(lt::alert *a)
+{
+    Q_UNUSED(a)
+    qWarning() << "Alert queue grew too big.";
+}
 
-    /* storage_notification */
-    else if (auto s = lt::alert_cast<lt::read_piece_alert>(a)) {
-        Q_UNUSED(s) // emit fileCompleted(index);
-    }
-    else if (auto s = lt::alert_cast<lt::file_prio_alert>(a)) {
-        Q_UNUSED(s)
-    }
-    else if (auto s = lt::alert_cast<lt::oversized_file_alert>(a)) {
-        Q_UNUSED(s)
-    }
-    else if (auto s = lt::alert_cast<lt::torrent_conflict_alert>(a)) {
-        Q_UNUSED(s)
-    }
-    else if (auto s = lt::alert_cast<lt::peer_info_alert>(a)) {
-        Q_UNUSED(s)
-    }
-    else if (auto s = lt::alert_cast<lt::file_progress_alert>(a)) {
-        Q_UNUSED(s)
-    }
-    else if (auto s = lt::alert_cast<lt::piece_info_alert>(a)) {
-        Q_UNUSED(s)
-    }
-    else if (auto s = lt::alert_cast<lt::piece_availability_alert>(a)) {
-        Q_UNUSED(s)
+void WorkerThread::onFileProgressAlert(lt::alert *a)
+{
+    auto s = static_cast<lt::file_progress_alert*>(a);
+    if (s->handle != m_detailHandle) {
+        return; // reply to a previously inspected torrent
     }
-    else if (auto s = lt::alert_cast<lt::tracker_list_alert>(a)) {
-        Q_UNUSED(s)
+    const qsizetype count = std::min(m_detail.files.count(), static_cast<qsizetype>(s->files.size()));
+    for (auto index = 0; index < count; ++index) {
+        auto findex = static_cast<lt::file_index_t>(index);
+        m_detail.files[index].bytesReceived = static_cast<qsizetype>(s->files[findex]);
     }
+    onDetailReplied();
+}
 
-    else if (auto s = lt::alert_cast<lt::file_renamed_alert>(a)) {
-        //        int index = (int)s->index;
-        //        QString newName = QString::fromUtf8(s->new_name());
-        Q_UNUSED(s) //  emit fileRenamed(index, newName);
-    }
-    else if (auto s = lt::alert_cast<lt::file_rename_failed_alert>(a)) {
-        //        int index = (int)s->index;
-        //        QString errorMessage = QString::fromStdString(s->error.message());
-        Q_UNUSED(s) //  emit fileRenameFailed(index, errorMessage);
-    }
-    else if (auto s = lt::alert_cast<lt::storage_moved_alert>(a)) {
-        Q_UNUSED(s) //  emit storageMoved();
-    }
-    else if (auto s = lt::alert_cast<lt::storage_moved_failed_alert>(a)) {
-        Q_UNUSED(s) //  emit storageMoveFailed();
-    }
-    else if (auto s = lt::alert_cast<lt::torrent_deleted_alert>(a)) {
-        Q_UNUSED(s) //  emit torrentDeleted();
+void WorkerThread::onPeerInfoAlert(lt::alert *a)
+{
+    auto s = static_cast<lt::peer_info_alert*>(a);
+    if (s->handle != m_detailHandle) {
+        return;
     }
-    else if (auto s = lt::alert_cast<lt::torrent_delete_failed_alert>(a)) {
-        Q_UNUSED(s) //  emit torrentDeleteFailed();
+    m_detail.peers.clear();
+    for (auto peer : s->peer_info) {
+        m_detail.peers.append(TorrentUtils::toTorrentPeerInfo(peer));
     }
-    else if (auto s = lt::alert_cast<lt::save_resume_data_alert>(a)) {
-        Q_UNUSED(s) //  emit resumeDataSaved();
+    onDetailReplied();
+}
 
-    } else if (auto s = lt::alert_cast<lt::save_resume_data_failed_alert>(a)) {
-        Q_UNUSED(s) //  emit resumeDataSaveFailed();
-    }
-    else if (auto s = lt::alert_cast<lt::file_error_alert>(a)) {
-        Q_UNUSED(s) //  emit fileReadOrWriteError();
+void WorkerThread::onTrackerListAlert(lt::alert *a)
+{
+    auto s = static_cast<lt::tracker_list_alert*>(a);
+    if (s->handle != m_detailHandle) {
+        return;
     }
-    else if (auto s = lt::alert_cast<lt::cache_flushed_alert>(a)) {
-        Q_UNUSED(s) //  emit cache_flushed();
+    m_detail.trackers.clear();
+    for (auto tracker : s->trackers) {
+        m_detail.trackers.append(TorrentUtils::toTorrentTrackerInfo(tracker));
     }
+    onDetailReplied();
+}
 
-
-
-
-    /* file_progress_notification */
-    else if (auto s = lt::alert_cast<lt::file_completed_alert>(a)) {
-        //        int index = (int)s->index;
-        Q_UNUSED(s) //  emit fileCompleted(index);
+void WorkerThread::onPieceAvailabilityAlert(lt::alert *a)
+{
+    auto s = static_cast<lt::piece_availability_alert*>(a);
+    if (s->handle != m_detailHandle) {
+        return;
     }
+    m_detail.pieceAvailability = QVector<int>(s->piece_availability.begin(), s->piece_availability.end());
+    onDetailReplied();
+}
 
-    /* performance_warning */
-    else if (auto s = lt::alert_cast<lt::performance_alert>(a)) {
-        //        QString message = QString::fromStdString(s->message());
-        Q_UNUSED(s) //  emit performanceWarning(message);
+/******************************************************************************
+ ******************************************************************************/
+/*!
+ * \brief Sets the torrent whose details are requested, at each status poll.
+ * An empty \a uuid stops the requests.
+ */
+void WorkerThread::setInspectedTorrent(const UniqueId &uuid)
+{
+    {
+        const std::lock_guard<std::mutex> lock(m_inspectedMutex);
+        m_inspectedId = uuid;
     }
+    wakeUp();
+}
 
-    /* tracker_notification & error_notification */
-    else if (auto s = lt::alert_cast<lt::tracker_error_alert>(a)) {
-        //        int times_in_row = s->times_in_row;
-        Q_UNUSED(s) //  emit trackerConnectionFailed(times_in_row, errorCode);
-    }
-    else if (auto s = lt::alert_cast<lt::tracker_warning_alert>(a)) {
-        //        QString message = QString::fromUtf8(s->warning_message());
-        Q_UNUSED(s) //  emit trackerMessageReceived(message);
-    }
-    else if (auto s = lt::alert_cast<lt::scrape_reply_alert>(a)) {
-        //        int incomplete = s->incomplete;
-        //        int complete = s->complete;
-        Q_UNUSED(s) //  emit trackerScrapeSucceeded(incomplete, complete);
-    }
-    else if (auto s = lt::alert_cast<lt::scrape_failed_alert>(a)) {
-        //        QString errorCode = QString::fromStdString(s->error.message());
-        //        QString errorMessage = QString::fromUtf8(s->error_message());
-        Q_UNUSED(s) //  emit trackerScrapeFailed(errorCode, errorMessage);
-    }
-    else if (auto s = lt::alert_cast<lt::tracker_reply_alert>(a)) {
-        //        int peersCount = s->num_peers;
-        Q_UNUSED(s) //  emit trackerInfo(peersCount);
-    }
-    else if (auto s = lt::alert_cast<lt::dht_reply_alert>(a)) {
-        //        int peersCount = s->num_peers;
-        Q_UNUSED(s) //  emit trackerDHTInfo(peersCount);
-    }
-    else if (auto s = lt::alert_cast<lt::tracker_announce_alert>(a)) {
-        //        int eventcode = s->event;
-        Q_UNUSED(s) //  emit trackerEventSent(eventcode);
-    }
+/*!
+ * \brief Forgets the last info sent for the torrent:
+ * its next status is sent entirely.
+ */
+void WorkerThread::resetInfo(const UniqueId &uuid)
+{
+    const std::lock_guard<std::mutex> lock(m_resetMutex);
+    m_resetInfoIds.insert(uuid);
+}
 
-    /* peer_notification */
-    else if (auto s = lt::alert_cast<lt::peer_ban_alert>(a)) {
-        Q_UNUSED(s) //  emit peerBanned();
-    }
-    else if (auto s = lt::alert_cast<lt::peer_unsnubbed_alert>(a)) {
-        Q_UNUSED(s) //  emit peerUnsnubbed();
-    }
-    else if (auto s = lt::alert_cast<lt::peer_snubbed_alert>(a)) {
-        Q_UNUSED(s) //  emit peerSnubbed();
+/*!
+ * \brief Requests the details of the inspected torrent.
+ * The files, peers, trackers and piece availability are posted asynchronously
+ * by libtorrent, so the details are emitted when the last reply is received.
+ * Only the cheap properties are read synchronously.
+ */
+void WorkerThread::requestDetail()
+{
+    UniqueId uuid;
+    {
+        const std::lock_guard<std::mutex> lock(m_inspectedMutex);
+        uuid = m_inspectedId;
     }
-    else if (auto s = lt::alert_cast<lt::peer_error_alert>(a)) {
-        //        QString operation = QString::fromUtf8(lt::operation_name(s->op));
-        //        QString errorCode = QString::fromStdString(s->error.message());
-        Q_UNUSED(s) //  emit peerAboutToDisconnected(operation, errorCode);
+    if (uuid != m_detailId || !m_detailHandle.is_valid()) {
+        m_detailId = uuid;
+        m_detailHandle = uuid.isEmpty() ? lt::torrent_handle() : findTorrent(uuid);
+        m_detail = {};
+        m_isDetailReset = true;
     }
-    else if (auto s = lt::alert_cast<lt::peer_connect_alert>(a)) {
-        Q_UNUSED(s)
-        // don't log every peer we try to connect to
+    m_pendingDetailReplies = 0;
+    if (!m_detailHandle.is_valid()) {
         return;
-        //  int socket_type = s->socket_type;
-        //  emit peerConnected(socket_type);
-    }
-    else if (auto s = lt::alert_cast<lt::peer_disconnected_alert>(a)) {
-        //        int socket_type = s->socket_type;
-        //        operation_t const op;
-        //		error_code const error;
-        //		close_reason_t const reason;
-        Q_UNUSED(s) //  emit peerDisconnected(/*socket_type*/);
-    }
-    else if (auto s = lt::alert_cast<lt::invalid_request_alert>(a)) {
-        //        peer_request const request;
-        //		bool const we_have;
-        //		bool const peer_interested;
-        //		bool const withheld;
-        Q_UNUSED(s) //  emit peerInvalidPieceReceived();
-    }
-    else if (auto s = lt::alert_cast<lt::piece_finished_alert>(a)) {
-        Q_UNUSED(s) //  emit pieceFinished();
-    }
-    else if (auto s = lt::alert_cast<lt::lsd_peer_alert>(a)) {
-        Q_UNUSED(s) //  emit lsd_peer();
-    }
-    else if (auto s = lt::alert_cast<lt::incoming_connection_alert>(a)) {
-        Q_UNUSED(s) //  emit peerIncomingConnectionAccepted();
-    }
-    else if (auto s = lt::alert_cast<lt::incoming_request_alert>(a)) {
-        Q_UNUSED(s) //  emit peerIncomingrequestAccepted();
     }
+    const auto &handle = m_detailHandle;
 
+    m_detail.uploadBandwidthLimit   = handle.upload_limit();
+    m_detail.downloadBandwidthLimit = handle.download_limit();
+    m_detail.maxUploads             = handle.max_uploads();
+    m_detail.maxConnections         = handle.max_connections();
 
-    /* block_progress_notification */
-    else if (auto s = lt::alert_cast<lt::request_dropped_alert>(a)) {
-        Q_UNUSED(s) //  emit peerPieceRejected();
-    }
-    else if (auto s = lt::alert_cast<lt::block_timeout_alert>(a)) {
-        Q_UNUSED(s) //  emit peerPieceTimeOut();
-    }
-    else if (auto s = lt::alert_cast<lt::block_finished_alert>(a)) {
-        Q_UNUSED(s) //  emit peerPieceFinished();
-    }
-    else if (auto s = lt::alert_cast<lt::block_downloading_alert>(a)) {
-        Q_UNUSED(s) //  emit peerPieceDownloading();
+    m_detail.httpSeeds.clear();
+    for (auto webSeed : handle.http_seeds()) {
+        m_detail.httpSeeds.append(TorrentUtils::toString(webSeed));
     }
-    else if (auto s = lt::alert_cast<lt::unwanted_block_alert>(a)) {
-        Q_UNUSED(s) //  emit peerPieceUnwanted();
+    m_detail.urlSeeds.clear();
+    for (auto webSeed : handle.url_seeds()) {
+        m_detail.urlSeeds.append(TorrentUtils::toString(webSeed));
     }
 
-    else if (auto s = lt::alert_cast<lt::url_seed_alert>(a)) {
-        Q_UNUSED(s) //  emit seedUrlFailed();
-    }
-    else if (auto s = lt::alert_cast<lt::block_uploaded_alert>(a)) {
-        Q_UNUSED(s) //  emit blockUploaded();
+    m_detail.piecePriority.clear();
+    for (auto priority : handle.get_piece_priorities()) {
+        m_detail.piecePriority.append(TorrentUtils::toPriority(priority));
     }
 
-
-    /* block_progress_notification */
-    else if (auto s = lt::alert_cast<lt::alerts_dropped_alert>(a)) {
-        Q_UNUSED(s) //  emit alerts_dropped_alert();
-        qWarning() << "Alert queue grew too big.";
-    }
-    else if (auto s = lt::alert_cast<lt::socks5_alert>(a)) {
-        Q_UNUSED(s) //  emit socks5_alert();
+    if (handle.torrent_file()) {
+        // Keep the previous progress until the file_progress_alert is received
+        auto priorities = handle.get_file_priorities();
+        const qsizetype count = static_cast<qsizetype>(priorities.size());
+        m_detail.files.resize(count);
+        for (auto index = 0; index < count; ++index) {
+            m_detail.files[index].priority = TorrentUtils::toPriority(priorities.at(static_cast<std::size_t>(index)));
+        }
+        handle.post_file_progress(lt::torrent_handle::piece_granularity);
+        m_pendingDetailReplies++;
     }
+    handle.post_peer_info();
+    handle.post_trackers();
+    handle.post_piece_availability();
+    m_pendingDetailReplies += 3;
+}
 
-    else {
-        // if we didn't handle the alert, print it to the log
-        qWarning() << Q_FUNC_INFO << "didn't handle the alert (unkown/uncatched alert).";
+void WorkerThread::onDetailReplied()
+{
+    if (m_pendingDetailReplies <= 0) {
+        return;
+    }
+    if (--m_pendingDetailReplies == 0) {
+        TorrentStatus s;
+        s.unique_id = m_detailId;
+        if (m_isDetailReset) {
+            // The GUI holds the detail of a previous inspection
+            s.detailFields = TorrentHandleInfo::AllFields;
+            s.detail = m_detail;
+            m_isDetailReset = false;
+        } else {
+            s.setDetailChanges(m_lastDetail, m_detail);
+        }
+        m_lastDetail = m_detail;
+        if (!s.isEmpty()) {
+            emit statusUpdated(s);
+        }
     }
 }
 
@@ -1742,6 +1731,14 @@ inline void WorkerThread::onMetadataReceived(const lt::torrent_handle &handle)
  ******************************************************************************/
 inline void WorkerThread::onStateUpdated(const std::vector<lt::torrent_status> &status)
 {
+    QSet<UniqueId> resetInfoIds;
+    {
+        const std::lock_guard<std::mutex> lock(m_resetMutex);
+        resetInfoIds.swap(m_resetInfoIds);
+    }
+    for (const auto &uuid : std::as_const(resetInfoIds)) {
+        m_lastInfo.remove(uuid);
+    }
     for (auto s : status) {
         signalizeStatusUpdated(s);
     }
@@ -1778,8 +1775,7 @@ inline void WorkerThread::signalizeStatusUpdated(const lt::torrent_status &statu
     }
 
     TorrentStatus s;
-    s.unique_id = TorrentUtils::toUniqueId(handle.info_hash());
-    s.detail = TorrentUtils::toTorrentHandleInfo(handle);
+    s.unique_id = TorrentUtils::toUniqueId(status.info_hashes);
 
     TorrentInfo t;
 
@@ -1807,8 +1803,8 @@ inline void WorkerThread::signalizeStatusUpdated(const lt::torrent_status &statu
     t.bytesFailed       = static_cast<qsizetype>(status.total_failed_bytes);
     t.bytesRedundant    = static_cast<qsizetype>(status.total_redundant_bytes);
 
-    t.downloadedPieces  = TorrentUtils::toBitArray(status.pieces);
-    t.verifiedPieces    = TorrentUtils::toBitArray(status.verified_pieces);
+    t.downloadedPieces  = TorrentUtils::toPieceBitmap(status.pieces);
+    t.verifiedPieces    = TorrentUtils::toPieceBitmap(status.verified_pieces);
 
     t.bytesReceived     = static_cast<qsizetype>(status.total_done);
     t.bytesTotal        = static_cast<qsizetype>(status.total);
@@ -1887,8 +1883,19 @@ inline void WorkerThread::signalizeStatusUpdated(const lt::torrent_status &statu
 
     // t.flags = status.flags(); // see torrent flags
 
-    s.info = t;
-    emit statusUpdated(s);
+    auto previous = m_lastInfo.find(s.unique_id);
+    if (previous == m_lastInfo.end()) {
+        // First status, sent entirely
+        s.infoFields = TorrentInfo::AllFields;
+        s.info = t;
+        m_lastInfo.insert(s.unique_id, t);
+    } else {
+        s.setInfoChanges(previous.value(), t);
+        previous.value() = t;
+    }
+    if (!s.isEmpty()) {
+        emit statusUpdated(s);
+    }
 }
 
 /******************************************************************************
@@ -1902,6 +1909,14 @@ UniqueId TorrentUtils::toUniqueId(const lt::sha1_hash &hash)
     return {};
 }
 
+/*!
+ * \brief Returns the id of the torrent, the same as toUniqueId(handle.info_hash()).
+ */
+UniqueId TorrentUtils::toUniqueId(const lt::info_hash_t &hashes)
+{
+    return toUniqueId(hashes.get_best());
+}
+
 lt::sha1_hash TorrentUtils::fromUniqueId(const UniqueId &uuid)
 {
     lt::span<char const> in(uuid.toStdString());
@@ -2045,10 +2060,9 @@ TorrentHandleInfo TorrentUtils::toTorrentHandleInfo(const lt::torrent_handle &ha
                       static_cast<qsizetype>(priorities.size()) });
 
         for (auto index = 0; index < count; ++index) {
-            auto findex = static_cast<lt::file_index_t>(index);
             TorrentFileInfo fi;
             fi.bytesReceived = static_cast<qsizetype>(progress.at(static_cast<std::size_t>(index)));
-            fi.priority = toPriority(handle.file_priority(findex));
+            fi.priority = toPriority(priorities.at(static_cast<std::size_t>(index)));
             t.files.append(fi);
         }
     }
@@ -2059,54 +2073,7 @@ TorrentHandleInfo TorrentUtils::toTorrentHandleInfo(const lt::torrent_handle &ha
     std::vector<lt::peer_info> peers;
     handle.get_peer_info(peers);
     for (auto peer : peers) {
-        TorrentPeerInfo d;
-
-        auto peerIp = toString(peer.ip.address().to_string());
-        auto peerPort = peer.ip.port();
-        d.endpoint = EndPoint(peerIp, peerPort);
-        d.userAgent = toString(peer.client);
-
-        d.availablePieces = toBitArray(peer.pieces);
-
-        d.bytesDownloaded = peer.total_download;
-        d.bytesUploaded = peer.total_upload;
-
-        d.lastTimeRequested = peer.last_request.count();
-        d.lastTimeActive    = peer.last_active.count();
-        d.timeDownloadQueue = peer.download_queue_time.count();
-
-        auto flags = peer.flags;
-        if (flags & lt::peer_info::interesting)         d.setFlag(TorrentPeerInfo::Flag::Interesting);
-        if (flags & lt::peer_info::choked)              d.setFlag(TorrentPeerInfo::Flag::Choked);
-        if (flags & lt::peer_info::remote_interested)   d.setFlag(TorrentPeerInfo::Flag::RemoteInterested);
-        if (flags & lt::peer_info::remote_choked)       d.setFlag(TorrentPeerInfo::Flag::RemoteChoked);
-        if (flags & lt::peer_info::supports_extensions) d.setFlag(TorrentPeerInfo::Flag::SupportsExtensions);
-        if (flags & lt::peer_info::local_connection)    d.setFlag(TorrentPeerInfo::Flag::LocalConnection);
-        if (flags & lt::peer_info::handshake)           d.setFlag(TorrentPeerInfo::Flag::Handshake);
-        if (flags & lt::peer_info::connecting)          d.setFlag(TorrentPeerInfo::Flag::Connecting);
-        // if (flags & lt::peer_info::queued)           d.setFlag(TorrentPeerInfo::Flag::Queued);
-        if (flags & lt::peer_info::on_parole)           d.setFlag(TorrentPeerInfo::Flag::OnParole);
-        if (flags & lt::peer_info::seed)                d.setFlag(TorrentPeerInfo::Flag::Seed);
-        if (flags & lt::peer_info::optimistic_unchoke)  d.setFlag(TorrentPeerInfo::Flag::OptimisticUnchoke);
-        if (flags & lt::peer_info::snubbed)             d.setFlag(TorrentPeerInfo::Flag::Snubbed);
-        if (flags & lt::peer_info::upload_only)         d.setFlag(TorrentPeerInfo::Flag::UploadOnly);
-        if (flags & lt::peer_info::endgame_mode)        d.setFlag(TorrentPeerInfo::Flag::Endgame_Mode);
-        if (flags & lt::peer_info::holepunched)         d.setFlag(TorrentPeerInfo::Flag::Holepunched);
-        if (flags & lt::peer_info::i2p_socket)          d.setFlag(TorrentPeerInfo::Flag::I2pSocket);
-        if (flags & lt::peer_info::utp_socket)          d.setFlag(TorrentPeerInfo::Flag::UtpSocket);
-        if (flags & lt::peer_info::ssl_socket)          d.setFlag(TorrentPeerInfo::Flag::SslSocket);
-        if (flags & lt::peer_info::rc4_encrypted)       d.setFlag(TorrentPeerInfo::Flag::Rc4Encrypted);
-        if (flags & lt::peer_info::plaintext_encrypted) d.setFlag(TorrentPeerInfo::Flag::Plaintextencrypted);
-
-        auto sourceFlags = peer.source;
-        if (sourceFlags & lt::peer_info::tracker)     d.setSourceFlag(TorrentPeerInfo::SourceFlag::FromTracker);
-        if (sourceFlags & lt::peer_info::dht)         d.setSourceFlag(TorrentPeerInfo::SourceFlag::FromDHT);
-        if (sourceFlags & lt::peer_info::pex)         d.setSourceFlag(TorrentPeerInfo::SourceFlag::FromPeerExchange);
-        if (sourceFlags & lt::peer_info::lsd)         d.setSourceFlag(TorrentPeerInfo::SourceFlag::FromLocalServiceDiscovery);
-        if (sourceFlags & lt::peer_info::resume_data) d.setSourceFlag(TorrentPeerInfo::SourceFlag::FromFastResumeData);
-        if (sourceFlags & lt::peer_info::incoming)    d.setSourceFlag(TorrentPeerInfo::SourceFlag::FromPeerIncomingData);
-
-        t.peers.append(d);
+        t.peers.append(toTorrentPeerInfo(peer));
     }
 
     // ***************
@@ -2155,6 +2122,58 @@ TorrentHandleInfo TorrentUtils::toTorrentHandleInfo(const lt::torrent_handle &ha
     return t;
 }
 
+TorrentPeerInfo TorrentUtils::toTorrentPeerInfo(const lt::peer_info &peer)
+{
+    TorrentPeerInfo d;
+
+    auto peerIp = toString(peer.ip.address().to_string());
+    auto peerPort = peer.ip.port();
+    d.endpoint = EndPoint(peerIp, peerPort);
+    d.userAgent = toString(peer.client);
+
+    d.availablePieces = toPieceBitmap(peer.pieces);
+
+    d.bytesDownloaded = peer.total_download;
+    d.bytesUploaded = peer.total_upload;
+
+    d.lastTimeRequested = peer.last_request.count();
+    d.lastTimeActive    = peer.last_active.count();
+    d.timeDownloadQueue = peer.download_queue_time.count();
+
+    auto flags = peer.flags;
+    if (flags & lt::peer_info::interesting)         d.setFlag(TorrentPeerInfo::Flag::Interesting);
+    if (flags & lt::peer_info::choked)              d.setFlag(TorrentPeerInfo::Flag::Choked);
+    if (flags & lt::peer_info::remote_interested)   d.setFlag(TorrentPeerInfo::Flag::RemoteInterested);
+    if (flags & lt::peer_info::remote_choked)       d.setFlag(TorrentPeerInfo::Flag::RemoteChoked);
+    if (flags & lt::peer_info::supports_extensions) d.setFlag(TorrentPeerInfo::Flag::SupportsExtensions);
+    if (flags & lt::peer_info::local_connection)    d.setFlag(TorrentPeerInfo::Flag::LocalConnection);
+    if (flags & lt::peer_info::handshake)           d.setFlag(TorrentPeerInfo::Flag::Handshake);
+    if (flags & lt::peer_info::connecting)          d.setFlag(TorrentPeerInfo::Flag::Connecting);
+    // if (flags & lt::peer_info::queued)           d.setFlag(TorrentPeerInfo::Flag::Queued);
+    if (flags & lt::peer_info::on_parole)           d.setFlag(TorrentPeerInfo::Flag::OnParole);
+    if (flags & lt::peer_info::seed)                d.setFlag(TorrentPeerInfo::Flag::Seed);
+    if (flags & lt::peer_info::optimistic_unchoke)  d.setFlag(TorrentPeerInfo::Flag::OptimisticUnchoke);
+    if (flags & lt::peer_info::snubbed)             d.setFlag(TorrentPeerInfo::Flag::Snubbed);
+    if (flags & lt::peer_info::upload_only)         d.setFlag(TorrentPeerInfo::Flag::UploadOnly);
+    if (flags & lt::peer_info::endgame_mode)        d.setFlag(TorrentPeerInfo::Flag::Endgame_Mode);
+    if (flags & lt::peer_info::holepunched)         d.setFlag(TorrentPeerInfo::Flag::Holepunched);
+    if (flags & lt::peer_info::i2p_socket)          d.setFlag(TorrentPeerInfo::Flag::I2pSocket);
+    if (flags & lt::peer_info::utp_socket)          d.setFlag(TorrentPeerInfo::Flag::UtpSocket);
+    if (flags & lt::peer_info::ssl_socket)          d.setFlag(TorrentPeerInfo::Flag::SslSocket);
+    if (flags & lt::peer_info::rc4_encrypted)       d.setFlag(TorrentPeerInfo::Flag::Rc4Encrypted);
+    if (flags & lt::peer_info::plaintext_encrypted) d.setFlag(TorrentPeerInfo::Flag::Plaintextencrypted);
+
+    auto sourceFlags = peer.source;
+    if (sourceFlags & lt::peer_info::tracker)     d.setSourceFlag(TorrentPeerInfo::SourceFlag::FromTracker);
+    if (sourceFlags & lt::peer_info::dht)         d.setSourceFlag(TorrentPeerInfo::SourceFlag::FromDHT);
+    if (sourceFlags & lt::peer_info::pex)         d.setSourceFlag(TorrentPeerInfo::SourceFlag::FromPeerExchange);
+    if (sourceFlags & lt::peer_info::lsd)         d.setSourceFlag(TorrentPeerInfo::SourceFlag::FromLocalServiceDiscovery);
+    if (sourceFlags & lt::peer_info::resume_data) d.setSourceFlag(TorrentPeerInfo::SourceFlag::FromFastResumeData);
+    if (sourceFlags & lt::peer_info::incoming)    d.setSourceFlag(TorrentPeerInfo::SourceFlag::FromPeerIncomingData);
+
+    return d;
+}
+
 TorrentMetaInfo TorrentUtils::toTorrentMetaInfo(const lt::add_torrent_params &params)
 {
     TorrentMetaInfo m;
@@ -2229,9 +2248,9 @@ TorrentMetaInfo TorrentUtils::toTorrentMetaInfo(const lt::add_torrent_params &pa
         m.bannedPeers.append(p);
     }
 
-    m.unfinishedPieces = toBitArray(params.unfinished_pieces);
-    m.downloadedPieces = toBitArray(params.have_pieces);
-    m.verifiedPieces   = toBitArray(params.verified_pieces);
+    m.unfinishedPieces = toPieceBitmap(params.unfinished_pieces, params.have_pieces.size());
+    m.downloadedPieces = toPieceBitmap(params.have_pieces);
+    m.verifiedPieces   = toPieceBitmap(params.verified_pieces);
 
     m.lastTimeDownload = toDateTime(params.last_download);
     m.lastTimeUpload   = toDateTime(params.last_upload);
@@ -2258,33 +2277,31 @@ QString TorrentUtils::toString(const lt::sha1_hash &hash)
     return {};
 }
 
-QBitArray TorrentUtils::toBitArray(const lt::typed_bitfield<lt::piece_index_t> &vec)
+/*!
+ * \brief Copies the words of the bitfield, that is in the BitTorrent format.
+ */
+PieceBitmap TorrentUtils::toPieceBitmap(const lt::typed_bitfield<lt::piece_index_t> &pieces)
 {
-    auto size = vec.size();
-    QBitArray ba(size, false);
-    for (auto i = 0; i < size; ++i) {
-        if (vec.get_bit(static_cast<lt::piece_index_t>(i))) {
-            ba.setBit(i);
-        }
-    }
-    return ba;
+    return PieceBitmap::fromBitfield(pieces.data(), pieces.size());
 }
 
-QBitArray TorrentUtils::toBitArray(const std::map<lt::piece_index_t, lt::bitfield> &map)
+/*!
+ * \brief Returns the bitmap of the pieces in \a map,
+ * of at least \a size bits (the count of pieces, if known).
+ */
+PieceBitmap TorrentUtils::toPieceBitmap(const std::map<lt::piece_index_t, lt::bitfield> &map, int size)
 {
-    int size = 0;
-    QList<int> indexes;
-    for (auto kv : map) {
-        auto key = kv.first;
-        auto index = static_cast<int>(key);
-        indexes.append(index);
-        size = qMax(size, index);
+    if (!map.empty()) {
+        size = qMax(size, static_cast<int>(map.rbegin()->first) + 1);
     }
-    QBitArray ba(size, false);
-    for (auto index : indexes) {
-        ba.setBit(index);
+    PieceBitmap bitmap(size);
+    for (const auto &kv : map) {
+        auto index = static_cast<int>(kv.first);
+        if (index >= 0) {
+            bitmap.setBit(index);
+        }
     }
-    return ba;
+    return bitmap;
 }
 
 QDateTime TorrentUtils::toDateTime(const std::time_t &time)
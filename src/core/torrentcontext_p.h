@@ -24,16 +24,23 @@
 #include <QtCore/QObject>
 #include <QtCore/QThread>
 #include <QtCore/QMap>
+#include <QtCore/QSet>
 
+#include <atomic>             // std::atomic
+#include <chrono>             // std::chrono::milliseconds
+#include <condition_variable> // std::condition_variable
+#include <mutex>              // std::mutex
 #include <vector> // std::vector
 #include <ctime>  // std::time_t, definition required by MSVC 2017
 
 #include "libtorrent/fwd.hpp"
+#include "libtorrent/alert.hpp"         // lt::alert_category_t
 #include "libtorrent/bitfield.hpp"      // lt::typed_bitfield
 #include "libtorrent/error_code.hpp"    // lt::error_code
 #include "libtorrent/session_types.hpp" // lt::remove_flags_t
 #include "libtorrent/string_view.hpp"   // lt:string_view
 #include "libtorrent/sha1_hash.hpp"     // lt::sha1_hash
+#include "libtorrent/torrent_handle.hpp" // lt::torrent_handle
 
 class NetworkManager;
 class Settings;
@@ -97,6 +104,8 @@ public:
 
     void renameFile(Torrent *torrent, int index, const QString &newName);
 
+    void setInspectedTorrent(Torrent *torrent);
+
 public slots:
     void onSettingsChanged();
 
@@ -120,6 +129,8 @@ private slots:
 
 private:
     QHash<QNetworkReply *, Torrent *> m_currentDownloads = {};
+    Torrent *m_inspectedTorrent = nullptr;
+    void setLocalState(Torrent *torrent, TorrentInfo::TorrentState state, bool mustRefreshMetaInfo);
     void downloadMagnetLink(Torrent *torrent);
     void downloadTorrentFile(Torrent *torrent);
     void abortNetworkReply(Torrent *torrent);
@@ -155,11 +166,19 @@ public:
     bool isEnabled() const;
     void setEnabled(bool enabled);
 
+    void setRefreshInterval(std::chrono::milliseconds status);
+
+    lt::alert_category_t alertMask() const;
+    void setAlertDebugEnabled(bool enabled);
+
     lt::torrent_handle addTorrent(lt::add_torrent_params const& params, lt::error_code& ec);
     void removeTorrent(const lt::torrent_handle& h, lt::remove_flags_t options = {});
 
     lt::torrent_handle findTorrent(const UniqueId &uuid) const;
 
+    void setInspectedTorrent(const UniqueId &uuid);
+    void resetInfo(const UniqueId &uuid);
+
     TorrentInitialMetaInfo dump(const QString &filename) const;
 
 signals:
@@ -173,11 +192,57 @@ signals:
     void stopped();
 
 private:
-    bool shouldQuit = false;
+    std::atomic<bool> shouldQuit = false;
     lt::session *m_session_ptr = nullptr;
 
+    /* Cadence of the status polls, in milliseconds */
+    std::atomic<int> m_statusRefresh;
+
+    /* Torrents in the session, counted from the alerts by the loop */
+    int m_torrentCount = 0;
+
+    /* Wakes the loop up when libtorrent has alerts, or when stopping */
+    std::mutex m_alertMutex;
+    std::condition_variable m_alertCondition;
+    bool m_hasAlerts = false;
+    void wakeUp();
+
+    /* The details (files, peers, trackers...) are requested for this torrent only */
+    std::mutex m_inspectedMutex;
+    UniqueId m_inspectedId = {};
+    UniqueId m_detailId = {};
+    lt::torrent_handle m_detailHandle = {};
+    TorrentHandleInfo m_detail = {};
+    TorrentHandleInfo m_lastDetail = {};
+    bool m_isDetailReset = true;
+    int m_pendingDetailReplies = 0;
+    void requestDetail();
+    void onDetailReplied();
+
+    /* Last emitted info, to emit only the changes */
+    QHash<UniqueId, TorrentInfo> m_lastInfo = {};
+    std::mutex m_resetMutex;
+    QSet<UniqueId> m_resetInfoIds = {};
+
+    /* Debug mode: all the alerts are requested, and logged */
+    std::atomic<bool> m_debugAlerts = false;
+
+    using AlertHandler = void (WorkerThread::*)(lt::alert *a);
+    static const AlertHandler* alertHandlers();
+
     void signalizeAlert(lt::alert* alert);
 
+    void onAddTorrentAlert(lt::alert *a);
+    void onTorrentRemovedAlert(lt::alert *a);
+    void onStateUpdateAlert(lt::alert *a);
+    void onMetadataReceivedAlert(lt::alert *a);
+    void onErrorAlert(lt::alert *a);
+    void onAlertsDroppedAlert(lt::alert *a);
+    void onFileProgressAlert(lt::alert *a);
+    void onPeerInfoAlert(lt::alert *a);
+    void onTrackerListAlert(lt::alert *a);
+    void onPieceAvailabilityAlert(lt::alert *a);
+
     inline void onTorrentAdded(const lt::torrent_handle &handle, const lt::add_torrent_params &params, const lt::error_code &error);
     inline void onMetadataReceived(const lt::torrent_handle &handle);
     inline void onStateUpdated(const std::vector<lt::torrent_status> &status);
@@ -198,19 +263,21 @@ class TorrentUtils
 public:
     /// \todo move to torrentutils.h
     static UniqueId toUniqueId(const lt::sha1_hash &hash);
+    static UniqueId toUniqueId(const lt::info_hash_t &hashes);
     static lt::sha1_hash fromUniqueId(const UniqueId &uuid);
 
     static TorrentInitialMetaInfo toTorrentInitialMetaInfo(std::shared_ptr<lt::torrent_info const> ti);
     static TorrentMetaInfo toTorrentMetaInfo(const lt::add_torrent_params &params);
     static TorrentHandleInfo toTorrentHandleInfo(const lt::torrent_handle &handle);
+    static TorrentPeerInfo toTorrentPeerInfo(const lt::peer_info &peer);
 
     static QString toString(const std::string &str);
     static QString toString(const lt::string_view &s);
     static QString toString(const lt::sha1_hash &hash);
     static QDateTime toDateTime(const std::time_t &time);
 
-    static QBitArray toBitArray(const lt::typed_bitfield<lt::piece_index_t> &pieces);
-    static QBitArray toBitArray(const std::map<lt::piece_index_t, lt::bitfield> &map);
+    static PieceBitmap toPieceBitmap(const lt::typed_bitfield<lt::piece_index_t> &pieces);
+    static PieceBitmap toPieceBitmap(const std::map<lt::piece_index_t, lt::bitfield> &map, int size = 0);
 
     static EndPoint toEndPoint(const lt::tcp::endpoint &endpoint);
     static lt::tcp::endpoint fromEndPoint(const EndPoint &endpoint);
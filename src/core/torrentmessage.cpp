@@ -16,6 +16,8 @@
 
 #include "torrentmessage.h"
 
+#include <tuple> // std::tie
+
 template<typename Enum>
 static inline void _q_set_flag(QFlags<Enum> *f, Enum flag, bool on = true)
 {
@@ -328,6 +330,60 @@ QString TorrentTrackerInfo::sourceString() const
     Q_UNREACHABLE();
 }
 
+/******************************************************************************
+ ******************************************************************************/
+TorrentHandleInfo::Fields TorrentHandleInfo::changedFields(const TorrentHandleInfo &other) const
+{
+    Fields fields = NoField;
+    if (std::tie(uploadBandwidthLimit, downloadBandwidthLimit, maxUploads, maxConnections)
+            != std::tie(other.uploadBandwidthLimit, other.downloadBandwidthLimit, other.maxUploads, other.maxConnections)) {
+        fields |= LimitsField;
+    }
+    if (files != other.files) {
+        fields |= FilesField;
+    }
+    if (peers != other.peers) {
+        fields |= PeersField;
+    }
+    if (trackers != other.trackers) {
+        fields |= TrackersField;
+    }
+    if (httpSeeds != other.httpSeeds || urlSeeds != other.urlSeeds) {
+        fields |= SeedsField;
+    }
+    if (pieceAvailability != other.pieceAvailability || piecePriority != other.piecePriority) {
+        fields |= PiecesField;
+    }
+    return fields;
+}
+
+void TorrentHandleInfo::copyFields(const TorrentHandleInfo &other, Fields fields)
+{
+    if (fields.testFlag(LimitsField)) {
+        uploadBandwidthLimit    = other.uploadBandwidthLimit;
+        downloadBandwidthLimit  = other.downloadBandwidthLimit;
+        maxUploads              = other.maxUploads;
+        maxConnections          = other.maxConnections;
+    }
+    if (fields.testFlag(FilesField)) {
+        files = other.files;
+    }
+    if (fields.testFlag(PeersField)) {
+        peers = other.peers;
+    }
+    if (fields.testFlag(TrackersField)) {
+        trackers = other.trackers;
+    }
+    if (fields.testFlag(SeedsField)) {
+        httpSeeds = other.httpSeeds;
+        urlSeeds = other.urlSeeds;
+    }
+    if (fields.testFlag(PiecesField)) {
+        pieceAvailability = other.pieceAvailability;
+        piecePriority = other.piecePriority;
+    }
+}
+
 /******************************************************************************
  ******************************************************************************/
 QString TorrentInfo::torrentStateString() const
@@ -359,6 +415,149 @@ const char* TorrentInfo::torrentState_c_str() const
     Q_UNREACHABLE();
 }
 
+/*!
+ * \brief Returns the groups of fields that differ from \a other.
+ */
+TorrentInfo::Fields TorrentInfo::changedFields(const TorrentInfo &other) const
+{
+    Fields fields = NoField;
+    if (std::tie(error, state, lastWorkingTrackerUrl, infohash,
+                 isSeeding, isFinished, hasMetadata, hasIncoming, isMovingStorage,
+                 isAnnouncingToTrackers, isAnnouncingToLSD, isAnnouncingToDHT)
+            != std::tie(other.error, other.state, other.lastWorkingTrackerUrl, other.infohash,
+                        other.isSeeding, other.isFinished, other.hasMetadata, other.hasIncoming, other.isMovingStorage,
+                        other.isAnnouncingToTrackers, other.isAnnouncingToLSD, other.isAnnouncingToDHT)) {
+        fields |= StateField;
+    }
+    if (std::tie(bytesSessionDownloaded, bytesSessionUploaded,
+                 bytesSessionPayloadDownload, bytesSessionPayloadUpload,
+                 bytesFailed, bytesRedundant,
+                 bytesReceived, bytesTotal, bytesWantedReceived, bytesWantedTotal,
+                 bytesAllSessionsPayloadDownload, bytesAllSessionsPayloadUpload,
+                 percent, downloadSpeed, uploadSpeed,
+                 download_payload_rate, upload_payload_rate, downloadedPiecesCount)
+            != std::tie(other.bytesSessionDownloaded, other.bytesSessionUploaded,
+                        other.bytesSessionPayloadDownload, other.bytesSessionPayloadUpload,
+                        other.bytesFailed, other.bytesRedundant,
+                        other.bytesReceived, other.bytesTotal, other.bytesWantedReceived, other.bytesWantedTotal,
+                        other.bytesAllSessionsPayloadDownload, other.bytesAllSessionsPayloadUpload,
+                        other.percent, other.downloadSpeed, other.uploadSpeed,
+                        other.download_payload_rate, other.upload_payload_rate, other.downloadedPiecesCount)) {
+        fields |= StatsField;
+    }
+    if (std::tie(connectedSeedsCount, connectedPeersCount,
+                 completePeersCount, incompletePeersCount,
+                 seedsCount, peersCount, candidatePeersCount,
+                 distributedFullCopiesCount, distributedFraction, distributedCopiesFraction,
+                 peersUnchokedCount, peersConnectionCount,
+                 upBandwidthQuotaQueue, downBandwidthQuotaQueue, seedRank)
+            != std::tie(other.connectedSeedsCount, other.connectedPeersCount,
+                        other.completePeersCount, other.incompletePeersCount,
+                        other.seedsCount, other.peersCount, other.candidatePeersCount,
+                        other.distributedFullCopiesCount, other.distributedFraction, other.distributedCopiesFraction,
+                        other.peersUnchokedCount, other.peersConnectionCount,
+                        other.upBandwidthQuotaQueue, other.downBandwidthQuotaQueue, other.seedRank)) {
+        fields |= SwarmField;
+    }
+    if (std::tie(uploadSlotsLimit, connectionsNumberLimit, blockSizeInByte)
+            != std::tie(other.uploadSlotsLimit, other.connectionsNumberLimit, other.blockSizeInByte)) {
+        fields |= LimitsField;
+    }
+    if (std::tie(addedTime, completedTime, lastSeenCompletedTime,
+                 elapsedTime, remaingTime,
+                 activeTimeDuration, finishedTimeDuration, seedingTimeDuration,
+                 lastTimeDownload, lastTimeUpload)
+            != std::tie(other.addedTime, other.completedTime, other.lastSeenCompletedTime,
+                        other.elapsedTime, other.remaingTime,
+                        other.activeTimeDuration, other.finishedTimeDuration, other.seedingTimeDuration,
+                        other.lastTimeDownload, other.lastTimeUpload)) {
+        fields |= TimesField;
+    }
+    if (downloadedPieces != other.downloadedPieces || verifiedPieces != other.verifiedPieces) {
+        fields |= PiecesField;
+    }
+    return fields;
+}
+
+/*!
+ * \brief Copies the given groups of fields from \a other.
+ */
+void TorrentInfo::copyFields(const TorrentInfo &other, Fields fields)
+{
+    if (fields.testFlag(StateField)) {
+        error                   = other.error;
+        state                   = other.state;
+        lastWorkingTrackerUrl   = other.lastWorkingTrackerUrl;
+        infohash                = other.infohash;
+        isSeeding               = other.isSeeding;
+        isFinished              = other.isFinished;
+        hasMetadata             = other.hasMetadata;
+        hasIncoming             = other.hasIncoming;
+        isMovingStorage         = other.isMovingStorage;
+        isAnnouncingToTrackers  = other.isAnnouncingToTrackers;
+        isAnnouncingToLSD       = other.isAnnouncingToLSD;
+        isAnnouncingToDHT       = other.isAnnouncingToDHT;
+    }
+    if (fields.testFlag(StatsField)) {
+        bytesSessionDownloaded          = other.bytesSessionDownloaded;
+        bytesSessionUploaded            = other.bytesSessionUploaded;
+        bytesSessionPayloadDownload     = other.bytesSessionPayloadDownload;
+        bytesSessionPayloadUpload       = other.bytesSessionPayloadUpload;
+        bytesFailed                     = other.bytesFailed;
+        bytesRedundant                  = other.bytesRedundant;
+        bytesReceived                   = other.bytesReceived;
+        bytesTotal                      = other.bytesTotal;
+        bytesWantedReceived             = other.bytesWantedReceived;
+        bytesWantedTotal                = other.bytesWantedTotal;
+        bytesAllSessionsPayloadDownload = other.bytesAllSessionsPayloadDownload;
+        bytesAllSessionsPayloadUpload   = other.bytesAllSessionsPayloadUpload;
+        percent                         = other.percent;
+        downloadSpeed                   = other.downloadSpeed;
+        uploadSpeed                     = other.uploadSpeed;
+        download_payload_rate           = other.download_payload_rate;
+        upload_payload_rate             = other.upload_payload_rate;
+        downloadedPiecesCount           = other.downloadedPiecesCount;
+    }
+    if (fields.testFlag(SwarmField)) {
+        connectedSeedsCount         = other.connectedSeedsCount;
+        connectedPeersCount         = other.connectedPeersCount;
+        completePeersCount          = other.completePeersCount;
+        incompletePeersCount        = other.incompletePeersCount;
+        seedsCount                  = other.seedsCount;
+        peersCount                  = other.peersCount;
+        candidatePeersCount         = other.candidatePeersCount;
+        distributedFullCopiesCount  = other.distributedFullCopiesCount;
+        distributedFraction         = other.distributedFraction;
+        distributedCopiesFraction   = other.distributedCopiesFraction;
+        peersUnchokedCount          = other.peersUnchokedCount;
+        peersConnectionCount        = other.peersConnectionCount;
+        upBandwidthQuotaQueue       = other.upBandwidthQuotaQueue;
+        downBandwidthQuotaQueue     = other.downBandwidthQuotaQueue;
+        seedRank                    = other.seedRank;
+    }
+    if (fields.testFlag(LimitsField)) {
+        uploadSlotsLimit        = other.uploadSlotsLimit;
+        connectionsNumberLimit  = other.connectionsNumberLimit;
+        blockSizeInByte         = other.blockSizeInByte;
+    }
+    if (fields.testFlag(TimesField)) {
+        addedTime               = other.addedTime;
+        completedTime           = other.completedTime;
+        lastSeenCompletedTime   = other.lastSeenCompletedTime;
+        elapsedTime             = other.elapsedTime;
+        remaingTime             = other.remaingTime;
+        activeTimeDuration      = other.activeTimeDuration;
+        finishedTimeDuration    = other.finishedTimeDuration;
+        seedingTimeDuration     = other.seedingTimeDuration;
+        lastTimeDownload        = other.lastTimeDownload;
+        lastTimeUpload          = other.lastTimeUpload;
+    }
+    if (fields.testFlag(PiecesField)) {
+        downloadedPieces        = other.downloadedPieces;
+        verifiedPieces          = other.verifiedPieces;
+    }
+}
+
 /******************************************************************************
  ******************************************************************************/
 TorrentNodeInfo::TorrentNodeInfo(const QString &_host, int _port)
@@ -366,3 +565,86 @@ TorrentNodeInfo::TorrentNodeInfo(const QString &_host, int _port)
     , port(_port)
 {
 }
+
+/******************************************************************************
+ ******************************************************************************/
+/*!
+ * \brief Computes the indexes of the pieces set in \a current but not
+ * in \a previous. Returns false when the bitfield must be sent entirely:
+ * its size changed, some pieces were lost (e.g. after a recheck),
+ * or the indexes would be larger than the bitfield.
+ */
+static bool addedPieceIndexes(const PieceBitmap &previous, const PieceBitmap &current, QList<int> &indexes)
+{
+    if (previous.size() != current.size()) {
+        return false;
+    }
+    if ((previous & ~current).count(true) > 0) {
+        return false;
+    }
+    const auto added = current & ~previous;
+    if (added.count(true) * 32 > current.size()) {
+        return false;
+    }
+    indexes = added.indexes();
+    return true;
+}
+
+bool TorrentStatus::isEmpty() const
+{
+    return infoFields == TorrentInfo::NoField
+            && detailFields == TorrentHandleInfo::NoField
+            && downloadedPieceIndexes.isEmpty()
+            && verifiedPieceIndexes.isEmpty();
+}
+
+/*!
+ * \brief Encodes the changes from \a previous to \a current.
+ */
+void TorrentStatus::setInfoChanges(const TorrentInfo &previous, const TorrentInfo &current)
+{
+    infoFields = current.changedFields(previous);
+    info = {};
+    downloadedPieceIndexes.clear();
+    verifiedPieceIndexes.clear();
+    if (infoFields.testFlag(TorrentInfo::PiecesField)) {
+        if (addedPieceIndexes(previous.downloadedPieces, current.downloadedPieces, downloadedPieceIndexes)
+                && addedPieceIndexes(previous.verifiedPieces, current.verifiedPieces, verifiedPieceIndexes)) {
+            infoFields &= ~TorrentInfo::Fields(TorrentInfo::PiecesField);
+        } else {
+            downloadedPieceIndexes.clear();
+            verifiedPieceIndexes.clear();
+        }
+    }
+    info.copyFields(current, infoFields);
+}
+
+void TorrentStatus::applyInfoChanges(TorrentInfo &info) const
+{
+    info.copyFields(this->info, infoFields);
+    for (auto index : downloadedPieceIndexes) {
+        if (index >= 0 && index < info.downloadedPieces.size()) {
+            info.downloadedPieces.setBit(index);
+        }
+    }
+    for (auto index : verifiedPieceIndexes) {
+        if (index >= 0 && index < info.verifiedPieces.size()) {
+            info.verifiedPieces.setBit(index);
+        }
+    }
+}
+
+/*!
+ * \brief Encodes the changes from \a previous to \a current.
+ */
+void TorrentStatus::setDetailChanges(const TorrentHandleInfo &previous, const TorrentHandleInfo &current)
+{
+    detailFields = current.changedFields(previous);
+    detail = {};
+    detail.copyFields(current, detailFields);
+}
+
+void TorrentStatus::applyDetailChanges(TorrentHandleInfo &detail) const
+{
+    detail.copyFields(this->detail, detailFields);
+}
@@ -18,8 +18,8 @@
 #define CORE_TORRENT_MESSAGE_H
 
 #include <Core/IDownloadItem>
+#include <Core/PieceBitmap>
 
-#include <QtCore/QBitArray>
 #include <QtCore/QDateTime>
 #include <QtCore/QFlag>
 #include <QtCore/QFlags>
@@ -228,7 +228,7 @@ public:
     EndPoint endpoint;
     QString userAgent;
 
-    QBitArray availablePieces; // 1: peer has that piece, 0: peer miss that piece
+    PieceBitmap availablePieces; // 1: peer has that piece, 0: peer miss that piece
 
     qint64 bytesDownloaded = 0;
     qint64 bytesUploaded = 0;
@@ -284,8 +284,24 @@ public:
 class TorrentHandleInfo // Torrent
 {
 public:
+    /* Groups of fields, to send only the changed ones */
+    enum Field {
+        NoField       = 0x00,
+        LimitsField   = 0x01, // bandwidth, uploads and connections limits
+        FilesField    = 0x02,
+        PeersField    = 0x04,
+        TrackersField = 0x08,
+        SeedsField    = 0x10,
+        PiecesField   = 0x20, // piece availability and priorities
+        AllFields     = 0x3F
+    };
+    Q_DECLARE_FLAGS(Fields, Field)
+
     auto operator<=>(const TorrentHandleInfo&) const = default;
 
+    Fields changedFields(const TorrentHandleInfo &other) const;
+    void copyFields(const TorrentHandleInfo &other, Fields fields);
+
     int uploadBandwidthLimit = -1; // bytes per second
     int downloadBandwidthLimit = -1;
 
@@ -303,6 +319,8 @@ public:
     QVector<TorrentFileInfo::Priority> piecePriority;
 };
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(TorrentHandleInfo::Fields)
+
 /******************************************************************************
  ******************************************************************************/
 class TorrentInfo // TorrentStatusInfo
@@ -318,8 +336,24 @@ public:
         checking_resume_data
     };
 
+    /* Groups of fields, to send only the changed ones */
+    enum Field {
+        NoField     = 0x00,
+        StateField  = 0x01, // state, flags, error, tracker and infohash
+        StatsField  = 0x02, // byte counters, progress and speeds
+        SwarmField  = 0x04, // peer counts, distributed copies and queues
+        LimitsField = 0x08, // slots and connections limits, block size
+        TimesField  = 0x10, // dates and durations
+        PiecesField = 0x20, // downloaded and verified pieces, entirely
+        AllFields   = 0x3F
+    };
+    Q_DECLARE_FLAGS(Fields, Field)
+
     auto operator<=>(const TorrentInfo&) const = default;
 
+    Fields changedFields(const TorrentInfo &other) const;
+    void copyFields(const TorrentInfo &other, Fields fields);
+
     QString torrentStateString() const;
     const char* torrentState_c_str() const;
 
@@ -338,8 +372,8 @@ public:
     qsizetype bytesFailed = 0;
     qsizetype bytesRedundant = 0;
 
-    QBitArray downloadedPieces = {};
-    QBitArray verifiedPieces = {}; // seed mode only
+    PieceBitmap downloadedPieces = {};
+    PieceBitmap verifiedPieces = {}; // seed mode only
 
     qsizetype bytesReceived = 0;
     qsizetype bytesTotal = 0;
@@ -415,6 +449,8 @@ public:
     QDateTime lastTimeUpload = {};
 };
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(TorrentInfo::Fields)
+
 
 /******************************************************************************
  ******************************************************************************/
@@ -540,9 +576,9 @@ public:
     QList<TorrentPeerInfo> defaultPeers = {};
     QList<TorrentPeerInfo> bannedPeers = {};
 
-    QBitArray unfinishedPieces = {};
-    QBitArray downloadedPieces = {};
-    QBitArray verifiedPieces = {}; // seed mode only
+    PieceBitmap unfinishedPieces = {};
+    PieceBitmap downloadedPieces = {};
+    PieceBitmap verifiedPieces = {}; // seed mode only
 
     QDateTime lastTimeDownload = {};
     QDateTime lastTimeUpload = {};
@@ -567,8 +603,28 @@ struct TorrentStatus
     auto operator<=>(const TorrentStatus&) const = default;
 
     UniqueId unique_id = {};
+
+    /*
+     * Only the changes since the previous status are sent:
+     * 'info' and 'detail' hold meaningful values for the given fields only.
+     * The newly downloaded or verified pieces are sent as indexes,
+     * unless the bitfields are sent entirely (TorrentInfo::PiecesField).
+     */
+    TorrentInfo::Fields infoFields = {};
     TorrentInfo info = {};
+    QList<int> downloadedPieceIndexes = {};
+    QList<int> verifiedPieceIndexes = {};
+
+    TorrentHandleInfo::Fields detailFields = {};
     TorrentHandleInfo detail = {};
+
+    bool isEmpty() const;
+
+    void setInfoChanges(const TorrentInfo &previous, const TorrentInfo &current);
+    void applyInfoChanges(TorrentInfo &info) const;
+
+    void setDetailChanges(const TorrentHandleInfo &previous, const TorrentHandleInfo &current);
+    void applyDetailChanges(TorrentHandleInfo &detail) const;
 };
 
 /* Enable the type to be used with QVariant. */
@@ -0,0 +1,220 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "daemon.h"
+
+#include <Core/AbstractDownloadItem>
+#include <Core/DownloadManager>
+#include <Core/Settings>
+#include <Core/StreamManager>
+#include <Core/TorrentContext>
+#include <Ipc/ControlServer>
+
+#include <QtCore/QDebug>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSignalBlocker>
+
+
+Daemon::Daemon(QObject *parent) : QObject(parent)
+  , m_downloadManager(new DownloadManager(this))
+  , m_streamManager(new StreamManager(this))
+  , m_settings(new Settings(this))
+  , m_controlServer(new ControlServer(m_downloadManager, this))
+{
+    m_downloadManager->setSettings(m_settings);
+
+    m_streamManager->setSettings(m_settings);
+
+    TorrentContext& torrentContext = TorrentContext::getInstance();
+    torrentContext.setSettings(m_settings);
+    torrentContext.setNetworkManager(m_downloadManager->networkManager());
+
+    connect(m_downloadManager, SIGNAL(queueLoaded()), this, SLOT(onQueueLoaded()));
+    connect(m_downloadManager, SIGNAL(jobFinished(IDownloadItem*)), this, SLOT(onJobFinished(IDownloadItem*)));
+}
+
+/******************************************************************************
+ ******************************************************************************/
+DownloadManager* Daemon::downloadManager() const
+{
+    return m_downloadManager;
+}
+
+Settings* Daemon::settings() const
+{
+    return m_settings;
+}
+
+/******************************************************************************
+ ******************************************************************************/
+/*!
+ * \brief Reads the settings, then loads the queue.
+ *
+ * If queueFile is given, it replaces the queue of the settings,
+ * for this session only: the settings are never written by the daemon.
+ */
+void Daemon::start(const QString &queueFile)
+{
+    {
+        /* Load the queue once, with the final settings */
+        const QSignalBlocker blocker(m_settings);
+        m_settings->readSettings();
+        if (!queueFile.isEmpty()) {
+            m_settings->setDatabase(QFileInfo(queueFile).absoluteFilePath());
+        }
+    }
+    qInfo("Queue: %s", qPrintable(m_settings->database()));
+    if (m_settings->database().isEmpty()) {
+        onQueueLoaded();
+    }
+    emit m_settings->changed();
+}
+
+/*!
+ * \brief Listens to the local control API, once the queue is loaded.
+ * \sa ControlServer
+ */
+void Daemon::listen(const QString &controlServerName)
+{
+    m_controlServerName = controlServerName;
+    if (!m_loaded || m_controlServerName.isEmpty()) {
+        return;
+    }
+    if (m_controlServer->listen(m_controlServerName)) {
+        qInfo("Control API: %s", qPrintable(m_controlServer->fullServerName()));
+    } else {
+        qWarning("Can't listen to the control API '%s': %s",
+                 qPrintable(m_controlServerName),
+                 qPrintable(m_controlServer->errorString()));
+    }
+}
+
+void Daemon::onQueueLoaded()
+{
+    if (m_loaded) {
+        return;
+    }
+    m_loaded = true;
+    qInfo("%lld download(s) in the queue", static_cast<qint64>(m_downloadManager->count()));
+    listen(m_controlServerName);
+    const auto messages = m_pendingMessages;
+    m_pendingMessages.clear();
+    for (const auto &message : messages) {
+        handleMessage(message);
+    }
+}
+
+/******************************************************************************
+ ******************************************************************************/
+/*!
+ * \brief Executes the command of the message.
+ * The commands received while the queue is loading are delayed.
+ */
+void Daemon::handleMessage(const QString &message)
+{
+    if (!m_loaded) {
+        m_pendingMessages << message;
+        return;
+    }
+    auto arguments = message.split(QChar::Space, Qt::SkipEmptyParts);
+    if (arguments.isEmpty()) {
+        return;
+    }
+    auto command = arguments.takeFirst();
+
+    if (command == C_DAEMON_ADD || command == C_DAEMON_ADD_PAUSED) {
+        QList<QUrl> urls;
+        for (const auto &argument : std::as_const(arguments)) {
+            urls << QUrl::fromUserInput(argument);
+        }
+        add(urls, command == C_DAEMON_ADD);
+
+    } else if (command == C_DAEMON_RESUME_ALL) {
+        resumeAll();
+
+    } else if (command == C_DAEMON_PAUSE_ALL) {
+        pauseAll();
+
+    } else if (command == C_DAEMON_QUIT) {
+        emit quitRequested();
+
+    } else {
+        qWarning("Unknown command: %s", qPrintable(command));
+    }
+}
+
+/******************************************************************************
+ ******************************************************************************/
+void Daemon::add(const QList<QUrl> &urls, bool started)
+{
+    QList<IDownloadItem*> items;
+    for (const auto &url : urls) {
+        if (!url.isValid()) {
+            qWarning("Invalid URL: %s", qPrintable(url.toString()));
+            continue;
+        }
+        auto item = DownloadEngine::isTorrentUrl(url)
+                ? m_downloadManager->createTorrentItem(url)
+                : m_downloadManager->createItem(url);
+        items << item;
+    }
+    if (!items.isEmpty()) {
+        m_downloadManager->append(items, started);
+        qInfo("Added %lld download(s)", static_cast<qint64>(items.count()));
+    }
+}
+
+void Daemon::resumeAll()
+{
+    /* The stopped jobs are materialized in one pass, not one by one */
+    auto items = m_downloadManager->downloadItems();
+    items.removeIf([](IDownloadItem *item) { return !item->isResumable(); });
+    for (auto item : m_downloadManager->materialize(items)) {
+        m_downloadManager->resume(item);
+    }
+}
+
+void Daemon::pauseAll()
+{
+    for (auto item : m_downloadManager->downloadItems()) {
+        m_downloadManager->pause(item);
+    }
+}
+
+/******************************************************************************
+ ******************************************************************************/
+void Daemon::onJobFinished(IDownloadItem *item)
+{
+    auto downloadItem = dynamic_cast<AbstractDownloadItem*>(item);
+    if (!downloadItem) {
+        return;
+    }
+    switch (downloadItem->state()) {
+    case IDownloadItem::Completed:
+    case IDownloadItem::Seeding:
+        qInfo("Completed: %s", qPrintable(downloadItem->localFullFileName()));
+        break;
+    case IDownloadItem::NetworkError:
+    case IDownloadItem::FileError:
+        qWarning("Failed: %s (%s)",
+                 qPrintable(downloadItem->sourceUrl().toString()),
+                 qPrintable(downloadItem->errorMessage()));
+        break;
+    default:
+        break;
+    }
+}
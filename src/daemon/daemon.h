@@ -0,0 +1,97 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef DAEMON_DAEMON_H
+#define DAEMON_DAEMON_H
+
+#include <QtCore/QList>
+#include <QtCore/QObject>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QUrl>
+
+class ControlServer;
+class DownloadManager;
+class IDownloadItem;
+class Settings;
+class StreamManager;
+
+/*!
+ * \brief Commands sent to the running daemon by the command line.
+ *
+ * The message is the command, followed by its arguments,
+ * separated by char space (U+0020 or ' ').
+ *
+ * \code
+ * "[ADD] https://www.example.org/file1.zip https://www.example.org/file2.zip"
+ * \endcode
+ */
+static const QLatin1StringView C_DAEMON_ADD           ("[ADD]");
+static const QLatin1StringView C_DAEMON_ADD_PAUSED    ("[ADD_PAUSED]");
+static const QLatin1StringView C_DAEMON_RESUME_ALL    ("[RESUME_ALL]");
+static const QLatin1StringView C_DAEMON_PAUSE_ALL     ("[PAUSE_ALL]");
+static const QLatin1StringView C_DAEMON_QUIT          ("[QUIT]");
+
+/*!
+ * \class Daemon
+ * \brief Runs the download engine without GUI.
+ *
+ * The daemon loads the same settings and queue as the application,
+ * but doesn't instantiate any widget, icon or web engine.
+ */
+class Daemon : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Daemon(QObject *parent = nullptr);
+    ~Daemon() override = default;
+
+    DownloadManager* downloadManager() const;
+    Settings* settings() const;
+
+    void start(const QString &queueFile = {});
+    void listen(const QString &controlServerName);
+
+public slots:
+    void handleMessage(const QString &message);
+
+    void add(const QList<QUrl> &urls, bool started = true);
+    void resumeAll();
+    void pauseAll();
+
+signals:
+    void quitRequested();
+
+private slots:
+    void onQueueLoaded();
+    void onJobFinished(IDownloadItem *item);
+
+private:
+    /* Rem: the manager is deleted first, it saves the queue with the settings */
+    DownloadManager *m_downloadManager = nullptr;
+    StreamManager *m_streamManager = nullptr;
+    Settings *m_settings = nullptr;
+    ControlServer *m_controlServer = nullptr;
+    QString m_controlServerName = {};
+
+    /* The commands received while the queue is loading */
+    bool m_loaded = false;
+    QStringList m_pendingMessages = {};
+};
+
+#endif // DAEMON_DAEMON_H
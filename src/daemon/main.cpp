@@ -0,0 +1,217 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "daemon.h"
+
+#include "../version.h"
+#include <Constants>
+#include <QtSingleCoreApplication>
+#include <Ipc/ControlServer>
+
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QDebug>
+
+#ifdef Q_OS_UNIX
+#  include <QtCore/QSocketNotifier>
+#  include <csignal>
+#  include <sys/socket.h>
+#  include <unistd.h>
+#endif
+
+#include <boost/stacktrace.hpp>
+
+
+#ifndef QT_DEBUG
+void releaseVerboseMessageHandler(QtMsgType type, const QMessageLogContext &, const QString &msg)
+{
+    switch (type) {
+    case QtDebugMsg: fprintf(stderr, "Debug: %s\n", qPrintable(msg)); break;
+    case QtInfoMsg: fprintf(stderr, "Info: %s\n", qPrintable(msg)); break;
+    case QtWarningMsg: fprintf(stderr, "Warning: %s\n", qPrintable(msg)); break;
+    case QtCriticalMsg: fprintf(stderr, "Critical: %s\n", qPrintable(msg)); break;
+    case QtFatalMsg: fprintf(stderr, "Fatal: %s\n", qPrintable(msg)); break;
+    }
+}
+void releaseDefaultMessageHandler(QtMsgType type, const QMessageLogContext &, const QString &msg)
+{
+    switch (type) {
+    case QtDebugMsg:
+        // In release mode, ignore debug messages but show fatal and warning.
+        break;
+    case QtInfoMsg: fprintf(stderr, "Info: %s\n", qPrintable(msg)); break;
+    case QtWarningMsg: fprintf(stderr, "Warning: %s\n", qPrintable(msg)); break;
+    case QtCriticalMsg: fprintf(stderr, "Critical: %s\n", qPrintable(msg)); break;
+    case QtFatalMsg: fprintf(stderr, "Fatal: %s\n", qPrintable(msg)); break;
+    }
+}
+#endif
+
+#ifdef Q_OS_UNIX
+/*
+ * Rem: Only async-signal-safe functions can be called in a signal handler,
+ * so the handler just writes to a socket pair, and the event loop quits.
+ */
+static int s_signalFd[2] = { -1, -1 };
+
+static void quitSignalHandler(int)
+{
+    char c = 1;
+    auto ret = ::write(s_signalFd[0], &c, sizeof(c));
+    Q_UNUSED(ret)
+}
+
+static void installQuitSignalHandlers(QCoreApplication *application)
+{
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, s_signalFd) != 0) {
+        qWarning("Can't create the signal socket pair.");
+        return;
+    }
+    auto notifier = new QSocketNotifier(s_signalFd[1], QSocketNotifier::Read, application);
+    QObject::connect(notifier, &QSocketNotifier::activated, application, [notifier]() {
+        notifier->setEnabled(false);
+        char c;
+        auto ret = ::read(s_signalFd[1], &c, sizeof(c));
+        Q_UNUSED(ret)
+        qInfo("Quitting...");
+        QCoreApplication::quit();
+    });
+
+    struct sigaction action = {};
+    action.sa_handler = quitSignalHandler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+    QtSingleCoreApplication application(argc, argv);
+
+    QCoreApplication::setApplicationName(STR_APPLICATION_NAME);
+    QCoreApplication::setOrganizationName(STR_APPLICATION_ORGANIZATION);
+    QCoreApplication::setApplicationVersion(STR_APPLICATION_VERSION);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QString("\n%0").arg(QT_TRANSLATE_NOOP("main", "Another Download Manager (headless daemon)")));
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    QCommandLineOption verboseOption(QStringList() << "V" << "verbose", "Verbose (debug) mode");
+    parser.addOption(verboseOption);
+
+    QCommandLineOption queueOption(QStringList() << "q" << "queue", "Use the queue <file> instead of the queue of the settings", "file");
+    parser.addOption(queueOption);
+
+    QCommandLineOption pausedOption(QStringList() << "p" << "paused", "Add the URLs in paused state");
+    parser.addOption(pausedOption);
+
+    QCommandLineOption resumeAllOption(QStringList() << "resume-all", "Resume all the downloads of the running daemon");
+    parser.addOption(resumeAllOption);
+
+    QCommandLineOption pauseAllOption(QStringList() << "pause-all", "Pause all the downloads of the running daemon");
+    parser.addOption(pauseAllOption);
+
+    QCommandLineOption quitOption(QStringList() << "quit", "Quit the running daemon");
+    parser.addOption(quitOption);
+
+    QCommandLineOption controlOption(QStringList() << "control", QString("Listen to the JSON-RPC control API on the local socket <name> (default: %0)").arg(C_CONTROL_SERVER_NAME), "name", C_CONTROL_SERVER_NAME);
+    parser.addOption(controlOption);
+
+    QCommandLineOption noControlOption(QStringList() << "no-control", "Disable the control API");
+    parser.addOption(noControlOption);
+
+    parser.addPositionalArgument("url", QT_TRANSLATE_NOOP("main", "target URL to download"));
+
+    parser.process(application);
+
+#ifndef QT_DEBUG
+    if (parser.isSet(verboseOption)) {
+        qInstallMessageHandler(releaseVerboseMessageHandler);
+    } else {
+        qInstallMessageHandler(releaseDefaultMessageHandler);
+    }
+#else
+    qInstallMessageHandler(nullptr); // default handler (show all messages)
+#endif
+
+    QStringList messages;
+    const QStringList positionalArguments = parser.positionalArguments();
+    if (!positionalArguments.isEmpty()) {
+        QString message = parser.isSet(pausedOption) ? C_DAEMON_ADD_PAUSED : C_DAEMON_ADD;
+        for (const auto &positionalArgument : positionalArguments) {
+            message += QChar::Space;
+            message += positionalArgument;
+        }
+        messages << message;
+    }
+    if (parser.isSet(resumeAllOption)) {
+        messages << C_DAEMON_RESUME_ALL;
+    }
+    if (parser.isSet(pauseAllOption)) {
+        messages << C_DAEMON_PAUSE_ALL;
+    }
+    if (parser.isSet(quitOption)) {
+        messages << C_DAEMON_QUIT;
+    }
+
+    if (application.isRunning()) {
+        for (const auto &message : std::as_const(messages)) {
+            bool ok = application.sendMessage(message, MSEC_MESSAGE_TIMEOUT);
+            if (!ok) {
+                qCritical("Message sending failed; the daemon may be frozen.");
+                return EXIT_FAILURE;
+            }
+        }
+        return EXIT_SUCCESS;
+    }
+
+    if (parser.isSet(quitOption)) {
+        qWarning("No daemon is running.");
+        return EXIT_FAILURE;
+    }
+
+    Daemon daemon;
+
+    QObject::connect(&application, SIGNAL(messageReceived(QString)), &daemon, SLOT(handleMessage(QString)));
+    QObject::connect(&daemon, SIGNAL(quitRequested()), &application, SLOT(quit()));
+
+#ifdef Q_OS_UNIX
+    installQuitSignalHandlers(&application);
+#endif
+
+    if (!parser.isSet(noControlOption)) {
+        daemon.listen(parser.value(controlOption));
+    }
+    daemon.start(parser.value(queueOption));
+
+    for (const auto &message : std::as_const(messages)) {
+        daemon.handleMessage(message);
+    }
+
+    try {
+        return QtSingleCoreApplication::exec();
+
+    } catch (const std::exception &exception) {
+        /// \todo use future C++23 <stacktrace> instead
+        std::string bt = boost::stacktrace::to_string(boost::stacktrace::stacktrace());
+        qWarning() << "Caught Fatal exception: " << QString::fromUtf8(exception.what());
+        qWarning() << QString::fromUtf8(bt);
+        return EXIT_FAILURE;
+    }
+}
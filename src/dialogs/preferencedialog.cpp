@@ -117,6 +117,7 @@ void PreferenceDialog::connectUi()
 
     // Tab Network
     connect(ui->maxSimultaneousDownloadSlider, SIGNAL(valueChanged(int)), this, SLOT(maxSimultaneousDownloadSlided(int)));
+    connect(ui->maxSimultaneousDownloadPerHostSlider, SIGNAL(valueChanged(int)), this, SLOT(maxSimultaneousDownloadPerHostSlided(int)));
     connect(ui->concurrentFragmentSlider, SIGNAL(valueChanged(int)), this, SLOT(concurrentFragmentSlided(int)));
 
     connect(ui->proxyTypeComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(proxyTypeChanged(int)));
@@ -406,6 +407,11 @@ void PreferenceDialog::maxSimultaneousDownloadSlided(int value)
     ui->maxSimultaneousDownloadValue->setText(QString::number(value));
 }
 
+void PreferenceDialog::maxSimultaneousDownloadPerHostSlided(int value)
+{
+    ui->maxSimultaneousDownloadPerHostValue->setText(QString::number(value));
+}
+
 void PreferenceDialog::concurrentFragmentSlided(int value)
 {
     ui->concurrentFragmentValue->setText(QString::number(value));
@@ -500,6 +506,10 @@ void PreferenceDialog::read()
 
     // Tab Network
     ui->maxSimultaneousDownloadSlider->setValue(m_settings->maxSimultaneousDownloads());
+    ui->maxSimultaneousDownloadPerHostSlider->setValue(m_settings->maxSimultaneousDownloadsPerHost());
+    ui->limitPerDomainCheckBox->setChecked(m_settings->isLimitPerDomainEnabled());
+    ui->downloadLimitSpinBox->setValue(m_settings->downloadLimit());
+    ui->downloadLimitScheduleLineEdit->setText(m_settings->downloadLimitSchedule());
     ui->concurrentFragmentSlider->setValue(m_settings->concurrentFragments());
 
     ui->customBatchGroupBox->setChecked(m_settings->isCustomBatchEnabled());
@@ -536,6 +546,7 @@ void PreferenceDialog::read()
     ui->privacyRemovePausedCheckBox->setChecked(m_settings->isRemovePausedEnabled());
 
     ui->browseDatabaseFile->setCurrentPath(m_settings->database());
+    ui->logFileCheckBox->setChecked(m_settings->isLogFileEnabled());
 
     int index = static_cast<int>(m_settings->checkUpdateBeatMode());
     ui->checkUpdateComboBox->setCurrentIndex(index);
@@ -581,6 +592,10 @@ void PreferenceDialog::write()
 
     // Tab Network
     m_settings->setMaxSimultaneousDownloads(ui->maxSimultaneousDownloadSlider->value());
+    m_settings->setMaxSimultaneousDownloadsPerHost(ui->maxSimultaneousDownloadPerHostSlider->value());
+    m_settings->setLimitPerDomainEnabled(ui->limitPerDomainCheckBox->isChecked());
+    m_settings->setDownloadLimit(ui->downloadLimitSpinBox->value());
+    m_settings->setDownloadLimitSchedule(ui->downloadLimitScheduleLineEdit->text());
     m_settings->setConcurrentFragments(ui->concurrentFragmentSlider->value());
 
     m_settings->setCustomBatchEnabled(ui->customBatchGroupBox->isChecked());
@@ -616,6 +631,7 @@ void PreferenceDialog::write()
     m_settings->setRemovePausedEnabled(ui->privacyRemovePausedCheckBox->isChecked());
 
     m_settings->setDatabase(ui->browseDatabaseFile->currentPath());
+    m_settings->setLogFileEnabled(ui->logFileCheckBox->isChecked());
 
     auto mode = static_cast<CheckUpdateBeatMode>(
                 ui->checkUpdateComboBox->currentIndex());
@@ -62,6 +62,7 @@ private slots:
     void resetTheme();
 
     void maxSimultaneousDownloadSlided(int value);
+    void maxSimultaneousDownloadPerHostSlided(int value);
     void concurrentFragmentSlided(int value);
 
     void proxyTypeChanged(int index);
@@ -0,0 +1,592 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "controlserver.h"
+
+#include <Constants>
+#include <Core/IDownloadItem>
+
+#include <QtCore/QDebug>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonParseError>
+#include <QtNetwork/QLocalServer>
+#include <QtNetwork/QLocalSocket>
+
+#include <algorithm> /* std::clamp, std::min */
+#include <iterator> /* std::size */
+
+static const QLatin1StringView C_JSON_RPC_VERSION  ("2.0");
+
+
+static inline QJsonObject errorObject(ControlServer::ErrorCode code, const QString &message)
+{
+    return QJsonObject{
+        { "code", code },
+        { "message", message }
+    };
+}
+
+static inline QJsonObject response(const QJsonValue &id, const QJsonValue &result)
+{
+    return QJsonObject{
+        { "jsonrpc", C_JSON_RPC_VERSION },
+        { "result", result },
+        { "id", id }
+    };
+}
+
+static inline QJsonObject errorResponse(const QJsonValue &id, ControlServer::ErrorCode code, const QString &message)
+{
+    return QJsonObject{
+        { "jsonrpc", C_JSON_RPC_VERSION },
+        { "error", errorObject(code, message) },
+        { "id", id }
+    };
+}
+
+/******************************************************************************
+ ******************************************************************************/
+ControlServer::ControlServer(DownloadEngine *engine, QObject *parent) : QObject(parent)
+  , m_engine(engine)
+  , m_server(new QLocalServer(this))
+{
+    Q_ASSERT(m_engine);
+
+    /* Only the user who runs the engine can control it */
+    m_server->setSocketOptions(QLocalServer::UserAccessOption);
+
+    connect(m_server, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+
+    connect(m_engine, SIGNAL(jobAppended(DownloadRange)), this, SLOT(onJobAppended(DownloadRange)));
+    connect(m_engine, SIGNAL(jobRemoved(DownloadRange)), this, SLOT(onJobRemoved(DownloadRange)));
+    connect(m_engine, SIGNAL(jobReplaced(DownloadRange,DownloadRange)), this, SLOT(onJobReplaced(DownloadRange,DownloadRange)));
+    connect(m_engine, SIGNAL(jobsChanged(QSet<IDownloadItem*>)), this, SLOT(onJobsChanged(QSet<IDownloadItem*>)));
+    connect(m_engine, SIGNAL(jobFinished(IDownloadItem*)), this, SLOT(onJobFinished(IDownloadItem*)));
+}
+
+ControlServer::~ControlServer()
+{
+    close();
+}
+
+/******************************************************************************
+ ******************************************************************************/
+/*!
+ * \brief Listens on the local socket name.
+ * On Unix, a stale socket file, left by a crashed process, is removed first.
+ */
+bool ControlServer::listen(const QString &name)
+{
+    close();
+    QLocalServer::removeServer(name);
+    return m_server->listen(name);
+}
+
+void ControlServer::close()
+{
+    m_subscribers.clear();
+    const auto clients = m_server->findChildren<QLocalSocket*>();
+    for (auto client : clients) {
+        client->disconnect(this);
+        client->abort();
+        client->deleteLater();
+    }
+    m_server->close();
+}
+
+bool ControlServer::isListening() const
+{
+    return m_server->isListening();
+}
+
+QString ControlServer::fullServerName() const
+{
+    return m_server->fullServerName();
+}
+
+QString ControlServer::errorString() const
+{
+    return m_server->errorString();
+}
+
+/******************************************************************************
+ ******************************************************************************/
+void ControlServer::onNewConnection()
+{
+    while (m_server->hasPendingConnections()) {
+        auto client = m_server->nextPendingConnection();
+        connect(client, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+        connect(client, SIGNAL(disconnected()), this, SLOT(onDisconnected()));
+    }
+}
+
+void ControlServer::onReadyRead()
+{
+    auto client = qobject_cast<QLocalSocket*>(sender());
+    if (!client) {
+        return;
+    }
+    while (client->canReadLine()) {
+        /* One more byte, for the '\n' of a line of the maximum size */
+        auto line = client->readLine(MAX_CONTROL_MESSAGE_SIZE + 1);
+        if (!line.endsWith('\n')) {
+            /* The rest of the line would be read as another request */
+            qWarning("Control request too large, the client is disconnected.");
+            drop(client);
+            return;
+        }
+        auto message = line.trimmed();
+        if (message.isEmpty()) {
+            continue;
+        }
+        auto reply = handleMessage(message, client);
+        if (!reply.isEmpty()) {
+            write(client, reply);
+        }
+        if (client->bytesToWrite() > MAX_CONTROL_PENDING_SIZE) {
+            qWarning("Control client doesn't read its responses, it is disconnected.");
+            drop(client);
+            return;
+        }
+    }
+    if (client->bytesAvailable() > MAX_CONTROL_MESSAGE_SIZE) {
+        qWarning("Control request too large, the client is disconnected.");
+        drop(client);
+    }
+}
+
+void ControlServer::onDisconnected()
+{
+    auto client = qobject_cast<QLocalSocket*>(sender());
+    if (!client) {
+        return;
+    }
+    m_subscribers.remove(client);
+    client->deleteLater();
+}
+
+/*!
+ * \brief Disconnects the client immediately, without sending its pending data.
+ */
+void ControlServer::drop(QLocalSocket *client)
+{
+    m_subscribers.remove(client);
+    client->disconnect(this);
+    client->abort();
+    client->deleteLater();
+}
+
+void ControlServer::write(QLocalSocket *client, const QByteArray &message)
+{
+    client->write(message);
+    client->write("\n", 1);
+}
+
+/******************************************************************************
+ ******************************************************************************/
+/*!
+ * \brief Executes the request, or the batch of requests, of the message.
+ * Returns the response, or an empty array if the message contains only
+ * notifications (requests without id).
+ */
+QByteArray ControlServer::handleMessage(const QByteArray &message, QLocalSocket *client)
+{
+    QJsonParseError parseError;
+    auto document = QJsonDocument::fromJson(message, &parseError);
+    if (parseError.error != QJsonParseError::NoError) {
+        auto reply = errorResponse(QJsonValue::Null, ParseError, parseError.errorString());
+        return QJsonDocument(reply).toJson(QJsonDocument::Compact);
+    }
+
+    if (document.isArray()) {
+        const auto requests = document.array();
+        if (requests.isEmpty()) {
+            auto reply = errorResponse(QJsonValue::Null, InvalidRequest, QLatin1String("Empty batch"));
+            return QJsonDocument(reply).toJson(QJsonDocument::Compact);
+        }
+        QJsonArray replies;
+        for (const auto &request : requests) {
+            auto reply = handleRequest(request, client);
+            if (!reply.isEmpty()) {
+                replies.append(reply);
+            }
+        }
+        if (replies.isEmpty()) {
+            return {};
+        }
+        return QJsonDocument(replies).toJson(QJsonDocument::Compact);
+    }
+
+    auto reply = handleRequest(document.object(), client);
+    if (reply.isEmpty()) {
+        return {};
+    }
+    return QJsonDocument(reply).toJson(QJsonDocument::Compact);
+}
+
+QJsonObject ControlServer::handleRequest(const QJsonValue &value, QLocalSocket *client)
+{
+    if (!value.isObject()) {
+        return errorResponse(QJsonValue::Null, InvalidRequest, QLatin1String("Not an object"));
+    }
+    const auto request = value.toObject();
+    const auto id = request.value("id");
+    const auto isNotification = !request.contains("id");
+
+    const auto method = request.value("method").toString();
+    if (request.value("jsonrpc").toString() != C_JSON_RPC_VERSION || method.isEmpty()) {
+        return errorResponse(id, InvalidRequest, QLatin1String("Invalid request"));
+    }
+    const auto paramsValue = request.value("params");
+    if (!paramsValue.isUndefined() && !paramsValue.isObject()) {
+        return errorResponse(id, InvalidParams, QLatin1String("Params must be an object"));
+    }
+    const auto params = paramsValue.toObject();
+
+    QString error;
+    QJsonValue result;
+    if (method == QLatin1String("add")) {
+        result = add(params, &error);
+
+    } else if (method == QLatin1String("pause")) {
+        result = pause(params, &error);
+
+    } else if (method == QLatin1String("resume")) {
+        result = resume(params, &error);
+
+    } else if (method == QLatin1String("remove")) {
+        result = remove(params, &error);
+
+    } else if (method == QLatin1String("query")) {
+        result = query(params, &error);
+
+    } else if (method == QLatin1String("stats")) {
+        result = stats();
+
+    } else if (method == QLatin1String("subscribe")) {
+        if (!client) {
+            error = QLatin1String("No client to notify");
+        } else {
+            m_subscribers.insert(client);
+            result = true;
+        }
+
+    } else if (method == QLatin1String("unsubscribe")) {
+        m_subscribers.remove(client);
+        result = true;
+
+    } else {
+        return isNotification
+                ? QJsonObject()
+                : errorResponse(id, MethodNotFound, QString("Method not found: %0").arg(method));
+    }
+
+    if (isNotification) {
+        return {};
+    }
+    if (!error.isEmpty()) {
+        return errorResponse(id, InvalidParams, error);
+    }
+    return response(id, result);
+}
+
+/******************************************************************************
+ ******************************************************************************/
+QJsonValue ControlServer::add(const QJsonObject &params, QString *error)
+{
+    const auto urls = params.value("urls").toArray();
+    if (urls.isEmpty()) {
+        *error = QLatin1String("Missing \"urls\"");
+        return {};
+    }
+    const auto started = !params.value("paused").toBool(false);
+
+    QList<IDownloadItem*> items;
+    QJsonArray ids;
+    for (const auto &value : urls) {
+        const auto url = QUrl::fromUserInput(value.toString());
+        IDownloadItem *item = nullptr;
+        if (url.isValid()) {
+            item = DownloadEngine::isTorrentUrl(url)
+                    ? m_engine->createTorrentItem(url)
+                    : m_engine->createItem(url);
+        }
+        if (item) {
+            items.append(item);
+            ids.append(idOf(item));
+        } else {
+            ids.append(QJsonValue::Null);
+        }
+    }
+    m_engine->append(items, started);
+    return QJsonObject{ { "ids", ids } };
+}
+
+QJsonValue ControlServer::pause(const QJsonObject &params, QString *error)
+{
+    const auto items = itemsFrom(params, true, error);
+    for (auto item : items) {
+        m_engine->pause(item);
+    }
+    return QJsonObject{ { "count", items.count() } };
+}
+
+QJsonValue ControlServer::resume(const QJsonObject &params, QString *error)
+{
+    const auto items = itemsFrom(params, true, error);
+    /* The stopped jobs are materialized in one pass, not one by one */
+    auto resumableItems = items;
+    resumableItems.removeIf([](IDownloadItem *item) { return !item->isResumable(); });
+    for (auto item : m_engine->materialize(resumableItems)) {
+        m_engine->resume(item);
+    }
+    return QJsonObject{ { "count", items.count() } };
+}
+
+QJsonValue ControlServer::remove(const QJsonObject &params, QString *error)
+{
+    const auto items = itemsFrom(params, false, error);
+    m_engine->remove(items);
+    return QJsonObject{ { "count", items.count() } };
+}
+
+QJsonValue ControlServer::query(const QJsonObject &params, QString *error)
+{
+    auto items = itemsFrom(params, true, error);
+
+    if (params.contains("states")) {
+        QSet<IDownloadItem::State> states;
+        const auto values = params.value("states").toArray();
+        for (const auto &value : values) {
+            IDownloadItem::State state;
+            if (!stateFromString(value.toString(), &state)) {
+                *error = QString("Unknown state: %0").arg(value.toString());
+                return {};
+            }
+            states.insert(state);
+        }
+        items.removeIf([&states](IDownloadItem *item) { return !states.contains(item->state()); });
+    }
+
+    const auto total = items.count();
+    const auto offset = std::clamp<qsizetype>(params.value("offset").toInteger(0), 0, total);
+    const auto limit = params.value("limit").toInteger(-1);
+    const auto count = limit < 0 ? total - offset : std::min<qsizetype>(limit, total - offset);
+
+    return QJsonObject{
+        { "total", total },
+        { "items", toJson(items.mid(offset, count)) }
+    };
+}
+
+QJsonValue ControlServer::stats() const
+{
+    return QJsonObject{
+        { "count", m_engine->count() },
+        { "waiting", m_engine->waitingJobCount() },
+        { "running", m_engine->runningJobCount() },
+        { "paused", m_engine->pausedJobCount() },
+        { "completed", m_engine->completedJobCount() },
+        { "failed", m_engine->failedJobCount() },
+        { "speed", m_engine->smoothedSpeed() },
+        { "instantSpeed", m_engine->instantSpeed() },
+        { "averageSpeed", m_engine->averageSpeed() }
+    };
+}
+
+/*!
+ * \brief Returns the items of the "ids" param, in the same order.
+ * The unknown ids are ignored.
+ */
+QList<IDownloadItem*> ControlServer::itemsFrom(const QJsonObject &params, bool allByDefault, QString *error) const
+{
+    if (!params.contains("ids")) {
+        if (allByDefault) {
+            return m_engine->downloadItems();
+        }
+        *error = QLatin1String("Missing \"ids\"");
+        return {};
+    }
+    QList<IDownloadItem*> items;
+    const auto ids = params.value("ids").toArray();
+    for (const auto &id : ids) {
+        auto item = m_items.value(id.toInteger(-1), nullptr);
+        if (item) {
+            items.append(item);
+        }
+    }
+    return items;
+}
+
+/******************************************************************************
+ ******************************************************************************/
+qint64 ControlServer::idOf(IDownloadItem *item)
+{
+    auto it = m_ids.constFind(item);
+    if (it != m_ids.constEnd()) {
+        return it.value();
+    }
+    auto id = m_nextId++;
+    m_ids.insert(item, id);
+    m_items.insert(id, item);
+    return id;
+}
+
+QJsonObject ControlServer::toJson(IDownloadItem *item)
+{
+    return QJsonObject{
+        { "id", idOf(item) },
+        { "url", item->sourceUrl().toString() },
+        { "fileName", item->localFullFileName() },
+        { "state", stateToString(item->state()) },
+        { "bytesReceived", item->bytesReceived() },
+        { "bytesTotal", item->bytesTotal() },
+        { "progress", item->progress() },
+        { "speed", item->speed() }
+    };
+}
+
+QJsonArray ControlServer::toJson(const QList<IDownloadItem*> &items)
+{
+    QJsonArray array;
+    for (auto item : items) {
+        array.append(toJson(item));
+    }
+    return array;
+}
+
+/******************************************************************************
+ ******************************************************************************/
+/*!
+ * \brief Sends the event to the subscribed clients.
+ * A client that doesn't read its events is disconnected, rather than
+ * buffering them without limit. Dropping events would silently leave
+ * the client with a wrong view of the queue.
+ */
+void ControlServer::notify(const QString &method, const QJsonObject &params)
+{
+    QJsonObject notification{
+        { "jsonrpc", C_JSON_RPC_VERSION },
+        { "method", method },
+        { "params", params }
+    };
+    const auto message = QJsonDocument(notification).toJson(QJsonDocument::Compact);
+    QList<QLocalSocket*> slowClients;
+    for (auto client : std::as_const(m_subscribers)) {
+        if (client->bytesToWrite() > MAX_CONTROL_PENDING_SIZE) {
+            slowClients.append(client);
+            continue;
+        }
+        write(client, message);
+    }
+    for (auto client : std::as_const(slowClients)) {
+        qWarning("Control client doesn't read its events, it is disconnected.");
+        drop(client);
+    }
+}
+
+void ControlServer::onJobAppended(const DownloadRange &range)
+{
+    if (m_subscribers.isEmpty()) {
+        return;
+    }
+    notify(QLatin1String("added"), QJsonObject{ { "items", toJson(range) } });
+}
+
+void ControlServer::onJobRemoved(const DownloadRange &range)
+{
+    QJsonArray ids;
+    for (auto item : range) {
+        auto id = m_ids.take(item);
+        if (id > 0) {
+            m_items.remove(id);
+            ids.append(id);
+        }
+    }
+    if (m_subscribers.isEmpty() || ids.isEmpty()) {
+        return;
+    }
+    notify(QLatin1String("removed"), QJsonObject{ { "ids", ids } });
+}
+
+/*!
+ * \brief The materialized items keep the ids of their records.
+ */
+void ControlServer::onJobReplaced(const DownloadRange &before, const DownloadRange &after)
+{
+    for (qsizetype i = 0; i < before.size(); ++i) {
+        auto id = m_ids.take(before.at(i));
+        if (id > 0) {
+            m_ids.insert(after.at(i), id);
+            m_items.insert(id, after.at(i));
+        }
+    }
+}
+
+void ControlServer::onJobsChanged(const QSet<IDownloadItem*> &items)
+{
+    if (m_subscribers.isEmpty()) {
+        return;
+    }
+    notify(QLatin1String("changed"), QJsonObject{ { "items", toJson(items.values()) } });
+}
+
+void ControlServer::onJobFinished(IDownloadItem *item)
+{
+    if (m_subscribers.isEmpty()) {
+        return;
+    }
+    notify(QLatin1String("finished"), QJsonObject{ { "item", toJson(item) } });
+}
+
+/******************************************************************************
+ ******************************************************************************/
+static const QLatin1StringView s_states[] = {
+    QLatin1StringView("idle"),
+    QLatin1StringView("paused"),
+    QLatin1StringView("stopped"),
+    QLatin1StringView("preparing"),
+    QLatin1StringView("connecting"),
+    QLatin1StringView("downloadingMetadata"),
+    QLatin1StringView("downloading"),
+    QLatin1StringView("endgame"),
+    QLatin1StringView("completed"),
+    QLatin1StringView("seeding"),
+    QLatin1StringView("skipped"),
+    QLatin1StringView("networkError"),
+    QLatin1StringView("fileError")
+};
+static_assert(std::size(s_states) == IDownloadItem::FileError + 1, "Missing state name");
+
+/*!
+ * \brief Returns the name of the state in the protocol (not translated).
+ */
+QString ControlServer::stateToString(IDownloadItem::State state)
+{
+    return s_states[state];
+}
+
+bool ControlServer::stateFromString(const QString &str, IDownloadItem::State *state)
+{
+    for (int i = 0; i <= IDownloadItem::FileError; ++i) {
+        if (str == s_states[i]) {
+            *state = static_cast<IDownloadItem::State>(i);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,140 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef IPC_CONTROL_SERVER_H
+#define IPC_CONTROL_SERVER_H
+
+#include <Core/DownloadEngine>
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonObject>
+#include <QtCore/QJsonValue>
+#include <QtCore/QList>
+#include <QtCore/QObject>
+#include <QtCore/QSet>
+#include <QtCore/QString>
+
+class QLocalServer;
+class QLocalSocket;
+
+static const QLatin1StringView C_CONTROL_SERVER_NAME   ("ArrowDL-control");
+
+/*!
+ * \class ControlServer
+ * \brief Local control API of the download queue, over a local socket.
+ *
+ * The socket is a Unix domain socket (a named pipe on Windows).
+ * The protocol is JSON-RPC 2.0, one JSON text per line (UTF-8, '\n').
+ * A batch (JSON array) of requests gets a batch of responses.
+ *
+ * Methods:
+ *
+ * "add"..........: {"urls": [<url>...], "paused": <bool>}
+ *                  -> {"ids": [<id or null>...]}
+ *
+ * "pause"........: {"ids": [<id>...]}, or all if "ids" is missing
+ * "resume".......: {"ids": [<id>...]}, or all if "ids" is missing
+ * "remove".......: {"ids": [<id>...]}
+ *                  -> {"count": <number of items>}
+ *
+ * "query"........: {"ids": [<id>...], "states": [<state>...],
+ *                   "offset": <int>, "limit": <int>}, all optional
+ *                  -> {"total": <int>, "items": [<item>...]}
+ *
+ * "stats"........: -> {"count": <int>, "running": <int>, ... "speed": <bytes/s>}
+ *
+ * "subscribe"....: the client receives the events as JSON-RPC notifications:
+ * "unsubscribe"..: "added", "removed", "changed" (batched), "finished".
+ *
+ * Example
+ * \code
+ * --> {"jsonrpc": "2.0", "method": "add", "params": {"urls": ["https://www.example.org/a.zip"]}, "id": 1}
+ * <-- {"jsonrpc": "2.0", "result": {"ids": [12]}, "id": 1}
+ * <-- {"jsonrpc": "2.0", "method": "changed", "params": {"items": [{"id": 12, "state": "downloading", ...}]}}
+ * \endcode
+ */
+class ControlServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum ErrorCode {
+        ParseError = -32700,
+        InvalidRequest = -32600,
+        MethodNotFound = -32601,
+        InvalidParams = -32602
+    };
+
+    explicit ControlServer(DownloadEngine *engine, QObject *parent = nullptr);
+    ~ControlServer() override;
+
+    bool listen(const QString &name = C_CONTROL_SERVER_NAME);
+    void close();
+    bool isListening() const;
+
+    QString fullServerName() const;
+    QString errorString() const;
+
+    QByteArray handleMessage(const QByteArray &message, QLocalSocket *client = nullptr);
+
+    static QString stateToString(IDownloadItem::State state);
+    static bool stateFromString(const QString &str, IDownloadItem::State *state);
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+    void onDisconnected();
+
+    void onJobAppended(const DownloadRange &range);
+    void onJobRemoved(const DownloadRange &range);
+    void onJobReplaced(const DownloadRange &before, const DownloadRange &after);
+    void onJobsChanged(const QSet<IDownloadItem *> &items);
+    void onJobFinished(IDownloadItem *item);
+
+private:
+    DownloadEngine *m_engine = nullptr;
+    QLocalServer *m_server = nullptr;
+    QSet<QLocalSocket *> m_subscribers = {};
+
+    /* The items are identified by a number, never reused */
+    QHash<IDownloadItem *, qint64> m_ids = {};
+    QHash<qint64, IDownloadItem *> m_items = {};
+    qint64 m_nextId = 1;
+
+    qint64 idOf(IDownloadItem *item);
+    QJsonObject toJson(IDownloadItem *item);
+    QJsonArray toJson(const QList<IDownloadItem *> &items);
+
+    QJsonObject handleRequest(const QJsonValue &request, QLocalSocket *client);
+
+    QJsonValue add(const QJsonObject &params, QString *error);
+    QJsonValue pause(const QJsonObject &params, QString *error);
+    QJsonValue resume(const QJsonObject &params, QString *error);
+    QJsonValue remove(const QJsonObject &params, QString *error);
+    QJsonValue query(const QJsonObject &params, QString *error);
+    QJsonValue stats() const;
+
+    QList<IDownloadItem *> itemsFrom(const QJsonObject &params, bool allByDefault, QString *error) const;
+
+    void notify(const QString &method, const QJsonObject &params);
+    void drop(QLocalSocket *client);
+    static void write(QLocalSocket *client, const QByteArray &message);
+};
+
+#endif // IPC_CONTROL_SERVER_H
@@ -20,6 +20,7 @@
 #include "about.h"
 
 #include <Constants>
+#include <Core/AbstractDownloadItem>
 #include <Core/IDownloadItem>
 #include <Core/DownloadManager>
 #include <Core/DownloadTorrentItem>
@@ -143,7 +144,7 @@ MainWindow::MainWindow(QWidget *parent): QMainWindow(parent)
     /* The SceneManager centralizes the changes. */
     connect(m_downloadManager, SIGNAL(jobAppended(DownloadRange)), this, SLOT(onJobAddedOrRemoved(DownloadRange)));
     connect(m_downloadManager, SIGNAL(jobRemoved(DownloadRange)), this, SLOT(onJobAddedOrRemoved(DownloadRange)));
-    connect(m_downloadManager, SIGNAL(jobStateChanged(IDownloadItem*)), this, SLOT(onJobStateChanged(IDownloadItem*)));
+    connect(m_downloadManager, SIGNAL(jobsChanged(QSet<IDownloadItem*>)), this, SLOT(onJobsChanged(QSet<IDownloadItem*>)));
     connect(m_downloadManager, SIGNAL(jobFinished(IDownloadItem*)), this, SLOT(onJobFinished(IDownloadItem*)));
     connect(m_downloadManager, SIGNAL(jobRenamed(QString,QString,bool)), this, SLOT(onJobRenamed(QString,QString,bool)), Qt::QueuedConnection);
     connect(m_downloadManager, SIGNAL(selectionChanged()), this, SLOT(onSelectionChanged()));
@@ -972,8 +973,27 @@ void MainWindow::bottom()
 }
 
 void MainWindow::speedLimit()
-{    
-    qWarning("todo: speedLimit() not implemented yet.");
+{
+    const auto selection = m_downloadManager->selection();
+    if (selection.isEmpty()) {
+        return;
+    }
+    auto first = dynamic_cast<AbstractDownloadItem*>(selection.first());
+    auto current = first ? static_cast<int>(first->speedLimit() / 1024) : 0;
+    bool ok = false;
+    auto value = QInputDialog::getInt(
+                this, tr("Speed Limit"),
+                tr("Maximum speed of the selected downloads, in KB/s (0: unlimited):"),
+                current, 0, 1024 * 1024, 1, &ok);
+    if (!ok) {
+        return;
+    }
+    for (auto item : selection) {
+        auto downloadItem = dynamic_cast<AbstractDownloadItem*>(item);
+        if (downloadItem) {
+            downloadItem->setSpeedLimit(qint64(value) * 1024);
+        }
+    }
 }
 
 void MainWindow::forceStart()
@@ -1038,11 +1058,10 @@ void MainWindow::onJobAddedOrRemoved(const DownloadRange &/*range*/)
     refreshTitleAndStatus();
 }
 
-void MainWindow::onJobStateChanged(IDownloadItem * /*downloadItem*/)
+void MainWindow::onJobsChanged(const QSet<IDownloadItem *> & /*items*/)
 {
-    // if (m_downloadManager->isSelected(downloadItem)) {
+    /* Once per batch of changes, not once per changed item */
     refreshMenus();
-    // }
     refreshTitleAndStatus();
 }
 
@@ -1089,9 +1108,9 @@ void MainWindow::refreshTitleAndStatus()
     if (speed > 0) {
         totalSpeed = QString("~%0").arg(Format::currentSpeedToString(speed));
     }
-    auto completedCount = m_downloadManager->completedJobs().count();
-    auto runningCount = m_downloadManager->runningJobs().count();
-    auto failedCount = m_downloadManager->failedJobs().count();
+    auto completedCount = m_downloadManager->completedJobCount();
+    auto runningCount = m_downloadManager->runningJobCount();
+    auto failedCount = m_downloadManager->failedJobCount();
     auto count = m_downloadManager->count();
     auto doneCount = completedCount + failedCount;
 
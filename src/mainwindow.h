@@ -19,6 +19,7 @@
 
 #include <Core/IDownloadItem>
 
+#include <QtCore/QSet>
 #include <QtWidgets/QMainWindow>
 
 class DownloadManager;
@@ -131,7 +132,7 @@ public slots:
 
 private slots:
     void onJobAddedOrRemoved(const DownloadRange &range);
-    void onJobStateChanged(IDownloadItem *downloadItem);
+    void onJobsChanged(const QSet<IDownloadItem *> &items);
     void onJobFinished(IDownloadItem *downloadItem);
     void onJobRenamed(const QString &oldName, const QString &newName, bool success);
     void onSelectionChanged();
@@ -26,6 +26,7 @@
 #include <Widgets/Globals>
 
 #include <QtCore/QDebug>
+#include <QtCore/QItemSelectionModel>
 #include <QtCore/QMimeData>
 #include <QtCore/QFileInfo>
 #include <QtGui/QDrag>
@@ -38,10 +39,20 @@
 #include <QtWidgets/QMenu>
 #include <QtWidgets/QStyledItemDelegate>
 
+#include <algorithm> /* std::sort, std::unique */
+#include <functional> /* std::greater */
+#include <limits> /* std::numeric_limits */
+
 
 QueueView::QueueView(QWidget *parent)
-    : QTreeWidget(parent)
+    : QTreeView(parent)
 {
+    setModel(new QueueModel(this));
+
+    // All the rows have the same height, so that the view
+    // lays out and scrolls without querying every row
+    setUniformRowHeights(true);
+
     setHorizontalScrollMode(QAbstractItemView::ScrollPerPixel);
     setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
 
@@ -50,12 +61,17 @@ QueueView::QueueView(QWidget *parent)
     setDragDropMode(QAbstractItemView::DragOnly);
 }
 
+QueueModel* QueueView::queueModel() const
+{
+    return static_cast<QueueModel*>(model());
+}
+
 void QueueView::mousePressEvent(QMouseEvent *event)
 {
     if (event->button() == Qt::LeftButton) {
         dragStartPosition = event->pos();
     }
-    QTreeWidget::mousePressEvent(event);
+    QTreeView::mousePressEvent(event);
 }
 
 void QueueView::mouseMoveEvent(QMouseEvent *event)
@@ -67,12 +83,12 @@ void QueueView::mouseMoveEvent(QMouseEvent *event)
             < QApplication::startDragDistance()) {
         return;
     }
-    auto queueItems = toQueueItem(selectedItems());
+    auto downloadItems = selectedDownloadItems();
 
     QPixmap pixmap;
     QList<QUrl> urls;
-    for (auto queueItem : queueItems) {
-        auto url = urlFrom(queueItem);
+    for (auto downloadItem : downloadItems) {
+        auto url = urlFrom(downloadItem);
         if (!url.isEmpty()) {
             if (pixmap.isNull()) {
                 pixmap = MimeDatabase::fileIcon(url);
@@ -92,29 +108,25 @@ void QueueView::mouseMoveEvent(QMouseEvent *event)
 
     Qt::DropAction dropAction = drag->exec(Qt::MoveAction);
     if (dropAction == Qt::MoveAction) {
-        for (auto queueItem : queueItems) {
-            emit dropped(queueItem);
+        for (auto downloadItem : downloadItems) {
+            emit dropped(downloadItem);
         }
     }
 }
 
-QList<QueueItem*> QueueView::toQueueItem(const QList<QTreeWidgetItem *> &items) const
+QList<IDownloadItem*> QueueView::selectedDownloadItems() const
 {
-    QList<QueueItem*> queueItems;
-    for (auto item : items) {
-        auto queueItem = dynamic_cast<QueueItem*>(item);
-        if (queueItem)
-            queueItems << queueItem;
+    QList<IDownloadItem*> downloadItems;
+    for (const auto &index : selectionModel()->selectedRows()) {
+        auto downloadItem = queueModel()->item(index);
+        if (downloadItem)
+            downloadItems << downloadItem;
     }
-    return queueItems;
+    return downloadItems;
 }
 
-QUrl QueueView::urlFrom(const QueueItem *queueItem) const
+QUrl QueueView::urlFrom(const IDownloadItem *downloadItem) const
 {
-    if (!queueItem)
-        return {};
-
-    const AbstractDownloadItem* downloadItem = queueItem->downloadItem();
     if (!downloadItem)
         return {};
 
@@ -210,8 +222,8 @@ void QueueViewItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem
 
     } else if (index.column() == COL_2_PROGRESS_BAR) {
 
-        auto progress = index.data(QueueItem::ProgressRole).toInt();
-        auto state = static_cast<IDownloadItem::State>(index.data(QueueItem::StateRole).toInt());
+        auto progress = index.data(QueueModel::ProgressRole).toInt();
+        auto state = static_cast<IDownloadItem::State>(index.data(QueueModel::StateRole).toInt());
 
         CustomStyleOptionProgressBar progressBarOption;
         progressBarOption.state = myOption.state;
@@ -334,21 +346,58 @@ QIcon QueueViewItemDelegate::stateIcon(IDownloadItem::State state) const
 
 /******************************************************************************
  ******************************************************************************/
-QueueItem::QueueItem(AbstractDownloadItem *downloadItem, QTreeWidget *view)
-    : QObject(view)
-    , QTreeWidgetItem(view, QTreeWidgetItem::UserType)
-    , m_downloadItem(downloadItem)
+QueueModel::QueueModel(QObject *parent)
+    : QAbstractTableModel(parent)
 {
-    this->setSizeHint(COL_2_PROGRESS_BAR, QSize(COLUMN_DEFAULT_WIDTH, ROW_DEFAULT_HEIGHT));
-    this->setFlags(Qt::ItemIsEditable | flags());
+}
 
-    connect(m_downloadItem, SIGNAL(changed()), this, SLOT(updateItem()));
+int QueueModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : static_cast<int>(m_items.count());
+}
 
-    updateItem();
+int QueueModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : static_cast<int>(m_headers.count());
+}
+
+QVariant QueueModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole) {
+        if (section >= 0 && section < m_headers.count()) {
+            return m_headers.at(section);
+        }
+        return {};
+    }
+    return QAbstractItemModel::headerData(section, orientation, role);
 }
 
-static QString estimatedTime(AbstractDownloadItem *downloadItem)
+void QueueModel::setHeaders(const QStringList &headers)
 {
+    if (headers.count() != m_headers.count()) {
+        beginResetModel();
+        m_headers = headers;
+        endResetModel();
+    } else {
+        m_headers = headers;
+        emit headerDataChanged(Qt::Horizontal, 0, static_cast<int>(m_headers.count()) - 1);
+    }
+}
+
+Qt::ItemFlags QueueModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
+        return Qt::NoItemFlags;
+    }
+    return Qt::ItemIsEditable | Qt::ItemIsDragEnabled | QAbstractTableModel::flags(index);
+}
+
+static QString estimatedTime(const IDownloadItem *item)
+{
+    auto downloadItem = dynamic_cast<const AbstractDownloadItem*>(item);
+    if (!downloadItem) {
+        return AbstractDownloadItem::stateToString(item->state());
+    }
     switch (downloadItem->state()) {
     case IDownloadItem::Downloading:
         return Format::timeToString(downloadItem->remainingTime());
@@ -360,30 +409,228 @@ static QString estimatedTime(AbstractDownloadItem *downloadItem)
     }
 }
 
-void QueueItem::updateItem()
+static QString sizeToString(const IDownloadItem *downloadItem)
 {
-    QString size;
-    if (m_downloadItem->bytesTotal() > 0) {
-        size = tr("%0 of %1").arg(
-                    Format::fileSizeToString(m_downloadItem->bytesReceived()),
-                    Format::fileSizeToString(m_downloadItem->bytesTotal()));
-    } else {
-        size = tr("Unknown");
+    if (downloadItem->bytesTotal() > 0) {
+        return QueueModel::tr("%0 of %1").arg(
+                    Format::fileSizeToString(downloadItem->bytesReceived()),
+                    Format::fileSizeToString(downloadItem->bytesTotal()));
+    }
+    return QueueModel::tr("Unknown");
+}
+
+/*!
+ * \brief Formats the cell from the item, when the view requests it.
+ */
+QVariant QueueModel::data(const QModelIndex &index, int role) const
+{
+    auto downloadItem = item(index);
+    if (!downloadItem) {
+        return {};
+    }
+    switch (role) {
+    case Qt::DisplayRole:
+        switch (index.column()) {
+        case COL_0_FILE_NAME:       return downloadItem->localFileName();
+        case COL_1_WEBSITE_DOMAIN:  return downloadItem->sourceUrl().host(); /// \todo domain only
+        case COL_3_PERCENT:         return QString("%0%").arg(qMax(0, downloadItem->progress()));
+        case COL_4_SIZE:            return sizeToString(downloadItem);
+        case COL_5_ESTIMATED_TIME:  return estimatedTime(downloadItem);
+        case COL_6_SPEED:           return Format::currentSpeedToString(downloadItem->speed());
+        default:
+            break;
+        }
+        break;
+
+    case Qt::EditRole:
+        if (index.column() == COL_0_FILE_NAME) {
+            return downloadItem->localFileName();
+        }
+        break;
+
+    case Qt::SizeHintRole:
+        if (index.column() == COL_2_PROGRESS_BAR) {
+            return QSize(COLUMN_DEFAULT_WIDTH, ROW_DEFAULT_HEIGHT);
+        }
+        break;
+
+    case StateRole:
+        return downloadItem->state();
+
+    case ProgressRole:
+        return downloadItem->progress();
+
+    default:
+        break;
+    }
+    return {};
+}
+
+/******************************************************************************
+ ******************************************************************************/
+IDownloadItem* QueueModel::item(const QModelIndex &index) const
+{
+    if (!index.isValid() || index.row() < 0 || index.row() >= m_items.count()) {
+        return nullptr;
+    }
+    return m_items.at(index.row());
+}
+
+AbstractDownloadItem* QueueModel::downloadItem(const QModelIndex &index) const
+{
+    return dynamic_cast<AbstractDownloadItem*>(item(index));
+}
+
+QModelIndex QueueModel::indexOf(IDownloadItem *item, int column) const
+{
+    auto it = m_rows.constFind(item);
+    if (it == m_rows.constEnd()) {
+        return {};
+    }
+    return index(it.value(), column);
+}
+
+void QueueModel::reindex(int first)
+{
+    for (auto row = first; row < m_items.count(); ++row) {
+        m_rows.insert(m_items.at(row), row);
+    }
+}
+
+/******************************************************************************
+ ******************************************************************************/
+void QueueModel::appendItems(const DownloadRange &range)
+{
+    if (range.isEmpty()) {
+        return;
+    }
+    auto first = static_cast<int>(m_items.count());
+    auto last = first + static_cast<int>(range.count()) - 1;
+    beginInsertRows(QModelIndex(), first, last);
+    m_items.append(range);
+    reindex(first);
+    endInsertRows();
+}
+
+/*!
+ * \brief Removes the rows of the items, by contiguous blocks.
+ */
+void QueueModel::removeItems(const DownloadRange &range)
+{
+    QList<int> rows;
+    for (auto item : range) {
+        auto it = m_rows.constFind(item);
+        if (it != m_rows.constEnd()) {
+            rows << it.value();
+        }
     }
+    if (rows.isEmpty()) {
+        return;
+    }
+    std::sort(rows.begin(), rows.end(), std::greater<int>());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
 
-    QString speed = Format::currentSpeedToString(m_downloadItem->speed());
+    for (auto i = 0; i < rows.count(); ) {
+        auto last = rows.at(i);
+        auto first = last;
+        for (++i; i < rows.count() && rows.at(i) == first - 1; ++i) {
+            first = rows.at(i);
+        }
+        beginRemoveRows(QModelIndex(), first, last);
+        for (auto row = first; row <= last; ++row) {
+            m_rows.remove(m_items.at(row));
+        }
+        m_items.remove(first, last - first + 1);
+        endRemoveRows();
+    }
+    reindex(rows.last());
+}
 
-    this->setText(COL_0_FILE_NAME      , m_downloadItem->localFileName());
-    this->setText(COL_1_WEBSITE_DOMAIN , m_downloadItem->sourceUrl().host()); /// \todo domain only
-    this->setData(COL_2_PROGRESS_BAR   , StateRole, m_downloadItem->state());
-    this->setData(COL_2_PROGRESS_BAR   , ProgressRole, m_downloadItem->progress());
-    this->setText(COL_3_PERCENT        , QString("%0%").arg(qMax(0, m_downloadItem->progress())));
-    this->setText(COL_4_SIZE           , size);
-    this->setText(COL_5_ESTIMATED_TIME , estimatedTime(m_downloadItem));
-    this->setText(COL_6_SPEED          , speed);
+/*!
+ * \brief Replaces the items at the same rows, e.g. the records
+ * materialized by the engine.
+ */
+void QueueModel::replaceItems(const DownloadRange &before, const DownloadRange &after)
+{
+    Q_ASSERT(before.count() == after.count());
+    auto first = std::numeric_limits<int>::max();
+    auto last = -1;
+    for (qsizetype i = 0; i < before.count(); ++i) {
+        auto it = m_rows.constFind(before.at(i));
+        if (it == m_rows.constEnd()) {
+            continue;
+        }
+        auto row = it.value();
+        m_rows.erase(it);
+        m_items[row] = after.at(i);
+        m_rows.insert(after.at(i), row);
+        first = qMin(first, row);
+        last = qMax(last, row);
+    }
+    if (last < 0) {
+        return;
+    }
+    emit dataChanged(index(first, 0), index(last, columnCount() - 1));
+}
 
-    //item->setText(C_COL_7_SEGMENTS, "Unknown");
-    // todo etc...
+/*!
+ * \brief Reorders the rows as the given items.
+ * The selection and the current index follow their items.
+ */
+void QueueModel::sortItems(const DownloadRange &items)
+{
+    if (items.count() != m_items.count()) {
+        beginResetModel();
+        m_items = items;
+        m_rows.clear();
+        reindex(0);
+        endResetModel();
+        return;
+    }
+    emit layoutAboutToBeChanged();
+    const auto oldItems = m_items;
+    m_items = items;
+    reindex(0);
+
+    const auto from = persistentIndexList();
+    QModelIndexList to;
+    to.reserve(from.count());
+    for (const auto &index : from) {
+        auto row = m_rows.value(oldItems.at(index.row()), -1);
+        to << (row < 0 ? QModelIndex() : this->index(row, index.column()));
+    }
+    changePersistentIndexList(from, to);
+    emit layoutChanged();
+}
+
+/*!
+ * \brief Notifies the view that the rows of the items changed.
+ *
+ * A single range is emitted, the view repaints the visible rows only.
+ */
+void QueueModel::updateItems(const QSet<IDownloadItem *> &items)
+{
+    auto first = std::numeric_limits<int>::max();
+    auto last = -1;
+    for (auto item : items) {
+        auto it = m_rows.constFind(item);
+        if (it != m_rows.constEnd()) {
+            first = qMin(first, it.value());
+            last = qMax(last, it.value());
+        }
+    }
+    if (last < 0) {
+        return;
+    }
+    emit dataChanged(index(first, 0), index(last, columnCount() - 1));
+}
+
+void QueueModel::updateAll()
+{
+    if (m_items.isEmpty()) {
+        return;
+    }
+    emit dataChanged(index(0, 0), index(rowCount() - 1, columnCount() - 1));
 }
 
 /******************************************************************************
@@ -403,18 +650,17 @@ DownloadQueueView::DownloadQueueView(QWidget *parent) : QWidget(parent)
     m_queueView->setRootIsDecorated(false);
     m_queueView->setMidLineWidth(3);
 
-    setColumnWidths(QList<int>());
-
     // Edit with second click
     m_queueView->setEditTriggers(QAbstractItemView::SelectedClicked);
 
-    connect(m_queueView, SIGNAL(itemSelectionChanged()), this, SLOT(onQueueViewItemSelectionChanged()));
+    connect(m_queueView->selectionModel(), SIGNAL(selectionChanged(QItemSelection,QItemSelection)),
+            this, SLOT(onQueueViewItemSelectionChanged()));
     connect(m_queueView, SIGNAL(doubleClicked(QModelIndex)), this, SLOT(onQueueViewDoubleClicked(QModelIndex)));
 
     connect(m_queueView->itemDelegate(), SIGNAL(commitData(QWidget*)), this, SLOT(onQueueItemCommitData(QWidget*)));
 
     // Drag-n-Drop
-    connect(m_queueView, SIGNAL(dropped(QueueItem*)), this, SLOT(onQueueItemDropped(QueueItem*)));
+    connect(m_queueView, SIGNAL(dropped(IDownloadItem*)), this, SLOT(onQueueItemDropped(IDownloadItem*)));
 
     auto layout = new QGridLayout(this);
     layout->addWidget(m_queueView);
@@ -423,6 +669,8 @@ DownloadQueueView::DownloadQueueView(QWidget *parent) : QWidget(parent)
     this->setLayout(layout);
 
     retranslateUi();
+
+    setColumnWidths(QList<int>());
 }
 
 /******************************************************************************
@@ -481,7 +729,7 @@ bool DownloadQueueView::restoreState(const QByteArray &state, int version)
 QList<int> DownloadQueueView::columnWidths() const
 {
     QList<int> widths;
-    for (int column = 0, count = m_queueView->columnCount(); column < count; ++column) {
+    for (int column = 0, count = m_queueView->model()->columnCount(); column < count; ++column) {
         auto width = m_queueView->columnWidth(column);
         widths.append(width);
     }
@@ -495,7 +743,7 @@ static int defaultColumnWidth(int index)
 
 void DownloadQueueView::setColumnWidths(const QList<int> &widths)
 {
-    for (int column = 0, count = m_queueView->columnCount(); column < count; ++column) {
+    for (int column = 0, count = m_queueView->model()->columnCount(); column < count; ++column) {
         if (column < widths.count()) {
             auto width = widths.at(column);
             m_queueView->setColumnWidth(column, width);
@@ -509,10 +757,11 @@ void DownloadQueueView::setColumnWidths(const QList<int> &widths)
  ******************************************************************************/
 void DownloadQueueView::rename()
 {
-    if (!m_queueView->selectedItems().isEmpty()) {
-        auto treeItem = m_queueView->selectedItems().first();
-        m_queueView->setCurrentItem(treeItem, COL_0_FILE_NAME);
-        m_queueView->editItem(treeItem, COL_0_FILE_NAME);
+    auto rows = m_queueView->selectionModel()->selectedRows(COL_0_FILE_NAME);
+    if (!rows.isEmpty()) {
+        auto index = rows.first();
+        m_queueView->selectionModel()->setCurrentIndex(index, QItemSelectionModel::NoUpdate);
+        m_queueView->edit(index);
     }
 }
 
@@ -534,8 +783,10 @@ void DownloadQueueView::setEngine(DownloadEngine *downloadEngine)
           SLOT(onJobAdded(DownloadRange)) },
         { SIGNAL(jobRemoved(DownloadRange)),
           SLOT(onJobRemoved(DownloadRange)) },
-        { SIGNAL(jobStateChanged(IDownloadItem*)),
-          SLOT(onJobStateChanged(IDownloadItem*)) },
+        { SIGNAL(jobReplaced(DownloadRange,DownloadRange)),
+          SLOT(onJobReplaced(DownloadRange,DownloadRange)) },
+        { SIGNAL(jobsChanged(QSet<IDownloadItem*>)),
+          SLOT(onJobsChanged(QSet<IDownloadItem*>)) },
         { SIGNAL(selectionChanged()),
           SLOT(onSelectionChanged()) },
         { SIGNAL(sortChanged()),
@@ -586,15 +837,8 @@ void DownloadQueueView::retranslateUi()
             << tr("Est. time")      /* Hidden by default */
             << tr("Speed")          /* Hidden by default */
                ;
-    m_queueView->setHeaderLabels(headers);
-
-    for (auto index = 0; index < m_queueView->topLevelItemCount(); ++index) {
-        auto treeItem = m_queueView->topLevelItem(index);
-        auto queueItem = dynamic_cast<QueueItem *>(treeItem);
-        if (queueItem) {
-            queueItem->updateItem();
-        }
-    }
+    m_queueView->queueModel()->setHeaders(headers);
+    m_queueView->queueModel()->updateAll();
 }
 
 void DownloadQueueView::restylizeUi()
@@ -610,34 +854,26 @@ void DownloadQueueView::restylizeUi()
  ******************************************************************************/
 void DownloadQueueView::onJobAdded(const DownloadRange &range)
 {
-    for (auto item : range) {
-        auto downloadItem = dynamic_cast<AbstractDownloadItem*>(item);
-        auto queueItem = new QueueItem(downloadItem, m_queueView);
-        m_queueView->addTopLevelItem(queueItem);
-    }
+    m_queueView->queueModel()->appendItems(range);
 }
 
 void DownloadQueueView::onJobRemoved(const DownloadRange &range)
 {
-    for (auto item : range) {
-        auto index = getIndex(item);
-        if (index >= 0) {
-            auto treeItem = m_queueView->takeTopLevelItem(index);
-            auto queueItem = dynamic_cast<QueueItem*>(treeItem);
-            Q_ASSERT(queueItem);
-            if (queueItem) {
-                queueItem->deleteLater();
-            }
-        }
-    }
+    m_queueView->queueModel()->removeItems(range);
 }
 
-void DownloadQueueView::onJobStateChanged(IDownloadItem *item)
+void DownloadQueueView::onJobReplaced(const DownloadRange &before, const DownloadRange &after)
 {
-    auto queueItem = getQueueItem(item);
-    if (queueItem) {
-        queueItem->updateItem();
-    }
+    m_queueView->queueModel()->replaceItems(before, after);
+}
+
+/*!
+ * \brief Updates the rows of the changed items only.
+ * The view repaints the rows that are visible.
+ */
+void DownloadQueueView::onJobsChanged(const QSet<IDownloadItem *> &items)
+{
+    m_queueView->queueModel()->updateItems(items);
 }
 
 /******************************************************************************
@@ -647,78 +883,36 @@ void DownloadQueueView::onSelectionChanged()
     const QSignalBlocker blocker(m_downloadEngine);
     m_downloadEngine->beginSelectionChange();
 
-    auto selection = m_downloadEngine->selection();
-    for (auto index = 0; index < m_queueView->topLevelItemCount(); ++index) {
-        auto treeItem = m_queueView->topLevelItem(index);
-        auto queueItem = dynamic_cast<const QueueItem *>(treeItem);
-        auto isSelected = selection.contains(queueItem->downloadItem());
-        treeItem->setSelected(isSelected);
+    QItemSelection itemSelection;
+    for (auto item : m_downloadEngine->selection()) {
+        auto index = m_queueView->queueModel()->indexOf(item);
+        if (index.isValid()) {
+            itemSelection.select(index, index);
+        }
     }
+    m_queueView->selectionModel()->select(
+                itemSelection, QItemSelectionModel::ClearAndSelect | QItemSelectionModel::Rows);
 
     m_downloadEngine->endSelectionChange();
 }
 
+/*!
+ * \brief Reorders the rows. The selection and the current row
+ * follow their items.
+ */
 void DownloadQueueView::onSortChanged()
 {
-    // Save selection and current item
-    auto currentItem = m_queueView->currentItem();
-    auto selection = m_downloadEngine->selection();
-
-    auto items = m_downloadEngine->downloadItems();
-    for (auto i = 0; i < items.size(); ++i) {
-        auto downloadItem = items.at(i);
-        auto index = getIndex(downloadItem);
-        if (index != -1) {
-            // Rem: takeTopLevelItem() changes the selection
-            auto treeItem =  m_queueView->takeTopLevelItem(index);
-            if (treeItem) {
-                m_queueView->insertTopLevelItem(static_cast<int>(i), treeItem);
-            }
-        }
-    }
-    // Restore selection and current item
-    m_queueView->setCurrentItem(currentItem);
-    m_downloadEngine->setSelection(selection);
-}
-
-/******************************************************************************
- ******************************************************************************/
-int DownloadQueueView::getIndex(IDownloadItem *downloadItem) const
-{
-    for (auto index = 0; index < m_queueView->topLevelItemCount(); ++index) {
-        auto treeItem = m_queueView->topLevelItem(index);
-        if (treeItem->type() == QTreeWidgetItem::UserType) {
-            auto queueItem = dynamic_cast<const QueueItem *>(treeItem);
-            if (queueItem && downloadItem && queueItem->downloadItem() == downloadItem) {
-                return index;
-            }
-        }
-    }
-    return -1;
-}
-
-QueueItem* DownloadQueueView::getQueueItem(IDownloadItem *downloadItem)
-{
-    auto index = getIndex(downloadItem);
-    if (index >= 0) {
-        auto treeItem = m_queueView->topLevelItem(index);
-        if (treeItem->type() == QTreeWidgetItem::UserType) {
-            auto queueItem = dynamic_cast<QueueItem *>(treeItem);
-            if (queueItem && queueItem->downloadItem() == downloadItem) {
-                return queueItem;
-            }
-        }
-    }
-    return nullptr;
+    m_queueView->queueModel()->sortItems(m_downloadEngine->downloadItems());
 }
 
 /******************************************************************************
  ******************************************************************************/
 void DownloadQueueView::onQueueViewDoubleClicked(const QModelIndex &index)
 {
-    auto treeItem = m_queueView->itemFromIndex(index);
-    auto queueItem = dynamic_cast<const QueueItem *>(treeItem);
-    emit doubleClicked(queueItem->downloadItem());
+    auto downloadItem = m_queueView->queueModel()->downloadItem(index);
+    if (downloadItem) {
+        emit doubleClicked(downloadItem);
+    }
 }
 
 /*!
@@ -727,9 +921,8 @@ void DownloadQueueView::onQueueViewDoubleClicked(const QModelIndex &index)
 void DownloadQueueView::onQueueViewItemSelectionChanged()
 {
     QList<IDownloadItem *> selection;
-    for (auto treeItem : m_queueView->selectedItems()) {
-        auto queueItem = dynamic_cast<const QueueItem *>(treeItem);
-        selection << queueItem->downloadItem();
+    for (auto downloadItem : m_queueView->selectedDownloadItems()) {
+        selection << downloadItem;
     }
     m_downloadEngine->setSelection(selection);
 }
@@ -749,20 +942,19 @@ void DownloadQueueView::onQueueItemCommitData(QWidget *editor)
             newName = newName.left(pos);
         }
 
-        auto treeItem = m_queueView->currentItem();
-        auto queueItem = dynamic_cast<QueueItem *>(treeItem);
-        auto downloadItem = queueItem->downloadItem();
-
-        downloadItem->rename(newName);
-        queueItem->updateItem();
+        auto downloadItem = m_queueView->queueModel()->downloadItem(m_queueView->currentIndex());
+        if (downloadItem) {
+            downloadItem->rename(newName);
+            m_queueView->queueModel()->updateItems({ downloadItem });
+        }
     }
 }
 
-void DownloadQueueView::onQueueItemDropped(QueueItem *queueItem)
+void DownloadQueueView::onQueueItemDropped(IDownloadItem *item)
 {
-    if (queueItem) {
+    if (item) {
         QList<IDownloadItem*> items;
-        items << queueItem->downloadItem();
+        items << item;
         m_downloadEngine->remove(items);
     }
 }
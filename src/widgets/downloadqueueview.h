@@ -21,10 +21,10 @@
 
 #include <QtWidgets/QWidget>
 #include <QtCore/QModelIndex>
+#include <QtCore/QSet>
 
 using DownloadRange = QList<IDownloadItem *>;
 class DownloadEngine;
-class QueueItem;
 class QueueView;
 
 class QMenu;
@@ -59,14 +59,15 @@ protected slots:
 private slots:
     void onJobAdded(const DownloadRange &range);
     void onJobRemoved(const DownloadRange &range);
-    void onJobStateChanged(IDownloadItem *item);
+    void onJobReplaced(const DownloadRange &before, const DownloadRange &after);
+    void onJobsChanged(const QSet<IDownloadItem *> &items);
     void onSelectionChanged();
     void onSortChanged();
 
     void onQueueViewDoubleClicked(const QModelIndex &index);
     void onQueueViewItemSelectionChanged();
     void onQueueItemCommitData(QWidget *editor);
-    void onQueueItemDropped(QueueItem *queueItem);
+    void onQueueItemDropped(IDownloadItem *item);
 
     void showContextMenu(const QPoint &pos) ;
 
@@ -80,9 +81,6 @@ private:
 
     QList<int> columnWidths() const;
     void setColumnWidths(const QList<int> &widths);
-
-    int getIndex(IDownloadItem *downloadItem) const;
-    QueueItem* getQueueItem(IDownloadItem *downloadItem);
 };
 
 #endif // WIDGETS_DOWNLOAD_QUEUE_VIEW_H
@@ -19,37 +19,67 @@
 
 #include "downloadqueueview.h"
 
-#include <QtWidgets/QTreeWidget>
-#include <QtWidgets/QTreeWidgetItem>
+#include <QtCore/QAbstractTableModel>
+#include <QtCore/QHash>
+#include <QtWidgets/QTreeView>
 
 class AbstractDownloadItem;
 
-class QueueItem : public QObject, public QTreeWidgetItem
+/*!
+ * QueueModel exposes the items of the engine's queue as rows.
+ *
+ * The model stores only the pointers to the items, and an index
+ * of their rows. The cells are formatted on demand in data(),
+ * so only the visible rows are formatted and painted by the view.
+ *
+ * A row can be a record of the queue file, that isn't an
+ * AbstractDownloadItem: its cells are read from the record.
+ */
+class QueueModel : public QAbstractTableModel
 {
     Q_OBJECT
 public:
-    enum ProgressBar {
-        StateRole = Qt::UserRole + 1,
-        ProgressRole
+    enum Role {
+        StateRole = Qt::UserRole + 1, ///< The state of the item. (int)
+        ProgressRole ///< The progress value. (int, between -1 and 100)
     };
 
-    explicit QueueItem(AbstractDownloadItem *downloadItem, QTreeWidget *view);
+    explicit QueueModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
 
-    AbstractDownloadItem* downloadItem() const { return m_downloadItem; }
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
 
-public slots:
-    void updateItem();
+    void setHeaders(const QStringList &headers);
+
+    IDownloadItem* item(const QModelIndex &index) const;
+    AbstractDownloadItem* downloadItem(const QModelIndex &index) const;
+    QModelIndex indexOf(IDownloadItem *item, int column = 0) const;
+
+    void appendItems(const DownloadRange &range);
+    void removeItems(const DownloadRange &range);
+    void replaceItems(const DownloadRange &before, const DownloadRange &after);
+    void sortItems(const DownloadRange &items);
+    void updateItems(const QSet<IDownloadItem *> &items);
+    void updateAll();
 
 private:
-    AbstractDownloadItem *m_downloadItem = nullptr;
+    QList<IDownloadItem *> m_items = {};
+    QHash<IDownloadItem *, int> m_rows = {};
+    QStringList m_headers = {};
+
+    void reindex(int first);
 };
 
 /******************************************************************************
  ******************************************************************************/
 /*!
- * QueueView extends QTreeWidget to allow drag and drop.
+ * QueueView extends QTreeView to allow drag and drop.
  */
-class QueueView : public QTreeWidget
+class QueueView : public QTreeView
 {
     friend class DownloadQueueView; /* To acceed protected members */
     Q_OBJECT
@@ -57,8 +87,10 @@ class QueueView : public QTreeWidget
 public:
     QueueView(QWidget *parent);
 
+    QueueModel* queueModel() const;
+
 signals:
-    void dropped(QueueItem *queueItem);
+    void dropped(IDownloadItem *item);
 
 protected:
     void mousePressEvent(QMouseEvent *event) override;
@@ -67,8 +99,8 @@ protected:
 private:
     QPoint dragStartPosition = {};
 
-    QList<QueueItem*> toQueueItem(const QList<QTreeWidgetItem*> &items) const;
-    QUrl urlFrom(const QueueItem *queueItem) const;
+    QList<IDownloadItem*> selectedDownloadItems() const;
+    QUrl urlFrom(const IDownloadItem *downloadItem) const;
 };
 
 #endif // WIDGETS_DOWNLOAD_QUEUE_VIEW_P_H
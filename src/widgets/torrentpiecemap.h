@@ -17,12 +17,12 @@
 #ifndef WIDGETS_TORRENT_PIECE_MAP_H
 #define WIDGETS_TORRENT_PIECE_MAP_H
 
-#include <QtCore/QBitArray>
 #include <QtCore/QReadWriteLock>
 #include <QtCore/QThread>
 #include <QtWidgets/QWidget>
 #include <QtWidgets/QGraphicsItem>
 
+#include <Core/PieceBitmap>
 #include <Core/Torrent>
 
 class QGraphicsScene;
@@ -38,9 +38,9 @@ class TorrentPieceItem;
 struct TorrentPieceData
 {
     qint64 size = 0;
-    QBitArray availablePieces = {};
-    QBitArray downloadedPieces = {};
-    QBitArray verifiedPieces = {};
+    PieceBitmap availablePieces = {};
+    PieceBitmap downloadedPieces = {};
+    PieceBitmap verifiedPieces = {};
     QVector<int> pieceAvailability = {};
     QVector<TorrentFileInfo::Priority> piecePriority = {};
 };
@@ -308,6 +308,9 @@ void TorrentWidget::setTorrentContext(TorrentBaseContext *torrentContext)
 void TorrentWidget::clear()
 {
     m_torrent = nullptr;
+    if (m_torrentContext) {
+        m_torrentContext->setInspectedTorrent(nullptr);
+    }
     resetUi();
 }
 
@@ -336,6 +339,9 @@ void TorrentWidget::setTorrent(Torrent *torrent)
     if (m_torrent) {
         connect(m_torrent, &Torrent::changed, this, &TorrentWidget::onChanged);
     }
+    if (m_torrentContext) {
+        m_torrentContext->setInspectedTorrent(m_torrent);
+    }
     resetUi();
 }
 
@@ -833,7 +839,7 @@ void TorrentWidget::updateProgressBar()
 {
     if (m_torrent && m_torrent->progress() >= 0) {
         ui->torrentProgressBar->setValue(m_torrent->progress());
-        ui->torrentProgressBar->setPieces(m_torrent->info().downloadedPieces);
+        ui->torrentProgressBar->setPieces(m_torrent->info().downloadedPieces.toBitArray());
     } else {
         ui->torrentProgressBar->setValue(0);
         ui->torrentProgressBar->clearPieces();
@@ -0,0 +1,170 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <Core/BandwidthLimiter>
+
+#include <QtCore/QDebug>
+#include <QtTest/QtTest>
+
+class tst_BandwidthLimiter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void unlimited();
+    void refill();
+    void refill_fraction();
+    void debt();
+    void refund();
+
+    void parseSchedule_data();
+    void parseSchedule();
+    void contains();
+};
+
+/******************************************************************************
+******************************************************************************/
+void tst_BandwidthLimiter::unlimited()
+{
+    TokenBucket target;
+    QVERIFY(!target.isLimited());
+    target.refill(0);
+    target.consume(1000);
+    target.refill(1000);
+    QCOMPARE(target.rate(), qint64(0));
+}
+
+void tst_BandwidthLimiter::refill()
+{
+    TokenBucket target(1000);
+    QVERIFY(target.isLimited());
+
+    target.refill(0); // full
+    QCOMPARE(target.tokens(), target.capacity());
+
+    target.consume(target.capacity());
+    QCOMPARE(target.tokens(), qint64(0));
+
+    target.refill(100);
+    QCOMPARE(target.tokens(), qint64(100));
+
+    target.refill(100000); // never above the capacity
+    QCOMPARE(target.tokens(), target.capacity());
+}
+
+void tst_BandwidthLimiter::refill_fraction()
+{
+    TokenBucket target(100); // 1 token every 10 msecs
+    target.refill(0);
+    target.consume(target.capacity());
+
+    /* The fractions of token are not lost */
+    for (qint64 now = 1; now <= 1000; ++now) {
+        target.refill(now);
+    }
+    QCOMPARE(target.tokens(), target.capacity());
+
+    target.consume(target.capacity());
+    for (qint64 now = 1001; now <= 1100; ++now) {
+        target.refill(now);
+    }
+    QCOMPARE(target.tokens(), qint64(10));
+}
+
+void tst_BandwidthLimiter::debt()
+{
+    TokenBucket target(1000);
+    target.refill(0);
+    target.consume(target.capacity() + 500);
+    QCOMPARE(target.tokens(), qint64(-500));
+
+    target.refill(600);
+    QCOMPARE(target.tokens(), qint64(100));
+}
+
+void tst_BandwidthLimiter::refund()
+{
+    TokenBucket target(1000);
+    target.refill(0);
+    target.consume(target.capacity());
+    target.refund(300);
+    QCOMPARE(target.tokens(), qint64(300));
+
+    target.refund(target.capacity()); // never above the capacity
+    QCOMPARE(target.tokens(), target.capacity());
+
+    TokenBucket unlimited;
+    unlimited.refund(300);
+    QCOMPARE(unlimited.tokens(), qint64(0));
+}
+
+/******************************************************************************
+******************************************************************************/
+void tst_BandwidthLimiter::parseSchedule_data()
+{
+    QTest::addColumn<QString>("input");
+    QTest::addColumn<int>("count");
+    QTest::addColumn<qint64>("firstLimit");
+
+    QTest::newRow("empty") << QString() << 0 << qint64(0);
+    QTest::newRow("one") << "08:00-18:00=512" << 1 << qint64(512 * 1024);
+    QTest::newRow("two") << "08:00-18:00=512; 22:00-06:00=0" << 2 << qint64(512 * 1024);
+    QTest::newRow("lines") << "8:00-18:00=16\n22:00-6:00=0\n" << 2 << qint64(16 * 1024);
+    QTest::newRow("invalid time") << "08:00-25:00=512" << 0 << qint64(0);
+    QTest::newRow("invalid limit") << "08:00-18:00=fast" << 0 << qint64(0);
+    QTest::newRow("negative") << "08:00-18:00=-1" << 0 << qint64(0);
+    QTest::newRow("garbage") << "hello; 08:00-18:00=1" << 1 << qint64(1024);
+}
+
+void tst_BandwidthLimiter::parseSchedule()
+{
+    QFETCH(QString, input);
+    QFETCH(int, count);
+    QFETCH(qint64, firstLimit);
+
+    auto actual = BandwidthLimiter::parseSchedule(input);
+
+    QCOMPARE(actual.count(), qsizetype(count));
+    if (count > 0) {
+        QCOMPARE(actual.first().limit, firstLimit);
+    }
+}
+
+void tst_BandwidthLimiter::contains()
+{
+    auto periods = BandwidthLimiter::parseSchedule("08:00-18:00=512; 22:00-06:00=0");
+    QCOMPARE(periods.count(), qsizetype(2));
+
+    auto day = periods.at(0);
+    QVERIFY(!day.contains(QTime(7, 59)));
+    QVERIFY(day.contains(QTime(8, 0)));
+    QVERIFY(day.contains(QTime(17, 59)));
+    QVERIFY(!day.contains(QTime(18, 0)));
+
+    auto night = periods.at(1);
+    QVERIFY(night.contains(QTime(23, 0)));
+    QVERIFY(night.contains(QTime(0, 0)));
+    QVERIFY(night.contains(QTime(5, 59)));
+    QVERIFY(!night.contains(QTime(6, 0)));
+    QVERIFY(!night.contains(QTime(12, 0)));
+}
+
+/******************************************************************************
+ ******************************************************************************/
+QTEST_APPLESS_MAIN(tst_BandwidthLimiter)
+
+#include "tst_bandwidthlimiter.moc"
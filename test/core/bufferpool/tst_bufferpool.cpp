@@ -0,0 +1,103 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Core/BufferPool>
+
+#include <QtCore/QDebug>
+#include <QtTest/QtTest>
+
+class tst_BufferPool : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void acquire();
+    void reuse();
+    void reuseShared();
+    void steadyState();
+};
+
+/******************************************************************************
+******************************************************************************/
+void tst_BufferPool::acquire()
+{
+    BufferPool target(1024);
+    auto buffer = target.acquire();
+    QCOMPARE(buffer.size(), qsizetype(1024));
+    QVERIFY(buffer.isDetached());
+    QCOMPARE(target.acquisitionCount(), qint64(1));
+    QCOMPARE(target.allocationCount(), qint64(1));
+}
+
+void tst_BufferPool::reuse()
+{
+    BufferPool target(1024);
+    auto buffer = target.acquire();
+    auto data = buffer.constData();
+    buffer.resize(10);
+    target.release(buffer);
+    buffer = QByteArray();
+
+    auto actual = target.acquire();
+    QCOMPARE(actual.size(), qsizetype(1024));
+    QCOMPARE(actual.constData(), data);
+    QCOMPARE(target.allocationCount(), qint64(1));
+}
+
+void tst_BufferPool::reuseShared()
+{
+    BufferPool target(1024);
+    auto buffer = target.acquire();
+    auto reader = buffer; // e.g. queued in the DiskWriter
+    target.release(buffer);
+    buffer = QByteArray();
+
+    /* The buffer is still read: don't reuse it */
+    auto other = target.acquire();
+    QVERIFY(other.constData() != reader.constData());
+    QCOMPARE(target.allocationCount(), qint64(2));
+    target.release(other);
+    other = QByteArray();
+
+    /* The reader is done */
+    reader = QByteArray();
+    target.acquire();
+    target.acquire();
+    QCOMPARE(target.allocationCount(), qint64(2));
+}
+
+void tst_BufferPool::steadyState()
+{
+    BufferPool target(1024);
+    QList<QByteArray> readers;
+    for (int i = 0; i < 1000; ++i) {
+        auto buffer = target.acquire();
+        buffer.resize(512);
+        readers.append(buffer);
+        target.release(buffer);
+        if (readers.size() > 4) {
+            readers.removeFirst();
+        }
+    }
+    QCOMPARE(target.acquisitionCount(), qint64(1000));
+    QVERIFY(target.allocationCount() <= 6);
+}
+
+/******************************************************************************
+ ******************************************************************************/
+QTEST_APPLESS_MAIN(tst_BufferPool)
+
+#include "tst_bufferpool.moc"
@@ -0,0 +1,315 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <Core/DiskWriter>
+
+#include <Constants>
+
+#include <QtCore/QDebug>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSemaphore>
+#include <QtCore/QTemporaryFile>
+#include <QtTest/QSignalSpy>
+#include <QtTest/QtTest>
+
+class tst_DiskWriter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void cleanup();
+
+    void coalesce();
+    void coalesceBufferCount();
+    void congestion();
+    void drained();
+    void closeAfterWrites();
+    void closeAfterFailedWrite();
+
+private:
+    QTemporaryFile m_gateFile;
+    QSemaphore m_entered;
+    QSemaphore m_released;
+    bool m_isBlocked = false;
+
+    void blockWriter();
+    void unblockWriter();
+};
+
+/******************************************************************************
+ ******************************************************************************/
+static QByteArray readAll(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    return file.readAll();
+}
+
+/*!
+ * Blocks the writer thread in a task, so that the next writes stay in the queue.
+ */
+void tst_DiskWriter::blockWriter()
+{
+    QVERIFY(m_gateFile.isOpen() || m_gateFile.open());
+    DiskWriter::getInstance().close(m_gateFile.handle(), [this](bool) {
+        m_entered.release();
+        m_released.acquire();
+        return true;
+    });
+    m_entered.acquire();
+    m_isBlocked = true;
+}
+
+void tst_DiskWriter::unblockWriter()
+{
+    if (m_isBlocked) {
+        m_isBlocked = false;
+        m_released.release();
+    }
+}
+
+void tst_DiskWriter::cleanup()
+{
+    unblockWriter(); /* Even if the test failed */
+}
+
+/******************************************************************************
+ ******************************************************************************/
+void tst_DiskWriter::coalesce()
+{
+    // Given
+    auto &target = DiskWriter::getInstance();
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    auto handle = file.handle();
+    const qint64 size = WRITE_CHUNK_SIZE / WRITE_CHUNK_BUFFERS;
+    blockWriter();
+
+    // When
+    for (int i = 0; i < WRITE_CHUNK_BUFFERS; ++i) {
+        QVERIFY(target.write(handle, i * size, QByteArray(size, char('a' + i))));
+    }
+
+    // Then
+    /* The contiguous writes become one write of WRITE_CHUNK_SIZE */
+    QCOMPARE(target.queuedWriteCount(), qsizetype(1));
+
+    // When
+    QVERIFY(target.write(handle, WRITE_CHUNK_SIZE, QByteArray(size, 'y')));
+
+    // Then
+    QCOMPARE(target.queuedWriteCount(), qsizetype(2));
+
+    // When
+    /* Not contiguous */
+    QVERIFY(target.write(handle, 2 * WRITE_CHUNK_SIZE, QByteArray(size, 'z')));
+
+    // Then
+    QCOMPARE(target.queuedWriteCount(), qsizetype(3));
+
+    // When
+    unblockWriter();
+
+    // Then
+    QVERIFY(target.flush(handle));
+    QCOMPARE(target.queuedWriteCount(), qsizetype(0));
+    auto content = readAll(file.fileName());
+    QCOMPARE(content.size(), qsizetype(2 * WRITE_CHUNK_SIZE + size));
+    for (int i = 0; i < WRITE_CHUNK_BUFFERS; ++i) {
+        QCOMPARE(content.mid(i * size, size), QByteArray(size, char('a' + i)));
+    }
+    QCOMPARE(content.mid(WRITE_CHUNK_SIZE, size), QByteArray(size, 'y'));
+    QCOMPARE(content.mid(WRITE_CHUNK_SIZE + size, WRITE_CHUNK_SIZE - size), QByteArray(WRITE_CHUNK_SIZE - size, '\0'));
+    QCOMPARE(content.mid(2 * WRITE_CHUNK_SIZE, size), QByteArray(size, 'z'));
+}
+
+void tst_DiskWriter::coalesceBufferCount()
+{
+    // Given
+    auto &target = DiskWriter::getInstance();
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    auto handle = file.handle();
+    blockWriter();
+
+    // When
+    /* Tiny chunks: the number of buffers of a write is limited */
+    for (int i = 0; i < WRITE_CHUNK_BUFFERS + 1; ++i) {
+        QVERIFY(target.write(handle, i, QByteArray(1, char('a' + i))));
+    }
+
+    // Then
+    QCOMPARE(target.queuedWriteCount(), qsizetype(2));
+
+    // When
+    unblockWriter();
+
+    // Then
+    QVERIFY(target.flush(handle));
+    QByteArray expected;
+    for (int i = 0; i < WRITE_CHUNK_BUFFERS + 1; ++i) {
+        expected.append(char('a' + i));
+    }
+    QCOMPARE(readAll(file.fileName()), expected);
+}
+
+void tst_DiskWriter::congestion()
+{
+    // Given
+    auto &target = DiskWriter::getInstance();
+    QTemporaryFile file1;
+    QTemporaryFile file2;
+    QTemporaryFile file3;
+    QVERIFY(file1.open());
+    QVERIFY(file2.open());
+    QVERIFY(file3.open());
+    const QByteArray block(WRITE_CHUNK_SIZE, 'x'); /* shared by the writes */
+    const auto blockCount1 = (WRITE_QUEUE_MAX_SIZE - WRITE_QUEUE_RESUME_SIZE) / WRITE_CHUNK_SIZE;
+    const auto blockCount2 = WRITE_QUEUE_RESUME_SIZE / WRITE_CHUNK_SIZE;
+    QSignalSpy spyDrained(&target, SIGNAL(drained()));
+    blockWriter();
+
+    // When
+    for (qint64 i = 0; i < blockCount1; ++i) {
+        QVERIFY(target.write(file1.handle(), i * WRITE_CHUNK_SIZE, block));
+    }
+    for (qint64 i = 0; i < blockCount2; ++i) {
+        QVERIFY(target.write(file2.handle(), i * WRITE_CHUNK_SIZE, block));
+    }
+
+    // Then
+    /* WRITE_QUEUE_MAX_SIZE exactly */
+    QVERIFY(!target.isCongested());
+
+    // When
+    QVERIFY(target.write(file3.handle(), 0, QByteArray("z")));
+
+    // Then
+    QVERIFY(target.isCongested());
+
+    // When
+    target.discard(file1.handle());
+
+    // Then
+    /* WRITE_QUEUE_RESUME_SIZE + 1 byte */
+    QVERIFY(target.isCongested());
+
+    // When
+    target.discard(file3.handle());
+
+    // Then
+    QVERIFY(!target.isCongested());
+    QVERIFY(spyDrained.wait(5000));
+    QCOMPARE(spyDrained.count(), 1);
+
+    unblockWriter();
+    QVERIFY(target.flush(file2.handle()));
+    QCOMPARE(QFileInfo(file2.fileName()).size(), WRITE_QUEUE_RESUME_SIZE);
+    QCOMPARE(QFileInfo(file1.fileName()).size(), qint64(0));
+}
+
+void tst_DiskWriter::drained()
+{
+    // Given
+    auto &target = DiskWriter::getInstance();
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    const QByteArray block(WRITE_CHUNK_SIZE, 'x');
+    const auto blockCount = WRITE_QUEUE_MAX_SIZE / WRITE_CHUNK_SIZE + 1;
+    QSignalSpy spyDrained(&target, SIGNAL(drained()));
+    blockWriter();
+    for (qint64 i = 0; i < blockCount; ++i) {
+        QVERIFY(target.write(file.handle(), i * WRITE_CHUNK_SIZE, block));
+    }
+    QVERIFY(target.isCongested());
+
+    // When
+    unblockWriter();
+
+    // Then
+    QVERIFY(spyDrained.wait(10000));
+    QCOMPARE(spyDrained.count(), 1);
+    QVERIFY(!target.isCongested());
+    QVERIFY(target.flush(file.handle()));
+    QCOMPARE(QFileInfo(file.fileName()).size(), blockCount * WRITE_CHUNK_SIZE);
+}
+
+void tst_DiskWriter::closeAfterWrites()
+{
+    // Given
+    auto &target = DiskWriter::getInstance();
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    auto fileName = file.fileName();
+    QObject context;
+    auto isDone = false;
+    auto result = false;
+    qint64 sizeAtClose = -1;
+    blockWriter();
+    QVERIFY(target.write(file.handle(), 0, QByteArray("data")));
+
+    // When
+    auto ticket = target.close(file.handle(), [&](bool written) {
+        sizeAtClose = QFileInfo(fileName).size();
+        return written;
+    }, &context, [&](bool ok) {
+        isDone = true;
+        result = ok;
+    });
+    unblockWriter();
+    target.waitForClosed(ticket);
+
+    // Then
+    /* The task runs after the queued writes of its file */
+    QCOMPARE(sizeAtClose, qint64(4));
+    QVERIFY(!isDone); /* Called back in the main thread */
+    QTRY_VERIFY(isDone);
+    QVERIFY(result);
+}
+
+void tst_DiskWriter::closeAfterFailedWrite()
+{
+    // Given
+    auto &target = DiskWriter::getInstance();
+    QTemporaryFile temporary;
+    QVERIFY(temporary.open());
+    QFile file(temporary.fileName());
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    auto isWritten = true;
+
+    // When
+    QVERIFY(target.write(file.handle(), 0, QByteArray("data")));
+    auto ticket = target.close(file.handle(), [&](bool written) {
+        isWritten = written;
+        return written;
+    });
+    target.waitForClosed(ticket);
+
+    // Then
+    QVERIFY(!isWritten);
+}
+
+/******************************************************************************
+ ******************************************************************************/
+/*
+ * QSignalSpy::wait() requires QTEST_MAIN instead of QTEST_APPLESS_MAIN,
+ * otherwise we get QEventLoop: Cannot be used without QApplication
+ */
+QTEST_MAIN(tst_DiskWriter)
+
+#include "tst_diskwriter.moc"
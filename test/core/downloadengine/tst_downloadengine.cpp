@@ -20,6 +20,7 @@
 #include <Core/DownloadEngine>
 
 #include <QtCore/QDebug>
+#include <QtCore/QElapsedTimer>
 #include <QtCore/QUrl>
 
 #include <QtTest/QSignalSpy>
@@ -36,6 +37,12 @@ private slots:
     void initTestCase();
 
     void append();
+    void tick();
+    void jobsChanged();
+    void statistics();
+    void scheduler();
+    void schedulerAfterMove();
+    void schedulerPerHost();
 
     void do_not_move();
     void moveCurrentTop();
@@ -48,6 +55,7 @@ void tst_DownloadEngine::initTestCase()
 {
     qRegisterMetaType<IDownloadItem*>("IDownloadItem*");
     qRegisterMetaType<DownloadRange>("DownloadRange");
+    qRegisterMetaType<QSet<IDownloadItem*>>("QSet<IDownloadItem*>");
 }
 
 /******************************************************************************
@@ -97,6 +105,80 @@ void tst_DownloadEngine::append()
     QCOMPARE(item->bytesTotal(), bytesTotal);
 }
 
+/******************************************************************************
+ ******************************************************************************/
+void tst_DownloadEngine::tick()
+{
+    // Given
+    QScopedPointer<DownloadEngine> target(new DownloadEngine(this));
+    QSignalSpy spyJobsChanged(target.data(), SIGNAL(jobsChanged(QSet<IDownloadItem*>)));
+    QSignalSpy spyJobFinished(target.data(), &DownloadEngine::jobFinished);
+
+    const qsizetype bytesTotal = 10*1024*1024;
+    const int count = 4;
+    QList<IDownloadItem*> items;
+    for (int i = 0; i < count; ++i) {
+        items.append(new FakeDownloadItem(
+                         QUrl(QString("http://www.example.com/%0.png").arg(i)),
+                         QString("%0.png").arg(i), bytesTotal, 50, 1500));
+    }
+
+    // When
+    QElapsedTimer elapsed;
+    elapsed.start();
+    target->append(items, true);
+    while (spyJobFinished.count() < count) {
+        QVERIFY(spyJobFinished.wait(5000));
+    }
+
+    // Then
+    /*
+     * One batch per tick (150 ms), whatever the number of running items,
+     * plus the batches of the state changes, when each item finishes
+     */
+    QVERIFY(spyJobsChanged.count() > 0);
+    QVERIFY(spyJobsChanged.count() <= elapsed.elapsed() / 150 + 1 + count);
+    auto changed = spyJobsChanged.first().at(0).value<QSet<IDownloadItem*>>();
+    QCOMPARE(changed.size(), qsizetype(count));
+
+    /* The timer stops with the downloads */
+    QTest::qWait(100);
+    spyJobsChanged.clear();
+    QTest::qWait(500);
+    QCOMPARE(spyJobsChanged.count(), 0);
+}
+
+void tst_DownloadEngine::jobsChanged()
+{
+    // Given
+    QScopedPointer<DownloadEngine> target(new DownloadEngine(this));
+    QSignalSpy spyJobStateChanged(target.data(), &DownloadEngine::jobStateChanged);
+    QSignalSpy spyJobsChanged(target.data(), SIGNAL(jobsChanged(QSet<IDownloadItem*>)));
+    QList<IDownloadItem*> items;
+    QList<FakeDownloadItem*> fakeItems;
+    for (int i = 0; i < 10; ++i) {
+        auto item = new FakeDownloadItem(QString("item %0").arg(i));
+        items.append(item);
+        fakeItems.append(item);
+    }
+
+    // When
+    target->append(items, false); // Paused
+    for (auto item : std::as_const(fakeItems)) {
+        item->setState(IDownloadItem::Stopped);
+        item->setState(IDownloadItem::Paused);
+    }
+
+    // Then
+    QCOMPARE(spyJobStateChanged.count(), 3 * items.count());
+    QCOMPARE(spyJobsChanged.count(), 0); // not yet
+    QVERIFY(spyJobsChanged.wait(1000));
+    QTest::qWait(100);
+    QCOMPARE(spyJobsChanged.count(), 1);
+    auto changed = spyJobsChanged.first().at(0).value<QSet<IDownloadItem*>>();
+    QCOMPARE(changed.size(), items.count());
+}
+
 /******************************************************************************
  ******************************************************************************/
 static void VERIFY_ORDER(const QScopedPointer<DownloadEngine> &engine, QList<int> indexes)
@@ -212,6 +294,170 @@ void tst_DownloadEngine::moveCurrentBottom()
     VERIFY_ORDER(target, QList<int>({0, 1, 3, 5, 8, 9, 2, 4, 6, 7}));
 }
 
+/******************************************************************************
+ ******************************************************************************/
+void tst_DownloadEngine::statistics()
+{
+    // Given
+    QScopedPointer<DownloadEngine> target(new DownloadEngine(this));
+    target->append(createDummyList(), false);
+    auto first = target->downloadItems().at(0);
+    auto second = target->downloadItems().at(1);
+
+    // Then
+    QCOMPARE(target->pausedJobCount(), qsizetype(10));
+    QCOMPARE(target->runningJobCount(), qsizetype(0));
+
+    // When
+    target->resume(first);
+
+    // Then
+    QCOMPARE(first->state(), IDownloadItem::Downloading);
+    QCOMPARE(target->pausedJobCount(), qsizetype(9));
+    QCOMPARE(target->runningJobCount(), qsizetype(1));
+    QCOMPARE(target->runningJobs(), QList<IDownloadItem*>({first}));
+
+    // When
+    target->pause(first);
+    target->cancel(second);
+
+    // Then
+    QCOMPARE(target->pausedJobCount(), qsizetype(9));
+    QCOMPARE(target->runningJobCount(), qsizetype(0));
+    QCOMPARE(target->failedJobCount(), qsizetype(1));
+    QCOMPARE(target->failedJobs(), QList<IDownloadItem*>({second}));
+
+    // When
+    target->remove({second});
+
+    // Then
+    QCOMPARE(target->count(), qsizetype(9));
+    QCOMPARE(target->failedJobCount(), qsizetype(0));
+    QCOMPARE(target->totalSpeed(), qreal(0));
+}
+
+void tst_DownloadEngine::scheduler()
+{
+    // Given
+    QScopedPointer<DownloadEngine> target(new DownloadEngine(this));
+    target->setMaxSimultaneousDownloads(1);
+    target->append(createDummyList(), false);
+    auto items = target->downloadItems();
+
+    // When
+    target->resume(items.at(0));
+    target->resume(items.at(7));
+    target->resume(items.at(8));
+
+    // Then
+    QCOMPARE(items.at(0)->state(), IDownloadItem::Downloading);
+    QCOMPARE(items.at(7)->state(), IDownloadItem::Idle);
+    QCOMPARE(items.at(8)->state(), IDownloadItem::Idle);
+
+    // When
+    select(target, QList<int>({8}));
+    target->moveCurrentTop();
+    target->pause(items.at(0));
+
+    // Then
+    QCOMPARE(items.at(8)->state(), IDownloadItem::Downloading);
+    QCOMPARE(items.at(7)->state(), IDownloadItem::Idle);
+    QCOMPARE(target->runningJobCount(), qsizetype(1));
+    QCOMPARE(target->waitingJobCount(), qsizetype(1));
+}
+
+void tst_DownloadEngine::schedulerAfterMove()
+{
+    // Given
+    QScopedPointer<DownloadEngine> target(new DownloadEngine(this));
+    target->setMaxSimultaneousDownloads(1);
+    target->append(createDummyList(), false);
+    auto items = target->downloadItems();
+    for (auto i = 0; i < 5; ++i) {
+        target->resume(items.at(i));
+    }
+
+    // When
+    select(target, QList<int>({3, 4}));
+    target->moveCurrentUp();
+    select(target, QList<int>({1}));
+    target->moveCurrentBottom();
+
+    // Then
+    VERIFY_ORDER(target, QList<int>({0, 3, 4, 2, 5, 6, 7, 8, 9, 1}));
+
+    /* The Idle items start in the new order of the queue */
+    for (auto i : QList<int>({0, 3, 4, 2})) {
+        QCOMPARE(items.at(i)->state(), IDownloadItem::Downloading);
+        target->pause(items.at(i));
+    }
+    QCOMPARE(items.at(1)->state(), IDownloadItem::Downloading);
+}
+
+void tst_DownloadEngine::schedulerPerHost()
+{
+    // Given
+    QScopedPointer<DownloadEngine> target(new DownloadEngine(this));
+    target->setMaxSimultaneousDownloads(3);
+    target->setMaxSimultaneousDownloadsPerHost(1);
+    const QList<QUrl> urls = {
+        QUrl("https://www.example.com/0.png"),
+        QUrl("https://www.example.com/1.png"),
+        QUrl("https://www.example.com/2.png"),
+        QUrl("https://cdn.example.com/3.png"),
+        QUrl("https://www.example.org/4.png")
+    };
+    QList<IDownloadItem*> items;
+    for (const auto &url : urls) {
+        auto item = new FakeDownloadItem();
+        item->setSourceUrl(url);
+        items.append(item);
+    }
+    target->append(items, false);
+
+    // When
+    for (auto item : items) {
+        target->resume(item);
+    }
+
+    // Then
+    QCOMPARE(items.at(0)->state(), IDownloadItem::Downloading);
+    QCOMPARE(items.at(1)->state(), IDownloadItem::Idle);
+    QCOMPARE(items.at(2)->state(), IDownloadItem::Idle);
+    QCOMPARE(items.at(3)->state(), IDownloadItem::Downloading);
+    QCOMPARE(items.at(4)->state(), IDownloadItem::Downloading);
+
+    // When
+    target->setLimitPerDomainEnabled(true);
+    target->pause(items.at(0));
+
+    // Then
+    QCOMPARE(items.at(1)->state(), IDownloadItem::Idle); // cdn.example.com is running
+    QCOMPARE(target->runningJobCount(), qsizetype(2));
+
+    // When
+    target->setLimitPerDomainEnabled(false);
+
+    // Then
+    QCOMPARE(items.at(1)->state(), IDownloadItem::Downloading);
+    QCOMPARE(items.at(2)->state(), IDownloadItem::Idle);
+    QCOMPARE(target->runningJobCount(), qsizetype(3));
+
+    // When
+    target->pause(items.at(4));
+
+    // Then
+    QCOMPARE(items.at(2)->state(), IDownloadItem::Idle); // www.example.com is running
+    QCOMPARE(target->runningJobCount(), qsizetype(2));
+
+    // When
+    target->setMaxSimultaneousDownloadsPerHost(2);
+
+    // Then
+    QCOMPARE(items.at(2)->state(), IDownloadItem::Downloading);
+    QCOMPARE(target->runningJobCount(), qsizetype(3));
+}
+
 /******************************************************************************
  ******************************************************************************/
 /*
@@ -0,0 +1,320 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../../utils/fakehttpserver.h"
+
+#include <Constants>
+#include <Core/DownloadManager>
+#include <Core/DownloadItem>
+#include <Core/File>
+#include <Core/ResourceItem>
+
+#include <QtCore/QDebug>
+#include <QtCore/QFile>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QTemporaryDir>
+#include <QtTest/QSignalSpy>
+#include <QtTest/QtTest>
+
+
+void hideQDebugMessage(QtMsgType, const QMessageLogContext &, const QString &)
+{
+    /*
+     * Do nothing: just hide QDebug messages,
+     * to diminish visual pollution in the test
+     */
+}
+
+class tst_DownloadItem : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase() {
+        qInstallMessageHandler(hideQDebugMessage);
+    }
+
+    void setPendingRanges_data();
+    void setPendingRanges();
+
+    void splitIntoSegments();
+    void resumePendingRanges();
+    void restartFromZero();
+    void rebalanceSegments();
+
+private:
+    QTemporaryDir m_tempDir;
+
+    inline DownloadItem *createJob(QSharedPointer<DownloadManager> downloadManager,
+                                   const QUrl &url, const QString &mask);
+};
+
+/******************************************************************************
+ ******************************************************************************/
+/**
+ * Helper function to create a content that can't be mistaken for a shifted copy
+ */
+static QByteArray createContent(qsizetype size)
+{
+    QByteArray ret(size, '\0');
+    for (qsizetype i = 0; i < size; ++i) {
+        ret[i] = static_cast<char>((i * 7 + i / 251) & 0xFF);
+    }
+    return ret;
+}
+
+static QByteArray readAll(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    return file.readAll();
+}
+
+DownloadItem *tst_DownloadItem::createJob(
+        QSharedPointer<DownloadManager> downloadManager,
+        const QUrl &url, const QString &mask)
+{
+    Q_ASSERT(m_tempDir.isValid());
+    ResourceItem* resource = new ResourceItem();
+    resource->setUrl(url.toString());
+    resource->setDestination(m_tempDir.path());
+    resource->setMask(mask);
+    DownloadItem *item = new DownloadItem(downloadManager.data());
+    item->setResource(resource);
+    return item;
+}
+
+/******************************************************************************
+ ******************************************************************************/
+void tst_DownloadItem::setPendingRanges_data()
+{
+    QTest::addColumn<QString>("input");
+    QTest::addColumn<QString>("expected");
+
+    QTest::newRow("empty") << QString() << QString();
+    QTest::newRow("one range") << QString("0-499") << QString("0-499");
+    QTest::newRow("open end") << QString("1000-") << QString("1000-");
+    QTest::newRow("several") << QString("0-499,1000-") << QString("0-499,1000-");
+    QTest::newRow("spaces") << QString(" 0 - 499 , 1000 - ") << QString("0-499,1000-");
+    QTest::newRow("single byte") << QString("42-42") << QString("42-42");
+    QTest::newRow("empty token") << QString("0-499,,1000-") << QString("0-499,1000-");
+    QTest::newRow("inverted") << QString("500-100,1000-") << QString("1000-");
+    QTest::newRow("no begin") << QString("-500,1000-") << QString("1000-");
+    QTest::newRow("negative") << QString("-1-500") << QString();
+    QTest::newRow("no dash") << QString("500") << QString();
+    QTest::newRow("garbage") << QString("abc-def,0-9") << QString("0-9");
+}
+
+void tst_DownloadItem::setPendingRanges()
+{
+    QFETCH(QString, input);
+    QFETCH(QString, expected);
+
+    // Given
+    QSharedPointer<DownloadManager> downloadManager(new DownloadManager(this));
+    QScopedPointer<DownloadItem> target(
+                createJob(downloadManager, QUrl("http://www.example.com/a.bin"), "*name*.*ext*"));
+
+    // When
+    target->setPendingRanges(input);
+
+    // Then
+    QCOMPARE(target->pendingRanges(), expected);
+
+    // When
+    target->setPendingRanges(target->pendingRanges());
+
+    // Then
+    QCOMPARE(target->pendingRanges(), expected);
+}
+
+/******************************************************************************
+ ******************************************************************************/
+void tst_DownloadItem::splitIntoSegments()
+{
+    // Given
+    auto size = 4 * MIN_CONNECTION_SEGMENT_SIZE;
+    auto content = createContent(size);
+    FakeHttpServer server(content);
+    QVERIFY(server.listen());
+
+    QSharedPointer<DownloadManager> downloadManager(new DownloadManager(this));
+    QScopedPointer<DownloadItem> target(
+                createJob(downloadManager, server.url("split.bin"), "*name*.*ext*"));
+    target->setMaxConnectionSegments(4);
+
+    QSignalSpy spyFinished(target.data(), SIGNAL(finished()));
+
+    // When
+    target->resume();
+
+    // Then
+    QVERIFY(spyFinished.wait(10000));
+    QCOMPARE(target->state(), DownloadItem::Completed);
+    QCOMPARE(target->bytesTotal(), size);
+    QCOMPARE(target->bytesReceived(), size);
+    QVERIFY(readAll(target->localFullFileName()) == content);
+
+    /* The first request has no range, the next ones split the rest of the file */
+    auto ranges = server.requestedRanges();
+    QCOMPARE(ranges.first(), QString());
+    QVERIFY(ranges.contains("bytes=1048576-2097151"));
+    QVERIFY(ranges.contains("bytes=2097152-3145727"));
+    QVERIFY(ranges.contains("bytes=3145728-4194303"));
+}
+
+void tst_DownloadItem::resumePendingRanges()
+{
+    // Given
+    auto size = 4 * MIN_CONNECTION_SEGMENT_SIZE;
+    auto content = createContent(size);
+    FakeHttpServer server(content);
+    QVERIFY(server.listen());
+
+    QSharedPointer<DownloadManager> downloadManager(new DownloadManager(this));
+    QScopedPointer<DownloadItem> target(
+                createJob(downloadManager, server.url("resume.bin"), "*name*.*ext*"));
+    target->setMaxConnectionSegments(1);
+
+    /* The partial file misses the second megabyte */
+    auto partial = content;
+    partial.replace(MIN_CONNECTION_SEGMENT_SIZE, MIN_CONNECTION_SEGMENT_SIZE,
+                    QByteArray(MIN_CONNECTION_SEGMENT_SIZE, '\0'));
+    QFile file(File::partialFileName(target->localFullFileName()));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QCOMPARE(file.write(partial), qint64(size));
+    file.close();
+
+    target->setBytesTotal(size);
+    target->setPendingRanges("1048576-2097151");
+
+    QSignalSpy spyFinished(target.data(), SIGNAL(finished()));
+
+    // When
+    target->resume();
+
+    // Then
+    QVERIFY(spyFinished.wait(10000));
+    QCOMPARE(target->state(), DownloadItem::Completed);
+    QCOMPARE(target->bytesReceived(), size);
+    QCOMPARE(server.requestedRanges(), QStringList() << "bytes=1048576-2097151");
+    QVERIFY(readAll(target->localFullFileName()) == content);
+}
+
+/**
+ * The partial file is older than the file on the server: the server answers
+ * the range request with the whole new file, that replaces the partial file.
+ */
+void tst_DownloadItem::restartFromZero()
+{
+    // Given
+    auto size = 4 * MIN_CONNECTION_SEGMENT_SIZE;
+    auto content = createContent(size);
+    FakeHttpServer server(content);
+    server.setEntityTag("\"v2\"");
+    QVERIFY(server.listen());
+
+    QSharedPointer<DownloadManager> downloadManager(new DownloadManager(this));
+    QScopedPointer<DownloadItem> target(
+                createJob(downloadManager, server.url("restart.bin"), "*name*.*ext*"));
+    target->setMaxConnectionSegments(1);
+
+    QFile file(File::partialFileName(target->localFullFileName()));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QCOMPARE(file.write(QByteArray(size, 'x')), qint64(size));
+    file.close();
+
+    target->resource()->setHttpEntityTag("\"v1\"");
+    target->setBytesTotal(size);
+    target->setPendingRanges("1048576-2097151");
+
+    QSignalSpy spyFinished(target.data(), SIGNAL(finished()));
+
+    // When
+    target->resume();
+
+    // Then
+    QVERIFY(spyFinished.wait(10000));
+    QCOMPARE(target->state(), DownloadItem::Completed);
+    QCOMPARE(target->bytesReceived(), size);
+    QCOMPARE(server.requestedRanges(), QStringList() << "bytes=1048576-2097151");
+    QCOMPARE(target->resource()->httpEntityTag(), QString("\"v2\""));
+    QVERIFY(readAll(target->localFullFileName()) == content);
+}
+
+/**
+ * The last segment is stuck: the idle connections first steal the half
+ * of its range, then its remaining range is requested a second time (endgame).
+ * The download can only finish if both happen.
+ */
+void tst_DownloadItem::rebalanceSegments()
+{
+    // Given
+    auto size = 4 * MIN_CONNECTION_SEGMENT_SIZE;
+    auto content = createContent(size);
+    FakeHttpServer server(content);
+    server.setStalledRange(3 * MIN_CONNECTION_SEGMENT_SIZE);
+    QVERIFY(server.listen());
+
+    QSharedPointer<DownloadManager> downloadManager(new DownloadManager(this));
+    QScopedPointer<DownloadItem> target(
+                createJob(downloadManager, server.url("endgame.bin"), "*name*.*ext*"));
+    target->setMaxConnectionSegments(4);
+
+    QSignalSpy spyFinished(target.data(), SIGNAL(finished()));
+
+    // When
+    target->resume();
+
+    // Then
+    QVERIFY(spyFinished.wait(10000));
+    QCOMPARE(target->state(), DownloadItem::Completed);
+    QCOMPARE(target->bytesReceived(), size);
+    QVERIFY(readAll(target->localFullFileName()) == content);
+
+    auto ranges = server.requestedRanges();
+    qsizetype stolen = 0;
+    qsizetype duplicated = 0;
+    for (const auto &range : std::as_const(ranges)) {
+        auto bounds = range.mid(QString("bytes=").size()).split('-');
+        if (bounds.count() != 2) {
+            continue;
+        }
+        auto begin = bounds.at(0).toLongLong();
+        auto end = bounds.at(1).toLongLong();
+        if (begin > 3 * MIN_CONNECTION_SEGMENT_SIZE && end == size - 1) {
+            stolen++;
+        }
+        if (begin == 3 * MIN_CONNECTION_SEGMENT_SIZE && end < size - 1) {
+            QVERIFY(end - begin + 1 < 2 * ENDGAME_BLOCK_SIZE);
+            duplicated++;
+        }
+    }
+    QVERIFY(stolen > 0);
+    QCOMPARE(duplicated, qsizetype(1));
+}
+
+/******************************************************************************
+ ******************************************************************************/
+/*
+ * QSignalSpy::wait() requires QTEST_MAIN instead of QTEST_APPLESS_MAIN,
+ * because the download needs an event loop.
+ */
+QTEST_MAIN(tst_DownloadItem)
+
+#include "tst_downloaditem.moc"
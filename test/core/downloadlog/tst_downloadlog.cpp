@@ -0,0 +1,150 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <Core/DownloadLog>
+
+#include <Constants>
+
+#include <QtCore/QDebug>
+#include <QtCore/QFile>
+#include <QtCore/QTemporaryDir>
+#include <QtTest/QtTest>
+
+class tst_DownloadLog : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void cleanup();
+
+    void append();
+    void appendBounded();
+    void appendProgress();
+    void spill();
+    void remove();
+};
+
+/******************************************************************************
+******************************************************************************/
+void tst_DownloadLog::cleanup()
+{
+    DownloadLog::setDirectory({});
+}
+
+void tst_DownloadLog::append()
+{
+    DownloadLog target;
+    target.append("first");
+    target.append("second");
+    QCOMPARE(target.count(), qsizetype(2));
+    auto lines = target.text().split('\n', Qt::SkipEmptyParts);
+    QCOMPARE(lines.count(), 2);
+    QVERIFY(lines.at(0).endsWith("] first"));
+    QVERIFY(lines.at(1).endsWith("] second"));
+}
+
+void tst_DownloadLog::appendBounded()
+{
+    DownloadLog target;
+    for (int i = 0; i < 10 * LOG_MAX_LINES; ++i) {
+        target.append(QString("line %0").arg(i));
+    }
+    QCOMPARE(target.count(), qsizetype(LOG_MAX_LINES));
+    auto lines = target.text().split('\n', Qt::SkipEmptyParts);
+    QVERIFY(lines.first().endsWith(QString("] line %0").arg(9 * LOG_MAX_LINES)));
+    QVERIFY(lines.last().endsWith(QString("] line %0").arg(10 * LOG_MAX_LINES - 1)));
+}
+
+void tst_DownloadLog::appendProgress()
+{
+    DownloadLog target;
+    target.append("start");
+    for (int i = 0; i < 1000; ++i) {
+        target.appendProgress(QString("progress %0").arg(i));
+    }
+    /* The progress lines within a second replace each other */
+    QCOMPARE(target.count(), qsizetype(2));
+    QVERIFY(target.text().endsWith("] progress 999\n"));
+
+    target.append("finished");
+    target.appendProgress("progress");
+    QCOMPARE(target.count(), qsizetype(4));
+}
+
+void tst_DownloadLog::spill()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    DownloadLog::setDirectory(dir.path());
+
+    DownloadLog target;
+    target.setId(42);
+    for (int i = 0; i < 3 * LOG_MAX_LINES; ++i) {
+        target.append(QString("line %0").arg(i));
+    }
+    target.flush();
+
+    QVERIFY(QFile::exists(target.fileName()));
+    QCOMPARE(target.fileName(), dir.filePath(QString("42%0").arg(LOG_FILE_SUFFIX)));
+    QCOMPARE(target.count(), qsizetype(LOG_MAX_LINES));
+
+    auto lines = target.fullText().split('\n', Qt::SkipEmptyParts);
+    QCOMPARE(lines.count(), 3 * LOG_MAX_LINES);
+    QVERIFY(lines.first().endsWith("] line 0"));
+    QVERIFY(lines.last().endsWith(QString("] line %0").arg(3 * LOG_MAX_LINES - 1)));
+}
+
+void tst_DownloadLog::remove()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    DownloadLog::setDirectory(dir.path());
+
+    /* Two downloads to the same destination don't share their log file */
+    DownloadLog other;
+    other.setId(1);
+    DownloadLog target;
+    target.setId(2);
+    for (int i = 0; i < 3 * LOG_MAX_LINES; ++i) {
+        other.append(QString("other %0").arg(i));
+        target.append(QString("line %0").arg(i));
+    }
+    other.flush();
+    target.flush();
+    auto fileName = target.fileName();
+    QVERIFY(QFile::exists(fileName));
+    QVERIFY(QFile::exists(other.fileName()));
+    QVERIFY(fileName != other.fileName());
+
+    // When
+    target.remove();
+    for (int i = 0; i < 3 * LOG_MAX_LINES; ++i) {
+        target.append(QString("line %0").arg(i));
+    }
+    target.flush();
+
+    // Then
+    QVERIFY(!QFile::exists(fileName));
+    QVERIFY(target.fileName().isEmpty());
+    QVERIFY(QFile::exists(other.fileName()));
+}
+
+/******************************************************************************
+ ******************************************************************************/
+QTEST_APPLESS_MAIN(tst_DownloadLog)
+
+#include "tst_downloadlog.moc"
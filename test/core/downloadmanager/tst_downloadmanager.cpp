@@ -18,6 +18,8 @@
 #include <Core/DownloadItem>
 #include <Core/Mask>
 #include <Core/ResourceItem>
+#include <Core/Session>
+#include <Core/Settings>
 
 #include <QtCore/QDebug>
 #include <QtCore/QFile>
@@ -49,6 +51,10 @@ private slots:
     }
 
     void appendJobPaused();
+    void sessionJournal();
+    void sessionLazyLoad();
+    void sessionRecords();
+    void loadQueueRecords();
 
 private:
     QTemporaryDir m_tempDir;
@@ -115,6 +121,232 @@ void tst_DownloadManager::appendJobPaused()
     QCOMPARE(localFile.size(), qsizetype(1256));
 }
 
+void tst_DownloadManager::sessionJournal()
+{
+    // Given
+    QSharedPointer<DownloadManager> downloadManager(new DownloadManager(this));
+    auto filename = m_tempDir.filePath("queue.json");
+
+    Session target;
+    target.load(filename, downloadManager.data());
+
+    auto item1 = createDummyJob(downloadManager, "http://www.example.com/1.html", "*name*");
+    auto item2 = createDummyJob(downloadManager, "http://www.example.com/2.html", "*name*");
+    auto item3 = createDummyJob(downloadManager, "http://www.example.com/3.html", "*name*");
+
+    // When
+    target.markChanged(item1);
+    target.markChanged(item2);
+    target.markChanged(item3);
+    QVERIFY(target.commit());
+    target.markRemoved(item2);
+    QVERIFY(target.commit());
+    target.flush();
+
+    // Then
+    QVERIFY(!QFile::exists(filename));
+    QVERIFY(QFile::exists(Session::journalFileName(filename)));
+
+    Session other;
+    auto actual = other.load(filename, downloadManager.data());
+    QCOMPARE(actual.count(), 2);
+    QCOMPARE(actual.at(0)->resource()->url(), QString("http://www.example.com/1.html"));
+    QCOMPARE(actual.at(1)->resource()->url(), QString("http://www.example.com/3.html"));
+    QVERIFY(other.isCompactionNeeded());
+
+    // When
+    QVERIFY(other.compact(QList<IDownloadItem *>(actual.cbegin(), actual.cend())));
+    other.flush();
+
+    // Then
+    QVERIFY(QFile::exists(filename));
+    QVERIFY(!QFile::exists(Session::journalFileName(filename)));
+    QVERIFY(!QFile::exists(filename + ".tmp"));
+
+    Session reloaded;
+    actual = reloaded.load(filename, downloadManager.data());
+    QCOMPARE(actual.count(), 2);
+    QCOMPARE(actual.at(1)->resource()->url(), QString("http://www.example.com/3.html"));
+    QVERIFY(!reloaded.isCompactionNeeded());
+}
+
+void tst_DownloadManager::sessionLazyLoad()
+{
+    // Given
+    QSharedPointer<DownloadManager> downloadManager(new DownloadManager(this));
+    auto filename = m_tempDir.filePath("lazy.json");
+
+    QList<IDownloadItem *> items;
+    for (int i = 0; i < 5; ++i) {
+        auto item = createDummyJob(downloadManager, QString("http://www.example.com/%0.html").arg(i), "*name*");
+        item->setBytesReceived(i * 100);
+        items.append(item);
+    }
+    Session writer;
+    writer.open(filename);
+    QVERIFY(writer.compact(items));
+    writer.flush();
+
+    QFile file(filename);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.read(4), QByteArray("ADLQ"));
+    file.close();
+
+    // When
+    Session target;
+    QCOMPARE(target.open(filename), qsizetype(5));
+    target.requestCompaction();
+    auto first = target.materialize(downloadManager.data(), 2);
+
+    // Then
+    QCOMPARE(first.count(), 2);
+    QVERIFY(target.isLoading());
+    QVERIFY(!target.isCompactionNeeded());
+    auto second = dynamic_cast<DownloadItem *>(first.at(1));
+    QVERIFY(second);
+    QCOMPARE(second->resource()->url(), QString("http://www.example.com/1.html"));
+    QCOMPARE(second->resource()->destination(), m_tempDir.path());
+    QCOMPARE(second->bytesReceived(), qsizetype(100));
+
+    // When
+    auto next = target.materialize(downloadManager.data(), 10);
+
+    // Then
+    QCOMPARE(next.count(), 3);
+    QVERIFY(!target.isLoading());
+    QVERIFY(target.isCompactionNeeded());
+    auto last = dynamic_cast<DownloadItem *>(next.at(2));
+    QVERIFY(last);
+    QCOMPARE(last->resource()->url(), QString("http://www.example.com/4.html"));
+    QCOMPARE(last->bytesReceived(), qsizetype(400));
+}
+
+void tst_DownloadManager::sessionRecords()
+{
+    // Given
+    QSharedPointer<DownloadManager> downloadManager(new DownloadManager(this));
+    auto filename = m_tempDir.filePath("records.json");
+
+    auto idle = createDummyJob(downloadManager, "http://www.example.com/0.html", "*name*");
+    auto completed = createDummyJob(downloadManager, "http://www.example.com/1.html", "*name*");
+    completed->setState(IDownloadItem::Completed);
+    completed->setBytesReceived(100);
+    completed->setBytesTotal(100);
+    auto stopped = createDummyJob(downloadManager, "http://www.example.com/2.html", "*name*");
+    stopped->setState(IDownloadItem::Stopped);
+
+    Session writer;
+    writer.open(filename);
+    QVERIFY(writer.compact({ idle, completed, stopped }));
+    writer.flush();
+
+    // When
+    Session target;
+    target.open(filename);
+    auto actual = target.materialize(downloadManager.data());
+
+    // Then
+    QCOMPARE(actual.count(), 3);
+    QVERIFY(dynamic_cast<DownloadItem *>(actual.at(0)));
+    auto record = dynamic_cast<SessionRecord *>(actual.at(1));
+    QVERIFY(record);
+    QVERIFY(dynamic_cast<SessionRecord *>(actual.at(2)));
+    QCOMPARE(record->state(), IDownloadItem::Completed);
+    QCOMPARE(record->bytesReceived(), qsizetype(100));
+    QCOMPARE(record->progress(), 100);
+    QCOMPARE(record->sourceUrl(), QUrl("http://www.example.com/1.html"));
+    QCOMPARE(record->localFullFileName(), completed->localFullFileName());
+    QVERIFY(!record->isResumable());
+    QVERIFY(actual.at(2)->isResumable());
+
+    // When
+    auto item = target.readItem(record, downloadManager.data());
+
+    // Then
+    QVERIFY(target.contains(item));
+    QVERIFY(!target.contains(record));
+    QCOMPARE(item->state(), IDownloadItem::Completed);
+    QCOMPARE(item->resource()->url(), QString("http://www.example.com/1.html"));
+    QCOMPARE(item->localFullFileName(), completed->localFullFileName());
+
+    // When
+    delete record;
+    QVERIFY(target.compact({ actual.at(0), item, actual.at(2) }));
+    target.flush();
+
+    // Then
+    Session reloaded;
+    auto reloadedItems = reloaded.load(filename, downloadManager.data());
+    QCOMPARE(reloadedItems.count(), 3);
+    QCOMPARE(reloadedItems.at(1)->state(), IDownloadItem::Completed);
+    QCOMPARE(reloadedItems.at(2)->state(), IDownloadItem::Stopped);
+    QCOMPARE(reloadedItems.at(2)->resource()->url(), QString("http://www.example.com/2.html"));
+    delete actual.at(2);
+}
+
+void tst_DownloadManager::loadQueueRecords()
+{
+    // Given
+    auto filename = m_tempDir.filePath("queue-records.json");
+    QString completedFileName;
+    {
+        QSharedPointer<DownloadManager> downloadManager(new DownloadManager(this));
+        auto idle = createDummyJob(downloadManager, "http://www.example.com/0.html", "*name*");
+        auto completed = createDummyJob(downloadManager, "http://www.example.com/1.html", "*name*");
+        completed->setState(IDownloadItem::Completed);
+        auto stopped = createDummyJob(downloadManager, "http://www.example.com/2.html", "*name*");
+        stopped->setState(IDownloadItem::Stopped);
+        completedFileName = completed->localFileName();
+
+        Session writer;
+        writer.open(filename);
+        QVERIFY(writer.compact({ idle, completed, stopped }));
+        writer.flush();
+    }
+    Settings settings(nullptr);
+    QSharedPointer<DownloadManager> target(new DownloadManager(this));
+    target->setSettings(&settings);
+    QSignalSpy spyQueueLoaded(target.data(), SIGNAL(queueLoaded()));
+
+    // When
+    settings.setDatabase(filename);
+
+    // Then
+    QCOMPARE(spyQueueLoaded.count(), 1);
+    auto items = target->downloadItems();
+    QCOMPARE(items.count(), 3);
+    QVERIFY(dynamic_cast<DownloadItem *>(items.at(0)));
+    QVERIFY(!dynamic_cast<DownloadItem *>(items.at(1)));
+    QVERIFY(!dynamic_cast<DownloadItem *>(items.at(2)));
+    QCOMPARE(items.at(1)->localFileName(), completedFileName);
+    QCOMPARE(target->completedJobCount(), qsizetype(1));
+    QCOMPARE(target->failedJobCount(), qsizetype(1));
+
+    // When
+    target->setSelection({ items.at(1) });
+
+    // Then
+    auto selected = dynamic_cast<DownloadItem *>(target->selection().first());
+    QVERIFY(selected);
+    QCOMPARE(target->downloadItems().at(1), target->selection().first());
+    QCOMPARE(selected->state(), IDownloadItem::Completed);
+    QCOMPARE(selected->localFileName(), completedFileName);
+    QCOMPARE(target->completedJobCount(), qsizetype(1));
+    QVERIFY(!dynamic_cast<DownloadItem *>(target->downloadItems().at(2)));
+
+    // When
+    target->setMaxSimultaneousDownloads(0); /* Don't start it */
+    target->resume(items.at(2));
+
+    // Then
+    auto resumed = dynamic_cast<DownloadItem *>(target->downloadItems().at(2));
+    QVERIFY(resumed);
+    QCOMPARE(resumed->state(), IDownloadItem::Idle);
+    QCOMPARE(resumed->resource()->url(), QString("http://www.example.com/2.html"));
+    QCOMPARE(target->waitingJobCount(), qsizetype(1));
+    QCOMPARE(target->failedJobCount(), qsizetype(0));
+}
+
 /******************************************************************************
  ******************************************************************************/
 
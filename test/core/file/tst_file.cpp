@@ -0,0 +1,260 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Core/File>
+#include <Core/ResourceItem>
+
+#include <QtCore/QDebug>
+#include <QtCore/QDateTime>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QTemporaryDir>
+#include <QtTest/QSignalSpy>
+#include <QtTest/QtTest>
+
+class tst_File : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void preallocate();
+    void preallocateTooLarge();
+    void writeAtOffset();
+    void commit();
+    void close();
+    void cancel();
+    void commitWithoutFile();
+    void reopenWhileClosing();
+
+private:
+    QTemporaryDir m_tempDir;
+
+    inline ResourceItem *createResource(const QString &fileName);
+};
+
+/******************************************************************************
+ ******************************************************************************/
+static QByteArray readAll(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    return file.readAll();
+}
+
+ResourceItem *tst_File::createResource(const QString &fileName)
+{
+    Q_ASSERT(m_tempDir.isValid());
+    auto resource = new ResourceItem();
+    resource->setUrl(QString("http://www.example.com/%0").arg(fileName));
+    resource->setDestination(m_tempDir.path());
+    resource->setMask("*name*.*ext*");
+    return resource;
+}
+
+/******************************************************************************
+ ******************************************************************************/
+void tst_File::preallocate()
+{
+    // Given
+    QScopedPointer<ResourceItem> resource(createResource("preallocate.bin"));
+    auto fileName = resource->localFileUrl().toLocalFile();
+    File target;
+    QCOMPARE(target.open(resource.data()), File::Open);
+
+    // When
+    auto actual = target.preallocate(4 * 1024 * 1024);
+
+    // Then
+    QVERIFY(actual);
+    QCOMPARE(target.size(), qint64(4 * 1024 * 1024));
+    QCOMPARE(QFileInfo(File::partialFileName(fileName)).size(), qint64(4 * 1024 * 1024));
+
+    // When
+    actual = target.preallocate(1024);
+
+    // Then
+    QVERIFY(actual);
+    QCOMPARE(target.size(), qint64(4 * 1024 * 1024)); /* never shrinks */
+
+    QVERIFY(!target.preallocate(0));
+    target.cancel();
+}
+
+void tst_File::preallocateTooLarge()
+{
+#if defined(Q_OS_LINUX)
+    // Given
+    QScopedPointer<ResourceItem> resource(createResource("too-large.bin"));
+    File target;
+    QCOMPARE(target.open(resource.data()), File::Open);
+
+    // When
+    /* 1 EiB: ENOSPC from fallocate(), or EFBIG from both fallocate() and the resize fallback */
+    auto actual = target.preallocate(qint64(1) << 60);
+
+    // Then
+    QVERIFY(!actual);
+    target.cancel();
+#else
+    QSKIP("The size limits depend on the file system.");
+#endif
+}
+
+void tst_File::writeAtOffset()
+{
+    // Given
+    QScopedPointer<ResourceItem> resource(createResource("offset.bin"));
+    auto fileName = resource->localFileUrl().toLocalFile();
+    File target;
+    QCOMPARE(target.open(resource.data()), File::Open);
+    QVERIFY(target.preallocate(300));
+
+    // When
+    /* The segments arrive in any order */
+    QVERIFY(target.write(200, QByteArray(100, 'c')));
+    QVERIFY(target.write(0, QByteArray(100, 'a')));
+    QVERIFY(target.write(100, QByteArray(100, 'b')));
+    QSignalSpy spyCommitted(&target, SIGNAL(committed(bool)));
+    target.commit();
+    QVERIFY(spyCommitted.wait(5000));
+    QCOMPARE(spyCommitted.first().first().toBool(), true);
+
+    // Then
+    QCOMPARE(readAll(fileName), QByteArray(100, 'a') + QByteArray(100, 'b') + QByteArray(100, 'c'));
+}
+
+void tst_File::commit()
+{
+    // Given
+    QScopedPointer<ResourceItem> resource(createResource("commit.bin"));
+    auto fileName = resource->localFileUrl().toLocalFile();
+
+    QFile existing(fileName);
+    QVERIFY(existing.open(QIODevice::WriteOnly));
+    existing.write("previous content");
+    existing.close();
+
+    auto time = QDateTime(QDate(2001, 2, 3), QTime(4, 5, 6));
+
+    File target;
+    QCOMPARE(target.open(resource.data()), File::Open);
+    QVERIFY(target.write(0, QByteArray("new content")));
+    target.setLastModifiedFileTime(time);
+    QSignalSpy spyCommitted(&target, SIGNAL(committed(bool)));
+
+    // When
+    target.commit();
+
+    // Then
+    /* The file is closed at once, then renamed by the writer thread */
+    QVERIFY(!target.isOpen());
+    QVERIFY(spyCommitted.wait(5000));
+    QCOMPARE(spyCommitted.count(), 1);
+    QCOMPARE(spyCommitted.first().first().toBool(), true);
+    QVERIFY(!QFile::exists(File::partialFileName(fileName)));
+    QCOMPARE(readAll(fileName), QByteArray("new content"));
+    QCOMPARE(QFileInfo(fileName).lastModified(), time);
+}
+
+void tst_File::close()
+{
+    // Given
+    QScopedPointer<ResourceItem> resource(createResource("close.bin"));
+    auto fileName = resource->localFileUrl().toLocalFile();
+    File target;
+    QCOMPARE(target.open(resource.data()), File::Open);
+    QVERIFY(target.write(0, QByteArray("partial")));
+
+    // When
+    target.close();
+
+    // Then
+    QVERIFY(!QFile::exists(fileName));
+    QTRY_COMPARE(readAll(File::partialFileName(fileName)), QByteArray("partial"));
+
+    // When
+    QCOMPARE(target.open(resource.data(), true), File::Open);
+
+    // Then
+    QCOMPARE(target.size(), qint64(7));
+    target.cancel();
+}
+
+void tst_File::cancel()
+{
+    // Given
+    QScopedPointer<ResourceItem> resource(createResource("cancel.bin"));
+    auto fileName = resource->localFileUrl().toLocalFile();
+    File target;
+    QCOMPARE(target.open(resource.data()), File::Open);
+    QVERIFY(target.write(0, QByteArray("partial")));
+
+    // When
+    target.cancel();
+
+    // Then
+    QVERIFY(!QFile::exists(fileName));
+    QVERIFY(!QFile::exists(File::partialFileName(fileName)));
+}
+
+void tst_File::commitWithoutFile()
+{
+    // Given
+    File target;
+    QSignalSpy spyCommitted(&target, SIGNAL(committed(bool)));
+
+    // When
+    target.commit();
+
+    // Then
+    QCOMPARE(spyCommitted.count(), 0); /* Always asynchronous */
+    QVERIFY(spyCommitted.wait(5000));
+    QCOMPARE(spyCommitted.first().first().toBool(), false);
+}
+
+void tst_File::reopenWhileClosing()
+{
+    // Given
+    QScopedPointer<ResourceItem> resource(createResource("reopen.bin"));
+    auto fileName = resource->localFileUrl().toLocalFile();
+    File target;
+    QCOMPARE(target.open(resource.data()), File::Open);
+    QVERIFY(target.write(0, QByteArray(1024 * 1024, 'a')));
+    target.close();
+
+    // When
+    /* Restart from zero: the previous writes must not land in the new file */
+    QCOMPARE(target.open(resource.data(), false), File::Open);
+    QVERIFY(target.write(0, QByteArray("b")));
+    QSignalSpy spyCommitted(&target, SIGNAL(committed(bool)));
+    target.commit();
+
+    // Then
+    QVERIFY(spyCommitted.wait(5000));
+    QCOMPARE(readAll(fileName), QByteArray("b"));
+}
+
+/******************************************************************************
+ ******************************************************************************/
+/*
+ * QSignalSpy::wait() requires QTEST_MAIN instead of QTEST_APPLESS_MAIN,
+ * otherwise we get QEventLoop: Cannot be used without QApplication
+ */
+QTEST_MAIN(tst_File)
+
+#include "tst_file.moc"
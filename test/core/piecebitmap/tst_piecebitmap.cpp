@@ -0,0 +1,281 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Core/PieceBitmap>
+
+#include <QtCore/QDebug>
+#include <QtTest/QtTest>
+
+class tst_PieceBitmap : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void constructor();
+    void setBit();
+    void resize();
+
+    void fromBitfield_data();
+    void fromBitfield();
+
+    void fromBitArray_data();
+    void fromBitArray();
+
+    void count_data();
+    void count();
+
+    void countRange_data();
+    void countRange();
+
+    void isAllSet();
+    void indexes();
+    void bitwiseOperators();
+};
+
+/******************************************************************************
+ ******************************************************************************/
+/**
+ * Helper function to initialize a bitmap from a string
+ */
+static PieceBitmap toPieceBitmap(const QString &str)
+{
+    PieceBitmap ret(str.length());
+    for (auto i = 0; i < str.length(); ++i) {
+        if (str.at(i) == QChar('1')) {
+            ret.setBit(i);
+        }
+    }
+    return ret;
+}
+
+/**
+ * Helper function to write the bitmap in the BitTorrent bitfield format
+ */
+static QByteArray toBitfield(const QString &str)
+{
+    QByteArray ret((str.length() + 7) / 8, '\0');
+    for (auto i = 0; i < str.length(); ++i) {
+        if (str.at(i) == QChar('1')) {
+            ret[i / 8] = static_cast<char>(ret.at(i / 8) | (0x80 >> (i % 8)));
+        }
+    }
+    return ret;
+}
+
+static QBitArray toBitArray(const QString &str)
+{
+    QBitArray ret(str.length());
+    for (auto i = 0; i < str.length(); ++i) {
+        ret.setBit(i, str.at(i) == QChar('1'));
+    }
+    return ret;
+}
+
+static void addBitRows()
+{
+    QTest::addColumn<QString>("bits");
+
+    QTest::newRow("null") << QString();
+    QTest::newRow("1 bit") << QString("1");
+    QTest::newRow("3 bits") << QString("010");
+    QTest::newRow("8 bits") << QString("11010011");
+    QTest::newRow("11 bits") << QString("00101100111");
+    QTest::newRow("63 bits") << QString(63, '1');
+    QTest::newRow("64 bits") << QString(32, '0') + QString(32, '1');
+    QTest::newRow("65 bits") << QString("1") + QString(63, '0') + QString("1");
+    QTest::newRow("200 bits") << QString("1101").repeated(50);
+}
+
+/******************************************************************************
+ ******************************************************************************/
+void tst_PieceBitmap::constructor()
+{
+    PieceBitmap empty;
+    QVERIFY(empty.isEmpty());
+    QCOMPARE(empty.size(), qsizetype(0));
+    QCOMPARE(empty.count(true), qsizetype(0));
+
+    PieceBitmap ones(70, true);
+    QCOMPARE(ones.size(), qsizetype(70));
+    QCOMPARE(ones.count(true), qsizetype(70));
+    QCOMPARE(ones.count(false), qsizetype(0));
+
+    PieceBitmap zeros(70);
+    QCOMPARE(zeros.count(true), qsizetype(0));
+    QCOMPARE(zeros.count(false), qsizetype(70));
+}
+
+void tst_PieceBitmap::setBit()
+{
+    PieceBitmap bitmap(100);
+    bitmap.setBit(0);
+    bitmap.setBit(63);
+    bitmap.setBit(64, true);
+    bitmap.setBit(99);
+    bitmap.setBit(99, false);
+
+    QVERIFY(bitmap.testBit(0));
+    QVERIFY(!bitmap.testBit(1));
+    QVERIFY(bitmap.at(63));
+    QVERIFY(bitmap.at(64));
+    QVERIFY(!bitmap.at(99));
+    QCOMPARE(bitmap.count(true), qsizetype(3));
+
+    bitmap.clearBit(0);
+    QCOMPARE(bitmap.count(true), qsizetype(2));
+
+    bitmap.fill(true);
+    QCOMPARE(bitmap.count(true), qsizetype(100));
+}
+
+void tst_PieceBitmap::resize()
+{
+    PieceBitmap bitmap(70, true);
+    bitmap.resize(10);
+    QCOMPARE(bitmap.count(true), qsizetype(10));
+
+    // The new bits are zero
+    bitmap.resize(100);
+    QCOMPARE(bitmap.size(), qsizetype(100));
+    QCOMPARE(bitmap.count(true), qsizetype(10));
+
+    bitmap.clear();
+    QVERIFY(bitmap.isEmpty());
+}
+
+/******************************************************************************
+ ******************************************************************************/
+void tst_PieceBitmap::fromBitfield_data()
+{
+    addBitRows();
+}
+
+void tst_PieceBitmap::fromBitfield()
+{
+    QFETCH(QString, bits);
+    auto bitfield = toBitfield(bits);
+
+    auto actual = PieceBitmap::fromBitfield(bitfield.constData(), bits.length());
+
+    QCOMPARE(actual, toPieceBitmap(bits));
+}
+
+void tst_PieceBitmap::fromBitArray_data()
+{
+    addBitRows();
+}
+
+void tst_PieceBitmap::fromBitArray()
+{
+    QFETCH(QString, bits);
+    auto bitArray = toBitArray(bits);
+
+    auto actual = PieceBitmap::fromBitArray(bitArray);
+
+    QCOMPARE(actual, toPieceBitmap(bits));
+    QCOMPARE(actual.toBitArray(), bitArray);
+}
+
+/******************************************************************************
+ ******************************************************************************/
+void tst_PieceBitmap::count_data()
+{
+    addBitRows();
+}
+
+void tst_PieceBitmap::count()
+{
+    QFETCH(QString, bits);
+    auto bitmap = toPieceBitmap(bits);
+
+    QCOMPARE(bitmap.count(), bits.length());
+    QCOMPARE(bitmap.count(true), bits.count('1'));
+    QCOMPARE(bitmap.count(false), bits.count('0'));
+}
+
+void tst_PieceBitmap::countRange_data()
+{
+    QTest::addColumn<qsizetype>("first");
+    QTest::addColumn<qsizetype>("last");
+
+    QTest::newRow("empty") << qsizetype(5) << qsizetype(5);
+    QTest::newRow("inverted") << qsizetype(5) << qsizetype(2);
+    QTest::newRow("one bit") << qsizetype(5) << qsizetype(6);
+    QTest::newRow("in first word") << qsizetype(3) << qsizetype(40);
+    QTest::newRow("whole first word") << qsizetype(0) << qsizetype(64);
+    QTest::newRow("across words") << qsizetype(60) << qsizetype(70);
+    QTest::newRow("across three words") << qsizetype(1) << qsizetype(190);
+    QTest::newRow("to the end") << qsizetype(100) << qsizetype(200);
+    QTest::newRow("clipped") << qsizetype(-10) << qsizetype(300);
+}
+
+void tst_PieceBitmap::countRange()
+{
+    QFETCH(qsizetype, first);
+    QFETCH(qsizetype, last);
+    const QString bits = QString("1101000").repeated(30); // 210 bits
+    auto bitmap = toPieceBitmap(bits);
+
+    qsizetype expected = 0;
+    for (auto i = qMax(first, qsizetype(0)); i < qMin(last, bits.length()); ++i) {
+        if (bits.at(i) == QChar('1')) {
+            expected++;
+        }
+    }
+
+    QCOMPARE(bitmap.count(true, first, last), expected);
+}
+
+void tst_PieceBitmap::isAllSet()
+{
+    auto bitmap = toPieceBitmap(QString(10, '0') + QString(100, '1') + QString(10, '0'));
+
+    QVERIFY(bitmap.isAllSet(10, 110));
+    QVERIFY(bitmap.isAllSet(50, 51));
+    QVERIFY(!bitmap.isAllSet(9, 110));
+    QVERIFY(!bitmap.isAllSet(10, 111));
+    QVERIFY(!bitmap.isAllSet(100, 200)); // out of range
+}
+
+void tst_PieceBitmap::indexes()
+{
+    auto bitmap = toPieceBitmap(QString("1") + QString(62, '0') + QString("11") + QString(70, '0') + QString("1"));
+
+    QCOMPARE(bitmap.indexes(), QList<int>({0, 63, 64, 135}));
+    QVERIFY(PieceBitmap(100).indexes().isEmpty());
+}
+
+void tst_PieceBitmap::bitwiseOperators()
+{
+    auto a = toPieceBitmap("1100110011");
+    auto b = toPieceBitmap("1010101010");
+
+    QCOMPARE(a & b, toPieceBitmap("1000100010"));
+    QCOMPARE(a | b, toPieceBitmap("1110111011"));
+    QCOMPARE(~a, toPieceBitmap("0011001100"));
+    QCOMPARE((~a).count(true), qsizetype(4)); // the padding stays zero
+
+    // The missing bits of the smaller bitmap are zero
+    auto c = toPieceBitmap("11");
+    QCOMPARE(a & c, toPieceBitmap("1100000000"));
+    QCOMPARE(c | b, toPieceBitmap("1110101010"));
+}
+
+/******************************************************************************
+ ******************************************************************************/
+QTEST_APPLESS_MAIN(tst_PieceBitmap)
+
+#include "tst_piecebitmap.moc"
@@ -0,0 +1,159 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <Core/SpeedEstimator>
+
+#include <QtCore/QDebug>
+#include <QtTest/QtTest>
+
+class tst_SpeedEstimator : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void unknown();
+    void constantRate();
+    void resumedBytes();
+    void stepChange();
+    void stalled();
+    void coalesce();
+    void restart();
+
+private:
+    static void feed(SpeedEstimator &target, qint64 from, qint64 to, qint64 &bytes, qint64 rate);
+};
+
+/******************************************************************************
+******************************************************************************/
+/*
+ * Feeds the estimator every 10 msecs, at the given rate in bytes per second.
+ */
+void tst_SpeedEstimator::feed(SpeedEstimator &target, qint64 from, qint64 to, qint64 &bytes, qint64 rate)
+{
+    for (qint64 now = from + 10; now <= to; now += 10) {
+        bytes += rate / 100;
+        target.update(now, bytes);
+    }
+}
+
+/******************************************************************************
+******************************************************************************/
+void tst_SpeedEstimator::unknown()
+{
+    SpeedEstimator target;
+    QVERIFY(!target.isStarted());
+    QCOMPARE(target.instantRate(), qreal(-1));
+    QCOMPARE(target.smoothedRate(), qreal(-1));
+    QCOMPARE(target.averageRate(), qreal(-1));
+
+    target.start(0);
+    QVERIFY(target.isStarted());
+    QCOMPARE(target.instantRate(), qreal(-1));
+    QCOMPARE(target.smoothedRate(), qreal(-1));
+    QCOMPARE(target.averageRate(), qreal(-1));
+}
+
+void tst_SpeedEstimator::constantRate()
+{
+    SpeedEstimator target;
+    target.start(0);
+    qint64 bytes = 0;
+    feed(target, 0, 10000, bytes, 1000);
+
+    QCOMPARE(target.bytesReceived(), qint64(10000));
+    QCOMPARE(target.instantRate(), qreal(1000));
+    QCOMPARE(target.smoothedRate(), qreal(1000));
+    QCOMPARE(target.averageRate(), qreal(1000));
+}
+
+void tst_SpeedEstimator::resumedBytes()
+{
+    SpeedEstimator target;
+    qint64 bytes = 50000;
+    target.start(0, bytes); // already received before the resume
+    feed(target, 0, 5000, bytes, 1000);
+
+    QCOMPARE(target.bytesReceived(), qint64(5000));
+    QCOMPARE(target.averageRate(), qreal(1000));
+}
+
+void tst_SpeedEstimator::stepChange()
+{
+    SpeedEstimator target;
+    target.start(0);
+    qint64 bytes = 0;
+    feed(target, 0, 60000, bytes, 1000);
+    feed(target, 60000, 70000, bytes, 4000);
+
+    /* The instant and smoothed rates follow the change, not the average */
+    QCOMPARE(target.instantRate(), qreal(4000));
+    QVERIFY(target.smoothedRate() > 3500);
+    QVERIFY(target.smoothedRate() < 4000);
+    QVERIFY(target.averageRate() < 1500);
+}
+
+void tst_SpeedEstimator::stalled()
+{
+    SpeedEstimator target;
+    target.start(0);
+    qint64 bytes = 0;
+    feed(target, 0, 10000, bytes, 1000);
+    feed(target, 10000, 20000, bytes, 0);
+
+    QCOMPARE(target.instantRate(), qreal(0));
+    QVERIFY(target.smoothedRate() < 150);
+    QCOMPARE(target.averageRate(), qreal(500));
+}
+
+void tst_SpeedEstimator::coalesce()
+{
+    SpeedEstimator target;
+    target.start(0);
+
+    /* Closer than the sample period: counted, but not sampled yet */
+    target.update(10, 100);
+    target.update(20, 200);
+    QCOMPARE(target.smoothedRate(), qreal(-1));
+    QCOMPARE(target.bytesReceived(), qint64(200));
+    QCOMPARE(target.instantRate(), qreal(10000));
+
+    target.update(100, 1000);
+    QCOMPARE(target.smoothedRate(), qreal(10000));
+}
+
+void tst_SpeedEstimator::restart()
+{
+    SpeedEstimator target;
+    target.start(0);
+    qint64 bytes = 0;
+    feed(target, 0, 1000, bytes, 1000);
+
+    /* The transfer restarted from the beginning */
+    target.update(2000, 0);
+    QCOMPARE(target.bytesReceived(), qint64(0));
+    QCOMPARE(target.smoothedRate(), qreal(-1));
+    QCOMPARE(target.averageRate(), qreal(-1));
+
+    target.reset();
+    QVERIFY(!target.isStarted());
+}
+
+/******************************************************************************
+ ******************************************************************************/
+QTEST_APPLESS_MAIN(tst_SpeedEstimator)
+
+#include "tst_speedestimator.moc"
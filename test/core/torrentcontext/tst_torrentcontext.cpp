@@ -29,8 +29,9 @@ class tst_TorrentContext : public QObject
     Q_OBJECT
 
 private slots:
-    void toBitArray_data();
-    void toBitArray();
+    void toPieceBitmap_data();
+    void toPieceBitmap();
+    void toPieceBitmap_map();
     void dump_invalid();
 };
 
@@ -60,7 +61,7 @@ static QBitArray QStringToQBitArray(const QString &str)
     return ba;
 }
 
-void tst_TorrentContext::toBitArray_data()
+void tst_TorrentContext::toPieceBitmap_data()
 {
     QTest::addColumn<QBitArray>("input");
 
@@ -85,7 +86,7 @@ void tst_TorrentContext::toBitArray_data()
     QTest::newRow("data14") << QStringToQBitArray(QString("01000010111"));
 }
 
-void tst_TorrentContext::toBitArray()
+void tst_TorrentContext::toPieceBitmap()
 {
     // Given
     QFETCH(QBitArray, input);
@@ -95,13 +96,32 @@ void tst_TorrentContext::toBitArray()
             pieces.set_bit(static_cast<lt::piece_index_t>(i));
         }
     }
-    QBitArray expected = input;
+    PieceBitmap expected = PieceBitmap::fromBitArray(input);
 
     // When
-    QBitArray actual = TorrentUtils::toBitArray(pieces);
+    PieceBitmap actual = TorrentUtils::toPieceBitmap(pieces);
 
     // Then
     QCOMPARE(actual, expected);
+    QCOMPARE(actual.toBitArray(), input);
+}
+
+void tst_TorrentContext::toPieceBitmap_map()
+{
+    // Given
+    std::map<lt::piece_index_t, lt::bitfield> map;
+    map[lt::piece_index_t(2)] = lt::bitfield(16);
+    map[lt::piece_index_t(9)] = lt::bitfield(16);
+
+    // When
+    PieceBitmap actual = TorrentUtils::toPieceBitmap(map);
+    PieceBitmap actualSized = TorrentUtils::toPieceBitmap(map, 20);
+
+    // Then
+    QCOMPARE(actual.size(), qsizetype(10)); // the last index is included
+    QCOMPARE(actual.indexes(), QList<int>({2, 9}));
+    QCOMPARE(actualSized.size(), qsizetype(20));
+    QCOMPARE(actualSized.indexes(), QList<int>({2, 9}));
 }
 
 /******************************************************************************
@@ -0,0 +1,214 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <Core/TorrentMessage>
+
+#include <QtCore/QDebug>
+#include <QtTest/QtTest>
+
+class tst_TorrentMessage : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void changedFields();
+    void copyFields();
+
+    void infoChanges_noChange();
+    void infoChanges_first();
+    void infoChanges_newPieces();
+    void infoChanges_lostPieces();
+    void infoChanges_manyPieces();
+
+    void detailChanges();
+
+private:
+    static PieceBitmap toPieceBitmap(const QString &bits);
+};
+
+/******************************************************************************
+ ******************************************************************************/
+PieceBitmap tst_TorrentMessage::toPieceBitmap(const QString &bits)
+{
+    PieceBitmap ret(bits.size());
+    for (auto i = 0; i < bits.size(); ++i) {
+        ret.setBit(i, bits.at(i) == '1');
+    }
+    return ret;
+}
+
+/******************************************************************************
+ ******************************************************************************/
+void tst_TorrentMessage::changedFields()
+{
+    TorrentInfo previous;
+    TorrentInfo current;
+    QCOMPARE(current.changedFields(previous), TorrentInfo::Fields(TorrentInfo::NoField));
+
+    current.state = TorrentInfo::downloading;
+    current.downloadSpeed = 1234;
+    QCOMPARE(current.changedFields(previous), TorrentInfo::StateField | TorrentInfo::StatsField);
+
+    current = previous;
+    current.seedsCount = 5;
+    current.completedTime = QDateTime(QDate(2020, 1, 1), QTime(12, 0));
+    QCOMPARE(current.changedFields(previous), TorrentInfo::SwarmField | TorrentInfo::TimesField);
+
+    current = previous;
+    current.downloadedPieces = toPieceBitmap("0100");
+    QCOMPARE(current.changedFields(previous), TorrentInfo::Fields(TorrentInfo::PiecesField));
+}
+
+void tst_TorrentMessage::copyFields()
+{
+    TorrentInfo source;
+    source.state = TorrentInfo::seeding;
+    source.bytesReceived = 1000;
+    source.peersCount = 42;
+
+    TorrentInfo target;
+    target.copyFields(source, TorrentInfo::StateField);
+
+    QCOMPARE(target.state, TorrentInfo::seeding);
+    QCOMPARE(target.bytesReceived, qsizetype(0));
+    QCOMPARE(target.peersCount, 0);
+
+    target.copyFields(source, TorrentInfo::AllFields);
+    QCOMPARE(target, source);
+}
+
+/******************************************************************************
+ ******************************************************************************/
+void tst_TorrentMessage::infoChanges_noChange()
+{
+    TorrentInfo info;
+    info.downloadedPieces = toPieceBitmap("0110");
+
+    TorrentStatus status;
+    status.setInfoChanges(info, info);
+    QVERIFY(status.isEmpty());
+}
+
+void tst_TorrentMessage::infoChanges_first()
+{
+    TorrentInfo current;
+    current.state = TorrentInfo::downloading;
+    current.downloadedPieces = toPieceBitmap("0110");
+
+    TorrentStatus status;
+    status.setInfoChanges(TorrentInfo(), current);
+
+    // Size changed: the bitfield is sent entirely
+    QVERIFY(status.infoFields.testFlag(TorrentInfo::PiecesField));
+    QVERIFY(status.downloadedPieceIndexes.isEmpty());
+
+    TorrentInfo actual;
+    status.applyInfoChanges(actual);
+    QCOMPARE(actual, current);
+}
+
+void tst_TorrentMessage::infoChanges_newPieces()
+{
+    const QString bits(100, '0');
+    TorrentInfo previous;
+    previous.downloadedPieces = toPieceBitmap(bits);
+    previous.verifiedPieces = toPieceBitmap(bits);
+
+    TorrentInfo current = previous;
+    current.downloadedPieces.setBit(3);
+    current.downloadedPieces.setBit(57);
+    current.downloadedPiecesCount = 2;
+
+    TorrentStatus status;
+    status.setInfoChanges(previous, current);
+
+    QCOMPARE(status.infoFields, TorrentInfo::Fields(TorrentInfo::StatsField));
+    QCOMPARE(status.downloadedPieceIndexes, QList<int>({3, 57}));
+    QVERIFY(status.verifiedPieceIndexes.isEmpty());
+    QVERIFY(status.info.downloadedPieces.isEmpty());
+
+    TorrentInfo actual = previous;
+    status.applyInfoChanges(actual);
+    QCOMPARE(actual, current);
+}
+
+void tst_TorrentMessage::infoChanges_lostPieces()
+{
+    TorrentInfo previous;
+    previous.downloadedPieces = toPieceBitmap("1111000011110000111100001111000011110000");
+
+    TorrentInfo current;
+    current.downloadedPieces = toPieceBitmap("0111000011110000111100001111000011110000");
+
+    TorrentStatus status;
+    status.setInfoChanges(previous, current);
+
+    // A piece was lost (recheck): the bitfield is sent entirely
+    QVERIFY(status.infoFields.testFlag(TorrentInfo::PiecesField));
+    QVERIFY(status.downloadedPieceIndexes.isEmpty());
+
+    TorrentInfo actual = previous;
+    status.applyInfoChanges(actual);
+    QCOMPARE(actual, current);
+}
+
+void tst_TorrentMessage::infoChanges_manyPieces()
+{
+    TorrentInfo previous;
+    previous.downloadedPieces = toPieceBitmap(QString(64, '0'));
+
+    TorrentInfo current;
+    current.downloadedPieces = toPieceBitmap(QString(64, '1'));
+
+    TorrentStatus status;
+    status.setInfoChanges(previous, current);
+
+    // The indexes would be larger than the bitfield
+    QVERIFY(status.infoFields.testFlag(TorrentInfo::PiecesField));
+    QVERIFY(status.downloadedPieceIndexes.isEmpty());
+
+    TorrentInfo actual = previous;
+    status.applyInfoChanges(actual);
+    QCOMPARE(actual, current);
+}
+
+/******************************************************************************
+ ******************************************************************************/
+void tst_TorrentMessage::detailChanges()
+{
+    TorrentHandleInfo previous;
+    previous.maxUploads = 4;
+    previous.trackers.append(TorrentTrackerInfo());
+
+    TorrentHandleInfo current = previous;
+    current.peers.append(TorrentPeerInfo(EndPoint("127.0.0.1", 6881), "client"));
+
+    TorrentStatus status;
+    status.setDetailChanges(previous, current);
+
+    QCOMPARE(status.detailFields, TorrentHandleInfo::Fields(TorrentHandleInfo::PeersField));
+    QVERIFY(status.detail.trackers.isEmpty());
+
+    TorrentHandleInfo actual = previous;
+    status.applyDetailChanges(actual);
+    QCOMPARE(actual, current);
+}
+
+/******************************************************************************
+ ******************************************************************************/
+QTEST_APPLESS_MAIN(tst_TorrentMessage)
+
+#include "tst_torrentmessage.moc"
@@ -0,0 +1,422 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "../../utils/fakedownloadmanager.h"
+
+#include <Core/IDownloadItem>
+#include <Ipc/ControlServer>
+
+#include <Constants>
+
+#include <QtCore/QDebug>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtNetwork/QLocalSocket>
+
+#include <QtTest/QSignalSpy>
+#include <QtTest/QtTest>
+
+Q_DECLARE_OPAQUE_POINTER(IDownloadItem*)
+Q_DECLARE_METATYPE(DownloadRange)
+
+class tst_ControlServer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void stateToString();
+
+    void add();
+    void pauseResume();
+    void remove();
+    void query();
+    void stats();
+    void batch();
+    void errors_data();
+    void errors();
+
+    void socket();
+    void socketRequestTooLarge();
+    void socketSlowSubscriber();
+
+private:
+    static QJsonObject call(ControlServer *target, const QString &method, const QJsonObject &params = {});
+};
+
+void tst_ControlServer::initTestCase()
+{
+    qRegisterMetaType<IDownloadItem*>("IDownloadItem*");
+    qRegisterMetaType<DownloadRange>("DownloadRange");
+    qRegisterMetaType<QSet<IDownloadItem*>>("QSet<IDownloadItem*>");
+}
+
+QJsonObject tst_ControlServer::call(ControlServer *target, const QString &method, const QJsonObject &params)
+{
+    QJsonObject request{
+        { "jsonrpc", "2.0" },
+        { "method", method },
+        { "params", params },
+        { "id", 1 }
+    };
+    auto reply = target->handleMessage(QJsonDocument(request).toJson(QJsonDocument::Compact));
+    return QJsonDocument::fromJson(reply).object();
+}
+
+/******************************************************************************
+ ******************************************************************************/
+void tst_ControlServer::stateToString()
+{
+    for (int i = IDownloadItem::Idle; i <= IDownloadItem::FileError; ++i) {
+        auto state = static_cast<IDownloadItem::State>(i);
+        auto str = ControlServer::stateToString(state);
+        QVERIFY(!str.isEmpty());
+
+        IDownloadItem::State actual;
+        QVERIFY(ControlServer::stateFromString(str, &actual));
+        QCOMPARE(actual, state);
+    }
+    IDownloadItem::State actual;
+    QVERIFY(!ControlServer::stateFromString("unknown", &actual));
+}
+
+/******************************************************************************
+ ******************************************************************************/
+void tst_ControlServer::add()
+{
+    // Given
+    FakeDownloadManager engine;
+    ControlServer target(&engine);
+    QSignalSpy spyJobAppended(&engine, SIGNAL(jobAppended(DownloadRange)));
+
+    // When
+    auto reply = call(&target, "add", {
+                          { "urls", QJsonArray{ "https://www.example.com/a.zip", "", "https://www.example.com/b.zip" } },
+                          { "paused", true }
+                      });
+
+    // Then
+    QCOMPARE(reply.value("id").toInt(), 1);
+    QVERIFY(!reply.contains("error"));
+    auto ids = reply.value("result").toObject().value("ids").toArray();
+    QCOMPARE(ids.count(), 3);
+    QVERIFY(ids.at(0).toInteger() > 0);
+    QVERIFY(ids.at(1).isNull());
+    QVERIFY(ids.at(2).toInteger() > 0);
+    QVERIFY(ids.at(0).toInteger() != ids.at(2).toInteger());
+
+    /* One append for the whole batch */
+    QCOMPARE(spyJobAppended.count(), 1);
+    QCOMPARE(engine.count(), qsizetype(2));
+    QCOMPARE(engine.pausedJobCount(), qsizetype(2));
+}
+
+void tst_ControlServer::pauseResume()
+{
+    // Given
+    FakeDownloadManager engine;
+    ControlServer target(&engine);
+    auto ids = call(&target, "add", {
+                        { "urls", QJsonArray{ "https://www.example.com/a.zip", "https://www.example.com/b.zip" } },
+                        { "paused", true }
+                    }).value("result").toObject().value("ids").toArray();
+
+    // When
+    auto reply = call(&target, "resume", { { "ids", QJsonArray{ ids.at(0) } } });
+
+    // Then
+    QCOMPARE(reply.value("result").toObject().value("count").toInt(), 1);
+    QCOMPARE(engine.pausedJobCount(), qsizetype(1));
+
+    // When
+    reply = call(&target, "pause"); /* all */
+
+    // Then
+    QCOMPARE(reply.value("result").toObject().value("count").toInt(), 2);
+    QCOMPARE(engine.pausedJobCount(), qsizetype(2));
+}
+
+void tst_ControlServer::remove()
+{
+    // Given
+    FakeDownloadManager engine;
+    ControlServer target(&engine);
+    auto ids = call(&target, "add", {
+                        { "urls", QJsonArray{ "https://www.example.com/a.zip", "https://www.example.com/b.zip" } },
+                        { "paused", true }
+                    }).value("result").toObject().value("ids").toArray();
+
+    // When
+    auto reply = call(&target, "remove"); /* "ids" is required */
+
+    // Then
+    QCOMPARE(reply.value("error").toObject().value("code").toInt(), int(ControlServer::InvalidParams));
+    QCOMPARE(engine.count(), qsizetype(2));
+
+    // When
+    reply = call(&target, "remove", { { "ids", QJsonArray{ ids.at(1), 999 } } });
+
+    // Then
+    QCOMPARE(reply.value("result").toObject().value("count").toInt(), 1);
+    QCOMPARE(engine.count(), qsizetype(1));
+
+    /* The id of a removed item is unknown */
+    reply = call(&target, "query", { { "ids", QJsonArray{ ids.at(1) } } });
+    QCOMPARE(reply.value("result").toObject().value("total").toInt(), 0);
+}
+
+void tst_ControlServer::query()
+{
+    // Given
+    FakeDownloadManager engine;
+    ControlServer target(&engine);
+    QJsonArray urls;
+    for (int i = 0; i < 10; ++i) {
+        urls.append(QString("https://www.example.com/%0.zip").arg(i));
+    }
+    auto ids = call(&target, "add", {
+                        { "urls", urls },
+                        { "paused", true }
+                    }).value("result").toObject().value("ids").toArray();
+
+    // When
+    auto result = call(&target, "query", {
+                           { "states", QJsonArray{ "paused" } },
+                           { "offset", 2 },
+                           { "limit", 3 }
+                       }).value("result").toObject();
+
+    // Then
+    QCOMPARE(result.value("total").toInt(), 10);
+    auto items = result.value("items").toArray();
+    QCOMPARE(items.count(), 3);
+    auto item = items.at(0).toObject();
+    QCOMPARE(item.value("id"), ids.at(2));
+    QCOMPARE(item.value("url").toString(), QString("https://www.example.com/2.zip"));
+    QCOMPARE(item.value("state").toString(), QString("paused"));
+
+    // When
+    result = call(&target, "query", { { "states", QJsonArray{ "completed" } } }).value("result").toObject();
+
+    // Then
+    QCOMPARE(result.value("total").toInt(), 0);
+    QVERIFY(result.value("items").toArray().isEmpty());
+}
+
+void tst_ControlServer::stats()
+{
+    // Given
+    FakeDownloadManager engine;
+    ControlServer target(&engine);
+    call(&target, "add", {
+             { "urls", QJsonArray{ "https://www.example.com/a.zip", "https://www.example.com/b.zip" } },
+             { "paused", true }
+         });
+
+    // When
+    auto result = call(&target, "stats").value("result").toObject();
+
+    // Then
+    QCOMPARE(result.value("count").toInt(), 2);
+    QCOMPARE(result.value("paused").toInt(), 2);
+    QCOMPARE(result.value("running").toInt(), 0);
+    QVERIFY(result.contains("speed"));
+}
+
+/******************************************************************************
+ ******************************************************************************/
+void tst_ControlServer::batch()
+{
+    // Given
+    FakeDownloadManager engine;
+    ControlServer target(&engine);
+    QByteArray message =
+            "["
+            R"({"jsonrpc": "2.0", "method": "stats", "id": 1},)"
+            R"({"jsonrpc": "2.0", "method": "pause"},)" /* notification: no response */
+            R"({"jsonrpc": "2.0", "method": "unknown", "id": 2})"
+            "]";
+
+    // When
+    auto replies = QJsonDocument::fromJson(target.handleMessage(message)).array();
+
+    // Then
+    QCOMPARE(replies.count(), 2);
+    QCOMPARE(replies.at(0).toObject().value("id").toInt(), 1);
+    QVERIFY(replies.at(0).toObject().contains("result"));
+    QCOMPARE(replies.at(1).toObject().value("id").toInt(), 2);
+    QCOMPARE(replies.at(1).toObject().value("error").toObject().value("code").toInt(),
+             int(ControlServer::MethodNotFound));
+
+    /* Only notifications */
+    QVERIFY(target.handleMessage(R"({"jsonrpc": "2.0", "method": "pause"})").isEmpty());
+}
+
+void tst_ControlServer::errors_data()
+{
+    QTest::addColumn<QByteArray>("message");
+    QTest::addColumn<int>("code");
+
+    QTest::newRow("parse error") << QByteArray(R"({"jsonrpc": "2.0", "method")") << int(ControlServer::ParseError);
+    QTest::newRow("empty batch") << QByteArray("[]") << int(ControlServer::InvalidRequest);
+    QTest::newRow("no version") << QByteArray(R"({"method": "stats", "id": 1})") << int(ControlServer::InvalidRequest);
+    QTest::newRow("no method") << QByteArray(R"({"jsonrpc": "2.0", "id": 1})") << int(ControlServer::InvalidRequest);
+    QTest::newRow("bad params") << QByteArray(R"({"jsonrpc": "2.0", "method": "add", "params": [], "id": 1})") << int(ControlServer::InvalidParams);
+    QTest::newRow("no urls") << QByteArray(R"({"jsonrpc": "2.0", "method": "add", "params": {}, "id": 1})") << int(ControlServer::InvalidParams);
+    QTest::newRow("bad state") << QByteArray(R"({"jsonrpc": "2.0", "method": "query", "params": {"states": ["foo"]}, "id": 1})") << int(ControlServer::InvalidParams);
+}
+
+void tst_ControlServer::errors()
+{
+    QFETCH(QByteArray, message);
+    QFETCH(int, code);
+
+    // Given
+    FakeDownloadManager engine;
+    ControlServer target(&engine);
+
+    // When
+    auto reply = QJsonDocument::fromJson(target.handleMessage(message)).object();
+
+    // Then
+    QVERIFY(!reply.contains("result"));
+    QCOMPARE(reply.value("error").toObject().value("code").toInt(), code);
+}
+
+/******************************************************************************
+ ******************************************************************************/
+void tst_ControlServer::socket()
+{
+    // Given
+    FakeDownloadManager engine;
+    ControlServer target(&engine);
+    const QString name = QString("tst_controlserver_%0").arg(QCoreApplication::applicationPid());
+    QVERIFY2(target.listen(name), qPrintable(target.errorString()));
+
+    QLocalSocket client;
+    client.connectToServer(name);
+    QVERIFY(client.waitForConnected(5000));
+
+    // When
+    client.write(R"({"jsonrpc": "2.0", "method": "subscribe", "id": 1})" "\n");
+    client.write(R"({"jsonrpc": "2.0", "method": "add", "params": {"urls": ["https://www.example.com/a.zip"], "paused": true}, "id": 2})" "\n");
+
+    QList<QJsonObject> messages;
+    while (messages.count() < 3) {
+        if (!client.canReadLine()) {
+            QSignalSpy spyReadyRead(&client, &QLocalSocket::readyRead);
+            QVERIFY(spyReadyRead.wait(5000));
+        }
+        while (client.canReadLine()) {
+            messages.append(QJsonDocument::fromJson(client.readLine()).object());
+        }
+    }
+
+    // Then
+    QCOMPARE(messages.at(0).value("id").toInt(), 1);
+    QCOMPARE(messages.at(0).value("result").toBool(), true);
+
+    /* The event is sent during the request */
+    QCOMPARE(messages.at(1).value("method").toString(), QString("added"));
+    auto added = messages.at(1).value("params").toObject().value("items").toArray();
+    QCOMPARE(added.count(), 1);
+
+    QCOMPARE(messages.at(2).value("id").toInt(), 2);
+    auto ids = messages.at(2).value("result").toObject().value("ids").toArray();
+    QCOMPARE(added.at(0).toObject().value("id"), ids.at(0));
+
+    target.close();
+}
+
+void tst_ControlServer::socketRequestTooLarge()
+{
+    // Given
+    FakeDownloadManager engine;
+    ControlServer target(&engine);
+    const QString name = QString("tst_controlserver_large_%0").arg(QCoreApplication::applicationPid());
+    QVERIFY2(target.listen(name), qPrintable(target.errorString()));
+
+    QLocalSocket client;
+    client.connectToServer(name);
+    QVERIFY(client.waitForConnected(5000));
+
+    /* A valid request, padded over the limit: its end must not be read as a request */
+    QByteArray request = R"({"jsonrpc": "2.0", "method": "stats", "id": 1})";
+    request.append(QByteArray(MAX_CONTROL_MESSAGE_SIZE, ' '));
+    request.append(R"({"jsonrpc": "2.0", "method": "stats", "id": 2})" "\n");
+
+    // When
+    client.write(request);
+
+    // Then
+    QTRY_COMPARE_WITH_TIMEOUT(client.state(), QLocalSocket::UnconnectedState, 10000);
+    QVERIFY(!client.canReadLine());
+
+    target.close();
+}
+
+void tst_ControlServer::socketSlowSubscriber()
+{
+    // Given
+    FakeDownloadManager engine;
+    ControlServer target(&engine);
+    const QString name = QString("tst_controlserver_slow_%0").arg(QCoreApplication::applicationPid());
+    QVERIFY2(target.listen(name), qPrintable(target.errorString()));
+
+    QLocalSocket client;
+    client.connectToServer(name);
+    QVERIFY(client.waitForConnected(5000));
+    client.write(R"({"jsonrpc": "2.0", "method": "subscribe", "id": 1})" "\n");
+    QSignalSpy spyReadyRead(&client, &QLocalSocket::readyRead);
+    QVERIFY(spyReadyRead.wait(5000));
+
+    /* The client stops reading: the events pile up on the server side */
+    client.setReadBufferSize(1024);
+
+    QJsonArray urls;
+    const QString path(1000, 'a');
+    for (int i = 0; i < 1000; ++i) {
+        urls.append(QString("https://www.example.com/%0/%1.zip").arg(path).arg(i));
+    }
+
+    // When
+    for (int i = 0; i < 100 && client.state() == QLocalSocket::ConnectedState; ++i) {
+        call(&target, "add", { { "urls", urls }, { "paused", true } });
+        QCoreApplication::processEvents();
+    }
+
+    // Then
+    QTRY_COMPARE_WITH_TIMEOUT(client.state(), QLocalSocket::UnconnectedState, 10000);
+
+    /* The server still works */
+    auto reply = call(&target, "stats");
+    QVERIFY(reply.contains("result"));
+
+    target.close();
+}
+
+/******************************************************************************
+ ******************************************************************************/
+/*
+ * QSignalSpy::wait() requires QTEST_MAIN instead of QTEST_APPLESS_MAIN,
+ * otherwise we get QEventLoop: Cannot be used without QApplication
+ */
+QTEST_MAIN(tst_ControlServer)
+
+#include "tst_controlserver.moc"
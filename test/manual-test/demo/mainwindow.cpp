@@ -52,7 +52,7 @@ MainWindow::MainWindow(QWidget *parent): QMainWindow(parent)
     /* The SceneManager centralizes the changes. */
     QObject::connect(m_downloadManager, SIGNAL(jobAppended(DownloadRange)), this, SLOT(onJobAddedOrRemoved(DownloadRange)));
     QObject::connect(m_downloadManager, SIGNAL(jobRemoved(DownloadRange)), this, SLOT(onJobAddedOrRemoved(DownloadRange)));
-    QObject::connect(m_downloadManager, SIGNAL(jobStateChanged(IDownloadItem*)), this, SLOT(onJobStateChanged(IDownloadItem*)));
+    QObject::connect(m_downloadManager, SIGNAL(jobsChanged(QSet<IDownloadItem*>)), this, SLOT(onJobsChanged(QSet<IDownloadItem*>)));
     QObject::connect(m_downloadManager, SIGNAL(selectionChanged()), this, SLOT(onSelectionChanged()));
 
     /* Connect the rest of the GUI widgets together (selection, focus, etc.) */
@@ -372,7 +372,7 @@ void MainWindow::onJobAddedOrRemoved(DownloadRange /*range*/)
     refreshTitleAndStatus();
 }
 
-void MainWindow::onJobStateChanged(IDownloadItem * /*downloadItem*/)
+void MainWindow::onJobsChanged(QSet<IDownloadItem*> /*items*/)
 {
     refreshMenus();
     refreshTitleAndStatus();
@@ -390,9 +390,9 @@ void MainWindow::refreshTitleAndStatus()
             ? QString("~%0").arg(Format::currentSpeedToString(speed))
             : QString();
 
-    auto completedCount = m_downloadManager->completedJobs().count();
-    // auto runningCount = m_downloadManager->runningJobs().count();
-    auto failedCount = m_downloadManager->failedJobs().count();
+    auto completedCount = m_downloadManager->completedJobCount();
+    // auto runningCount = m_downloadManager->runningJobCount();
+    auto failedCount = m_downloadManager->failedJobCount();
     auto count = m_downloadManager->count();
     auto doneCount = completedCount + failedCount;
 
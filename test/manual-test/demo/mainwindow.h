@@ -19,6 +19,7 @@
 
 #include <Core/IDownloadItem>
 
+#include <QtCore/QSet>
 #include <QtWidgets/QMainWindow>
 
 class FakeDownloadManager;
@@ -82,7 +83,7 @@ public slots:
 
 private slots:
     void onJobAddedOrRemoved(DownloadRange downloadItem);
-    void onJobStateChanged(IDownloadItem *downloadItem);
+    void onJobsChanged(QSet<IDownloadItem*> items);
     void onSelectionChanged();
 
 private:
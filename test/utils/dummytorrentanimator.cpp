@@ -96,7 +96,7 @@ void DummyTorrentAnimator::setProgress(int percent)
     qsizetype bytesReceived = 0;
 
     // First, create a random piece map
-    info.downloadedPieces = createRandomBitArray(static_cast<int>(pieceCount), percent);
+    info.downloadedPieces = createRandomPieceBitmap(static_cast<int>(pieceCount), percent);
 
     TorrentHandleInfo detail = m_torrent->detail();
     qsizetype total = metaInfo.initialMetaInfo.files.count();
@@ -145,15 +145,15 @@ void DummyTorrentAnimator::setProgress(int percent)
 
 /******************************************************************************
  ******************************************************************************/
-QBitArray DummyTorrentAnimator::createRandomBitArray(int size, int percent)
+PieceBitmap DummyTorrentAnimator::createRandomPieceBitmap(int size, int percent)
 {
     if (percent <= 0) {
-        return QBitArray(size, false);
+        return PieceBitmap(size, false);
     }
     if (percent >= 100) {
-        return QBitArray(size, true);
+        return PieceBitmap(size, true);
     }
-    QBitArray ba = QBitArray(size, false);
+    PieceBitmap ba = PieceBitmap(size, false);
     if (percent == 50) {
         for (auto i = 0; i < size; i+=2) {
             ba.setBit(i);
@@ -293,7 +293,7 @@ void DummyTorrentAnimator::animatePeers()
 
 /******************************************************************************
  ******************************************************************************/
-void DummyTorrentAnimator::setPiecesRandomly(QBitArray &pieces)
+void DummyTorrentAnimator::setPiecesRandomly(PieceBitmap &pieces)
 {
     auto count = pieces.count();
     if (pieces.count(true) >  count - 10) {
@@ -17,6 +17,8 @@
 #ifndef UTILS_TORRENT_ANIMATOR_H
 #define UTILS_TORRENT_ANIMATOR_H
 
+#include <Core/PieceBitmap>
+
 #include <QtCore/QObject>
 #include <QtCore/QTimer>
 
@@ -60,8 +62,8 @@ private:
     void animatePieces();
     void animatePeers();
 
-    void setPiecesRandomly(QBitArray &pieces);
-    QBitArray createRandomBitArray(int size, int percent);
+    void setPiecesRandomly(PieceBitmap &pieces);
+    PieceBitmap createRandomPieceBitmap(int size, int percent);
 };
 
 #endif // UTILS_TORRENT_ANIMATOR_H
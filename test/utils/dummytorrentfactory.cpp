@@ -107,8 +107,8 @@ TorrentPtr TorrentSkeleton::toTorrent(QObject *parent)
     info.error = TorrentError(TorrentError::NoError);
     info.state = TorrentInfo::stopped;
 
-    info.downloadedPieces = QBitArray(total_pieces_count, false);
-    info.verifiedPieces = QBitArray(total_pieces_count, false);
+    info.downloadedPieces = PieceBitmap(total_pieces_count, false);
+    info.verifiedPieces = PieceBitmap(total_pieces_count, false);
 
     info.bytesReceived = 0;
     info.bytesTotal = static_cast<qint64>(total_size_in_KB * kilobytes);
@@ -217,9 +217,9 @@ TorrentPtr DummyTorrentFactory::createDummyTorrent(QObject *parent)
 
 /******************************************************************************
  ******************************************************************************/
-static QBitArray toAvailablePieces(qsizetype size, const QString &pieceSketch)
+static PieceBitmap toAvailablePieces(qsizetype size, const QString &pieceSketch)
 {
-    auto ba = QBitArray(size, false);
+    auto ba = PieceBitmap(size, false);
     auto count = pieceSketch.count();
     auto sectionSize = static_cast<qsizetype>(qreal(size) / count);
     for (auto i = 0; i < count; ++i) {
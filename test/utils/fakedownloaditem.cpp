@@ -91,9 +91,7 @@ void FakeDownloadItem::resume()
 
 void FakeDownloadItem::pause()
 {
-    // TO DO
-    // https://kunalmaemo.blogspot.com/2011/07/simple-download-manager-with-pause.html
-
+    m_fakeStreamTimer.stop();
     AbstractDownloadItem::pause();
 }
 
@@ -0,0 +1,160 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fakehttpserver.h"
+
+#include <QtNetwork/QHostAddress>
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
+
+
+FakeHttpServer::FakeHttpServer(const QByteArray &content, QObject *parent) : QObject(parent)
+  , m_server(new QTcpServer(this))
+  , m_content(content)
+{
+    connect(m_server, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+}
+
+FakeHttpServer::~FakeHttpServer()
+{
+}
+
+bool FakeHttpServer::listen()
+{
+    return m_server->listen(QHostAddress::LocalHost);
+}
+
+QUrl FakeHttpServer::url(const QString &fileName) const
+{
+    return QUrl(QString("http://127.0.0.1:%0/%1").arg(QString::number(m_server->serverPort()), fileName));
+}
+
+QStringList FakeHttpServer::requestedRanges() const
+{
+    return m_requestedRanges;
+}
+
+void FakeHttpServer::setEntityTag(const QByteArray &entityTag)
+{
+    m_entityTag = entityTag;
+}
+
+void FakeHttpServer::setStalledRange(qsizetype begin)
+{
+    m_stalledBegin = begin;
+}
+
+/******************************************************************************
+ ******************************************************************************/
+void FakeHttpServer::onNewConnection()
+{
+    while (auto socket = m_server->nextPendingConnection()) {
+        m_buffers.insert(socket, {});
+        connect(socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+        connect(socket, SIGNAL(disconnected()), this, SLOT(onDisconnected()));
+    }
+}
+
+void FakeHttpServer::onReadyRead()
+{
+    auto socket = qobject_cast<QTcpSocket*>(sender());
+    if (!socket) {
+        return;
+    }
+    auto &buffer = m_buffers[socket];
+    buffer += socket->readAll();
+
+    /* The connection is kept alive: it can carry several requests */
+    qsizetype index;
+    while ((index = buffer.indexOf("\r\n\r\n")) >= 0) {
+        auto header = QString::fromLatin1(buffer.left(index));
+        buffer.remove(0, index + 4);
+
+        QString range;
+        QString ifRange;
+        const auto lines = header.split("\r\n");
+        for (const auto &line : lines) {
+            if (line.startsWith("Range:", Qt::CaseInsensitive)) {
+                range = line.mid(6).trimmed();
+            } else if (line.startsWith("If-Range:", Qt::CaseInsensitive)) {
+                ifRange = line.mid(9).trimmed();
+            }
+        }
+        m_requestedRanges.append(range);
+        reply(socket, range, ifRange);
+    }
+}
+
+void FakeHttpServer::onDisconnected()
+{
+    auto socket = qobject_cast<QTcpSocket*>(sender());
+    if (socket) {
+        m_buffers.remove(socket);
+        socket->deleteLater();
+    }
+}
+
+void FakeHttpServer::reply(QTcpSocket *socket, const QString &range, const QString &ifRange)
+{
+    auto size = m_content.size();
+    QString entityTag;
+    if (!m_entityTag.isEmpty()) {
+        entityTag = QString("ETag: %0\r\n").arg(QString::fromLatin1(m_entityTag));
+    }
+
+    /* The content changed since the range was computed: send the whole content */
+    auto isChanged = !ifRange.isEmpty() && ifRange.toLatin1() != m_entityTag;
+    if (range.isEmpty() || isChanged) {
+        socket->write(QString("HTTP/1.1 200 OK\r\n"
+                              "Content-Type: application/octet-stream\r\n"
+                              "Content-Length: %0\r\n"
+                              "Accept-Ranges: bytes\r\n"
+                              "%1"
+                              "\r\n").arg(QString::number(size), entityTag).toLatin1());
+        socket->write(m_content);
+        return;
+    }
+
+    /* Format: "bytes=<begin>-" or "bytes=<begin>-<end>" */
+    auto bounds = range.mid(QString("bytes=").size()).split('-');
+    auto begin = bounds.value(0).toLongLong();
+    auto end = bounds.value(1).isEmpty() ? size - 1 : qMin(bounds.value(1).toLongLong(), size - 1);
+    if (begin >= size || end < begin) {
+        socket->write(QString("HTTP/1.1 416 Range Not Satisfiable\r\n"
+                              "Content-Range: bytes */%0\r\n"
+                              "Content-Length: 0\r\n"
+                              "\r\n").arg(QString::number(size)).toLatin1());
+        return;
+    }
+    auto length = end + 1 - begin;
+    socket->write(QString("HTTP/1.1 206 Partial Content\r\n"
+                          "Content-Type: application/octet-stream\r\n"
+                          "Content-Range: bytes %0-%1/%2\r\n"
+                          "Content-Length: %3\r\n"
+                          "Accept-Ranges: bytes\r\n"
+                          "%4"
+                          "\r\n").arg(QString::number(begin),
+                                      QString::number(end),
+                                      QString::number(size),
+                                      QString::number(length),
+                                      entityTag).toLatin1());
+    if (begin == m_stalledBegin) {
+        /* Never send the data: the connection looks alive, but is stuck */
+        m_stalledBegin = -1;
+        return;
+    }
+    socket->write(m_content.mid(begin, length));
+}
@@ -0,0 +1,69 @@
+/* - ArrowDL - Copyright (C) 2019-present Sebastien Vavassori
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FAKE_HTTP_SERVER_H
+#define FAKE_HTTP_SERVER_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QObject>
+#include <QtCore/QStringList>
+#include <QtCore/QUrl>
+
+class QTcpServer;
+class QTcpSocket;
+
+/*!
+ * \brief Minimal HTTP/1.1 server on the local host, that serves one content
+ * to any GET request, with support of the 'Range' header.
+ */
+class FakeHttpServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FakeHttpServer(const QByteArray &content, QObject *parent = nullptr);
+    ~FakeHttpServer() override;
+
+    bool listen();
+    QUrl url(const QString &fileName) const;
+
+    /* Values of the 'Range' headers received, empty if none */
+    QStringList requestedRanges() const;
+
+    /* Validator of the content: a request with another 'If-Range' receives the whole content */
+    void setEntityTag(const QByteArray &entityTag);
+
+    /* The first request of a range that begins at this offset receives the headers only */
+    void setStalledRange(qsizetype begin);
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+    void onDisconnected();
+
+private:
+    QTcpServer *m_server = nullptr;
+    QByteArray m_content;
+    QByteArray m_entityTag;
+    QStringList m_requestedRanges;
+    QHash<QTcpSocket*, QByteArray> m_buffers;
+    qsizetype m_stalledBegin = -1;
+
+    void reply(QTcpSocket *socket, const QString &range, const QString &ifRange);
+};
+
+#endif // FAKE_HTTP_SERVER_H